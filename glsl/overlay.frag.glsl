@@ -5,9 +5,11 @@ in vec2 fs_UV; // Interpolated texture coordinates from the vertex shader
 out vec4 out_Color; // Output color of the fragment shader
 
 uniform sampler2D u_Texture; // Sampler for the texture
+uniform sampler2D u_PreviousTexture; // The texture before the most recent simulation step
+uniform float u_Alpha; // How far the display time is from u_PreviousTexture to u_Texture
 
 void main()
 {
-    // Sample the texture at the given coordinates and output the color
-    out_Color = texture(u_Texture, fs_UV);
+    // Sample both textures at the given coordinates and output the color blended between them
+    out_Color = mix(texture(u_PreviousTexture, fs_UV), texture(u_Texture, fs_UV), u_Alpha);
 }
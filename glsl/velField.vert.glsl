@@ -3,20 +3,30 @@
 in vec4 vs_Pos; // Vertex position
 
 uniform sampler2D u_Texture; // Sampler for the texture
+uniform sampler2D u_PreviousTexture; // The velocity before the most recent simulation step
+uniform float u_Alpha;       // How far the display time is from u_PreviousTexture to u_Texture
+uniform vec2 u_GridSize;     // Width and height of the simulation grid in cells, one arrow per cell
 
 flat out int id; // the instance ID of this arrow
 out vec4 fs_vel;
 
+// Decodes a texel into the velocity it stores: a direction mapped to [0, 1] and a length divided by 10
+vec3 decodeVelocity(vec4 texel)
+{
+    return (texel.xyz * 2.f - 1.f) * texel.a;
+}
+
 void main()
 {
     int id = gl_InstanceID;
-    vec2 pos = vec2(id % 100, id / 100);                // find the grid position of this arrow by ID
+    int width = int(u_GridSize.x);
+    vec2 pos = vec2(id % width, id / width);            // find the grid position of this arrow by ID
     mat4 trans = mat4(1);                               // initialize transform matrix as identity
-    vec4 vel = texture(u_Texture, pos * 0.01);          // velocity equals the texture pos at adjusted pos value
-    // converting angles back to [-1, 1] from [0, 1]
-    vel.x = (vel.x * 2.f) - 1;
-    vel.y = (vel.y * 2.f) - 1;
-    vel.z = (vel.z * 2.f) - 1;
+    // blending the velocities before and after the most recent step, then splitting it into direction and length again
+    vec3 blended = mix(decodeVelocity(texture(u_PreviousTexture, pos / u_GridSize)),
+                       decodeVelocity(texture(u_Texture, pos / u_GridSize)), u_Alpha);
+    float len = length(blended);
+    vec4 vel = vec4(len > 0 ? blended / len : vec3(0), len);
     fs_vel = vel;                                       // sending vel to fragment shader
     
     float angle = atan(vel.y, vel.x);                   // getting angle from velocity y and x val
@@ -37,7 +47,7 @@ void main()
 
     trans = rotZ * trans;
 
-    trans[3].xy = vec2(-0.995, -0.995) + pos * 0.02;
+    trans[3].xy = vec2(-1.0) + (pos + 0.5) * 2.0 / u_GridSize;
 
     gl_Position = trans * vs_Pos;
 }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "densitySource.h"
+#include "velocitysource.h"
+#include "keyframes.h"
+#include "glm_includes.h"
+
+/// <summary>
+/// A circular density source that moves, grows and pulses along keyframe curves.
+/// The footprint holds the covered cells with a value of 1 and is only rebuilt when the rasterized circle changes,
+/// that is when the center crosses into another cell or the radius into another whole cell. The amount is applied
+/// through the strength of the source, so pulsing touches no cells at all.
+/// </summary>
+template <typename Scalar>
+class AnimatedCircularSource : public DensitySource<Scalar> {
+private:
+    Keyframes<glm::dvec2> center;
+    Keyframes<double> radius;
+    Keyframes<double> amount;
+
+    // Time since the source was created
+    double time;
+
+    // The circle the current footprint was rasterized from
+    glm::ivec2 rasterCenter;
+    int rasterRadius;
+
+    /// <summary>
+    /// Evaluates the curves at the current time, rebuilding the footprint if its cells changed.
+    /// </summary>
+    void Update();
+
+public:
+    /// <summary>
+    /// Constructs an animated circular density source.
+    /// </summary>
+    /// <param name="N">The width of the simulated grid</param>
+    /// <param name="M">The height of the simulated grid</param>
+    /// <param name="center">The center of the circle in grid coordinates over time.</param>
+    /// <param name="radius">The radius of the circle over time.</param>
+    /// <param name="amount">The density added per unit time over the whole circle, over time.</param>
+    AnimatedCircularSource(unsigned int N, unsigned int M, const Keyframes<glm::dvec2>& center,
+        const Keyframes<double>& radius, const Keyframes<double>& amount);
+
+    void Tick(double dt) override;
+
+    bool IsStatic() const override;
+
+    std::unique_ptr<DensitySource<Scalar>> Clone() const override;
+};
+
+/// <summary>
+/// A rectangular velocity source that moves, speeds up and turns along keyframe curves.
+/// Both footprints share one rectangle of 1s, rebuilt only when the lower left corner crosses into another cell.
+/// The speed and direction are applied through the strength of the source, so turning touches no cells at all.
+/// </summary>
+template <typename Scalar>
+class AnimatedRectVelocitySource : public VelocitySource<Scalar> {
+private:
+    int width;
+    int height;
+
+    Keyframes<glm::dvec2> position;
+    Keyframes<double> speed;
+    Keyframes<double> angle;
+
+    // Time since the source was created
+    double time;
+
+    // The lower left cell the current footprint was rasterized from
+    glm::ivec2 rasterPosition;
+
+    /// <summary>
+    /// Evaluates the curves at the current time, rebuilding the footprint if its cells changed.
+    /// </summary>
+    void Update();
+
+public:
+    /// <summary>
+    /// Constructs an animated rectangular velocity source.
+    /// </summary>
+    /// <param name="N">The width of the simulated grid</param>
+    /// <param name="M">The height of the simulated grid</param>
+    /// <param name="width">The width of the rectangle, clamped between [0, N].</param>
+    /// <param name="height">The height of the rectangle, clamped between [0, M].</param>
+    /// <param name="position">The lower left corner of the rectangle over time.</param>
+    /// <param name="speed">The velocity added per unit time to every covered cell, over time.</param>
+    /// <param name="angle">The direction of the velocity in radians counterclockwise from the x-axis, over time.</param>
+    AnimatedRectVelocitySource(unsigned int N, unsigned int M, int width, int height,
+        const Keyframes<glm::dvec2>& position, const Keyframes<double>& speed, const Keyframes<double>& angle);
+
+    void Tick(double dt) override;
+
+    bool IsStatic() const override;
+
+    std::unique_ptr<VelocitySource<Scalar>> Clone() const override;
+};
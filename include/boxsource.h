@@ -0,0 +1,40 @@
+#pragma once
+
+#include "volumesource.h"
+
+/// <summary>
+/// An axis-aligned box of cells in the volume of FluidSimulator3D that receives density and velocity.
+/// </summary>
+template <typename Scalar>
+class BoxSource : public VolumeSource<Scalar> {
+private:
+    /// <summary>
+    /// The corner cell of the box with the lowest coordinates. Clamped to the inner volume.
+    /// </summary>
+    glm::ivec3 corner;
+
+    /// <summary>
+    /// The number of cells the box spans along each axis.
+    /// </summary>
+    glm::ivec3 size;
+
+public:
+    /// <summary>
+    /// Constructs a box-shaped source.
+    /// </summary>
+    /// <param name="N">The width of the simulated volume.</param>
+    /// <param name="corner">The corner cell of the box with the lowest coordinates.</param>
+    /// <param name="size">The number of cells the box spans along each axis.</param>
+    /// <param name="density">The density added per unit time to every covered cell.</param>
+    /// <param name="velocity">The velocity added per unit time to every covered cell.</param>
+    BoxSource(unsigned int N, const glm::ivec3& corner, const glm::ivec3& size, double density,
+        const glm::dvec3& velocity);
+
+    std::unique_ptr<VolumeSource<Scalar>> Clone() const override;
+
+    /// <summary>
+    /// Builds the footprint of a box, clipped to the inner volume: every covered cell gets value.
+    /// </summary>
+    static SourceFootprint<Scalar> Rasterize(unsigned int N, const glm::ivec3& corner, const glm::ivec3& size,
+        Scalar value);
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+
+// Memory layout of the fields of FluidSimulator3D.
+// A volume with an inner width of N has (N+2)^3 cells (the inner cells plus one boundary layer on each side). They
+// are stored in bricks of 8x8x8 cells: the 512 cells of a brick are contiguous, x fastest, then y, then z, and the
+// bricks follow each other in the same order. The grid is padded to a whole number of bricks along every axis;
+// the padding cells are never read or written.
+// A 7-point stencil on a row-major volume touches planes (N+2)^2 cells apart, so the cells around a point are spread
+// over pages and fall out of the cache before their neighbors come back. Within a brick all of them lie in 2 KB of
+// floats, and the stencil only leaves the brick at its faces.
+
+/// <summary>
+/// Number of cells along each edge of a brick.
+/// </summary>
+constexpr int BRICK_EDGE = 8;
+
+/// <summary>
+/// Number of cells in a brick.
+/// </summary>
+constexpr int BRICK_CELLS = BRICK_EDGE * BRICK_EDGE * BRICK_EDGE;
+
+/// <summary>
+/// Maps the cells (i, j, k) of a volume with an inner width of N, 0 <= i, j, k <= N+1, to their place in the bricks.
+/// </summary>
+class BrickLayout {
+private:
+    int N;
+    int bricksPerAxis;
+
+    // Distance in elements between a brick and the next one along y and along z
+    int brickStrideY;
+    int brickStrideZ;
+
+public:
+    explicit BrickLayout(unsigned int N = 0) :
+        N(int(N)), bricksPerAxis((int(N) + 2 + BRICK_EDGE - 1) / BRICK_EDGE),
+        brickStrideY(bricksPerAxis * BRICK_CELLS), brickStrideZ(bricksPerAxis * bricksPerAxis * BRICK_CELLS)
+    {}
+
+    /// <summary>
+    /// Returns the index of cell (i, j, k) in the storage of a field.
+    /// </summary>
+    int Index(int i, int j, int k) const
+    {
+        int brick = ((k / BRICK_EDGE) * bricksPerAxis + j / BRICK_EDGE) * bricksPerAxis + i / BRICK_EDGE;
+        return brick * BRICK_CELLS + ((k % BRICK_EDGE) * BRICK_EDGE + j % BRICK_EDGE) * BRICK_EDGE + i % BRICK_EDGE;
+    }
+
+    /// <summary>
+    /// Returns the index of the first cell of a brick, and the coordinates of that cell.
+    /// </summary>
+    int BrickOrigin(int brick, int& i, int& j, int& k) const
+    {
+        i = brick % bricksPerAxis * BRICK_EDGE;
+        j = brick / bricksPerAxis % bricksPerAxis * BRICK_EDGE;
+        k = brick / (bricksPerAxis * bricksPerAxis) * BRICK_EDGE;
+        return brick * BRICK_CELLS;
+    }
+
+    // Offsets from a cell at local coordinate l (0 <= l < BRICK_EDGE) within its brick to its neighbors along each
+    // axis. They are 1, BRICK_EDGE and BRICK_EDGE^2 inside the brick, and jump to the next brick at its faces.
+
+    int NextX(int l) const { return l < BRICK_EDGE - 1 ? 1 : BRICK_CELLS - (BRICK_EDGE - 1); }
+    int PrevX(int l) const { return l > 0 ? -1 : -(BRICK_CELLS - (BRICK_EDGE - 1)); }
+    int NextY(int l) const { return l < BRICK_EDGE - 1 ? BRICK_EDGE : brickStrideY - (BRICK_EDGE - 1) * BRICK_EDGE; }
+    int PrevY(int l) const { return l > 0 ? -BRICK_EDGE : -(brickStrideY - (BRICK_EDGE - 1) * BRICK_EDGE); }
+    int NextZ(int l) const
+    {
+        return l < BRICK_EDGE - 1 ? BRICK_EDGE * BRICK_EDGE : brickStrideZ - (BRICK_EDGE - 1) * BRICK_EDGE * BRICK_EDGE;
+    }
+    int PrevZ(int l) const
+    {
+        return l > 0 ? -BRICK_EDGE * BRICK_EDGE : -(brickStrideZ - (BRICK_EDGE - 1) * BRICK_EDGE * BRICK_EDGE);
+    }
+
+    /// <summary>
+    /// Returns the inner width N of the volume.
+    /// </summary>
+    int GetN() const { return N; }
+
+    /// <summary>
+    /// Returns the number of bricks in the volume.
+    /// </summary>
+    int GetBrickCount() const { return bricksPerAxis * bricksPerAxis * bricksPerAxis; }
+
+    /// <summary>
+    /// Returns the number of elements needed to store a field, including the boundary and the padding.
+    /// </summary>
+    size_t GetSize() const { return size_t(GetBrickCount()) * BRICK_CELLS; }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// One bit per cell of a grid with an inner width of N and an inner height of M, including the boundary cells:
+/// bit i % 64 of word i / 64 of row j is cell (i, j). Every row starts on a new word, and the bits past column N + 1
+/// are always clear, so a row can be scanned or compared 64 cells at a time without looking at its neighbors.
+/// Used for the obstacles of the simulation, where a set bit is a solid cell.
+/// </summary>
+class CellBitmask {
+public:
+    using Word = uint64_t;
+    static constexpr int WORD_BITS = 64;
+
+private:
+    int N;
+    int M;
+    int wordsPerRow;
+    std::vector<Word> words;
+    int setCount;
+
+    // Sets or clears the bits of [iBegin, iEnd) in row j, which must lie inside the grid. Returns how many changed.
+    int SetSpan(int iBegin, int iEnd, int j, bool value);
+
+public:
+    /// <summary>
+    /// Constructs a mask of a grid with an inner width of N and an inner height of M with every bit clear.
+    /// </summary>
+    CellBitmask(unsigned int N = 0, unsigned int M = 0);
+
+    /// <summary>
+    /// Returns the bit of cell (i, j), for 0 <= i <= N + 1 and 0 <= j <= M + 1.
+    /// </summary>
+    bool Get(int i, int j) const
+    {
+        return (words[size_t(j) * wordsPerRow + i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    /// <summary>
+    /// Sets the bit of cell (i, j) to value.
+    /// </summary>
+    /// <returns>Whether the bit changed.</returns>
+    bool Set(int i, int j, bool value);
+
+    /// <summary>
+    /// Clears every bit.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Returns the number of set bits.
+    /// </summary>
+    int Count() const;
+
+    /// <summary>
+    /// Returns the number of words of a row.
+    /// </summary>
+    int GetWordsPerRow() const;
+
+    /// <summary>
+    /// Returns the words of row j; cell i is bit i % 64 of word i / 64.
+    /// </summary>
+    const Word* GetRow(int j) const;
+
+    /// <summary>
+    /// Returns the bits of the 64 cells (i, j) to (i + 63, j) in bits 0 to 63, whatever the alignment of i.
+    /// Cells past the end of the row read as clear.
+    /// </summary>
+    Word GetBits(int i, int j) const;
+
+    /// <summary>
+    /// Returns whether every cell of [iBegin, iEnd) in row j is clear, testing a word at a time.
+    /// </summary>
+    bool AllClear(int iBegin, int iEnd, int j) const;
+
+    /// <summary>
+    /// Returns whether every cell of [iBegin, iEnd) in row j is set, testing a word at a time.
+    /// </summary>
+    bool AllSet(int iBegin, int iEnd, int j) const;
+
+    /// <summary>
+    /// Returns the first column in [i, iEnd) of row j whose bit equals value, or iEnd if there is none.
+    /// Skips whole words of the other value, so finding the end of a run costs one step per 64 cells.
+    /// </summary>
+    int FindNext(int i, int iEnd, int j, bool value) const;
+
+    /// <summary>
+    /// Sets the bits of the cells in [x0, x1) x [y0, y1), clipped to the grid, to value.
+    /// </summary>
+    /// <returns>The number of bits that changed.</returns>
+    int SetRect(int x0, int y0, int x1, int y1, bool value);
+
+    /// <summary>
+    /// Sets the bits of the cells whose centers lie strictly within radius of (x, y), clipped to the grid, to value.
+    /// Each row of the disc is set as one span.
+    /// </summary>
+    /// <returns>The number of bits that changed.</returns>
+    int SetCircle(double x, double y, double radius, bool value);
+
+    /// <summary>
+    /// Computes the cells [iBegin, iEnd) of row j whose centers lie strictly within radius of (x, y), without
+    /// clipping them to a grid. The span is empty (iBegin >= iEnd) when the row misses the disc.
+    /// </summary>
+    static void GetCircleSpan(double x, double y, double radius, int j, int& iBegin, int& iEnd);
+};
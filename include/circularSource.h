@@ -7,7 +7,8 @@
 /// Represents a circular density source that adds density to the simulation
 /// within a specified radius and at a specified rate.
 /// </summary>
-class CircularSource : public DensitySource {
+template <typename Scalar>
+class CircularSource : public DensitySource<Scalar> {
 private:
     /// <summary>
     /// The center of the circular source in grid coordinates.
@@ -34,14 +35,23 @@ public:
     /// Constructs a circular density source.
     /// </summary> 
     /// <param name="N">The width of the simulated grid</param>
+    /// <param name="M">The height of the simulated grid</param>
     /// <param name="y">The y-coordinate of the center of the circular source.</param>
     /// <param name="radius">The radius of the source, determining its area of influence.</param>
     /// <param name="amount">The density amount to be added per unit area within the source's radius.</param>
-    CircularSource(unsigned int N, int x, int y, double radius, double amount);
+    CircularSource(unsigned int N, unsigned int M, int x, int y, double radius, double amount);
+
+    std::unique_ptr<DensitySource<Scalar>> Clone() const override;
 
     /// <summary>
-    /// Updates the density source each physics frame.
-    /// This function modifies the source array to reflect the current state of the circular source.
+    /// Builds the footprint of a circle: every cell closer than radius to the center gets densPerCell.
     /// </summary>
-    void Tick() override;
+    /// <param name="N">The width of the simulated grid</param>
+    /// <param name="M">The height of the simulated grid</param>
+    /// <param name="x">The x-coordinate of the center of the circle.</param>
+    /// <param name="y">The y-coordinate of the center of the circle.</param>
+    /// <param name="radius">The radius of the circle, truncated to whole cells.</param>
+    /// <param name="densPerCell">The value of every covered cell.</param>
+    static SourceFootprint<Scalar> Rasterize(unsigned int N, unsigned int M, int x, int y, double radius,
+        Scalar densPerCell);
 };
@@ -1,47 +1,75 @@
 #pragma once
 
+#include <memory>
 #include <vector>
-
-// Macro for accessing a 1D array with 2D-like syntax. This maps 2D indices (i, j) 
-// to a 1D index in a flattened array. The grid includes a boundary, 
-// so its actual dimensions are (N+2) x (N+2).
-#define IX(i, j) ((i) + (N + 2) * (j))
+#include "gridlayout.h"
+#include "sourcefootprint.h"
 
 /// <summary>
 /// Represents a source of density that can dynamically update over time.
 /// This class is intended to be used as a base class for specific types of density sources.
+/// The footprint is immutable once built and shared by every copy of the source, so cloning a source is cheap.
+/// Scalar is the floating point type of the simulation the source is added to (float or double).
 /// </summary>
+template <typename Scalar>
 class DensitySource {
 protected:
     /// <summary>
-    /// The width of the inner grid (non-boundary cells) excluding the boundary.
-    /// The total grid dimensions are (N+2) x (N+2) to account for boundaries.
+    /// The width and height of the inner grid (non-boundary cells) excluding the boundary.
+    /// The total grid dimensions are (N+2) x (M+2) to account for boundaries.
+    /// </summary>
+    unsigned int N;
+    unsigned int M;
+
+    /// <summary>
+    /// The cells the source covers and the amount of density added to each per unit time.
+    /// A source that changes over time replaces the footprint instead of modifying it.
     /// </summary>
-    unsigned int N;    
+    std::shared_ptr<const SourceFootprint<Scalar>> source;
 
     /// <summary>
-    /// The array representing the amount of density to be added to the simulation per unit time.
+    /// Multiplies the footprint when the source is applied, so the source can pulse without rewriting any cells.
     /// </summary>
-    std::vector<double> source;
+    double strength;
 
 public:
     /// <summary>
-    /// Initializaes the source vector to the correct size.
+    /// Initializes a source that does not cover any cells yet.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    DensitySource(unsigned int N, unsigned int M);
+
+    virtual ~DensitySource() = default;
+
+    /// <summary>
+    /// Returns a copy of the source, of the same derived type, sharing its footprint.
     /// </summary>
-    /// <param name="N"></param>
-    DensitySource(unsigned int N);
+    virtual std::unique_ptr<DensitySource<Scalar>> Clone() const;
 
     /// <summary>
-    /// Updates the source array dynamically each physics frame.
+    /// Updates the source dynamically each physics frame.
     /// This function should be overridden by derived classes to implement specific behavior.
     /// </summary>
-    virtual void Tick();
+    /// <param name="dt">The time step of the frame.</param>
+    virtual void Tick(double dt);
+
+    /// <summary>
+    /// Returns whether the footprint never changes, so the source can be merged into the compiled batch of a scene.
+    /// Derived classes whose Tick() replaces the footprint must return false.
+    /// </summary>
+    virtual bool IsStatic() const;
 
     /// <summary>
-    /// Retrieves the current source array, which contains the density values to be added to the simulation.
+    /// Retrieves the current source footprint, which contains the density values to be added to the simulation.
     /// </summary>
     /// <returns>
-    /// A constant reference to the source array containing density values.
+    /// A constant reference to the footprint of the covered cells and their density values.
     /// </returns>
-    const std::vector<double>& GetSource() const;
+    const SourceFootprint<Scalar>& GetSource() const;
+
+    /// <summary>
+    /// Returns the factor the footprint is multiplied by when the source is applied.
+    /// </summary>
+    double GetStrength() const;
 };
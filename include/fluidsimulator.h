@@ -1,135 +1,267 @@
 #pragma once
 
-// Macro for accessing a 1D array with 2D-like syntax. This maps 2D indices (i, j) 
-// to a 1D index in a flattened array. The grid includes a boundary, 
-// so its actual dimensions are (N+2) x (N+2).
-#define IX(i, j) ((i) + (N + 2) * (j))
-
 #include <vector>
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-#include "densitySource.h"
-#include "velocitysource.h"
+#include "glm_includes.h"
+#include "gridlayout.h"
+#include "obstaclemask.h"
+#include "proceduralvelocitysource.h"
+#include "sourcebatch.h"
+#include "sourceregistry.h"
+#include "tileactivity.h"
 #include "scenes/scene.h" 
+#include "threadpool.h"
+#include "kernels/stencilkernels.h"
+#include "solvers/conjugategradientsolver.h"
+#include "solvers/multigridsolver.h"
+#include "solvers/spectralpoissonsolver.h"
+#include "solvers/tilepressuresolver.h"
+#include <cstdint>
+#include <initializer_list>
 #include <map>
+#include <memory>
 #include <string>
 
-enum class BoundaryType {
-    NONE = 0,    // For scalar fields like density (no special reflection)
-    HORIZONTAL,  // For horizontal velocity (u)
-    VERTICAL     // For vertical velocity (v)
+enum class DomainBoundary {
+    WALLS = 0,   // Solid walls: velocities are reflected at the edges of the grid
+    PERIODIC     // The domain wraps around: what leaves one edge enters at the opposite one
+};
+
+enum class VelocityLayout {
+    COLLOCATED = 0, // u and v at the cell centers, with the wide central difference stencils of Stam's solver
+    STAGGERED       // A MAC grid: u on the faces between a cell and the next one along x, v along y
+};
+
+enum class PressureSolverType {
+    GAUSS_SEIDEL = 0, // A single relaxation sweep from zero, as in Stam's original solver
+    MULTIGRID,        // Multigrid preconditioned conjugate gradient until the residual reaches the pressure tolerance
+    CONJUGATE_GRADIENT // Conjugate gradient with the preconditioner selected by SetPressurePreconditioner
+};
+
+enum class RelaxationOrdering {
+    LEXICOGRAPHIC = 0, // Serial Gauss-Seidel sweeping the grid cell by cell
+    RED_BLACK          // Gauss-Seidel over a checkerboard coloring, with the rows of each color split across threads
 };
 
-static void SWAP(std::vector<double>& x0, std::vector<double>& x) {
+template <typename Scalar>
+static void SWAP(Field<Scalar>& x0, Field<Scalar>& x) {
     x0.swap(x);
 }
 
+/// <summary>
+/// Wall-clock time spent in each stage of the most recent Tick(), in milliseconds, summed over its substeps.
+/// </summary>
+struct TickTimings {
+    double velStepMs = 0.0;
+    double densStepMs = 0.0;
+    double totalMs = 0.0;
+    int diffusionSweeps = 0;  // Gauss-Seidel sweeps run by the Diffuse() calls of the tick
+    int substeps = 0;         // Steps the tick was split into to stay within the CFL number
+    double cfl = 0.0;         // Largest number of cells the fastest velocity component crossed in one substep
+};
+
+/// <summary>
+/// The GL-free simulation core. Owns the fields, sources and scenes and advances them in Tick().
+/// Rendering and input handling live in the front end (see MyGL), which only reads from this class.
+/// Scalar is the floating point type of the fields; it is instantiated for float and double.
+/// </summary>
+template <typename Scalar>
 class FluidSimulator {
 private:    
-    unsigned int N;          // The width of the inner grid (non-boundary cells) excluding the boundary.
-                             // The total grid dimensions are (N+2) x (N+2) to account for boundaries.
-
-    unsigned int elemCount;  // Total number of elements in the grid, including boundaries.
-                             // This equals (N+2) * (N+2).
+    /// <summary>
+    /// One field moved by AdvectFields: the grid receiving the advected values, the grid they are read from and the
+    /// boundary condition applied afterwards.
+    /// </summary>
+    struct AdvectedField {
+        BoundaryType b;
+        Field<Scalar>* d;
+        const Field<Scalar>* d0;
+    };
 
-    // Texture representing normalized density field as a greyscale image
-    GLuint densityTextureHandle;
+    using Run = typename ObstacleMask<Scalar>::Run;
 
-    // Texture representing the velocity field as an rgb image corresponding to xyz vals
-    GLuint velocityTextureHandle;
+    unsigned int N;          // The width of the inner grid (non-boundary cells) excluding the boundary.
+    unsigned int M;          // The height of the inner grid. The total grid dimensions are (N+2) x (M+2) to account
+                             // for boundaries. Cells are square, h = 1 / N wide, so the domain is M / N high.
 
-    // Texture representing the obstacles as a blue
-    GLuint obstacleTextureHandle;
+    unsigned int elemCount;  // Total number of elements in the grid, including boundaries.
+                             // This equals GridSize(N, M), which includes the row padding.
 
     // Horizontal velocity components of the fluid at the current time step
-    std::vector<double> u;
+    Field<Scalar> u;
 
     // Horizontal velocity components of the fluid at the previous time step
-    std::vector<double> u_prev;
+    Field<Scalar> u_prev;
 
     // Vertical velocity components of the fluid at the current time step
-    std::vector<double> v;
+    Field<Scalar> v;
 
     // Vertical velocity components of the fluid at the previous time step
-    std::vector<double> v_prev;
+    Field<Scalar> v_prev;
 
     // Density values of the fluid at the current time step
-    std::vector<double> dens;
+    Field<Scalar> dens;
 
     // Density values of the fluid at the previous time step
-    std::vector<double> dens_prev;
+    Field<Scalar> dens_prev;
 
-    // Vector storing whether grid location has an obstacle or not
-    std::vector<bool> obstacle;
+    // One bit per grid location, set where there is an obstacle
+    CellBitmask obstacle;
 
-    // Vector storing the RGBA values of the obstacle at this location
-    std::vector<glm::vec4> obstacleColor;
+    // Index into obstaclePalette of the color of the obstacle at each grid location, 0 where there is none
+    std::vector<uint8_t> obstacleColor;
 
-    // Density sources present in the current simulation 
-    std::vector<DensitySource> densSources; 
-    
-    // Velocity sources present in the current simulation
-    std::vector<VelocitySource> velSources; 
+    // The distinct RGBA colors obstacles have been painted with; entry 0 is transparent
+    std::vector<glm::vec4> obstaclePalette;
+
+    // The fluid runs and wall cells of the obstacles, rebuilt at the start of the first Tick() after they change
+    ObstacleMask<Scalar> obstacleMask;
+
+    // Density and velocity sources present in the current simulation, cloned from the active scene
+    SourceRegistry<Scalar> sources;
+
+    // The static sources of the active scene merged into one footprint per field when the scene is activated
+    SourceBatch<Scalar> staticSources;
 
     /// A map that matches the scene's name to the scenes avalible in the simulation </summary>
-    std::map<std::string, Scene> scenes;
+    std::map<std::string, Scene<Scalar>> scenes;
 
     /// The scene that is currently active. 
-    Scene* activeScene; 
+    Scene<Scalar>* activeScene; 
 
     double viscosity;
 
     double diffusion;
+
+    // Diffuse() stops relaxing once the residual falls below diffusionTolerance times the RMS of the field being
+    // diffused, or after maxDiffusionIterations sweeps
+    double diffusionTolerance;
+    int maxDiffusionIterations;
+
+    // Timings of the most recent call to Tick()
+    TickTimings lastTickTimings;
+
+    // Tick() splits its interval into substeps short enough that no velocity component crosses more than cflNumber
+    // cells in one of them, at most maxSubsteps of them. A CFL number of 0 always takes a single step.
+    double cflNumber;
+    int maxSubsteps;
+
+    // Largest magnitude of u and v over the fluid cells at the end of the most recent velocity step
+    double maxVelocity;
+
+    // The order in which the Gauss-Seidel sweeps of Diffuse and Project visit the grid cells
+    RelaxationOrdering relaxationOrdering;
+
+    // Persistent workers used by the red-black relaxation
+    std::unique_ptr<ThreadPool> threadPool;
+
+    // Row kernels for the widest instruction set supported by this CPU, chosen at construction
+    const StencilKernels<Scalar>* kernels;
+
+    // The solver Project uses for the pressure equation
+    PressureSolverType pressureSolverType;
+
+    // Preconditioner of the CONJUGATE_GRADIENT solver
+    PreconditionerType pressurePreconditioner;
+
+    // Settings of the iterative pressure solvers, kept here so they carry over when the solver is switched.
+    // A maximum of 0 keeps the default of the selected solver.
+    double pressureTolerance;
+    int maxPressureIterations;
+
+    // The iterative solver of the selected type, null for the single GAUSS_SEIDEL sweep
+    std::unique_ptr<PressureSolver<Scalar>> pressureSolver;
+
+    // Set when obstacles are added or removed, so the obstacle mask and the pressure solver are rebuilt before the
+    // next Tick()
+    bool obstaclesChanged;
+
+    // Convergence of the most recent pressure solve
+    SolveStats lastPressureStats;
+
+    // What happens at the edges of the grid
+    DomainBoundary domainBoundary;
+
+    // Where the velocity components are stored relative to the cells
+    VelocityLayout velocityLayout;
+
+    // Whether Project solves the pressure of an obstacle-free domain directly with the spectral solver
+    bool spectralPressure;
+
+    // Direct solver for obstacle-free domains, built for the current domainBoundary on first use
+    std::unique_ptr<SpectralPoissonSolver<Scalar>> spectralSolver;
+
+    // Whether the passes over the grid only visit the tiles holding smoke or motion, and the tiles around them
+    bool sparseTiles;
+
+    // Density and velocity components of at most these magnitudes count as empty when deciding which tiles stay
+    // active
+    double densityActivityThreshold;
+    double velocityActivityThreshold;
+
+    // The active tiles and their fluid runs, updated at the start and the end of every Tick() with sparseTiles on
+    TileActivity<Scalar> tileActivity;
+
+    // The pressure and divergence of Project with sparseTiles on. The pressure solvers write every cell, so these
+    // cannot share the scratch velocity fields, which must stay zero outside the active tiles.
+    Field<Scalar> sparsePressure;
+    Field<Scalar> sparseDivergence;
+
+    // Whether Project solves the pressure over the active tiles alone with sparseTiles on, closed to the still air
+    // around them, instead of over the whole grid
+    bool approximateSparsePressure;
+
+    // Solves the pressure over the active tiles with approximateSparsePressure on, in place of the spectral and
+    // iterative solvers; rebuilt for the active cells whenever the tiles are updated and some are inactive
+    std::unique_ptr<TilePressureSolver<Scalar>> tilePressureSolver;
+
+    // Set while Project visits the whole grid with sparseTiles on, so the passes it shares with the rest of a tick
+    // (LinearSolve) do too
+    bool wholeGridPasses;
+
     /// <summary>
-    /// Adds a source term to the given grid by incrementing its values.
+    /// Returns the first run of fluid cells of inner row j the passes visit: in the active tiles with sparseTiles on,
+    /// in the whole row otherwise or while wholeGridPasses is set.
+    /// </summary>
+    const Run* RunsBegin(int j) const
+    {
+        return sparseTiles && !wholeGridPasses ? tileActivity.RunsBegin(j) : obstacleMask.RunsBegin(j);
+    }
+
+    /// <summary>
+    /// Returns one past the last run of fluid cells of inner row j the passes visit.
+    /// </summary>
+    const Run* RunsEnd(int j) const
+    {
+        return sparseTiles && !wholeGridPasses ? tileActivity.RunsEnd(j) : obstacleMask.RunsEnd(j);
+    }
+
+    /// <summary>
+    /// Adds a source term to the given grid by incrementing the cells the source covers.
     /// </summary>
     /// <param name="N">The size of the grid (excluding boundaries).</param>
     /// <param name="x">The grid to which the source values will be added.</param>
-    /// <param name="s">The source grid containing the values to add.</param>
+    /// <param name="s">The footprint of the source, holding the values to add.</param>
     /// <param name="dT">The time step for scaling the source contribution.</param>
-    void AddSource(int N, std::vector<double>& x, const std::vector<double>& s, double dT);
+    void AddSource(int N, Field<Scalar>& x, const SourceFootprint<Scalar>& s, double dT);
 
     /// <summary>
-    /// Iterates through all active density sources in the simulation and updates the density grid by adding
-    /// the contributions from each source.
+    /// Adds the compiled batch of static density sources to the density grid in one pass, then the contributions
+    /// of the dynamic sources one by one.
     /// </summary>
     /// <param name="dT">The time step used to scale the contributions from each source.</param>
     void ApplyDensitySources(double dT);
 
     /// <summary>
-    /// Iterates through all active velocity sources in the simulation and updates the velocity grids by adding
-    /// the contributions from each source.
+    /// Adds the compiled batch of static velocity sources to the velocity grids in one pass per component, then the
+    /// contributions of the dynamic sources one by one. Procedural sources are evaluated row by row across the thread
+    /// pool.
     /// </summary>
     /// <param name="dT">The time step used to scale the contributions from each source.</param>
     void ApplyVelocitySources(double dT); 
     
-    /// <summary>
-    /// Adds amt density to the xy grid cell.
-    /// </summary>
-    /// <param name="x"></param>
-    /// <param name="y"></param>
-    /// <param name="amt"></param>
-    void AddDens(int x, int y, float amt);
-
-    /// <summary>
-    /// Adds amt vel to the xy grid cell;
-    /// </summary>
-    /// <param name="x"></param>
-    /// <param name="y"></param>
-    /// <param name="amtX"></param>
-    /// <param name="amtY"></param>
-    void AddVel(int x, int y, float amtX, float amtY);
-
-    /// <summary>
-    /// Toggles the obstacle at (x, y) with color color;
-    /// </summary>
-    /// <param name="x">x-coord</param>
-    /// <param name="y">y-coord</param>
-    /// <param name="color">color as RGBA</param>
-    void ToggleObs(int x, int y, bool isObs, glm::vec4 color);
-
     /// <summary>
     /// Diffuses the scalar field over the grid, spreading values according to the diffusion coefficient.
+    /// Relaxes until the residual reaches diffusionTolerance, and copies x0 without solving when the coefficient is 0.
     /// </summary>
     /// <param name="N">The size of the grid (excluding boundaries).</param>
     /// <param name="b">The type of boundary condition to apply (e.g., none, horizontal, vertical).</param>
@@ -137,7 +269,7 @@ private:
     /// <param name="x0">The grid containing the initial values before diffusion.</param>
     /// <param name="diff">The diffusion coefficient controlling the rate of diffusion.</param>
     /// <param name="dt">The time step over which diffusion occurs.</param>
-    void Diffuse(int N, BoundaryType b, std::vector<double>& x, const std::vector<double>& x0, double diff, double dt);
+    void Diffuse(int N, BoundaryType b, Field<Scalar>& x, const Field<Scalar>& x0, double diff, double dt);
 
     /// <summary>
     /// Moves scalar values (e.g., density) through the grid based on the velocity field.
@@ -149,8 +281,36 @@ private:
     /// <param name="u">The horizontal velocity field.</param>
     /// <param name="v">The vertical velocity field.</param>
     /// <param name="dt">The time step over which advection occurs.</param>
-    void Advect(int N, BoundaryType b, std::vector<double>& d, const std::vector<double>& d0, const std::vector<double>& u,
-        const std::vector<double>& v, double dt);
+    void Advect(int N, BoundaryType b, Field<Scalar>& d, const Field<Scalar>& d0, const Field<Scalar>& u,
+        const Field<Scalar>& v, double dt);
+
+    /// <summary>
+    /// Advects several fields through the same velocity field in one pass. The departure point and the bilinear
+    /// weights of each cell are computed once and used to gather every field, so moving u and v together costs
+    /// little more than moving one of them.
+    /// </summary>
+    /// <param name="N">The size of the grid (excluding boundaries).</param>
+    /// <param name="fields">The fields to advect. A destination grid must not also be a source or a velocity.</param>
+    /// <param name="u">The horizontal velocity field.</param>
+    /// <param name="v">The vertical velocity field.</param>
+    /// <param name="dt">The time step over which advection occurs.</param>
+    void AdvectFields(int N, std::initializer_list<AdvectedField> fields, const Field<Scalar>& u,
+        const Field<Scalar>& v, double dt);
+
+    /// <summary>
+    /// Advects one field of a staggered grid: the cell centers for b = NONE, the faces holding u for HORIZONTAL and
+    /// those holding v for VERTICAL. The velocity at each point is interpolated from the faces around it, and the
+    /// departure point is sampled on the grid of the field.
+    /// </summary>
+    /// <param name="N">The size of the grid (excluding boundaries).</param>
+    /// <param name="b">Which points of the cells the field lives on, and the boundary condition applied afterwards.</param>
+    /// <param name="d">The grid containing the advected values after the function completes.</param>
+    /// <param name="d0">The grid containing the initial values before advection.</param>
+    /// <param name="u">The horizontal velocity, on the faces between a cell and the next one along x.</param>
+    /// <param name="v">The vertical velocity, on the faces between a cell and the next one along y.</param>
+    /// <param name="dt">The time step over which advection occurs.</param>
+    void AdvectStaggered(int N, BoundaryType b, Field<Scalar>& d, const Field<Scalar>& d0, const Field<Scalar>& u,
+        const Field<Scalar>& v, double dt);
 
     /// <summary>
     /// Performs a full simulation step for the density field, including diffusion and advection.
@@ -162,8 +322,8 @@ private:
     /// <param name="v">The vertical velocity field.</param>
     /// <param name="diff">The diffusion coefficient controlling the rate of diffusion.</param>
     /// <param name="dt">The time step for the simulation step.</param>
-    void DensStep(int N, std::vector<double>& x, std::vector<double>& x0, const std::vector<double>& u,
-        const std::vector<double>& v, double diff, double dt);
+    void DensStep(int N, Field<Scalar>& x, Field<Scalar>& x0, const Field<Scalar>& u,
+        const Field<Scalar>& v, double diff, double dt);
 
     /// <summary>
     /// Performs a full simulation step for velocity field
@@ -175,42 +335,88 @@ private:
     /// <param name="v0">The vertical velocity field from the previous time step.</param>
     /// <param name="visc">The viscosity coefficient controlling the rate of diffusion.</param>
     /// <param name="dt">The time step for the simulation step.</param>
-    void VelStep(int N, std::vector<double>& u, std::vector<double>& v, std::vector<double>& u0, std::vector<double>& v0,
+    void VelStep(int N, Field<Scalar>& u, Field<Scalar>& v, Field<Scalar>& u0, Field<Scalar>& v0,
         double visc, double dt);
 
     /// <summary>
-    /// 
+    /// Returns the largest magnitude of u and v over the fluid cells the passes visit.
     /// </summary>
-    /// <param name="N"></param>
-    /// <param name="u"></param>
-    /// <param name="v"></param>
-    /// <param name="p"></param>
-    /// <param name="div"></param>
-    /// todo: documentation here 
-    void Project(int N, std::vector<double>& u, std::vector<double>& v, std::vector<double>& p, std::vector<double>& div);
+    double MeasureMaxVelocity() const;
 
     /// <summary>
-    /// Applies boundary conditions to a scalar field on the simulation grid.
+    /// Advances the sources, the velocity and the density by one step of dt, adding its timings to lastTickTimings.
     /// </summary>
-    /// <param name="N">The size of the inner grid (excluding boundary cells).</param>
-    /// <param name="b"> The type of boundary condition to apply </param>
-    /// <param name="x">The grid containing the scalar field to which boundary conditions are applied.</param>
-    void SetBoundaryConditions(int N, BoundaryType b, std::vector<double>& x);
+    void Step(double dt);
 
     /// <summary>
-    /// Updates the OpenGL texture with the current density field values.
+    /// Makes the velocity field (approximately) divergence free by solving for the pressure whose gradient
+    /// removes the divergence, and subtracting that gradient. Without obstacles the pressure is solved exactly by the
+    /// spectral solver (unless disabled), otherwise by the solver selected by pressureSolverType.
+    /// The iterative solvers only model solid walls, so a periodic domain with obstacles falls back to Gauss-Seidel
+    /// relaxation, which wraps through SetBoundaryConditions.
     /// </summary>
-    void UpdateDensityTexture();
+    /// <param name="N">The size of the grid (excluding boundaries).</param>
+    /// <param name="u">The horizontal velocity field, projected in place.</param>
+    /// <param name="v">The vertical velocity field, projected in place.</param>
+    /// <param name="p">Scratch grid receiving the pressure.</param>
+    /// <param name="div">Scratch grid receiving the scaled divergence.</param>
+    void Project(int N, Field<Scalar>& u, Field<Scalar>& v, Field<Scalar>& p, Field<Scalar>& div);
+
+    /// <summary>
+    /// Replaces pressureSolver with a solver of the selected type and preconditioner, set up for the current
+    /// obstacles, tolerance and iteration cap.
+    /// </summary>
+    void CreatePressureSolver();
+
+    /// <summary>
+    /// Rebuilds the obstacle mask and the couplings of the pressure solver after obstacles were added or removed,
+    /// and clears the fields inside the obstacles.
+    /// </summary>
+    void UpdateObstacles();
+
+    /// <summary>
+    /// Marks the tiles the sources of this tick add to and activates them, the tiles still holding smoke or motion,
+    /// and their neighbors.
+    /// </summary>
+    void ActivateTiles();
+
+    /// <summary>
+    /// Finds the active tiles left without smoke or motion at the end of a tick and clears them in every field, so
+    /// the next tick can skip them.
+    /// </summary>
+    void RetireIdleTiles();
+
+    /// <summary>
+    /// Returns whether the inactive tiles keep the faint motion the pressure and body forces give them: with sparse
+    /// tiles on and approximateSparsePressure off.
+    /// </summary>
+    bool HoldsStillMotion() const
+    {
+        return sparseTiles && !approximateSparsePressure;
+    }
+
+    /// <summary>
+    /// Replaces tilePressureSolver with a solver for the grid if sparse tiles and approximateSparsePressure are on,
+    /// and drops it otherwise.
+    /// </summary>
+    void CreateTilePressureSolver();
 
     /// <summary>
-    /// Updates the OpenGL texture with the current velocity field values.
+    /// Returns the palette index of color, adding it to the palette if it is new. Once all 255 entries are taken,
+    /// returns the entry closest to color.
     /// </summary>
-    void UpdateVelocityTexture();
+    uint8_t GetPaletteIndex(const glm::vec4& color);
 
     /// <summary>
-    /// Updates the OpenGL texture with the current obstacle values.
+    /// Applies boundary conditions to a scalar field on the simulation grid, at the edges of the domain and at the
+    /// walls of the obstacles. In a periodic domain every field wraps around at the edges and b only applies to the
+    /// obstacles. With a staggered layout the velocity components are held at zero on the wall faces instead of being
+    /// mirrored across the walls.
     /// </summary>
-    void UpdateObstacleTexture();
+    /// <param name="N">The size of the inner grid (excluding boundary cells).</param>
+    /// <param name="b"> The type of boundary condition to apply </param>
+    /// <param name="x">The grid containing the scalar field to which boundary conditions are applied.</param>
+    void SetBoundaryConditions(int N, BoundaryType b, Field<Scalar>& x);
 
     /// <summary>
     /// Initializes the set of availible scenes for the fluid simulator. 
@@ -222,81 +428,326 @@ private:
 
 public: 
     /// <summary>
-    /// Constructs a FluidSimulator object with a grid size of (N+2) x (N+2), 
+    /// Constructs a FluidSimulator object with a grid size of (N+2) x (M+2), 
     /// including boundary cells.
     /// </summary>
-    /// <param name="N">The width (and height) of the inner grid, excluding boundary cells. Defaults to 100.</param>
-    FluidSimulator(unsigned int N = 100, GLuint densityTextureHandle = -1, GLuint velocityTextureHandle = -1,
-        GLuint obstacleTextureHandle = -1);
+    /// <param name="N">The width of the inner grid, excluding boundary cells. Defaults to 100.</param>
+    /// <param name="M">The height of the inner grid, excluding boundary cells. 0, the default, makes the grid
+    /// square.</param>
+    FluidSimulator(unsigned int N = 100, unsigned int M = 0);
+
+    /// <summary>
+    /// Gets the width of the inner grid, excluding boundary cells.
+    /// </summary>
+    unsigned int GetN() const;
+
+    /// <summary>
+    /// Gets the height of the inner grid, excluding boundary cells.
+    /// </summary>
+    unsigned int GetM() const;
 
     /// <summary>
     /// Gets the current horizontal velocity components of the fluid.
     /// </summary>
     /// <returns>A constant reference to the vector representing the horizontal velocities (u).</returns>
-    const std::vector<double>& GetU() const;
+    const Field<Scalar>& GetU() const;
 
     /// <summary>
     /// Gets the current vertical velocity components of the fluid.
     /// </summary>
     /// <returns>A constant reference to the vector representing the vertical velocities (v).</returns>
-    const std::vector<double>& GetV() const;
+    const Field<Scalar>& GetV() const;
 
     /// <summary>
     /// Gets the current density values of the fluid.
     /// </summary>
     /// <returns>A constant reference to the vector representing the fluid densities.</returns>
-    const std::vector<double>& GetDens() const;
+    const Field<Scalar>& GetDens() const;
+
+    /// <summary>
+    /// Returns whether the grid cell (x, y) is occupied by an obstacle.
+    /// </summary>
+    bool IsObstacle(int x, int y) const;
+
+    /// <summary>
+    /// Returns the RGBA color of the obstacle at grid cell (x, y).
+    /// </summary>
+    const glm::vec4& GetObstacleColor(int x, int y) const;
+
+    /// <summary>
+    /// Returns the palette index of the obstacle color of every grid cell, 0 where there is no obstacle.
+    /// </summary>
+    const std::vector<uint8_t>& GetObstacleColorIndices() const;
+
+    /// <summary>
+    /// Returns the RGBA colors the obstacle color indices refer to.
+    /// </summary>
+    const std::vector<glm::vec4>& GetObstaclePalette() const;
+
+    /// <summary>
+    /// Returns the obstacles, a set bit per solid cell, for scanning many cells at once.
+    /// </summary>
+    const CellBitmask& GetObstacles() const;
+
+    /// <summary>
+    /// Advances the simulation by frameDt seconds. The interval is split into equal substeps when the fastest
+    /// velocity of the previous step would cross more than the CFL number of cells in one, and re-split after each
+    /// substep as the velocity changes, so calm scenes take a single step however long the frame while fast jets
+    /// stay within a few cells per step.
+    /// </summary>
+    /// <param name="frameDt">The simulated time to advance by, in seconds (default 0.016).</param>
+    void Tick(double frameDt = 0.016);
+
+    /// <summary>
+    /// Sets the most cells a velocity component may cross in one substep (default 1), and the most substeps a tick
+    /// is split into (default 8), beyond which the last substep takes the rest of the interval. A CFL number of 0
+    /// disables the substepping.
+    /// </summary>
+    void SetCflLimit(double cflNumber, int maxSubsteps);
+
+    /// <summary>
+    /// Returns the largest magnitude of u and v at the end of the most recent velocity step.
+    /// </summary>
+    double GetMaxVelocity() const;
+
+    /// <summary>
+    /// Retrieves how long each stage of the most recent Tick() took.
+    /// </summary>
+    const TickTimings& GetLastTickTimings() const;
+
+    /// <summary>
+    /// Solves x = (x0 + a * (sum of the four neighbors of x)) / c with Gauss-Seidel relaxation,
+    /// visiting the fluid cells in the order given by relaxationOrdering. Solid cells are not relaxed; they take their
+    /// wall values from SetBoundaryConditions after every sweep.
+    /// With a tolerance, every sweep also measures the RMS change of x, which times c is the RMS residual of the cells
+    /// just before they were updated, and the relaxation stops once that falls to tolerance times the RMS of x0.
+    /// </summary>
+    /// <param name="N">The size of the grid (excluding boundaries).</param>
+    /// <param name="b">The type of boundary condition to apply after every sweep.</param>
+    /// <param name="x">The grid holding the initial guess, overwritten with the solution.</param>
+    /// <param name="x0">The right hand side of the system.</param>
+    /// <param name="a">The weight of the neighboring cells.</param>
+    /// <param name="c">The normalization of each update, 1 + 4a for diffusion.</param>
+    /// <param name="iterations">The maximum number of sweeps to perform.</param>
+    /// <param name="tolerance">The relative residual at which to stop, or 0 to always run all the sweeps.</param>
+    /// <returns>The number of sweeps performed.</returns>
+    int LinearSolve(int N, BoundaryType b, Field<Scalar>& x, const Field<Scalar>& x0, double a, double c,
+        int iterations, double tolerance = 0.0);
+
+    /// <summary>
+    /// Computes the root mean square residual of x = (x0 + a * (sum of the four neighbors of x)) / c
+    /// over the inner grid, i.e. how far x is from solving the system relaxed by LinearSolve.
+    /// </summary>
+    /// <param name="N">The size of the grid (excluding boundaries).</param>
+    /// <param name="x">The current approximation of the solution.</param>
+    /// <param name="x0">The right hand side of the system.</param>
+    /// <param name="a">The weight of the neighboring cells.</param>
+    /// <param name="c">The normalization of each update.</param>
+    /// <returns>The RMS of x0 + a * (sum of neighbors) - c * x.</returns>
+    double LinearSolveResidual(int N, const Field<Scalar>& x, const Field<Scalar>& x0, double a, double c) const;
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the field being diffused, at which Diffuse stops relaxing.
+    /// 0 always runs the maximum number of sweeps.
+    /// </summary>
+    void SetDiffusionTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the maximum number of Gauss-Seidel sweeps per Diffuse (default 20).
+    /// </summary>
+    void SetMaxDiffusionIterations(int iterations);
 
     /// <summary>
-    /// The color of the obstacle we are drawing
+    /// Selects the order in which the Gauss-Seidel sweeps of Diffuse and Project visit the grid cells.
     /// </summary>
-    ImVec4 obstColor;
+    void SetRelaxationOrdering(RelaxationOrdering ordering);
 
     /// <summary>
-    /// Advances the simulation by one time step, performing all necessary updates to the fluid's state.
+    /// Returns the order in which the Gauss-Seidel sweeps visit the grid cells.
     /// </summary>
-    void Tick();
+    RelaxationOrdering GetRelaxationOrdering() const;
 
     /// <summary>
-    ///  Handles mouse events to reduce clutter in Tick()
+    /// Sets the number of threads the red-black relaxation splits its rows across.
     /// </summary>
-    void HandleMouse();
+    /// <param name="threadCount">The number of threads, including the calling thread. 0 uses one per hardware core.</param>
+    void SetThreadCount(unsigned int threadCount);
 
     /// <summary>
-    /// Retrieves the OpenGL texture handle for the density field.
+    /// Returns the number of threads the red-black relaxation splits its rows across.
     /// </summary>
-    /// <returns>The OpenGL texture handle associated with the density field.</returns>
-    GLuint GetDensityTextureHandle() const;
+    unsigned int GetThreadCount() const;
 
     /// <summary>
-    /// Set density gl handle
+    /// Selects the solver Project uses for the pressure equation. Multigrid is the default.
     /// </summary>
-    /// <param name="handle"></param> handle
-    void SetDensityTextureHandle(GLuint handle);
+    void SetPressureSolver(PressureSolverType type);
 
     /// <summary>
-    /// Retrieves the OpenGL texture handle for the velocity field.
+    /// Selects the preconditioner of the CONJUGATE_GRADIENT pressure solver. MIC(0) is the default.
     /// </summary>
-    /// <returns>The OpenGL texture handle associated with the density field.</returns>
-    GLuint GetVelocityTextureHandle() const;
+    void SetPressurePreconditioner(PreconditionerType type);
 
     /// <summary>
-    /// Set velocity gl handle
+    /// Returns the preconditioner of the CONJUGATE_GRADIENT pressure solver.
     /// </summary>
-    /// <param name="handle"></param> handle
-    void SetVelocityTextureHandle(GLuint handle);
+    PreconditionerType GetPressurePreconditioner() const;
 
     /// <summary>
-    /// Set obstacle gl handle
+    /// Returns the solver Project uses for the pressure equation.
     /// </summary>
-    /// <param name="handle"></param> handle
-    void SetObstacleTextureHandle(GLuint handle);
+    PressureSolverType GetPressureSolver() const;
 
     /// <summary>
-    /// Retrieves the OpenGL texture handle for the obstacles.
+    /// Enables or disables solving the pressure of obstacle-free domains with the spectral solver (enabled by
+    /// default). When disabled, Project always uses the solver selected by SetPressureSolver.
     /// </summary>
-    /// <returns>The OpenGL texture handle associated with the obstacles.</returns>
-    GLuint GetObstacleTextureHandle() const;
+    void SetSpectralPressure(bool enabled);
+
+    /// <summary>
+    /// Returns whether obstacle-free domains use the spectral pressure solver.
+    /// </summary>
+    bool GetSpectralPressure() const;
+
+    /// <summary>
+    /// Selects solid walls or a periodic, wrapping domain. Solid walls are the default.
+    /// </summary>
+    void SetDomainBoundary(DomainBoundary boundary);
+
+    /// <summary>
+    /// Returns whether the domain has solid walls or wraps around.
+    /// </summary>
+    DomainBoundary GetDomainBoundary() const;
+
+    /// <summary>
+    /// Selects where the velocity is stored and resets the simulation. COLLOCATED is the default.
+    /// With STAGGERED, u[IX(i, j)] is the velocity through the face between cells (i, j) and (i + 1, j) and
+    /// v[IX(i, j)] the one through the face between (i, j) and (i, j + 1). The divergence and the pressure gradient
+    /// then only span one cell, which couples neighboring pressures, so the 5-point pressure equation has no
+    /// checkerboard modes and the projection leaves no divergence beyond the solver tolerance.
+    /// </summary>
+    void SetVelocityLayout(VelocityLayout layout);
+
+    /// <summary>
+    /// Returns where the velocity is stored.
+    /// </summary>
+    VelocityLayout GetVelocityLayout() const;
+
+    /// <summary>
+    /// Enables or disables sparse tiles (disabled by default). When enabled, Diffuse and Advect only visit the tiles
+    /// of TileActivity::TILE_SIZE cells that hold density or velocity above the activity threshold, plus one tile
+    /// around them, and the rest of the grid is held at zero. Project still solves the pressure over the whole grid
+    /// and applies its gradient everywhere, then activates the tiles the gradient moved above the threshold and
+    /// clears the rest, so the result only differs from the dense one by motion below the threshold. Smoke must not
+    /// move more than a tile per tick.
+    /// </summary>
+    void SetSparseTiles(bool enabled);
+
+    /// <summary>
+    /// Returns whether the passes only visit the active tiles.
+    /// </summary>
+    bool GetSparseTiles() const;
+
+    /// <summary>
+    /// Enables or disables the approximate sparse pressure (disabled by default). When enabled with sparse tiles,
+    /// while some tiles are inactive, Project solves the pressure over the active tiles alone with a
+    /// TilePressureSolver, in place of the spectral and iterative solvers, so its cost follows the active area too.
+    /// This is a different model, not a faster way to the same result: no flux crosses into the still air around the
+    /// active tiles, so the return flow the dense solve spreads over the whole grid is lost, and the velocity differs
+    /// from the dense one by some 20% of its peak. The single GAUSS_SEIDEL sweep is unaffected.
+    /// </summary>
+    void SetApproximateSparsePressure(bool enabled);
+
+    /// <summary>
+    /// Returns whether sparse tiles solve the pressure over the active tiles alone.
+    /// </summary>
+    bool GetApproximateSparsePressure() const;
+
+    /// <summary>
+    /// Sets the magnitudes of density and of the velocity components at or below which a tile counts as empty
+    /// (defaults 1e-5 and 1e-3). The pressure spreads faint motion over the whole grid, so the velocity threshold is
+    /// what keeps the still air inactive.
+    /// </summary>
+    void SetActivityThresholds(double density, double velocity);
+
+    /// <summary>
+    /// Returns the tiles the passes visit. Every tile is active while sparse tiles are disabled.
+    /// </summary>
+    const TileActivity<Scalar>& GetTileActivity() const;
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the divergence, at which the iterative pressure solvers stop.
+    /// </summary>
+    void SetPressureTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the maximum number of cycles (or iterations) of the iterative pressure solvers per Project().
+    /// 0 restores the default of each solver: 20 multigrid cycles or 200 conjugate gradient iterations.
+    /// </summary>
+    void SetMaxPressureIterations(int iterations);
+
+    /// <summary>
+    /// Returns the convergence of the pressure solve of the most recent Project().
+    /// The residuals are only measured by the iterative and spectral solvers.
+    /// </summary>
+    const SolveStats& GetLastPressureStats() const;
+
+    /// <summary>
+    /// Limits the stencil kernels to the given instruction set. The widest one this CPU supports is used by default.
+    /// </summary>
+    /// <param name="maxLevel">The widest instruction set to use. Clamped to what the CPU supports.</param>
+    void SetMaxSimdLevel(SimdLevel maxLevel);
+
+    /// <summary>
+    /// Returns the kernels the solver is currently using.
+    /// </summary>
+    const StencilKernels<Scalar>& GetStencilKernels() const;
+
+    /// <summary>
+    /// Adds amt density to the xy grid cell.
+    /// </summary>
+    /// <param name="x"></param>
+    /// <param name="y"></param>
+    /// <param name="amt"></param>
+    void AddDens(int x, int y, float amt);
+
+    /// <summary>
+    /// Adds amt vel to the xy grid cell;
+    /// </summary>
+    /// <param name="x"></param>
+    /// <param name="y"></param>
+    /// <param name="amtX"></param>
+    /// <param name="amtY"></param>
+    void AddVel(int x, int y, float amtX, float amtY);
+
+    /// <summary>
+    /// Toggles the obstacle at (x, y) with color color;
+    /// </summary>
+    /// <param name="x">x-coord</param>
+    /// <param name="y">y-coord</param>
+    /// <param name="color">color as RGBA</param>
+    void ToggleObs(int x, int y, bool isObs, glm::vec4 color);
+
+    /// <summary>
+    /// Adds or removes obstacles over the cells [x0, x1) x [y0, y1), clipped to the grid, a word at a time.
+    /// </summary>
+    /// <param name="isObs">Whether the cells become obstacles or fluid.</param>
+    /// <param name="color">Color of the added obstacles as RGBA.</param>
+    void PaintObstacleRect(int x0, int y0, int x1, int y1, bool isObs, glm::vec4 color);
+
+    /// <summary>
+    /// Adds or removes obstacles over the cells whose centers lie strictly within radius of (x, y), one span per row.
+    /// </summary>
+    /// <param name="isObs">Whether the cells become obstacles or fluid.</param>
+    /// <param name="color">Color of the added obstacles as RGBA.</param>
+    void PaintObstacleCircle(double x, double y, double radius, bool isObs, glm::vec4 color);
+
+    /// <summary>
+    /// Removes any density and velocity held by the xy grid cell, e.g. after an obstacle is placed on it.
+    /// </summary>
+    /// <param name="x">x-coord</param>
+    /// <param name="y">y-coord</param>
+    void ClearCell(int x, int y);
 
     /// <summary>
     /// Retrieves a vector containing string literals of the scenes in the simulation. 
@@ -317,4 +768,12 @@ public:
     /// </summary>
     void Reset();
 };
-            
\ No newline at end of file
+            
+
+// The scalar type of the interactive front end. Define FLUID_SINGLE_PRECISION to build it with float fields,
+// which halves the memory and bandwidth of the solver and doubles the width of its SIMD kernels.
+#ifdef FLUID_SINGLE_PRECISION
+using SimulationScalar = float;
+#else
+using SimulationScalar = double;
+#endif
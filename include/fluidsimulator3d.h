@@ -0,0 +1,232 @@
+#pragma once
+
+#include "bricklayout.h"
+#include "glm_includes.h"
+#include "gridlayout.h"
+#include "volumesourceregistry.h"
+#include "scenes/scene3d.h"
+#include "threadpool.h"
+
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class VolumeBoundaryType {
+    NONE = 0,  // For scalar fields like density (no special reflection)
+    X,         // For the velocity along x (u), negated at the faces normal to x
+    Y,         // For the velocity along y (v), negated at the faces normal to y
+    Z          // For the velocity along z (w), negated at the faces normal to z
+};
+
+/// <summary>
+/// Wall-clock time spent in each stage of the most recent FluidSimulator3D::Tick(), in milliseconds.
+/// </summary>
+struct VolumeTickTimings {
+    double velStepMs = 0.0;
+    double densStepMs = 0.0;
+    double totalMs = 0.0;
+};
+
+/// <summary>
+/// Stam's stable fluids in a cube of (N+2)^3 cells: the same sources, implicit diffusion, semi-Lagrangian advection
+/// and pressure projection as FluidSimulator, with a third velocity component and 7-point stencils.
+///
+/// A volume is N times larger than a grid of the same width, so the fields are meant to be float (at N = 256 one
+/// field holds 17M cells) and are stored in bricks of 8x8x8 cells (see BrickLayout) so the stencils stay within a
+/// few cache lines. Every pass over the volume is split into bricks across the thread pool, and the Gauss-Seidel
+/// relaxation of the diffusion and the pressure uses a red-black ordering so both colors can be swept in parallel.
+/// As in Stam's solver, the pressure and the divergence borrow the buffers of the previous velocity, so a
+/// simulation holds eight fields.
+/// Scalar is the floating point type of the fields; it is instantiated for float and double.
+/// </summary>
+template <typename Scalar>
+class FluidSimulator3D {
+private:
+    /// <summary>
+    /// The inner cells of one brick: its first element, the coordinates of its first cell and the range of local
+    /// coordinates [begin, end) along each axis that fall inside the volume.
+    /// </summary>
+    struct BrickCells {
+        int origin;
+        glm::ivec3 first;
+        glm::ivec3 begin;
+        glm::ivec3 end;
+    };
+
+    /// <summary>
+    /// One field moved by Advect: the values receiving the advected field, those it is read from and the boundary
+    /// condition applied afterwards.
+    /// </summary>
+    struct AdvectedField {
+        VolumeBoundaryType b;
+        Field<Scalar>* d;
+        const Field<Scalar>* d0;
+    };
+
+    unsigned int N;          // The width of the inner volume along every axis. Cells are h = 1 / N wide.
+    BrickLayout layout;
+
+    // Velocity components of the fluid at the current and the previous time step
+    Field<Scalar> u;
+    Field<Scalar> u_prev;
+    Field<Scalar> v;
+    Field<Scalar> v_prev;
+    Field<Scalar> w;
+    Field<Scalar> w_prev;
+
+    // Density of the fluid at the current and the previous time step
+    Field<Scalar> dens;
+    Field<Scalar> dens_prev;
+
+    std::map<std::string, Scene3D<Scalar>> scenes;
+    std::string activeSceneName;
+
+    // Sources present in the current simulation, cloned from the active scene
+    VolumeSourceRegistry<Scalar> sources;
+
+    double viscosity;
+    double diffusion;
+
+    // Red-black Gauss-Seidel sweeps of every linear solve
+    int solverIterations;
+
+    VolumeTickTimings lastTickTimings;
+
+    std::unique_ptr<ThreadPool> threadPool;
+
+    /// <summary>
+    /// Returns the inner cells of a brick. The range is empty along an axis for bricks made only of boundary or
+    /// padding cells.
+    /// </summary>
+    BrickCells GetBrickCells(int brick) const;
+
+    /// <summary>
+    /// Runs body(cells) for every brick holding inner cells, split across the pool. Denormal values are flushed to 0
+    /// meanwhile: smoke thinning out by diffusion falls below the normal range of float, where arithmetic is several
+    /// times slower.
+    /// </summary>
+    void ForEachBrick(const std::function<void(const BrickCells&)>& body) const;
+
+    /// <summary>
+    /// Sums body(cells) over every brick holding inner cells, in the same order whatever the number of threads.
+    /// </summary>
+    double SumBricks(const std::function<double(const BrickCells&)>& body) const;
+
+    /// <summary>
+    /// Adds dt times the rates of every source to the cells they cover.
+    /// </summary>
+    void ApplySources(double dt);
+
+    /// <summary>
+    /// Sets the boundary layer of x: copies of the adjacent inner cells, negated on the faces normal to the
+    /// component b, and averages of their neighbors along the edges and at the corners.
+    /// </summary>
+    void SetBoundaryConditions(VolumeBoundaryType b, Field<Scalar>& x);
+
+    /// <summary>
+    /// Solves x = (x0 + a * (sum of the 6 neighbors of x)) / c with solverIterations red-black Gauss-Seidel sweeps.
+    /// </summary>
+    void LinearSolve(VolumeBoundaryType b, Field<Scalar>& x, const Field<Scalar>& x0, double a, double c);
+
+    /// <summary>
+    /// Diffuses x0 into x at rate diff. With a rate of 0 the two are swapped rather than copied, leaving the old
+    /// values of x in x0, which every caller discards.
+    /// </summary>
+    void Diffuse(VolumeBoundaryType b, Field<Scalar>& x, Field<Scalar>& x0, double diff, double dt);
+
+    /// <summary>
+    /// Moves several fields along the same backtrace through u, v and w, interpolating trilinearly.
+    /// </summary>
+    void Advect(std::initializer_list<AdvectedField> fields, const Field<Scalar>& u, const Field<Scalar>& v,
+        const Field<Scalar>& w, double dt);
+
+    /// <summary>
+    /// Removes the divergence of the velocity, using p and div as scratch for the pressure and the divergence.
+    /// </summary>
+    void Project(Field<Scalar>& p, Field<Scalar>& div);
+
+    void DensStep(double dt);
+    void VelStep(double dt);
+
+public:
+    /// <summary>
+    /// Constructs a simulation of a cube of N^3 inner cells.
+    /// </summary>
+    /// <param name="N">The width of the inner volume along every axis.</param>
+    FluidSimulator3D(unsigned int N = 64);
+
+    /// <summary>
+    /// Advances the simulation by one step.
+    /// </summary>
+    void Tick();
+
+    /// <summary>
+    /// Clears the velocity and the density.
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Returns the names of the scenes available to the volume.
+    /// </summary>
+    std::vector<std::string> GetSceneNames() const;
+
+    /// <summary>
+    /// Resets the simulation and replaces its sources with those of the named scene. Does nothing for an unknown
+    /// name.
+    /// </summary>
+    void ActivateSceneByName(const std::string& sceneName);
+
+    /// <summary>
+    /// Sets the number of threads the passes over the volume are split across. 0 uses one per core.
+    /// </summary>
+    void SetThreadCount(unsigned int threadCount);
+
+    /// <summary>
+    /// Sets the number of red-black Gauss-Seidel sweeps of the diffusion and pressure solves (default 20).
+    /// </summary>
+    void SetSolverIterations(int iterations);
+
+    /// <summary>
+    /// Adds density to the inner cell (i, j, k).
+    /// </summary>
+    void AddDens(int i, int j, int k, double amount);
+
+    /// <summary>
+    /// Adds velocity to the inner cell (i, j, k).
+    /// </summary>
+    void AddVel(int i, int j, int k, double uAmount, double vAmount, double wAmount);
+
+    /// <summary>
+    /// Returns the mapping from the cells (i, j, k) to their place in the fields.
+    /// </summary>
+    const BrickLayout& GetLayout() const;
+
+    const Field<Scalar>& GetU() const;
+    const Field<Scalar>& GetV() const;
+    const Field<Scalar>& GetW() const;
+    const Field<Scalar>& GetDens() const;
+
+    /// <summary>
+    /// Returns the density summed over the inner cells.
+    /// </summary>
+    double GetTotalDensity() const;
+
+    /// <summary>
+    /// Returns the RMS over the inner cells of the divergence in grid units, 0.5 (u(i + 1) - u(i - 1) + ...).
+    /// </summary>
+    double GetRmsDivergence() const;
+
+    /// <summary>
+    /// Returns the bytes held by the fields.
+    /// </summary>
+    size_t GetFieldBytes() const;
+
+    const VolumeTickTimings& GetLastTickTimings() const;
+
+    unsigned int GetN() const;
+
+    unsigned int GetThreadCount() const;
+};
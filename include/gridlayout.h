@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Memory layout shared by the simulator fields and the sources added to them.
+// A grid with an inner width of N and an inner height of M has M+2 rows of N+2 cells (the inner cells plus one
+// boundary cell on each side).
+// Every row is padded to a whole number of cache lines, so with 64-byte aligned storage each row starts on a
+// cache line, and the padding cells after column N+1 are never read or written by the solver.
+// The layout is counted in elements and is the same for every scalar type, so IX works on float and double
+// fields (and on the per-cell obstacle arrays) alike.
+
+/// <summary>
+/// Alignment of the field storage and of every row within it, in bytes. One cache line on current x86 CPUs,
+/// and the width of an AVX-512 vector.
+/// </summary>
+constexpr size_t GRID_ALIGNMENT = 64;
+
+/// <summary>
+/// Rows are padded to a multiple of this many elements: one cache line of the narrowest scalar type (float).
+/// </summary>
+constexpr int GRID_ROW_ALIGNMENT = int(GRID_ALIGNMENT / sizeof(float));
+
+/// <summary>
+/// Distance in elements between the starts of two consecutive rows of a grid with an inner width of N.
+/// </summary>
+constexpr int GridStride(unsigned int N)
+{
+    int stride = (int(N) + 2 + GRID_ROW_ALIGNMENT - 1) / GRID_ROW_ALIGNMENT * GRID_ROW_ALIGNMENT;
+    // A row length that is a multiple of 4 KB (512 doubles) maps the same column of every row to the same cache
+    // set, and the stencils touch three rows of several fields at once. Skip ahead to spread the rows across the sets.
+    if (stride % int(4096 / sizeof(double)) == 0) {
+        stride += GRID_ROW_ALIGNMENT;
+    }
+    return stride;
+}
+
+/// <summary>
+/// Number of elements needed to store a grid with an inner width of N and an inner height of M, including the
+/// boundary and the padding.
+/// </summary>
+constexpr size_t GridSize(unsigned int N, unsigned int M)
+{
+    return size_t(GridStride(N)) * (M + 2);
+}
+
+/// <summary>
+/// Number of elements needed to store a square grid with an inner width and height of N.
+/// </summary>
+constexpr size_t GridSize(unsigned int N)
+{
+    return GridSize(N, N);
+}
+
+// Macro for accessing a 1D array with 2D-like syntax. This maps 2D indices (i, j)
+// to a 1D index in a flattened array. The grid includes a boundary,
+// so its actual dimensions are (N+2) x (M+2), stored in rows of GridStride(N) elements.
+// Only the width is needed, so IX works on grids of any height.
+#define IX(i, j) ((i) + GridStride(N) * (j))
+
+/// <summary>
+/// Minimal allocator returning storage aligned to Alignment bytes, so vectors of fields start on a cache line.
+/// </summary>
+template <typename T, size_t Alignment = GRID_ALIGNMENT>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, size_t)
+    {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+/// <summary>
+/// Storage of one simulated field (velocity component, density, pressure, ...) laid out as described above.
+/// </summary>
+template <typename Scalar>
+using Field = std::vector<Scalar, AlignedAllocator<Scalar>>;
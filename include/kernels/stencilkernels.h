@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+
+/// <summary>
+/// Instruction set extensions the stencil kernels are implemented for, from narrowest to widest.
+/// </summary>
+enum class SimdLevel {
+    SCALAR = 0,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+/// <summary>
+/// The inner loops of the solver, operating on single grid rows so each implementation can use the widest
+/// vectors available. Row pointers point at the boundary cell (i = 0) of the row, and the kernels touch
+/// the inner cells i = 1..n, reading one cell past either end.
+/// There is one table per instruction set for each scalar type the simulator is built for (float and double).
+/// </summary>
+template <typename Scalar>
+struct StencilKernels {
+    /// <summary>
+    /// The instruction set this table was built for.
+    /// </summary>
+    SimdLevel level;
+
+    /// <summary>
+    /// The name of the instruction set, for logging.
+    /// </summary>
+    const char* name;
+
+    /// <summary>
+    /// x[cell] += dt * s[cell] for every cell in [0, count).
+    /// </summary>
+    void (*addSource)(Scalar* x, const Scalar* s, size_t count, Scalar dt);
+
+    /// <summary>
+    /// One half of a red-black Gauss-Seidel sweep over a row: for i = firstCell, firstCell + 2, ... <= n,
+    /// x[i] = (rhs[i] + a * (x[i - 1] + x[i + 1] + below[i] + above[i])) * invC.
+    /// Returns the sum of the squared changes of x. Each change is the residual of its cell just before the update,
+    /// divided by c, so this measures the convergence without a separate pass over the grid.
+    /// </summary>
+    double (*relaxRowRedBlack)(Scalar* x, const Scalar* rhs, const Scalar* below, const Scalar* above, int n,
+        int firstCell, Scalar a, Scalar invC);
+
+    /// <summary>
+    /// div[i] = scale * (u[i + 1] - u[i - 1] + vAbove[i] - vBelow[i]) and p[i] = 0 for i = 1..n.
+    /// </summary>
+    void (*divergenceRow)(Scalar* div, Scalar* p, const Scalar* u, const Scalar* vBelow, const Scalar* vAbove,
+        int n, Scalar scale);
+
+    /// <summary>
+    /// u[i] -= scale * (p[i + 1] - p[i - 1]) and v[i] -= scale * (pAbove[i] - pBelow[i]) for i = 1..n.
+    /// </summary>
+    void (*gradientRow)(Scalar* u, Scalar* v, const Scalar* p, const Scalar* pBelow, const Scalar* pAbove,
+        int n, Scalar scale);
+
+    /// <summary>
+    /// The divergence of a staggered (MAC) grid, where u[i] lies on the face between cells i and i + 1 and v[i] on
+    /// the face between the row and the one above: div[i] = scale * (u[i] - u[i - 1] + v[i] - vBelow[i]) and
+    /// p[i] = 0 for i = 1..n.
+    /// </summary>
+    void (*staggeredDivergenceRow)(Scalar* div, Scalar* p, const Scalar* u, const Scalar* vBelow, const Scalar* v,
+        int n, Scalar scale);
+
+    /// <summary>
+    /// The pressure gradient of a staggered grid: u[i] -= scale * (p[i + 1] - p[i]) and
+    /// v[i] -= scale * (pAbove[i] - p[i]) for i = 1..n.
+    /// </summary>
+    void (*staggeredGradientRow)(Scalar* u, Scalar* v, const Scalar* p, const Scalar* pAbove, int n, Scalar scale);
+};
+
+/// <summary>
+/// Queries the CPU (and the OS, for the wider register files) for the widest supported instruction set.
+/// The result is computed once and cached.
+/// </summary>
+SimdLevel DetectSimdLevel();
+
+/// <summary>
+/// Returns the kernels for the widest instruction set at or below maxLevel that this CPU supports.
+/// Defined for float and double.
+/// </summary>
+/// <param name="maxLevel">The widest instruction set the caller wants to use.</param>
+template <typename Scalar>
+const StencilKernels<Scalar>& GetStencilKernels(SimdLevel maxLevel = SimdLevel::AVX512);
+
+/// <summary>
+/// Per instruction set kernel tables, specialized for float and double in their own translation units so only
+/// those units are compiled for the wider instruction sets. Each returns nullptr when the target architecture
+/// has no such extension.
+/// </summary>
+template <typename Scalar>
+const StencilKernels<Scalar>* GetScalarStencilKernels();
+template <typename Scalar>
+const StencilKernels<Scalar>* GetSse2StencilKernels();
+template <typename Scalar>
+const StencilKernels<Scalar>* GetAvx2StencilKernels();
+template <typename Scalar>
+const StencilKernels<Scalar>* GetAvx512StencilKernels();
+
+template <> const StencilKernels<float>* GetScalarStencilKernels<float>();
+template <> const StencilKernels<double>* GetScalarStencilKernels<double>();
+template <> const StencilKernels<float>* GetSse2StencilKernels<float>();
+template <> const StencilKernels<double>* GetSse2StencilKernels<double>();
+template <> const StencilKernels<float>* GetAvx2StencilKernels<float>();
+template <> const StencilKernels<double>* GetAvx2StencilKernels<double>();
+template <> const StencilKernels<float>* GetAvx512StencilKernels<float>();
+template <> const StencilKernels<double>* GetAvx512StencilKernels<double>();
@@ -0,0 +1,178 @@
+#pragma once
+
+// Vector-width independent bodies of the stencil kernels. Only include this from the per instruction set
+// translation units (src/kernels/stencilkernels_*.cpp), after the intrinsics header and the traits type:
+//
+//   struct V {
+//       using Scalar;                               // float or double
+//       using Vec;                                  // vector of Scalar
+//       static constexpr int width;                 // lanes per vector
+//       static Vec Load(const Scalar*);             // unaligned load
+//       static void Store(Scalar*, Vec);            // unaligned store
+//       static Vec Set1(Scalar);
+//       static Vec Add(Vec, Vec); Sub; Mul;
+//       static Vec LoadEven(const Scalar* p);       // (p[0], p[2], ..., p[2 * width - 2]), reads 2 * width values
+//       static void StoreEven(Scalar* p, Vec);      // writes p[0], p[2], ..., leaves the odd elements unchanged
+//   };
+//
+// Everything lives in an anonymous namespace: these functions are compiled with wider instruction sets
+// than the rest of the program and must never be merged with a copy from another translation unit.
+
+#include "kernels/stencilkernels.h"
+
+namespace {
+
+template <typename V, typename Scalar = typename V::Scalar>
+void AddSourceKernel(Scalar* x, const Scalar* s, size_t count, Scalar dt)
+{
+    typename V::Vec vdt = V::Set1(dt);
+    size_t cell = 0;
+    for (; cell + V::width <= count; cell += V::width) {
+        V::Store(x + cell, V::Add(V::Load(x + cell), V::Mul(vdt, V::Load(s + cell))));
+    }
+    for (; cell < count; ++cell) {
+        x[cell] += dt * s[cell];
+    }
+}
+
+template <typename V, typename Scalar = typename V::Scalar>
+double RelaxRowRedBlackKernel(Scalar* x, const Scalar* rhs, const Scalar* below, const Scalar* above, int n,
+    int firstCell, Scalar a, Scalar invC)
+{
+    // The cells of one color are every other cell of the row, so each vector gathers width cells of that
+    // color (and their neighbors, which all have the other color) from 2 * width consecutive values.
+    // A vector starting at i reads up to x[i + 2 * width], which must not pass the boundary cell n + 1.
+    typename V::Vec va = V::Set1(a);
+    typename V::Vec vInvC = V::Set1(invC);
+    // The old values sit in the cache lines the neighbors were just loaded from, so tracking the change is nearly free
+    typename V::Vec sumSquaredChange = V::Set1(Scalar(0));
+    int i = firstCell;
+    if (i + 2 * V::width - 1 <= n) {
+        // Each vector is stored only after the next one has been loaded. Storing first would make the next
+        // (overlapping, unaligned) loads wait on store forwarding, which costs more than the math.
+        typename V::Vec neighbors = V::Add(V::Add(V::LoadEven(x + i - 1), V::LoadEven(x + i + 1)),
+            V::Add(V::LoadEven(below + i), V::LoadEven(above + i)));
+        typename V::Vec relaxed = V::Mul(V::Add(V::LoadEven(rhs + i), V::Mul(va, neighbors)), vInvC);
+        typename V::Vec change = V::Sub(relaxed, V::LoadEven(x + i));
+        for (i += 2 * V::width; i + 2 * V::width - 1 <= n; i += 2 * V::width) {
+            typename V::Vec nextNeighbors = V::Add(V::Add(V::LoadEven(x + i - 1), V::LoadEven(x + i + 1)),
+                V::Add(V::LoadEven(below + i), V::LoadEven(above + i)));
+            typename V::Vec nextRelaxed = V::Mul(V::Add(V::LoadEven(rhs + i), V::Mul(va, nextNeighbors)), vInvC);
+            typename V::Vec nextChange = V::Sub(nextRelaxed, V::LoadEven(x + i));
+            V::StoreEven(x + i - 2 * V::width, relaxed);
+            sumSquaredChange = V::Add(sumSquaredChange, V::Mul(change, change));
+            relaxed = nextRelaxed;
+            change = nextChange;
+        }
+        V::StoreEven(x + i - 2 * V::width, relaxed);
+        sumSquaredChange = V::Add(sumSquaredChange, V::Mul(change, change));
+    }
+
+    Scalar lanes[V::width];
+    V::Store(lanes, sumSquaredChange);
+    double sum = 0.0;
+    for (int lane = 0; lane < V::width; ++lane) {
+        sum += lanes[lane];
+    }
+    for (; i <= n; i += 2) {
+        Scalar relaxed = (rhs[i] + a * (x[i - 1] + x[i + 1] + below[i] + above[i])) * invC;
+        Scalar change = relaxed - x[i];
+        sum += change * change;
+        x[i] = relaxed;
+    }
+    return sum;
+}
+
+template <typename V, typename Scalar = typename V::Scalar>
+void DivergenceRowKernel(Scalar* div, Scalar* p, const Scalar* u, const Scalar* vBelow, const Scalar* vAbove,
+    int n, Scalar scale)
+{
+    typename V::Vec vScale = V::Set1(scale);
+    typename V::Vec zero = V::Set1(Scalar(0));
+    int i = 1;
+    for (; i + V::width - 1 <= n; i += V::width) {
+        typename V::Vec dx = V::Sub(V::Load(u + i + 1), V::Load(u + i - 1));
+        typename V::Vec dy = V::Sub(V::Load(vAbove + i), V::Load(vBelow + i));
+        V::Store(div + i, V::Mul(vScale, V::Add(dx, dy)));
+        V::Store(p + i, zero);
+    }
+    for (; i <= n; ++i) {
+        div[i] = scale * (u[i + 1] - u[i - 1] + vAbove[i] - vBelow[i]);
+        p[i] = 0;
+    }
+}
+
+template <typename V, typename Scalar = typename V::Scalar>
+void GradientRowKernel(Scalar* u, Scalar* v, const Scalar* p, const Scalar* pBelow, const Scalar* pAbove,
+    int n, Scalar scale)
+{
+    typename V::Vec vScale = V::Set1(scale);
+    int i = 1;
+    for (; i + V::width - 1 <= n; i += V::width) {
+        typename V::Vec dx = V::Sub(V::Load(p + i + 1), V::Load(p + i - 1));
+        typename V::Vec dy = V::Sub(V::Load(pAbove + i), V::Load(pBelow + i));
+        V::Store(u + i, V::Sub(V::Load(u + i), V::Mul(vScale, dx)));
+        V::Store(v + i, V::Sub(V::Load(v + i), V::Mul(vScale, dy)));
+    }
+    for (; i <= n; ++i) {
+        u[i] -= scale * (p[i + 1] - p[i - 1]);
+        v[i] -= scale * (pAbove[i] - pBelow[i]);
+    }
+}
+
+template <typename V, typename Scalar = typename V::Scalar>
+void StaggeredDivergenceRowKernel(Scalar* div, Scalar* p, const Scalar* u, const Scalar* vBelow, const Scalar* v,
+    int n, Scalar scale)
+{
+    typename V::Vec vScale = V::Set1(scale);
+    typename V::Vec zero = V::Set1(Scalar(0));
+    int i = 1;
+    for (; i + V::width - 1 <= n; i += V::width) {
+        typename V::Vec dx = V::Sub(V::Load(u + i), V::Load(u + i - 1));
+        typename V::Vec dy = V::Sub(V::Load(v + i), V::Load(vBelow + i));
+        V::Store(div + i, V::Mul(vScale, V::Add(dx, dy)));
+        V::Store(p + i, zero);
+    }
+    for (; i <= n; ++i) {
+        div[i] = scale * (u[i] - u[i - 1] + v[i] - vBelow[i]);
+        p[i] = 0;
+    }
+}
+
+template <typename V, typename Scalar = typename V::Scalar>
+void StaggeredGradientRowKernel(Scalar* u, Scalar* v, const Scalar* p, const Scalar* pAbove, int n, Scalar scale)
+{
+    typename V::Vec vScale = V::Set1(scale);
+    int i = 1;
+    for (; i + V::width - 1 <= n; i += V::width) {
+        typename V::Vec center = V::Load(p + i);
+        typename V::Vec dx = V::Sub(V::Load(p + i + 1), center);
+        typename V::Vec dy = V::Sub(V::Load(pAbove + i), center);
+        V::Store(u + i, V::Sub(V::Load(u + i), V::Mul(vScale, dx)));
+        V::Store(v + i, V::Sub(V::Load(v + i), V::Mul(vScale, dy)));
+    }
+    for (; i <= n; ++i) {
+        u[i] -= scale * (p[i + 1] - p[i]);
+        v[i] -= scale * (pAbove[i] - p[i]);
+    }
+}
+
+/// <summary>
+/// Builds the kernel table for the traits type V.
+/// </summary>
+template <typename V>
+constexpr StencilKernels<typename V::Scalar> MakeStencilKernels(SimdLevel level, const char* name)
+{
+    return StencilKernels<typename V::Scalar>{
+        level,
+        name,
+        &AddSourceKernel<V>,
+        &RelaxRowRedBlackKernel<V>,
+        &DivergenceRowKernel<V>,
+        &GradientRowKernel<V>,
+        &StaggeredDivergenceRowKernel<V>,
+        &StaggeredGradientRowKernel<V>,
+    };
+}
+
+}
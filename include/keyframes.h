@@ -0,0 +1,47 @@
+#pragma once
+
+#include <initializer_list>
+#include <utility>
+#include <vector>
+#include "glm_includes.h"
+
+/// <summary>
+/// A value that changes over time, given by keys at a number of times and interpolated linearly between them.
+/// Before the first key and after the last one the curve holds the nearest key, unless it loops, in which case it
+/// repeats with a period of the time of the last key.
+/// T is the type of the value: double or glm::dvec2.
+/// </summary>
+template <typename T>
+class Keyframes {
+private:
+    // (time, value) pairs sorted by time
+    std::vector<std::pair<double, T>> keys;
+    bool loop;
+
+public:
+    /// <summary>
+    /// Constructs a curve that always has the given value.
+    /// </summary>
+    Keyframes(T value = T(0));
+
+    /// <summary>
+    /// Constructs a curve from (time, value) keys, which may be given in any order.
+    /// </summary>
+    /// <param name="loop">Whether the curve repeats after its last key.</param>
+    Keyframes(std::initializer_list<std::pair<double, T>> keys, bool loop = false);
+
+    /// <summary>
+    /// Adds a key, replacing any key at the same time.
+    /// </summary>
+    void AddKey(double time, T value);
+
+    /// <summary>
+    /// Returns the value of the curve at the given time.
+    /// </summary>
+    T Evaluate(double time) const;
+
+    /// <summary>
+    /// Returns whether the curve has the same value at every time.
+    /// </summary>
+    bool IsConstant() const;
+};
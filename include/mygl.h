@@ -36,9 +36,46 @@ private:
 	GLuint testTextureHandle; /// <summary> The handle for the test texture created in RenderTestTexture() </summary>
 	GLuint velocityTextureHandle; /// <summary> The handle for the velocity field texture created in RenderVelocityField() </summary>
 	GLuint obstacleTextureHandle; /// <summary> The handle for the obstacle texture created in RenderObstacleTexture() </summary>
-	FluidSimulator fluidSimulator;
+	GLuint previousDensityTextureHandle; /// <summary> The density before the most recent step, blended with the density texture </summary>
+	GLuint previousVelocityTextureHandle; /// <summary> The velocity before the most recent step, blended with the velocity texture </summary>
+	FluidSimulator<SimulationScalar> fluidSimulator;
+	ImVec4 obstColor; /// <summary> The color of the obstacle we are drawing </summary>
 	
 	SceneSelector sceneSelector; /// <summary> An ImGui UI element for selecting the currently active scene in the simulationJKO </summary>
+
+	/// <summary> Simulated seconds each step of the fluid sim advances by, whatever the frame rate </summary>
+	static constexpr double simulationStep = 0.016;
+	/// <summary> The most steps one frame takes. Time beyond them is dropped, so a frame slowed down by stepping does
+	/// not leave even more steps to the next one. </summary>
+	static constexpr int maxStepsPerFrame = 4;
+
+	double lastFrameTime; /// <summary> glfwGetTime() at the start of the previous frame, negative before the first </summary>
+	double simulationAccumulator; /// <summary> Time elapsed but not simulated yet, less than one step after each frame </summary>
+	std::string activeSceneName; /// <summary> The scene last passed to the fluid sim </summary>
+
+	/// <summary>
+	/// Advances the fluid sim by whole steps for the time elapsed since the previous frame. The density and velocity
+	/// textures are double buffered: the current ones become the previous ones and are refilled after the last step,
+	/// and the shaders blend the two by how far the accumulator is into the next step, so the display moves smoothly
+	/// when frames and steps do not line up.
+	/// </summary>
+	void StepSimulation();
+
+	/// <summary>
+	/// Uploads the current fields into both the current and the previous textures, so nothing from before a reset is
+	/// blended in.
+	/// </summary>
+	void RefreshFieldTextures();
+
+	/// <summary>
+	/// Returns how far the display time is from the state before the most recent step to the state after it, 0 to 1.
+	/// </summary>
+	float GetDisplayAlpha() const;
+
+	/// <summary>
+	/// Creates an empty texture sampled the way the field textures are.
+	/// </summary>
+	GLuint CreateFieldTexture();
 	
 public: 
 	// Rule of Three
@@ -112,5 +149,25 @@ public:
 	/// Displays the velocity field's normal map
 	/// </summary>
 	void TestVelField();
+
+	/// <summary>
+	/// Handles mouse events that inject density, velocity and obstacles into the fluid simulator
+	/// </summary>
+	void HandleMouse();
+
+	/// <summary>
+	/// Updates an OpenGL texture with the current density field values.
+	/// </summary>
+	void UpdateDensityTexture(GLuint textureHandle);
+
+	/// <summary>
+	/// Updates an OpenGL texture with the current velocity field values.
+	/// </summary>
+	void UpdateVelocityTexture(GLuint textureHandle);
+
+	/// <summary>
+	/// Updates the OpenGL texture with the current obstacle values.
+	/// </summary>
+	void UpdateObstacleTexture();
 };
 
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <functional>
+#include "velocitysource.h"
+#include "glm_includes.h"
+
+/// <summary>
+/// A velocity source whose field is a formula instead of a footprint. It is evaluated on the fly, row by row, every
+/// time it is applied, so it takes no grid-sized memory and its parameters can change between ticks.
+/// Procedural sources are never merged into the compiled batch of a scene.
+/// </summary>
+template <typename Scalar>
+class ProceduralVelocitySource : public VelocitySource<Scalar> {
+public:
+    /// <summary>
+    /// Constructs a procedural source for a grid with an inner width of N and an inner height of M.
+    /// </summary>
+    ProceduralVelocitySource(unsigned int N, unsigned int M);
+
+    bool IsStatic() const override;
+
+    bool IsProcedural() const override;
+
+    /// <summary>
+    /// Returns whether the velocity the source adds is the gradient of a potential on the domain, like a uniform
+    /// force between walls. The projection removes such a field entirely from still fluid, so the source sets nothing
+    /// in motion by itself: with sparse tiles it is only added to the tiles already active, and marks none.
+    /// </summary>
+    /// <param name="periodic">Whether the domain wraps around, so that the potential must be periodic too.</param>
+    virtual bool IsGradient(bool periodic) const;
+
+    /// <summary>
+    /// Returns whether the source only adds to the inner cells [iBegin, iEnd) x [jBegin, jEnd), which sparse tiles
+    /// then activate. Returns false, the default, for sources that may add to any cell.
+    /// </summary>
+    virtual bool GetBounds(int& iBegin, int& iEnd, int& jBegin, int& jEnd) const;
+
+    /// <summary>
+    /// Adds uScale times the horizontal and vScale times the vertical velocity of the source to the inner cells
+    /// [iBegin, iEnd) of row j. Called for different rows from several threads at once.
+    /// </summary>
+    /// <param name="j">The row, from 1 to M.</param>
+    /// <param name="iBegin">The first cell of the row to add to, at least 1.</param>
+    /// <param name="iEnd">One past the last cell of the row to add to, at most N + 1.</param>
+    /// <param name="uRow">The horizontal velocity of the row, starting at cell (0, j).</param>
+    /// <param name="vRow">The vertical velocity of the row, starting at cell (0, j).</param>
+    /// <param name="uScale">The time step times the horizontal strength of the source.</param>
+    /// <param name="vScale">The time step times the vertical strength of the source.</param>
+    virtual void AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow, Scalar uScale,
+        Scalar vScale) const = 0;
+
+    /// <summary>
+    /// Returns the velocity the source adds per unit time at the point (x, y), in cells, for grids whose cells are
+    /// not visited row by row. Agrees with AddVelocityRow at the centers of the cells, before the strength of the
+    /// source is applied.
+    /// </summary>
+    virtual glm::dvec2 GetVelocity(double x, double y) const = 0;
+};
+
+/// <summary>
+/// A force per unit mass acting uniformly on every inner cell, such as gravity.
+/// </summary>
+template <typename Scalar>
+class BodyForceSource : public ProceduralVelocitySource<Scalar> {
+private:
+    double forceX;
+    double forceY;
+
+public:
+    /// <summary>
+    /// Constructs a uniform body force.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    /// <param name="forceX">The horizontal velocity added per unit time.</param>
+    /// <param name="forceY">The vertical velocity added per unit time.</param>
+    BodyForceSource(unsigned int N, unsigned int M, double forceX, double forceY);
+
+    /// <summary>
+    /// Changes the force, taking effect on the next tick.
+    /// </summary>
+    void SetForce(double forceX, double forceY);
+
+    std::unique_ptr<VelocitySource<Scalar>> Clone() const override;
+
+    bool IsGradient(bool periodic) const override;
+
+    void AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow, Scalar uScale,
+        Scalar vScale) const override;
+
+    glm::dvec2 GetVelocity(double x, double y) const override;
+};
+
+/// <summary>
+/// A rotating flow around a center: the velocity is perpendicular to the offset from the center, grows linearly
+/// with the distance, and can be turned by an angle to spiral inwards or outwards.
+/// </summary>
+template <typename Scalar>
+class VortexSource : public ProceduralVelocitySource<Scalar> {
+private:
+    glm::dvec2 center;
+    double angularSpeed;
+    double angle;
+
+public:
+    /// <summary>
+    /// Constructs a vortex.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    /// <param name="x">The x-coordinate of the center, in cells.</param>
+    /// <param name="y">The y-coordinate of the center, in cells.</param>
+    /// <param name="angularSpeed">The velocity per unit time added per cell of distance from the center.
+    /// Positive values turn counterclockwise.</param>
+    /// <param name="angle">The angle, in radians, by which the velocity is turned away from the tangent.</param>
+    VortexSource(unsigned int N, unsigned int M, double x, double y, double angularSpeed, double angle = 0.0);
+
+    /// <summary>
+    /// Changes the angular speed of the vortex, taking effect on the next tick.
+    /// </summary>
+    void SetAngularSpeed(double angularSpeed);
+
+    std::unique_ptr<VelocitySource<Scalar>> Clone() const override;
+
+    void AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow, Scalar uScale,
+        Scalar vScale) const override;
+
+    glm::dvec2 GetVelocity(double x, double y) const override;
+};
+
+/// <summary>
+/// A jet blowing outwards from a center, fastest at the center and fading linearly to nothing at the radius.
+/// </summary>
+template <typename Scalar>
+class RadialJetSource : public ProceduralVelocitySource<Scalar> {
+private:
+    glm::dvec2 center;
+    double radius;
+    double speed;
+
+public:
+    /// <summary>
+    /// Constructs a radial jet.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    /// <param name="x">The x-coordinate of the center, in cells.</param>
+    /// <param name="y">The y-coordinate of the center, in cells.</param>
+    /// <param name="radius">The distance, in cells, beyond which the jet adds nothing.</param>
+    /// <param name="speed">The outward velocity added per unit time at the center. Negative values suck inwards.</param>
+    RadialJetSource(unsigned int N, unsigned int M, double x, double y, double radius, double speed);
+
+    /// <summary>
+    /// Changes the speed of the jet, taking effect on the next tick.
+    /// </summary>
+    void SetSpeed(double speed);
+
+    std::unique_ptr<VelocitySource<Scalar>> Clone() const override;
+
+    bool GetBounds(int& iBegin, int& iEnd, int& jBegin, int& jEnd) const override;
+
+    void AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow, Scalar uScale,
+        Scalar vScale) const override;
+
+    glm::dvec2 GetVelocity(double x, double y) const override;
+};
+
+/// <summary>
+/// A velocity source defined by an arbitrary function of the cell, evaluated for every inner cell on every tick.
+/// The function is called from several threads at once and must not modify shared state.
+/// </summary>
+template <typename Scalar>
+class FunctionVelocitySource : public ProceduralVelocitySource<Scalar> {
+public:
+    /// <summary>
+    /// Returns the velocity added per unit time to cell (i, j). GetVelocity uses the cell nearest to the point.
+    /// </summary>
+    using VelocityFunction = std::function<glm::dvec2(int i, int j)>;
+
+private:
+    VelocityFunction velocity;
+
+public:
+    /// <summary>
+    /// Constructs a source from a velocity function.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    /// <param name="velocity">The velocity added per unit time to each cell.</param>
+    FunctionVelocitySource(unsigned int N, unsigned int M, VelocityFunction velocity);
+
+    std::unique_ptr<VelocitySource<Scalar>> Clone() const override;
+
+    void AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow, Scalar uScale,
+        Scalar vScale) const override;
+
+    glm::dvec2 GetVelocity(double x, double y) const override;
+};
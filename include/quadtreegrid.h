@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// The cells of a square domain N finest cells wide, refined as a quadtree: the root covers the whole domain, and
+/// each node is either a leaf cell or split into four children of half its width. N must be a power of two, so a
+/// cell of level l is N >> l finest cells wide. The leaves are kept in Z-order, which keeps the four children of a
+/// node next to each other and neighboring cells mostly close in memory.
+///
+/// Neighboring leaves never differ by more than one level (a 2:1 balanced tree), so a side of a cell meets either
+/// one cell at most one level coarser, one cell of its own level or two cells one level finer. Each such contact is
+/// one face, so the fields on the cells can be moved and projected with finite volume stencils of at most eight
+/// neighbors.
+/// </summary>
+class QuadtreeGrid {
+public:
+    /// <summary>
+    /// A leaf of the tree: the square of size x size finest cells whose lower left finest cell is (x, y), counted
+    /// from 0.
+    /// </summary>
+    struct Cell {
+        int x;
+        int y;
+        int size;
+        int level;
+        int node;   // The node of the tree this cell is the leaf of
+    };
+
+    /// <summary>
+    /// A node of the tree. The children of a split node are four consecutive nodes, the child covering the lower
+    /// left quarter first, then lower right, upper left and upper right.
+    /// </summary>
+    struct Node {
+        int firstChild;  // -1 for a leaf
+        int cell;        // The cell of a leaf, -1 for a split node
+        int parent;      // -1 for the root
+    };
+
+    /// <summary>
+    /// The contact between two leaves across a vertical (axis 0) or horizontal (axis 1) line. lower is the cell to
+    /// the left or below, upper the one to the right or above.
+    /// </summary>
+    struct Face {
+        int lower;
+        int upper;
+        int axis;
+        double length;  // The length of the contact, in finest cells: the width of the smaller cell
+        double weight;  // length divided by the distance between the two cell centers along the axis
+    };
+
+private:
+    int N;
+    int maxLevel;                        // log2(N), the level of the finest cells
+    std::vector<Node> nodes;             // nodes[0] is the root
+    std::vector<Cell> cells;             // The leaves, in Z-order
+    std::vector<Face> faces;
+    std::vector<int> cellFaces;          // The faces of cell c are cellFaces[cellFaceBegin[c]] to [cellFaceBegin[c + 1]]
+    std::vector<int> cellFaceBegin;
+
+    // The cells before the last Adapt() every cell averages: transferSources[transferBegin[c]] to
+    // [transferBegin[c + 1]]
+    std::vector<int> transferSources;
+    std::vector<int> transferBegin;
+
+    // The deepest node containing the finest cell (x, y) whose level is at most level
+    int FindNode(int x, int y, int level) const;
+
+    // The node across side (0 east, 1 west, 2 north, 3 south) of a cell, at most one level deeper than the cell's
+    // own level, or -1 at the edge of the domain
+    int FindNeighbor(const Cell& cell, int side, int level) const;
+
+    // Rebuilds the tree from the current one, splitting the cells with split set and merging the four leaf children
+    // of the nodes with merge set. sources receives, for every new cell, the current cells it is made of.
+    void Restructure(const std::vector<uint8_t>& split, const std::vector<uint8_t>& merge,
+        std::vector<int>& sources, std::vector<int>& sourceBegin);
+
+    // Whether merging the four leaf children of a node keeps the tree balanced
+    bool CanMerge(int node) const;
+
+    // Marks the leaves at least two levels coarser than a neighbor. Returns whether there were any.
+    bool FindUnbalanced(std::vector<uint8_t>& split) const;
+
+    void BuildFaces();
+
+public:
+    /// <summary>
+    /// Constructs the uniform grid of a domain N finest cells wide with every cell at the given level.
+    /// </summary>
+    QuadtreeGrid(unsigned int N = 1, int level = 0);
+
+    /// <summary>
+    /// Splits and merges cells, then splits whatever else keeps the tree 2:1 balanced, and rebuilds the faces.
+    /// Each cell with a positive change is split into four, unless it is at maxLevel already. Four sibling cells
+    /// with negative changes are merged into their parent, unless the parent is coarser than minLevel or the merged
+    /// cell would border cells two levels finer.
+    /// Call Transfer() on every field afterwards to carry its values over to the new cells.
+    /// </summary>
+    /// <param name="change">One entry per cell of the current grid.</param>
+    /// <returns>Whether any cell changed.</returns>
+    bool Adapt(const std::vector<int8_t>& change, int minLevel, int maxLevel);
+
+    /// <summary>
+    /// Replaces the per-cell values of the grid before the last Adapt() by those of the current grid: a split cell
+    /// passes its value to its children and a merged cell gets the average of its children, which keeps the total
+    /// of a field weighted by the cell areas.
+    /// </summary>
+    template <typename Values>
+    void Transfer(Values& values) const
+    {
+        Values previous(values);
+        values.assign(cells.size(), 0);
+        for (size_t c = 0; c < cells.size(); c++) {
+            double sum = 0.0;
+            for (int k = transferBegin[c]; k < transferBegin[c + 1]; k++) {
+                sum += previous[transferSources[k]];
+            }
+            values[c] = typename Values::value_type(sum / (transferBegin[c + 1] - transferBegin[c]));
+        }
+    }
+
+    /// <summary>
+    /// Returns the cell containing the point (x, y), in finest cells from the lower left corner of the domain.
+    /// Points outside the domain are clamped to its edge.
+    /// </summary>
+    int Locate(double x, double y) const;
+
+    /// <summary>
+    /// Returns the cell containing the finest cell (x, y), which must lie inside the domain.
+    /// </summary>
+    int Locate(int x, int y) const
+    {
+        return nodes[FindNode(x, y, maxLevel)].cell;
+    }
+
+    /// <summary>
+    /// Returns the width of the domain in finest cells.
+    /// </summary>
+    int GetN() const;
+
+    /// <summary>
+    /// Returns the level of the finest cells, log2(N).
+    /// </summary>
+    int GetMaxLevel() const;
+
+    /// <summary>
+    /// Returns the number of cells.
+    /// </summary>
+    int GetCellCount() const;
+
+    /// <summary>
+    /// Returns the cells, in Z-order.
+    /// </summary>
+    const std::vector<Cell>& GetCells() const;
+
+    /// <summary>
+    /// Returns the nodes of the tree, the root first.
+    /// </summary>
+    const std::vector<Node>& GetNodes() const;
+
+    /// <summary>
+    /// Returns the faces between neighboring cells. The edges of the domain have none.
+    /// </summary>
+    const std::vector<Face>& GetFaces() const;
+
+    /// <summary>
+    /// Returns the first index into GetFaces() of the faces of cell c.
+    /// </summary>
+    const int* CellFacesBegin(int c) const
+    {
+        return cellFaces.data() + cellFaceBegin[c];
+    }
+
+    /// <summary>
+    /// Returns one past the last index into GetFaces() of the faces of cell c.
+    /// </summary>
+    const int* CellFacesEnd(int c) const
+    {
+        return cellFaces.data() + cellFaceBegin[c + 1];
+    }
+};
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "gridlayout.h"
+#include "obstaclemask.h"
+#include "quadtreegrid.h"
+#include "sourceregistry.h"
+#include "scenes/scene.h"
+#include "solvers/quadtreepressuresolver.h"
+#include "threadpool.h"
+
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Wall-clock time spent in each stage of the most recent QuadtreeSimulator::Tick(), in milliseconds.
+/// </summary>
+struct QuadtreeTickTimings {
+    double remeshMs = 0.0;
+    double velStepMs = 0.0;
+    double densStepMs = 0.0;
+    double totalMs = 0.0;
+    int diffusionSweeps = 0;  // Sweeps run by the Diffuse() calls of the tick
+};
+
+/// <summary>
+/// Stam's stable fluids on an adaptive quadtree instead of a uniform grid, for domains too large to resolve
+/// everywhere: cells are refined where the smoke has edges or the flow turns, and merged again where it is smooth,
+/// so the cost follows the detail of the flow rather than the width of the domain.
+///
+/// The steps are those of FluidSimulator: sources, implicit diffusion, a pressure projection, semi-Lagrangian
+/// advection and a second projection. Every field holds one value per cell at its center. Advection traces each
+/// center back and interpolates bilinearly between the cell the departure point falls in and the cells one cell
+/// width away from it; diffusion and projection are finite volume stencils over the faces of the grid, so a uniform
+/// grid reproduces the collocated stencils of FluidSimulator. Every remeshInterval ticks the cells are refined or
+/// merged by one level and the fields carried over, conserving their totals.
+///
+/// The domain is N finest cells wide, N a power of two, in the cell coordinates of FluidSimulator, so its scenes
+/// and sources work unchanged. It is bounded by solid walls; obstacles and periodic domains are left to the uniform
+/// grid.
+/// </summary>
+template <typename Scalar>
+class QuadtreeSimulator {
+private:
+    // The cells one departure point is interpolated from, and whether each was reached through the left or right
+    // (wall X) or the bottom or top (wall Y) of the domain, where the normal velocity is mirrored
+    struct Stencil {
+        int cell[4];
+        Scalar weight[4];
+        bool wallX[4];
+        bool wallY[4];
+    };
+
+    // One field moved by Advect: the values receiving the advected field, those it is read from and the boundary
+    // condition at the walls
+    struct AdvectedField {
+        BoundaryType b;
+        Field<Scalar>* d;
+        const Field<Scalar>* d0;
+    };
+
+    unsigned int N;          // Width of the domain in finest cells, a power of two
+    QuadtreeGrid grid;
+
+    // Per-cell velocity and density of the current and the previous step
+    Field<Scalar> u;
+    Field<Scalar> u_prev;
+    Field<Scalar> v;
+    Field<Scalar> v_prev;
+    Field<Scalar> dens;
+    Field<Scalar> dens_prev;
+
+    // Per-cell pressure, kept between ticks as the initial guess of the next solve, and the net outflow of the cells
+    Field<Scalar> pressure;
+    Field<Scalar> divergence;
+
+    QuadtreePressureSolver<Scalar> pressureSolver;
+
+    std::map<std::string, Scene<Scalar>> scenes;
+    std::string activeSceneName;
+    SourceRegistry<Scalar> sources;
+
+    double viscosity;
+    double diffusion;
+
+    // Diffuse() stops relaxing once the residual falls below diffusionTolerance times the RMS of the field being
+    // diffused, or after maxDiffusionIterations sweeps
+    double diffusionTolerance;
+    int maxDiffusionIterations;
+
+    // The cells grouped by color, no two neighbors sharing one: the cells of color k are
+    // coloredCells[colorStarts[k]] to coloredCells[colorStarts[k + 1] - 1], in Z-order
+    std::vector<int> coloredCells;
+    std::vector<int> colorStarts;
+
+    // Cells are never merged below minLevel, whose uniform grid is the starting point, nor split beyond maxLevel
+    int minLevel;
+    int maxLevel;
+
+    // The grid adapts every remeshInterval ticks. A cell is split when the velocity or the density changes by more
+    // than the threshold across it or when it overlaps a source, and merged with its siblings when both change by
+    // less than a quarter of it.
+    int remeshInterval;
+    double vorticityThreshold;
+    double densityThreshold;
+
+    // Splitting stops at about cellBudget cells, keeping the cells that exceed their thresholds the most. The cells
+    // at sources are split regardless.
+    int cellBudget;
+
+    int tickCount;
+    QuadtreeTickTimings lastTickTimings;
+    SolveStats lastPressureStats;
+
+    std::unique_ptr<ThreadPool> threadPool;
+
+    // Runs body(c) for every cell across the pool
+    template <typename Body>
+    void ForEachCell(Body body)
+    {
+        threadPool->ParallelFor(0, grid.GetCellCount(), 1024, [&](int begin, int end) {
+            for (int c = begin; c < end; c++) {
+                body(c);
+            }
+        });
+    }
+
+    /// <summary>
+    /// Returns the cells and weights bilinearly interpolating the fields at (x, y), in finest cells.
+    /// </summary>
+    Stencil GetStencil(double x, double y) const;
+
+    /// <summary>
+    /// Adds dT times the footprint of a source to the cells it covers, each cell getting the average over the
+    /// finest cells it spans.
+    /// </summary>
+    void AddSource(Field<Scalar>& x, const SourceFootprint<Scalar>& s, double dT);
+
+    /// <summary>
+    /// Adds the density sources of the active scene.
+    /// </summary>
+    void ApplyDensitySources(double dT);
+
+    /// <summary>
+    /// Adds the velocity sources of the active scene. Procedural sources are evaluated at the cell centers.
+    /// </summary>
+    void ApplyVelocitySources(double dT);
+
+    /// <summary>
+    /// Colors the cells greedily in Z-order so that no two cells sharing a face get the same color, for the sweeps
+    /// of Diffuse(). Called whenever the grid changes.
+    /// </summary>
+    void ColorCells();
+
+    /// <summary>
+    /// Solves the implicit diffusion of x0 into x with multicolor Gauss-Seidel sweeps: the cells of one color only
+    /// depend on those of the others, so each color is relaxed across the pool. No flux crosses the walls. Relaxes
+    /// until the residual reaches diffusionTolerance, and copies x0 when the coefficient is 0.
+    /// </summary>
+    void Diffuse(Field<Scalar>& x, const Field<Scalar>& x0, double diff, double dt);
+
+    /// <summary>
+    /// Moves several fields along the same backtrace through u and v.
+    /// </summary>
+    void Advect(std::initializer_list<AdvectedField> fields, const Field<Scalar>& u, const Field<Scalar>& v,
+        double dt);
+
+    /// <summary>
+    /// Removes the divergence of u and v: solves for the pressure whose flux through the faces balances the flux of
+    /// the velocity, and subtracts its gradient.
+    /// </summary>
+    void Project(Field<Scalar>& u, Field<Scalar>& v);
+
+    void DensStep(double dt);
+    void VelStep(double dt);
+
+    /// <summary>
+    /// Sets atSource for the cells overlapping the finest cells [xBegin, xEnd) of row y.
+    /// </summary>
+    void MarkRow(int y, int xBegin, int xEnd, std::vector<int8_t>& atSource) const;
+
+    /// <summary>
+    /// Sets atSource for the cells overlapping the footprint of a grid source or the bounds of a procedural one,
+    /// for every source whose strength is not zero.
+    /// </summary>
+    void MarkSources(std::vector<int8_t>& atSource) const;
+
+    /// <summary>
+    /// Refines the cells across which the velocity or the density changes by more than its threshold and those
+    /// overlapping a source, merges the smooth ones, and carries every field over to the new cells.
+    /// </summary>
+    void Remesh();
+
+public:
+    /// <summary>
+    /// Constructs a simulation of a domain N finest cells wide, starting from the uniform grid of minLevel.
+    /// </summary>
+    /// <param name="N">The width of the domain in finest cells, a power of two.</param>
+    /// <param name="minLevel">The coarsest level cells are merged to; its cells are N >> minLevel wide.</param>
+    QuadtreeSimulator(unsigned int N = 1024, int minLevel = 5);
+
+    /// <summary>
+    /// Advances the simulation by one step, adapting the grid first on every remeshInterval-th tick.
+    /// </summary>
+    /// <param name="dt">The simulated time to advance by, in seconds (default 0.016).</param>
+    void Tick(double dt = 0.016);
+
+    /// <summary>
+    /// Clears the fields and returns to the uniform grid of minLevel.
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Returns the names of the scenes, the same as those of FluidSimulator.
+    /// </summary>
+    std::vector<std::string> GetSceneNames() const;
+
+    /// <summary>
+    /// Resets the simulation and replaces its sources with those of the named scene. Does nothing for an unknown
+    /// name.
+    /// </summary>
+    void ActivateSceneByName(const std::string& sceneName);
+
+    /// <summary>
+    /// Sets how many ticks pass between two adaptations of the grid.
+    /// </summary>
+    void SetRemeshInterval(int ticks);
+
+    /// <summary>
+    /// Sets the change of velocity and of density across a cell above which it is split.
+    /// </summary>
+    void SetRefinementThresholds(double vorticity, double density);
+
+    /// <summary>
+    /// Sets the number of cells beyond which the grid stops refining. Below it every cell over a threshold is split;
+    /// once splitting all of them would exceed it, only those exceeding their thresholds the most are.
+    /// </summary>
+    void SetCellBudget(int cells);
+
+    /// <summary>
+    /// Sets the number of threads the passes over the cells are split across. 0 uses one per core.
+    /// </summary>
+    void SetThreadCount(unsigned int threadCount);
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the divergence, at which the pressure solve stops.
+    /// </summary>
+    void SetPressureTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the field being diffused, at which the diffusion sweeps stop.
+    /// 0 always runs the maximum number of sweeps.
+    /// </summary>
+    void SetDiffusionTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the most sweeps one diffusion solve runs.
+    /// </summary>
+    void SetMaxDiffusionIterations(int iterations);
+
+    /// <summary>
+    /// Returns the cells of the simulation.
+    /// </summary>
+    const QuadtreeGrid& GetGrid() const;
+
+    /// <summary>
+    /// Returns the horizontal velocity of every cell.
+    /// </summary>
+    const Field<Scalar>& GetU() const;
+
+    /// <summary>
+    /// Returns the vertical velocity of every cell.
+    /// </summary>
+    const Field<Scalar>& GetV() const;
+
+    /// <summary>
+    /// Returns the density of every cell.
+    /// </summary>
+    const Field<Scalar>& GetDens() const;
+
+    /// <summary>
+    /// Returns the density summed over the finest cells, comparable with the sum over the grid of FluidSimulator.
+    /// </summary>
+    double GetTotalDensity() const;
+
+    /// <summary>
+    /// Returns the RMS of the divergence of the velocity, in the scaling of FluidSimulator.
+    /// </summary>
+    double GetRmsDivergence() const;
+
+    const QuadtreeTickTimings& GetLastTickTimings() const;
+
+    const SolveStats& GetLastPressureStats() const;
+
+    unsigned int GetThreadCount() const;
+};
@@ -3,7 +3,8 @@
 #include "velocitysource.h"
 #include "glm_includes.h"
 
-class RectVelocitySource : public VelocitySource {
+template <typename Scalar>
+class RectVelocitySource : public VelocitySource<Scalar> {
 private:
 	/// <summary>
 	/// The width of the rectangualr area where velocity is applied. 
@@ -13,13 +14,13 @@ private:
 
 	/// <summary>
 	/// The height of the rectangualr area where velocity is applied. 
-	/// Clamped between [0, N] 
+	/// Clamped between [0, M] 
 	/// </summary>
 	int height;
 
 	/// <summary>
 	/// The lower left position of the velocity source. 
-	/// Clamped between [(0, 0), (N - 1, N - 1)]
+	/// Clamped between [(0, 0), (N - 1, M - 1)]
 	/// </summary>
 	glm::ivec2 position; 
 
@@ -29,5 +30,14 @@ public:
 	/// </summary>
 	/// <param name="width"></param>
 	/// <param name="height"></param>
-	RectVelocitySource(unsigned int N, int width, int height, int x, int y, double uVel, double vVel);
+	RectVelocitySource(unsigned int N, unsigned int M, int width, int height, int x, int y, double uVel, double vVel);
+
+	std::unique_ptr<VelocitySource<Scalar>> Clone() const override;
+
+	/// <summary>
+	/// Builds the footprint of a rectangle whose lower left cell is (x, y), clamped to the grid like the
+	/// constructor clamps the source: every covered cell gets value.
+	/// </summary>
+	static SourceFootprint<Scalar> Rasterize(unsigned int N, unsigned int M, int width, int height, int x, int y,
+		Scalar value);
 };
\ No newline at end of file
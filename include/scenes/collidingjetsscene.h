@@ -0,0 +1,12 @@
+#pragma once
+
+#include "scene3d.h"
+
+/// <summary>
+/// Two jets of smoke fired at each other from opposite sides of the volume, spreading into a sheet where they meet.
+/// </summary>
+template <typename Scalar>
+class CollidingJetsScene : public Scene3D<Scalar> {
+public:
+	CollidingJetsScene(unsigned int N, const std::string& name = "Colliding Jets Scene");
+};
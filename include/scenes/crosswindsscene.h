@@ -2,7 +2,8 @@
 
 #include "scene.h"
 
-class CrosswindsScene : public Scene {
+template <typename Scalar>
+class CrosswindsScene : public Scene<Scalar> {
 public:
-	CrosswindsScene(unsigned int N, const std::string& name =  "Crosswind Scene");
+	CrosswindsScene(unsigned int N, unsigned int M, const std::string& name =  "Crosswind Scene");
 };
\ No newline at end of file
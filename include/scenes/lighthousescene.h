@@ -0,0 +1,9 @@
+#pragma once
+
+#include "scene.h"
+
+template <typename Scalar>
+class LighthouseScene : public Scene<Scalar> {
+public:
+	LighthouseScene(unsigned int N, unsigned int M, const std::string& name = "Lighthouse Scene");
+};
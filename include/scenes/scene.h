@@ -1,7 +1,6 @@
 #pragma once
 
-#include "densitysource.h"
-#include "velocitysource.h"
+#include "sourceregistry.h"
 
 #include <string>
 
@@ -9,28 +8,30 @@
 /// A class representing a scene in the simulation. 
 /// A scene is composed of components that alter the simulation, such as 
 /// density sourrces and velocity sources. 
+/// Scalar is the floating point type of the simulation the scene is loaded into (float or double).
 /// </summary>
+template <typename Scalar>
 class Scene {
 protected:
-	// The width of the inner grid (non-boundary cells) excluding the boundary.
-	// The total grid dimensions are (N+2) x (N+2) to account for boundaries.
+	// The width and height of the inner grid (non-boundary cells) excluding the boundary.
+	// The total grid dimensions are (N+2) x (M+2) to account for boundaries.
 	unsigned int N;
+	unsigned int M;
 
 	// The name of the scene
 	std::string name; 
 
-	// Density sources present in the current simulation 
-	std::vector<DensitySource> densSources;
-
-	// Velocity sources present in the current simulation 
-	std::vector<VelocitySource> velSources; 
+	// Density and velocity sources of the scene, copied into the simulator when the scene is activated
+	SourceRegistry<Scalar> sources;
 
 public:
 	/// <summary>
 	/// Constructs a scene object
 	/// </summary>
+	/// <param name="N"> The width of the inner grid </param>
+	/// <param name="M"> The height of the inner grid </param>
 	/// <param name="name"> The name of the scene </param>
-	Scene(unsigned int N = 1000, const std::string& name = "Empty Scene");
+	Scene(unsigned int N = 1000, unsigned int M = 1000, const std::string& name = "Empty Scene");
 
 	/// <summary>
 	/// Returns the name of the string.
@@ -39,14 +40,8 @@ public:
 	const std::string& GetName() const; 
 
 	/// <summary>
-	/// Returns the density sources in the scene.
-	/// </summary>
-	/// <returns> A constant DensitySource vector reference containing the density sources in the scene. </returns>
-	const std::vector<DensitySource>& GetDensSources() const; 
-
-	/// <summary>
-	/// Returns the velocity sources in the kscene.
+	/// Returns the density and velocity sources in the scene.
 	/// </summary>
-	/// <returns> A constant VelocitySource vector reference containing the velocity sources in the scene. </returns>
-	const std::vector<VelocitySource>& GetVelocitySources() const; 
+	/// <returns> A constant reference to the registry owning the sources of the scene. </returns>
+	const SourceRegistry<Scalar>& GetSources() const; 
 };
\ No newline at end of file
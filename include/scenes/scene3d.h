@@ -0,0 +1,43 @@
+#pragma once
+
+#include "volumesourceregistry.h"
+
+#include <string>
+
+/// <summary>
+/// A scene of FluidSimulator3D: a named set of volume sources, copied into the simulator when the scene is
+/// activated.
+/// Scalar is the floating point type of the simulation the scene is loaded into (float or double).
+/// </summary>
+template <typename Scalar>
+class Scene3D {
+protected:
+	// The width of the inner volume (non-boundary cells) along every axis.
+	// The total dimensions are (N+2)^3 to account for boundaries.
+	unsigned int N;
+
+	// The name of the scene
+	std::string name;
+
+	// Sources of the scene
+	VolumeSourceRegistry<Scalar> sources;
+
+public:
+	/// <summary>
+	/// Constructs a scene without sources
+	/// </summary>
+	/// <param name="N"> The width of the inner volume </param>
+	/// <param name="name"> The name of the scene </param>
+	Scene3D(unsigned int N = 100, const std::string& name = "Empty Scene");
+
+	/// <summary>
+	/// Returns the name of the scene.
+	/// </summary>
+	const std::string& GetName() const;
+
+	/// <summary>
+	/// Returns the sources in the scene.
+	/// </summary>
+	/// <returns> A constant reference to the registry owning the sources of the scene. </returns>
+	const VolumeSourceRegistry<Scalar>& GetSources() const;
+};
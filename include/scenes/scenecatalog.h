@@ -0,0 +1,14 @@
+#pragma once
+
+#include "scene.h"
+
+#include <map>
+#include <string>
+
+/// <summary>
+/// Creates every scene available to the simulations, for a grid with an inner width of N and an inner height of M,
+/// keyed by name.
+/// Shared by the simulators, so the uniform and the adaptive grids offer the same scenes.
+/// </summary>
+template <typename Scalar>
+std::map<std::string, Scene<Scalar>> CreateScenes(unsigned int N, unsigned int M);
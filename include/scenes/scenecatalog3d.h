@@ -0,0 +1,12 @@
+#pragma once
+
+#include "scene3d.h"
+
+#include <map>
+#include <string>
+
+/// <summary>
+/// Creates every scene available to FluidSimulator3D, for a volume with an inner width of N, keyed by name.
+/// </summary>
+template <typename Scalar>
+std::map<std::string, Scene3D<Scalar>> CreateScenes3D(unsigned int N);
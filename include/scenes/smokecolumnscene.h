@@ -0,0 +1,12 @@
+#pragma once
+
+#include "scene3d.h"
+
+/// <summary>
+/// A column of smoke rising from a ball near the floor of the volume, bent by a crosswind higher up.
+/// </summary>
+template <typename Scalar>
+class SmokeColumnScene : public Scene3D<Scalar> {
+public:
+	SmokeColumnScene(unsigned int N, const std::string& name = "Smoke Column Scene");
+};
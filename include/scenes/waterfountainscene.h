@@ -2,7 +2,8 @@
 
 #include "scene.h"
 
-class WaterFountainScene : public Scene {
+template <typename Scalar>
+class WaterFountainScene : public Scene<Scalar> {
 public:
-	WaterFountainScene(unsigned int N, const std::string& name = "Water Fountain Scene");
+	WaterFountainScene(unsigned int N, unsigned int M, const std::string& name = "Water Fountain Scene");
 };
\ No newline at end of file
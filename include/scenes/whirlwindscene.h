@@ -4,7 +4,8 @@
 #include "circularsource.h"
 #include "rectvelocitysource.h"
 
-class WhirlwindScene : public Scene {
+template <typename Scalar>
+class WhirlwindScene : public Scene<Scalar> {
 public: 
-	WhirlwindScene(unsigned int N = 1000, const std::string& name = "Whirlwind Scene"); 
+	WhirlwindScene(unsigned int N = 1000, unsigned int M = 1000, const std::string& name = "Whirlwind Scene"); 
 };
\ No newline at end of file
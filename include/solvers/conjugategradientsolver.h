@@ -0,0 +1,51 @@
+#pragma once
+
+#include "solvers/pressuresolver.h"
+
+enum class PreconditionerType {
+    JACOBI = 0,          // Divides by the diagonal. Cheapest, but the iteration count grows linearly with N
+    INCOMPLETE_POISSON,  // Sparse approximate inverse built from the lower triangle, applied with two parallel stencils
+    MIC0                 // Modified incomplete Cholesky with no fill-in. Fewest iterations, but its triangular solves
+                         // run serially
+};
+
+/// <summary>
+/// Matrix-free preconditioned conjugate gradient solver for the pressure equation of Project.
+///
+/// The matrix is never stored: applying it is the same five-point stencil over the couplings as the relaxation, and
+/// the preconditioners only keep one extra field. Conjugate gradient reduces the error over the whole grid at every
+/// iteration, so unlike relaxation it keeps converging when obstacles split the fluid into narrow channels.
+/// </summary>
+template <typename Scalar>
+class ConjugateGradientSolver : public PressureSolver<Scalar> {
+private:
+    PreconditionerType preconditionerType;
+
+    Field<Scalar> residual;   // rhs - A solution
+    Field<Scalar> z;          // Preconditioned residual
+    Field<Scalar> direction;  // Search direction
+    Field<Scalar> product;    // A direction, and the intermediate vector of the preconditioners
+
+    // MIC(0): 1 / sqrt(pivot) of every cell, from the factorization A ~ (F + E) E^-2 (F + E)^T, where F is the strict
+    // lower triangle of A and E the diagonal of pivots
+    Field<Scalar> inversePivot;
+
+    void BuildPreconditioner();
+    void Precondition(ThreadPool& threadPool);
+
+protected:
+    void CouplingsChanged() override;
+
+public:
+    /// <summary>
+    /// Sets up the solver for a grid with an inner width of N, an inner height of M and no obstacles.
+    /// </summary>
+    ConjugateGradientSolver(unsigned int N, unsigned int M, PreconditionerType preconditioner);
+
+    int Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs) override;
+
+    /// <summary>
+    /// Returns the preconditioner the solver was built with.
+    /// </summary>
+    PreconditionerType GetPreconditioner() const;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+/// <summary>
+/// Complex discrete Fourier transform of a fixed length n, X[k] = sum of x[j] * exp(-2 pi i j k / n).
+/// Powers of two use an iterative radix-2 transform. Other lengths are turned into a circular convolution of
+/// power-of-two length (Bluestein's algorithm), so every length runs in O(n log n).
+/// The plan is immutable once built, and every transform takes caller-owned scratch, so one plan can be shared by
+/// any number of threads.
+/// </summary>
+class Fft {
+private:
+    using Complex = std::complex<double>;
+
+    int n;
+    int radix2Size;                       // Length of the radix-2 transform: n, or the Bluestein convolution length
+    std::vector<int> bitReversed;         // Index permutation of the radix-2 transform
+    std::vector<Complex> twiddles;        // exp(-2 pi i k / radix2Size) for k < radix2Size / 2
+    std::vector<Complex> chirp;           // Bluestein: exp(-pi i k^2 / n) for k < n
+    std::vector<Complex> chirpSpectrum;   // Bluestein: transform of the conjugate chirp, wrapped to radix2Size
+
+    void Radix2(Complex* data) const;
+
+public:
+    /// <summary>
+    /// Builds the plan for transforms of length n.
+    /// </summary>
+    explicit Fft(int n);
+
+    /// <summary>
+    /// The transform length.
+    /// </summary>
+    int Size() const;
+
+    /// <summary>
+    /// Number of complex values the scratch buffer passed to Forward() and Inverse() must hold.
+    /// </summary>
+    size_t ScratchSize() const;
+
+    /// <summary>
+    /// Replaces data[0..n) with its discrete Fourier transform.
+    /// </summary>
+    void Forward(std::complex<double>* data, std::complex<double>* scratch) const;
+
+    /// <summary>
+    /// Replaces data[0..n) with its inverse transform, including the 1 / n, so Inverse(Forward(x)) = x.
+    /// </summary>
+    void Inverse(std::complex<double>* data, std::complex<double>* scratch) const;
+};
+
+/// <summary>
+/// Type II discrete cosine transform of a fixed length n, C[k] = sum of x[j] * cos(pi k (2j + 1) / (2n)), and its
+/// exact inverse. These diagonalize the 1D Laplacian with mirrored boundary cells (a Neumann wall halfway between
+/// the last inner cell and the boundary cell). Computed with one complex transform of length n (Makhoul's method).
+/// </summary>
+class Dct {
+private:
+    using Complex = std::complex<double>;
+
+    Fft fft;
+    std::vector<Complex> shift;  // exp(-pi i k / (2n))
+
+public:
+    /// <summary>
+    /// Builds the plan for transforms of length n.
+    /// </summary>
+    explicit Dct(int n);
+
+    /// <summary>
+    /// Number of complex values the scratch buffer passed to Forward() and Inverse() must hold.
+    /// </summary>
+    size_t ScratchSize() const;
+
+    /// <summary>
+    /// out[0..n) = DCT-II of in[0..n). in and out may be the same array.
+    /// </summary>
+    void Forward(const double* in, double* out, std::complex<double>* scratch) const;
+
+    /// <summary>
+    /// out[0..n) = the sequence whose DCT-II is in[0..n). in and out may be the same array.
+    /// </summary>
+    void Inverse(const double* in, double* out, std::complex<double>* scratch) const;
+};
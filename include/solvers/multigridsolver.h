@@ -0,0 +1,69 @@
+#pragma once
+
+#include "solvers/pressuresolver.h"
+
+#include <vector>
+
+/// <summary>
+/// Geometric multigrid solver for the pressure equation of Project.
+///
+/// Cells are merged 2x2 into the cells of the next coarser level until the grid is a few cells wide and high; the
+/// short side of a rectangular grid stops at a single cell while the long side keeps halving. A coarse face
+/// is as open as the average of the fine faces it covers, so partially blocked faces keep a fractional coupling.
+/// Each V-cycle smooths with red-black Gauss-Seidel, restricts the residual by summing the four children and
+/// interpolates the correction back bilinearly, which costs O(N^2) per cycle and converges at a rate that does not
+/// depend on N.
+///
+/// Walls thinner than a coarse cell are invisible to the coarse levels, which then couple the fluid on both sides
+/// and let plain V-cycles stall. The V-cycle is therefore used as the preconditioner of a conjugate gradient
+/// iteration, which corrects the few modes the coarse levels get wrong and keeps the cycle count low around any
+/// obstacle layout.
+/// </summary>
+template <typename Scalar>
+class MultigridSolver : public PressureSolver<Scalar> {
+private:
+    struct Level {
+        int N;                          // Inner width of this level
+        int M;                          // Inner height of this level
+        Field<Scalar> x;                // Solution (correction on the coarse levels)
+        Field<Scalar> b;                // Right hand side
+        Field<Scalar> r;                // Residual b - A x
+        Field<Scalar> eastWeight;       // Coupling of cell (i, j) to (i + 1, j), 0 across solid faces
+        Field<Scalar> northWeight;      // Coupling of cell (i, j) to (i, j + 1)
+        Field<Scalar> inverseDiagonal;  // 1 / (sum of the couplings of the cell), 0 for cells outside the fluid
+    };
+
+    // levels[0] is the simulation grid, each following level half as wide and half as high.
+    // The V-cycle on levels[0] approximately solves A z = r for the conjugate gradient iteration below.
+    std::vector<Level> levels;
+
+    // Conjugate gradient state on the simulation grid
+    Field<Scalar> residual;          // rhs - A solution
+    Field<Scalar> previousResidual;  // Residual of the previous iteration, for the flexible update of the direction
+    Field<Scalar> direction;         // Search direction
+    Field<Scalar> product;           // A direction
+
+    int preSmoothingSweeps;
+    int postSmoothingSweeps;
+    int coarsestSweeps;
+
+    void BuildCoarseLevel(const Level& fine, Level& coarse);
+    void Smooth(ThreadPool& threadPool, Level& level, int sweeps);
+    void ComputeResidual(ThreadPool& threadPool, Level& level);
+    void Restrict(ThreadPool& threadPool, const Level& fine, Level& coarse);
+    void ProlongAndCorrect(ThreadPool& threadPool, const Level& coarse, Level& fine);
+    void VCycle(ThreadPool& threadPool, size_t levelIndex);
+    const Field<Scalar>& Precondition(ThreadPool& threadPool, const Field<Scalar>& r);
+
+protected:
+    void CouplingsChanged() override;
+
+public:
+    /// <summary>
+    /// Builds the level hierarchy for a grid with an inner width of N, an inner height of M and no obstacles.
+    /// Each iteration of Solve() runs one V-cycle.
+    /// </summary>
+    MultigridSolver(unsigned int N, unsigned int M);
+
+    int Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs) override;
+};
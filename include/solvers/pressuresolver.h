@@ -0,0 +1,153 @@
+#pragma once
+
+#include "cellbitmask.h"
+#include "gridlayout.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <vector>
+
+/// <summary>
+/// Convergence of the most recent linear solve.
+/// </summary>
+struct SolveStats {
+    int iterations = 0;            // Cycles (or iterations) performed
+    double initialResidual = 0.0;  // RMS residual of the initial guess
+    double finalResidual = 0.0;    // RMS residual of the returned solution
+    double rhsNorm = 0.0;          // RMS of the right hand side, the scale the tolerance is relative to
+};
+
+/// <summary>
+/// Base of the iterative solvers for the pressure Poisson equation of Project,
+/// (number of fluid neighbors) * p - (sum of fluid neighbors of p) = rhs, over the fluid cells of the grid.
+/// Obstacles and the domain walls are solid: no flux crosses them (a Neumann condition), so they drop out of the
+/// stencil of their fluid neighbors.
+///
+/// Holds the couplings of the cells derived from the obstacle mask, the previous solution that warm starts the next
+/// solve, and the operations every solver needs: applying the matrix, dot products and balancing the right hand side.
+/// </summary>
+template <typename Scalar>
+class PressureSolver {
+private:
+    void BuildCouplings(const CellBitmask& obstacle);
+
+protected:
+    int N;                          // Inner width of the grid
+    int M;                          // Inner height of the grid
+    Field<Scalar> eastWeight;       // Coupling of cell (i, j) to (i + 1, j), 1 between two fluid cells, else 0
+    Field<Scalar> northWeight;      // Coupling of cell (i, j) to (i, j + 1)
+    Field<Scalar> inverseDiagonal;  // 1 / (number of fluid neighbors), 0 for cells without an equation
+    int fluidCells;                 // Number of cells with an equation
+
+    Field<Scalar> solution;         // Kept between calls as the initial guess of the next Solve()
+
+    double tolerance;
+    int maxIterations;
+
+    SolveStats lastStats;
+
+    PressureSolver(unsigned int N, unsigned int M, double tolerance, int maxIterations);
+
+    /// <summary>
+    /// Called after the couplings changed, so derived solvers can rebuild what they derive from them.
+    /// </summary>
+    virtual void CouplingsChanged() = 0;
+
+    /// <summary>
+    /// out = A in over the inner cells.
+    /// </summary>
+    void ApplyOperator(ThreadPool& threadPool, const Field<Scalar>& in, Field<Scalar>& out) const;
+
+    /// <summary>
+    /// Dot product of two fields over the inner cells, accumulated in double.
+    /// </summary>
+    double Dot(ThreadPool& threadPool, const Field<Scalar>& a, const Field<Scalar>& b) const;
+
+    /// <summary>
+    /// Computes residual = rhs - A solution, after removing the mean of rhs over the fluid cells. With solid walls all
+    /// around the equation only has a solution if the divergence sums to zero, which sources and advection do not
+    /// keep exactly. Records the norms in lastStats.
+    /// </summary>
+    /// <returns>The RMS of the residual.</returns>
+    double InitializeResidual(ThreadPool& threadPool, const Field<Scalar>& rhs, Field<Scalar>& residual);
+
+    /// <summary>
+    /// Pins the mean of the solution to zero and copies it to p. Cells inside obstacles get the average of their
+    /// fluid neighbors, so gradients next to an obstacle are close to zero across it.
+    /// </summary>
+    void StorePressure(Field<Scalar>& p);
+
+    // Rows are handed out in chunks of at least ~4096 cells so small grids run on the calling thread
+    static int MinRowsPerChunk(int N)
+    {
+        return std::max(1, 4096 / N);
+    }
+
+    // Runs body(j) for the inner rows 1..M of a grid N cells wide across the pool
+    template <typename Body>
+    static void ForEachRow(ThreadPool& threadPool, int N, int M, Body body)
+    {
+        threadPool.ParallelFor(1, M + 1, MinRowsPerChunk(N), [&](int rowBegin, int rowEnd) {
+            for (int j = rowBegin; j < rowEnd; j++) {
+                body(j);
+            }
+        });
+    }
+
+    // Sums body(j) over the inner rows 1..M. Every row gets its own slot so the total does not depend on the thread
+    // count.
+    template <typename Body>
+    static double SumRows(ThreadPool& threadPool, int N, int M, Body body)
+    {
+        std::vector<double> rowSums(M + 2, 0.0);
+        ForEachRow(threadPool, N, M, [&](int j) {
+            rowSums[j] = body(j);
+        });
+        double sum = 0.0;
+        for (double rowSum : rowSums) {
+            sum += rowSum;
+        }
+        return sum;
+    }
+
+public:
+    virtual ~PressureSolver() = default;
+
+    /// <summary>
+    /// Rebuilds the couplings from the obstacle mask of the simulation grid.
+    /// Call this whenever obstacles are added or removed.
+    /// </summary>
+    /// <param name="obstacle">A set bit per solid cell.</param>
+    void SetObstacles(const CellBitmask& obstacle);
+
+    /// <summary>
+    /// Solves the pressure equation for the divergence rhs, starting from the previous solution.
+    /// Iterates until the RMS residual falls below tolerance times the RMS of rhs, or the iteration cap is reached.
+    /// </summary>
+    /// <param name="threadPool">Workers the passes over the grid are split across.</param>
+    /// <param name="p">Receives the pressure of the inner cells. The boundary cells are left to the caller's boundary
+    /// conditions.</param>
+    /// <param name="rhs">The scaled divergence of the velocity field.</param>
+    /// <returns>The number of iterations performed.</returns>
+    virtual int Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs) = 0;
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the right hand side, at which Solve() stops.
+    /// </summary>
+    void SetTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the maximum number of iterations per Solve().
+    /// </summary>
+    void SetMaxIterations(int iterations);
+
+    /// <summary>
+    /// Forgets the previous solution, so the next Solve() starts from zero.
+    /// </summary>
+    void ResetInitialGuess();
+
+    /// <summary>
+    /// Returns the convergence of the most recent Solve().
+    /// </summary>
+    const SolveStats& GetLastStats() const;
+};
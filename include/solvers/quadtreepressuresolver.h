@@ -0,0 +1,101 @@
+#pragma once
+
+#include "gridlayout.h"
+#include "quadtreegrid.h"
+#include "solvers/pressuresolver.h"
+#include "threadpool.h"
+
+#include <vector>
+
+/// <summary>
+/// Multigrid preconditioned conjugate gradient solver for the pressure equation of a QuadtreeGrid:
+/// sum over the faces f of cell c of weight(f) * (p(c) - p(neighbor across f)) = rhs(c). The edges of the domain are
+/// solid walls, so the equation has a solution only when rhs sums to zero; its mean is removed first.
+///
+/// The coarse levels follow the tree: each level merges every group of four sibling unknowns into their parent,
+/// leaving the others as they are, until a few unknowns remain. The coupling of two coarse unknowns is the length of
+/// the faces between them over the distance between their centers, as if the coarse level had been discretized
+/// directly. Each V-cycle smooths with forward Gauss-Seidel sweeps in Z-order on the way down and backward sweeps on
+/// the way up, restricts the residual by summing it over the merged unknowns and passes the correction back to
+/// each of them unchanged.
+/// </summary>
+template <typename Scalar>
+class QuadtreePressureSolver {
+private:
+    struct Level {
+        int count;                        // Number of unknowns
+        std::vector<int> rowBegin;        // The couplings of unknown k are column and weight [rowBegin[k], rowBegin[k + 1])
+        std::vector<int> column;
+        std::vector<Scalar> weight;
+        std::vector<double> length;       // Total length of the faces behind each coupling, in finest cells
+        std::vector<Scalar> inverseDiagonal;
+        std::vector<int> size;            // Width of each unknown, in finest cells
+        std::vector<int> node;            // The node of the tree each unknown covers
+        std::vector<int> coarse;          // The unknown of the next coarser level each unknown is merged into
+        Field<Scalar> x;                  // Solution (correction on the coarse levels)
+        Field<Scalar> b;                  // Right hand side
+        Field<Scalar> r;                  // Residual b - A x
+    };
+
+    // levels[0] holds the cells of the grid, each following level fewer and larger unknowns
+    std::vector<Level> levels;
+
+    // Conjugate gradient state on the cells of the grid
+    Field<Scalar> residual;
+    Field<Scalar> previousResidual;
+    Field<Scalar> direction;
+    Field<Scalar> product;
+
+    double tolerance;
+    int maxIterations;
+    int preSmoothingSweeps;
+    int postSmoothingSweeps;
+    int coarsestSweeps;
+
+    SolveStats lastStats;
+
+    // Merges the complete groups of four siblings of fine. Returns false when there are none left.
+    bool BuildCoarseLevel(const QuadtreeGrid& grid, Level& fine, Level& coarse);
+    void Smooth(Level& level, int sweeps, bool backward);
+    void ComputeResidual(ThreadPool& threadPool, Level& level);
+    void ApplyOperator(ThreadPool& threadPool, const Level& level, const Field<Scalar>& in, Field<Scalar>& out) const;
+    double Dot(ThreadPool& threadPool, const Field<Scalar>& a, const Field<Scalar>& b) const;
+    void VCycle(ThreadPool& threadPool, size_t levelIndex);
+    const Field<Scalar>& Precondition(ThreadPool& threadPool, const Field<Scalar>& r);
+
+public:
+    /// <summary>
+    /// Constructs a solver without unknowns. Call SetGrid() before Solve().
+    /// </summary>
+    QuadtreePressureSolver(double tolerance = 1.0e-4, int maxIterations = 20);
+
+    /// <summary>
+    /// Rebuilds the couplings and the level hierarchy for the cells of grid. Call this whenever the grid adapts.
+    /// </summary>
+    void SetGrid(const QuadtreeGrid& grid);
+
+    /// <summary>
+    /// Solves the pressure equation for rhs, starting from p. Iterates until the RMS residual falls below tolerance
+    /// times the RMS of rhs, or the iteration cap is reached. The mean of the returned pressure is zero.
+    /// </summary>
+    /// <param name="threadPool">Workers the passes over the cells are split across.</param>
+    /// <param name="p">The initial guess, one value per cell, replaced by the pressure.</param>
+    /// <param name="rhs">The net outflow of every cell.</param>
+    /// <returns>The number of iterations performed.</returns>
+    int Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs);
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the right hand side, at which Solve() stops.
+    /// </summary>
+    void SetTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the maximum number of iterations per Solve().
+    /// </summary>
+    void SetMaxIterations(int iterations);
+
+    /// <summary>
+    /// Returns the convergence of the most recent Solve().
+    /// </summary>
+    const SolveStats& GetLastStats() const;
+};
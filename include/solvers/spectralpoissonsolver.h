@@ -0,0 +1,66 @@
+#pragma once
+
+#include "solvers/fft.h"
+#include "solvers/pressuresolver.h"
+
+#include <complex>
+#include <vector>
+
+/// <summary>
+/// Direct solver for the pressure equation of Project on a box without obstacles, 4 p - (sum of neighbors) = rhs.
+///
+/// On an empty box the five-point Laplacian is diagonalized by separable transforms: cosine transforms (DCT-II) for
+/// the mirrored boundary cells of solid walls, Fourier transforms for a periodic domain. Transforming the rows and
+/// then the columns, dividing by the eigenvalues and transforming back solves the system exactly in O(N M log N),
+/// with no iterations and no warm start. The rows and the columns are split across the thread pool.
+/// </summary>
+template <typename Scalar>
+class SpectralPoissonSolver {
+private:
+    int N;
+    int M;
+    bool periodic;
+
+    Fft fft;                                        // Periodic domain, along the rows
+    Fft columnFft;                                  // Periodic domain, along the columns
+    Dct dct;                                        // Solid walls, along the rows
+    Dct columnDct;                                  // Solid walls, along the columns
+    std::vector<double> eigenvalues;                // Eigenvalues of the 1D operator, 2 - 2 cos(angle of mode k)
+    std::vector<double> columnEigenvalues;          // The same along the columns
+
+    std::vector<double> spectrum;                   // Solid walls: M rows of N real coefficients
+    std::vector<std::complex<double>> complexSpectrum;  // Periodic domain: M rows of N complex coefficients
+
+    SolveStats lastStats;
+
+    void SolveWalls(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs);
+    void SolvePeriodic(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs);
+    void MeasureResidual(ThreadPool& threadPool, const Field<Scalar>& p, const Field<Scalar>& rhs);
+
+public:
+    /// <summary>
+    /// Plans the transforms for a grid with an inner width of N and an inner height of M.
+    /// </summary>
+    /// <param name="periodic">True for a domain that wraps around at its edges, false for solid walls.</param>
+    SpectralPoissonSolver(unsigned int N, unsigned int M, bool periodic);
+
+    /// <summary>
+    /// Returns whether the solver was built for a periodic domain.
+    /// </summary>
+    bool IsPeriodic() const;
+
+    /// <summary>
+    /// Solves the pressure equation for the divergence rhs. The mean of rhs, which has no solution, is dropped and
+    /// the pressure is returned with a mean of zero.
+    /// </summary>
+    /// <param name="threadPool">Workers the row and column transforms are split across.</param>
+    /// <param name="p">Receives the pressure of the inner cells. The boundary cells are left to the caller's boundary
+    /// conditions.</param>
+    /// <param name="rhs">The scaled divergence of the velocity field.</param>
+    void Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs);
+
+    /// <summary>
+    /// Returns the residual of the most recent Solve(), which counts as a single iteration.
+    /// </summary>
+    const SolveStats& GetLastStats() const;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "gridlayout.h"
+#include "solvers/pressuresolver.h"
+#include "threadpool.h"
+#include "tileactivity.h"
+
+#include <vector>
+
+/// <summary>
+/// Multigrid preconditioned conjugate gradient solver for the pressure equation of Project over the active tiles
+/// only, so the cost of a solve follows the area holding smoke or motion rather than the size of the grid.
+///
+/// The unknowns are the fluid cells of the active tiles, gathered into compact arrays. Cells outside them, the still
+/// air beyond the halo of the active tiles, are treated like obstacles: no flux crosses into them (a homogeneous
+/// Neumann condition), so each connected region of active cells is a closed box of its own, whose right hand side
+/// is balanced and whose pressure is pinned to a mean of zero separately. Cells just outside a region get the average
+/// pressure of the unknowns next to them, so the gradient across the edge is close to zero.
+///
+/// The coarse levels merge the unknowns 2x2 by their coordinates, as MultigridSolver merges the cells of the whole
+/// grid, with couplings of half the fine faces between two merged unknowns. Each V-cycle smooths with red-black
+/// Gauss-Seidel, restricts the residual by summing it over the merged unknowns and passes the correction back to
+/// each of them unchanged.
+/// </summary>
+template <typename Scalar>
+class TilePressureSolver {
+private:
+    struct Level {
+        int count;                            // Number of unknowns
+        int redCount;                         // Unknowns [0, redCount) are red, the rest black
+        bool colored;                         // Whether no two coupled unknowns share a color, false when a
+                                              // periodic level of odd width wraps onto itself
+        int width;                            // Width and height of the grid of this level, in unknowns
+        int height;
+        std::vector<int> x0;                  // Column and row of every unknown on the grid of this level
+        std::vector<int> y0;
+        std::vector<int> neighbor;            // Four per unknown, west, east, south and north; count where there is
+                                              // none, which indexes a zero past the end of x
+        std::vector<Scalar> weight;           // The coupling to each of the four neighbors, 0 where there is none
+        std::vector<Scalar> inverseDiagonal;  // 1 / (sum of the couplings), 0 for unknowns without neighbors
+        std::vector<int> coarse;              // The unknown of the next coarser level each unknown is merged into
+        std::vector<int> children;            // Four per unknown, the unknowns of the next finer level merged into
+                                              // it; the finer count where there are fewer
+        std::vector<int> index;               // The unknown at every position of the grid of this level, -1 where
+                                              // there is none; only the entries of the unknowns are ever set
+        Field<Scalar> x;                      // Solution (correction on the coarse levels), count + 1 values
+        Field<Scalar> b;                      // Right hand side
+        Field<Scalar> r;                      // Residual b - A x
+    };
+
+    int N;
+    int M;
+
+    // levels[0] holds the active fluid cells, each following level fewer and larger unknowns. Only the first
+    // levelCount are in use; the others keep their index maps for the next SetActiveCells().
+    std::vector<Level> levels;
+    int levelCount;
+
+    // The grid cell of every unknown of levels[0]
+    std::vector<int> cells;
+
+    // The connected region of every unknown of levels[0], and the number of unknowns of each region
+    std::vector<int> region;
+    std::vector<int> regionSize;
+
+    // The inactive cells next to the unknowns, each followed in edgeNeighbors by the unknowns it borders:
+    // edgeNeighbors[edgeBegin[e]] to [edgeBegin[e + 1]] for edge cell edgeCells[e]
+    std::vector<int> edgeCells;
+    std::vector<int> edgeBegin;
+    std::vector<int> edgeNeighbors;
+
+    // Conjugate gradient state on the unknowns of levels[0], each with a zero past the end like Level::x
+    Field<Scalar> values;
+    Field<Scalar> residual;
+    Field<Scalar> previousResidual;
+    Field<Scalar> direction;
+    Field<Scalar> product;
+
+    // The pressure of every grid cell, kept between calls as the initial guess of the next Solve()
+    Field<Scalar> solution;
+
+    double tolerance;
+    int maxIterations;
+    int preSmoothingSweeps;
+    int postSmoothingSweeps;
+    int coarsestSweeps;
+
+    SolveStats lastStats;
+
+    // Fills the colors and the inverse diagonal of a level whose unknowns, neighbors and couplings are set
+    void FinishLevel(Level& level);
+
+    // Merges the unknowns of fine 2x2 into those of coarse. Returns false when that would not shrink the level
+    // enough to be worth it.
+    bool BuildCoarseLevel(Level& fine, Level& coarse);
+
+    // Labels the connected regions of levels[0]
+    void FindRegions();
+
+    // Removes the mean over every region from the values x of levels[0]
+    void RemoveRegionMeans(Field<Scalar>& x) const;
+
+    void Smooth(ThreadPool& threadPool, Level& level, int sweeps);
+    void ComputeResidual(ThreadPool& threadPool, Level& level);
+    void ApplyOperator(ThreadPool& threadPool, const Level& level, const Field<Scalar>& in, Field<Scalar>& out) const;
+    double Dot(ThreadPool& threadPool, const Field<Scalar>& a, const Field<Scalar>& b) const;
+    void VCycle(ThreadPool& threadPool, size_t levelIndex);
+    const Field<Scalar>& Precondition(ThreadPool& threadPool, const Field<Scalar>& r);
+
+public:
+    // Iteration cap of Solve() unless set otherwise
+    static constexpr int DEFAULT_MAX_ITERATIONS = 20;
+
+    /// <summary>
+    /// Constructs a solver for a grid with an inner width of N and an inner height of M, without unknowns. Call
+    /// SetActiveCells() before Solve().
+    /// </summary>
+    TilePressureSolver(unsigned int N, unsigned int M, double tolerance = 1.0e-4,
+        int maxIterations = DEFAULT_MAX_ITERATIONS);
+
+    /// <summary>
+    /// Rebuilds the unknowns, their couplings and the level hierarchy from the fluid runs of the active tiles. Call
+    /// this whenever the tiles are updated; it costs about as much as one iteration of Solve().
+    /// </summary>
+    /// <param name="tiles">The active tiles, whose runs hold the fluid cells to solve for.</param>
+    /// <param name="periodic">Whether the domain wraps around at its edges.</param>
+    void SetActiveCells(const TileActivity<Scalar>& tiles, bool periodic);
+
+    /// <summary>
+    /// Solves the pressure equation for the divergence rhs over the active cells, starting from the previous
+    /// solution. Iterates until the RMS residual falls below tolerance times the RMS of rhs, or the iteration cap is
+    /// reached.
+    /// </summary>
+    /// <param name="threadPool">Workers the passes over the unknowns are split across.</param>
+    /// <param name="p">Receives the pressure of the active cells and of the inactive cells next to them. The other
+    /// cells are left untouched, the boundary cells to the caller's boundary conditions.</param>
+    /// <param name="rhs">The scaled divergence of the velocity field.</param>
+    /// <returns>The number of iterations performed.</returns>
+    int Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs);
+
+    /// <summary>
+    /// Sets the RMS residual, relative to the RMS of the right hand side, at which Solve() stops.
+    /// </summary>
+    void SetTolerance(double relativeTolerance);
+
+    /// <summary>
+    /// Sets the maximum number of iterations per Solve().
+    /// </summary>
+    void SetMaxIterations(int iterations);
+
+    /// <summary>
+    /// Forgets the previous solution, so the next Solve() starts from zero.
+    /// </summary>
+    void ResetInitialGuess();
+
+    /// <summary>
+    /// Returns the number of unknowns, the active fluid cells.
+    /// </summary>
+    int GetUnknownCount() const;
+
+    /// <summary>
+    /// Returns the convergence of the most recent Solve().
+    /// </summary>
+    const SolveStats& GetLastStats() const;
+};
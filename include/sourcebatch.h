@@ -0,0 +1,55 @@
+#pragma once
+
+#include "sourcefootprint.h"
+#include "sourceregistry.h"
+
+/// <summary>
+/// The static sources of a registry merged into one footprint per field. Applying the batch touches every covered
+/// cell once, however many sources overlap there, so a scene costs one pass per field plus its dynamic sources.
+/// Scalar is the floating point type of the simulation the sources are added to (float or double).
+/// </summary>
+template <typename Scalar>
+class SourceBatch {
+private:
+    SourceFootprint<Scalar> density;
+    SourceFootprint<Scalar> horizontalVelocity;
+    SourceFootprint<Scalar> verticalVelocity;
+
+    // Number of sources merged into the batch
+    size_t sourceCount;
+
+public:
+    /// <summary>
+    /// Constructs an empty batch.
+    /// </summary>
+    SourceBatch();
+
+    /// <summary>
+    /// Sums the footprints of every static source of the registry. Sources whose IsStatic() returns false are left
+    /// out and have to be applied on their own.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    /// <param name="sources">The sources to compile.</param>
+    SourceBatch(unsigned int N, unsigned int M, const SourceRegistry<Scalar>& sources);
+
+    /// <summary>
+    /// Returns the summed density of the static density sources.
+    /// </summary>
+    const SourceFootprint<Scalar>& GetDensity() const;
+
+    /// <summary>
+    /// Returns the summed horizontal velocity of the static velocity sources.
+    /// </summary>
+    const SourceFootprint<Scalar>& GetHorizontalVelocity() const;
+
+    /// <summary>
+    /// Returns the summed vertical velocity of the static velocity sources.
+    /// </summary>
+    const SourceFootprint<Scalar>& GetVerticalVelocity() const;
+
+    /// <summary>
+    /// Returns the number of sources merged into the batch.
+    /// </summary>
+    size_t GetSourceCount() const;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include "gridlayout.h"
+
+/// <summary>
+/// The cells a source adds to and the amount it adds to each, stored as runs of consecutive cells along the rows of
+/// the grid. Applying a source walks its runs, so the cost follows the area the source covers instead of the size
+/// of the grid. Cells outside every run receive nothing.
+/// Scalar is the floating point type of the simulation the source is added to (float or double).
+/// </summary>
+template <typename Scalar>
+class SourceFootprint {
+public:
+    /// <summary>
+    /// A run of length cells starting at grid index start, whose amounts are values[offset..offset + length).
+    /// </summary>
+    struct Span {
+        int start;
+        int length;
+        int offset;
+    };
+
+private:
+    std::vector<Span> spans;
+    std::vector<Scalar> values;
+
+public:
+    /// <summary>
+    /// Constructs an empty footprint, which covers no cells.
+    /// </summary>
+    SourceFootprint();
+
+    /// <summary>
+    /// Compresses a dense grid of GridSize(N, M) amounts into runs of its non-zero cells.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
+    /// <param name="grid">The amount of every cell of the grid, including the boundary.</param>
+    SourceFootprint(unsigned int N, unsigned int M, const std::vector<Scalar>& grid);
+
+    /// <summary>
+    /// Adds value to the cells i in [iBegin, iEnd) of row j. Does nothing for an empty range or a value of 0.
+    /// A cell must not be covered by two runs.
+    /// </summary>
+    /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    void AddRun(unsigned int N, int iBegin, int iEnd, int j, Scalar value);
+
+    /// <summary>
+    /// Adds value to the length cells starting at index start, for layouts other than that of IX (see BrickLayout).
+    /// Does nothing for an empty run or a value of 0. A cell must not be covered by two runs.
+    /// </summary>
+    void AddSpan(int start, int length, Scalar value);
+
+    /// <summary>
+    /// Returns the runs of covered cells.
+    /// </summary>
+    const std::vector<Span>& GetSpans() const;
+
+    /// <summary>
+    /// Returns the amounts of the covered cells, indexed by the offsets of the runs.
+    /// </summary>
+    const std::vector<Scalar>& GetValues() const;
+
+    /// <summary>
+    /// Returns the number of cells the footprint covers.
+    /// </summary>
+    size_t GetCellCount() const;
+};
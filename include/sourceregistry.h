@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "densitySource.h"
+#include "velocitysource.h"
+
+/// <summary>
+/// Owns the density and velocity sources of a scene or a running simulation, keeping their derived types, and
+/// advances them every step.
+/// Copying a registry clones every source. The clones share the immutable footprints of the originals, so a copy
+/// costs O(number of sources) whatever the grid size, while each copy keeps its own per-source state.
+/// Scalar is the floating point type of the simulation the sources are added to (float or double).
+/// </summary>
+template <typename Scalar>
+class SourceRegistry {
+private:
+    std::vector<std::unique_ptr<DensitySource<Scalar>>> densSources;
+    std::vector<std::unique_ptr<VelocitySource<Scalar>>> velSources;
+
+public:
+    /// <summary>
+    /// Constructs a registry without sources.
+    /// </summary>
+    SourceRegistry();
+
+    SourceRegistry(const SourceRegistry& other);
+    SourceRegistry(SourceRegistry&& other) noexcept = default;
+    SourceRegistry& operator=(const SourceRegistry& other);
+    SourceRegistry& operator=(SourceRegistry&& other) noexcept = default;
+
+    /// <summary>
+    /// Takes ownership of a density source.
+    /// </summary>
+    void AddDensitySource(std::unique_ptr<DensitySource<Scalar>> source);
+
+    /// <summary>
+    /// Takes ownership of a velocity source.
+    /// </summary>
+    void AddVelocitySource(std::unique_ptr<VelocitySource<Scalar>> source);
+
+    /// <summary>
+    /// Removes every source.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Calls Tick() on every source, once per simulation step.
+    /// </summary>
+    /// <param name="dt">The time step of the simulation step.</param>
+    void Tick(double dt);
+
+    /// <summary>
+    /// Returns the density sources.
+    /// </summary>
+    const std::vector<std::unique_ptr<DensitySource<Scalar>>>& GetDensitySources() const;
+
+    /// <summary>
+    /// Returns the velocity sources.
+    /// </summary>
+    const std::vector<std::unique_ptr<VelocitySource<Scalar>>>& GetVelocitySources() const;
+};
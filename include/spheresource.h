@@ -0,0 +1,43 @@
+#pragma once
+
+#include "volumesource.h"
+
+/// <summary>
+/// A ball of cells in the volume of FluidSimulator3D that receives density and velocity.
+/// </summary>
+template <typename Scalar>
+class SphereSource : public VolumeSource<Scalar> {
+private:
+    /// <summary>
+    /// The center of the ball in cell coordinates.
+    /// </summary>
+    glm::ivec3 center;
+
+    /// <summary>
+    /// The radius of the ball in cells.
+    /// </summary>
+    double radius;
+
+public:
+    /// <summary>
+    /// Constructs a spherical source.
+    /// </summary>
+    /// <param name="N">The width of the simulated volume.</param>
+    /// <param name="center">The cell at the center of the ball.</param>
+    /// <param name="radius">The radius of the ball, in cells.</param>
+    /// <param name="density">The density added per unit time to every covered cell.</param>
+    /// <param name="velocity">The velocity added per unit time to every covered cell.</param>
+    SphereSource(unsigned int N, const glm::ivec3& center, double radius, double density,
+        const glm::dvec3& velocity = glm::dvec3(0.0));
+
+    std::unique_ptr<VolumeSource<Scalar>> Clone() const override;
+
+    /// <summary>
+    /// Builds the footprint of a ball: every inner cell closer than radius to the center gets value.
+    /// </summary>
+    /// <param name="N">The width of the simulated volume.</param>
+    /// <param name="center">The cell at the center of the ball.</param>
+    /// <param name="radius">The radius of the ball, in cells.</param>
+    /// <param name="value">The weight of every covered cell.</param>
+    static SourceFootprint<Scalar> Rasterize(unsigned int N, const glm::ivec3& center, double radius, Scalar value);
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// A persistent pool of worker threads used to split grid loops across cores.
+/// The workers are created once and sleep between jobs, so dispatching a loop does not pay for thread creation.
+/// </summary>
+class ThreadPool {
+private:
+    // Worker threads. The thread calling ParallelFor() always runs the first chunk itself,
+    // so a pool of threadCount threads only owns threadCount - 1 workers.
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+
+    // Signalled when a new job is published or the pool is shutting down
+    std::condition_variable wakeCondition;
+
+    // Signalled when the last worker finishes its chunk of the current job
+    std::condition_variable doneCondition;
+
+    // The job currently being executed. Only valid while pendingWorkers > 0.
+    const std::function<void(int, int)>* job;
+
+    // The chunks of the current job, indexed by worker (chunk 0 belongs to the calling thread)
+    std::vector<std::pair<int, int>> chunks;
+
+    // Incremented every time a job is published so sleeping workers can tell a new job from a spurious wakeup
+    unsigned long long generation;
+
+    // Number of workers that have not finished the current job yet
+    unsigned int pendingWorkers;
+
+    bool stopping;
+
+    /// <summary>
+    /// Waits for jobs and runs this worker's chunk of each one until the pool is destroyed.
+    /// </summary>
+    /// <param name="workerIndex">The index of the chunk this worker executes.</param>
+    void WorkerLoop(unsigned int workerIndex);
+
+public:
+    /// <summary>
+    /// Creates a pool that splits work across threadCount threads, including the calling thread.
+    /// </summary>
+    /// <param name="threadCount">The number of threads to use. 0 uses one thread per hardware core.</param>
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// <summary>
+    /// Returns the number of threads work is split across, including the calling thread.
+    /// </summary>
+    unsigned int GetThreadCount() const;
+
+    /// <summary>
+    /// Splits [begin, end) into contiguous chunks and runs body(chunkBegin, chunkEnd) on each of them in parallel.
+    /// Blocks until every chunk has completed.
+    /// </summary>
+    /// <param name="begin">The first index of the range.</param>
+    /// <param name="end">One past the last index of the range.</param>
+    /// <param name="minChunkSize">The smallest chunk worth handing to a thread. Small ranges run on fewer threads.</param>
+    /// <param name="body">The function executed on each chunk.</param>
+    void ParallelFor(int begin, int end, int minChunkSize, const std::function<void(int, int)>& body);
+};
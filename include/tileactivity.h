@@ -0,0 +1,163 @@
+#pragma once
+
+#include "gridlayout.h"
+#include "obstaclemask.h"
+#include "sourcefootprint.h"
+#include "threadpool.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+/// <summary>
+/// Splits the inner grid into square tiles of TILE_SIZE cells and tracks which of them hold smoke or motion, so the
+/// passes over the grid can skip the still, empty air. The fields keep their row-major layout; the tiles only decide
+/// which cells are visited.
+///
+/// A tile is occupied when a watched field exceeds its activity threshold anywhere in it, or when a source or the
+/// user has touched it since the last update. The active tiles are the occupied ones plus a halo of one tile around
+/// them, into which smoke and motion can spread during a tick; everything outside them is kept at zero. The fluid
+/// cells of the active tiles are kept as runs per row, like the runs of ObstacleMask, so the row kernels run on them
+/// unchanged.
+/// </summary>
+template <typename Scalar>
+class TileActivity {
+public:
+    using Run = typename ObstacleMask<Scalar>::Run;
+
+    /// <summary>
+    /// The width and height of a tile, in cells.
+    /// </summary>
+    static constexpr int TILE_SIZE = 16;
+
+    /// <summary>
+    /// A field whose values above threshold in magnitude keep a tile occupied.
+    /// </summary>
+    struct WatchedField {
+        const Field<Scalar>* field;
+        Scalar threshold;
+    };
+
+private:
+    int N;
+    int M;
+    int tilesX;                      // Tiles per row of tiles, across the width
+    int tilesY;                      // Rows of tiles, across the height
+    std::vector<uint8_t> occupied;   // Per tile, row by row
+    std::vector<uint8_t> active;     // The occupied tiles and their neighbors
+    int activeTiles;
+    std::vector<Run> columns;        // The columns of the active tiles of a row of tiles, as spans of inner cells
+    std::vector<int> tileRowColumns; // The spans of tile row t are columns[tileRowColumns[t]] to [tileRowColumns[t + 1]]
+    std::vector<Run> runs;           // The fluid cells of the active tiles
+    std::vector<int> rowRuns;        // The runs of row j are runs[rowRuns[j]] to runs[rowRuns[j + 1]]
+
+    // The cells [begin, end) of tile t along an axis of n inner cells, boundary cells included when the tile is at
+    // the edge
+    void GetTileCells(int t, int n, bool withBoundary, int& begin, int& end) const;
+
+public:
+    /// <summary>
+    /// Constructs the tiles of a grid with an inner width of N and an inner height of M, all of them active. The runs
+    /// are empty until the first Update().
+    /// </summary>
+    TileActivity(unsigned int N = 0, unsigned int M = 0);
+
+    /// <summary>
+    /// Marks the tiles holding the inner cells [iBegin, iEnd) of row j as occupied.
+    /// </summary>
+    void MarkCells(int iBegin, int iEnd, int j);
+
+    /// <summary>
+    /// Marks the tiles a source footprint adds to as occupied.
+    /// </summary>
+    void MarkFootprint(const SourceFootprint<Scalar>& footprint);
+
+    /// <summary>
+    /// Marks every tile as occupied, for sources that act on the whole grid or fields of unknown content.
+    /// </summary>
+    void MarkAll();
+
+    /// <summary>
+    /// Marks every tile as empty, for fields that were just cleared.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Activates the occupied tiles and their neighbors, wrapping around the edges of a periodic domain, and
+    /// rebuilds the runs of the active fluid cells from the runs of the obstacle mask.
+    /// </summary>
+    void Update(const ObstacleMask<Scalar>& obstacleMask, bool periodic);
+
+    /// <summary>
+    /// Rechecks which active tiles are occupied: those where any of fields exceeds its threshold in magnitude.
+    /// The tiles are scanned across the thread pool, each stopping at its first value above the threshold.
+    /// </summary>
+    void UpdateOccupancy(ThreadPool& threadPool, std::initializer_list<WatchedField> fields);
+
+    /// <summary>
+    /// Sets the cells of the active tiles that are no longer occupied to zero in each of fields, together with the
+    /// boundary cells next to them, so every cell outside the next active tiles is zero.
+    /// </summary>
+    void ClearIdleTiles(std::initializer_list<Field<Scalar>*> fields) const;
+
+    /// <summary>
+    /// Marks the inactive tiles where any of fields exceeds its threshold in magnitude as occupied, for passes that
+    /// wrote outside the active tiles. Call Update() afterwards to activate them.
+    /// </summary>
+    /// <returns>Whether any tile was marked.</returns>
+    bool MarkHolding(ThreadPool& threadPool, std::initializer_list<WatchedField> fields);
+
+    /// <summary>
+    /// Sets the cells of the inactive tiles to zero in each of fields, together with the boundary cells next to
+    /// them.
+    /// </summary>
+    void ClearInactiveTiles(std::initializer_list<Field<Scalar>*> fields) const;
+
+    /// <summary>
+    /// Copies the cells of the inactive tiles, with the boundary cells next to them, from source to target, for
+    /// fields whose inactive tiles hold values the passes over the active tiles do not update.
+    /// </summary>
+    void CopyInactiveTiles(Field<Scalar>& target, const Field<Scalar>& source) const;
+
+    /// <summary>
+    /// Returns the first run of fluid cells in the active tiles of inner row j, 1 to M.
+    /// </summary>
+    const Run* RunsBegin(int j) const
+    {
+        return runs.data() + rowRuns[j];
+    }
+
+    /// <summary>
+    /// Returns one past the last run of fluid cells in the active tiles of inner row j.
+    /// </summary>
+    const Run* RunsEnd(int j) const
+    {
+        return runs.data() + rowRuns[j + 1];
+    }
+
+    /// <summary>
+    /// Returns the first span of columns covered by active tiles in inner row j, obstacles included.
+    /// </summary>
+    const Run* ColumnsBegin(int j) const
+    {
+        return columns.data() + tileRowColumns[(j - 1) / TILE_SIZE];
+    }
+
+    /// <summary>
+    /// Returns one past the last span of columns covered by active tiles in inner row j.
+    /// </summary>
+    const Run* ColumnsEnd(int j) const
+    {
+        return columns.data() + tileRowColumns[(j - 1) / TILE_SIZE + 1];
+    }
+
+    /// <summary>
+    /// Returns the number of active tiles.
+    /// </summary>
+    int GetActiveTileCount() const;
+
+    /// <summary>
+    /// Returns the number of tiles of the grid.
+    /// </summary>
+    int GetTileCount() const;
+};
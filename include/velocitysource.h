@@ -1,34 +1,37 @@
 #pragma once
 #pragma once
 
+#include <memory>
 #include <vector>
-
-// Macro for accessing a 1D array with 2D-like syntax. This maps 2D indices (i, j) 
-// to a 1D index in a flattened array. The grid includes a boundary, 
-// so its actual dimensions are (N+2) x (N+2).
-#define IX(i, j) ((i) + (N + 2) * (j))
+#include "gridlayout.h"
+#include "glm_includes.h"
+#include "sourcefootprint.h"
 
 /// <summary>
 /// Represents a source of velocity that can dynamically update over time.
 /// This class is intended to be used as a base class for specific types of velocity sources.
+/// The footprints are immutable once built and shared by every copy of the source, so cloning a source is cheap.
+/// Scalar is the floating point type of the simulation the source is added to (float or double).
 /// </summary>
+template <typename Scalar>
 class VelocitySource {
 protected:
     /// <summary>
-    /// The width of the inner grid (non-boundary cells) excluding the boundary.
-    /// The total grid dimensions are (N+2) x (N+2) to account for boundaries.
+    /// The width and height of the inner grid (non-boundary cells) excluding the boundary.
+    /// The total grid dimensions are (N+2) x (M+2) to account for boundaries.
     /// </summary>
     unsigned int N;
+    unsigned int M;
 
     /// <summary>
-    /// The array representing the amount of horizontal velocity to be added to the simulation per unit time.
+    /// The cells receiving horizontal velocity and the amount added to each per unit time.
     /// </summary>
-    std::vector<double> u;
+    std::shared_ptr<const SourceFootprint<Scalar>> u;
 
     /// <summary>
-    /// The array representing the amount of vertical velocity to be added to the simulation per unit time.
+    /// The cells receiving vertical velocity and the amount added to each per unit time.
     /// </summary>
-    std::vector<double> v;
+    std::shared_ptr<const SourceFootprint<Scalar>> v;
 
     /// <summary>
     /// The magnitude of the horizontal velocity component (u) applied to the grid.
@@ -44,6 +47,12 @@ protected:
     /// </summary>
     double vVel;
 
+    /// <summary>
+    /// Multiplies the horizontal (x) and vertical (y) footprints when the source is applied, so the source can pulse
+    /// or turn without rewriting any cells.
+    /// </summary>
+    glm::dvec2 strength;
+
 
 public:
     /// <summary>
@@ -51,38 +60,65 @@ public:
     /// based on the specified horizontal and vertical speed components.
     /// </summary>
     /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
     /// <param name="uVel">The magnitude of the horizontal velocity component to be added to the grid.</param>
     /// <param name="vVel">The magnitude of the vertical velocity component to be added to the grid.</param>
-    VelocitySource(unsigned int N, double uVel, double vVel);
+    VelocitySource(unsigned int N, unsigned int M, double uVel, double vVel);
 
     /// <summary>
     /// Constructs a velocity source that dynamically adds velocity to the simulation
-    /// based on the specified x and y velocity vector grids.
+    /// based on the specified x and y velocity vector grids. Only their non-zero cells are kept.
     /// </summary>
     /// <param name="N">The width of the inner grid (excluding boundaries).</param>
+    /// <param name="M">The height of the inner grid (excluding boundaries).</param>
     /// <param name="uVec">The vector of x velocities to be added to the grid.</param>
     /// <param name="vVec">The vector of y velocities to be added to the grid.</param>
-    VelocitySource(unsigned int N, std::vector<double> uVec, std::vector<double> vVec);
+    VelocitySource(unsigned int N, unsigned int M, std::vector<Scalar> uVec, std::vector<Scalar> vVec);
+
+    virtual ~VelocitySource() = default;
 
     /// <summary>
-    /// Updates the source arrays dynamically each physics frame.
+    /// Returns a copy of the source, of the same derived type, sharing its footprints.
+    /// </summary>
+    virtual std::unique_ptr<VelocitySource<Scalar>> Clone() const;
+
+    /// <summary>
+    /// Updates the source dynamically each physics frame.
     /// This function should be overridden by derived classes to implement specific behavior.
     /// </summary>
-    virtual void Tick();
+    /// <param name="dt">The time step of the frame.</param>
+    virtual void Tick(double dt);
 
     /// <summary>
-    /// Retrieves the current horizontal velocity source array, which contains the density values to be added to the simulation.
+    /// Returns whether the footprints never change, so the source can be merged into the compiled batch of a scene.
+    /// Derived classes whose Tick() replaces the footprints must return false.
+    /// </summary>
+    virtual bool IsStatic() const;
+
+    /// <summary>
+    /// Returns whether the source is a ProceduralVelocitySource, which computes its velocity on the fly instead of
+    /// storing footprints.
+    /// </summary>
+    virtual bool IsProcedural() const;
+
+    /// <summary>
+    /// Retrieves the current horizontal velocity source footprint, which contains the velocities to be added to the simulation.
     /// </summary>
     /// <returns>
-    /// A constant reference to the source array containing density values.
+    /// A constant reference to the footprint of the covered cells and their horizontal velocities.
     /// </returns>
-    const std::vector<double>& GetHorizontalVelocitySource() const;
+    const SourceFootprint<Scalar>& GetHorizontalVelocitySource() const;
 
     /// <summary>
-    /// Retrieves the current horizontal velocity source array, which contains the density values to be added to the simulation.
+    /// Retrieves the current vertical velocity source footprint, which contains the velocities to be added to the simulation.
     /// </summary>
     /// <returns>
-    /// A constant reference to the source array containing density values.
+    /// A constant reference to the footprint of the covered cells and their vertical velocities.
     /// </returns>
-    const std::vector<double>& GetVerticalVelocitySource() const;
+    const SourceFootprint<Scalar>& GetVerticalVelocitySource() const;
+
+    /// <summary>
+    /// Returns the factors the horizontal (x) and vertical (y) footprints are multiplied by when the source is applied.
+    /// </summary>
+    const glm::dvec2& GetStrength() const;
 };
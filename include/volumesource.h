@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include "bricklayout.h"
+#include "glm_includes.h"
+#include "sourcefootprint.h"
+
+/// <summary>
+/// A source of density and velocity in the volume of FluidSimulator3D. Every covered cell receives the density
+/// rate and the velocity rate per unit time, weighted by its value in the footprint.
+/// Derived classes decide the shape of the covered region. The footprint is laid out in bricks (see BrickLayout),
+/// immutable once built and shared by every copy of the source, so cloning a source is cheap.
+/// Scalar is the floating point type of the simulation the source is added to (float or double).
+/// </summary>
+template <typename Scalar>
+class VolumeSource {
+protected:
+    /// <summary>
+    /// The width of the inner volume (non-boundary cells) along every axis.
+    /// </summary>
+    unsigned int N;
+
+    /// <summary>
+    /// The cells the source covers and the weight of each.
+    /// </summary>
+    std::shared_ptr<const SourceFootprint<Scalar>> footprint;
+
+    /// <summary>
+    /// The density added per unit time to a cell of weight 1.
+    /// </summary>
+    double density;
+
+    /// <summary>
+    /// The velocity added per unit time to a cell of weight 1.
+    /// </summary>
+    glm::dvec3 velocity;
+
+    /// <summary>
+    /// Adds the cells i in [iBegin, iEnd) of row (j, k) to a footprint, one run per brick the row crosses.
+    /// </summary>
+    static void AddRow(SourceFootprint<Scalar>& footprint, const BrickLayout& layout, int iBegin, int iEnd, int j,
+        int k, Scalar value);
+
+public:
+    /// <summary>
+    /// Initializes a source that does not cover any cells yet.
+    /// </summary>
+    /// <param name="N">The width of the inner volume (excluding boundaries).</param>
+    /// <param name="density">The density added per unit time to every covered cell.</param>
+    /// <param name="velocity">The velocity added per unit time to every covered cell.</param>
+    VolumeSource(unsigned int N, double density, const glm::dvec3& velocity);
+
+    virtual ~VolumeSource() = default;
+
+    /// <summary>
+    /// Returns a copy of the source, of the same derived type, sharing its footprint.
+    /// </summary>
+    virtual std::unique_ptr<VolumeSource<Scalar>> Clone() const;
+
+    /// <summary>
+    /// Updates the source each physics frame. Derived classes may change their rates or replace the footprint.
+    /// </summary>
+    /// <param name="dt">The time step of the frame.</param>
+    virtual void Tick(double dt);
+
+    /// <summary>
+    /// Returns the covered cells and their weights.
+    /// </summary>
+    const SourceFootprint<Scalar>& GetFootprint() const;
+
+    /// <summary>
+    /// Returns the density added per unit time to a cell of weight 1.
+    /// </summary>
+    double GetDensity() const;
+
+    /// <summary>
+    /// Returns the velocity added per unit time to a cell of weight 1.
+    /// </summary>
+    const glm::dvec3& GetVelocity() const;
+};
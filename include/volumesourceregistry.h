@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "volumesource.h"
+
+/// <summary>
+/// Owns the sources of a 3D scene or a running FluidSimulator3D, keeping their derived types, and advances them
+/// every step. Copying a registry clones every source, sharing their immutable footprints, like SourceRegistry.
+/// Scalar is the floating point type of the simulation the sources are added to (float or double).
+/// </summary>
+template <typename Scalar>
+class VolumeSourceRegistry {
+private:
+    std::vector<std::unique_ptr<VolumeSource<Scalar>>> volumeSources;
+
+public:
+    /// <summary>
+    /// Constructs a registry without sources.
+    /// </summary>
+    VolumeSourceRegistry();
+
+    VolumeSourceRegistry(const VolumeSourceRegistry& other);
+    VolumeSourceRegistry(VolumeSourceRegistry&& other) noexcept = default;
+    VolumeSourceRegistry& operator=(const VolumeSourceRegistry& other);
+    VolumeSourceRegistry& operator=(VolumeSourceRegistry&& other) noexcept = default;
+
+    /// <summary>
+    /// Takes ownership of a source.
+    /// </summary>
+    void AddSource(std::unique_ptr<VolumeSource<Scalar>> source);
+
+    /// <summary>
+    /// Removes every source.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Calls Tick() on every source, once per simulation step.
+    /// </summary>
+    /// <param name="dt">The time step of the simulation step.</param>
+    void Tick(double dt);
+
+    /// <summary>
+    /// Returns the sources.
+    /// </summary>
+    const std::vector<std::unique_ptr<VolumeSource<Scalar>>>& GetSources() const;
+};
@@ -0,0 +1,118 @@
+#include "animatedsource.h"
+#include "circularSource.h"
+#include "rectvelocitysource.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// The cell containing a point given in grid coordinates
+glm::ivec2 NearestCell(const glm::dvec2& point)
+{
+    return glm::ivec2((int)std::floor(point.x + 0.5), (int)std::floor(point.y + 0.5));
+}
+
+}
+
+template <typename Scalar>
+AnimatedCircularSource<Scalar>::AnimatedCircularSource(unsigned int N, unsigned int M,
+    const Keyframes<glm::dvec2>& center, const Keyframes<double>& radius, const Keyframes<double>& amount) :
+    DensitySource<Scalar>(N, M), center(center), radius(radius), amount(amount), time(0.0), rasterCenter(0, 0),
+    rasterRadius(-1)
+{
+    Update();
+}
+
+template <typename Scalar>
+void AnimatedCircularSource<Scalar>::Update()
+{
+    glm::ivec2 cell = NearestCell(center.Evaluate(time));
+    double r = std::max(radius.Evaluate(time), 0.0);
+    // CircularSource truncates the radius to whole cells as well
+    int cells = (int)r;
+    if (cell != rasterCenter || cells != rasterRadius) {
+        rasterCenter = cell;
+        rasterRadius = cells;
+        this->source = std::make_shared<const SourceFootprint<Scalar>>(
+            CircularSource<Scalar>::Rasterize(this->N, this->M, cell.x, cell.y, r, Scalar(1)));
+    }
+
+    // Spread the amount over the area of the circle, like CircularSource
+    double area = glm::pi<double>() * r * r;
+    this->strength = area > 0 ? amount.Evaluate(time) / area : 0.0;
+}
+
+template <typename Scalar>
+void AnimatedCircularSource<Scalar>::Tick(double dt)
+{
+    time += dt;
+    Update();
+}
+
+template <typename Scalar>
+bool AnimatedCircularSource<Scalar>::IsStatic() const
+{
+    return center.IsConstant() && radius.IsConstant() && amount.IsConstant();
+}
+
+template <typename Scalar>
+std::unique_ptr<DensitySource<Scalar>> AnimatedCircularSource<Scalar>::Clone() const
+{
+    return std::make_unique<AnimatedCircularSource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+AnimatedRectVelocitySource<Scalar>::AnimatedRectVelocitySource(unsigned int N, unsigned int M, int width, int height,
+    const Keyframes<glm::dvec2>& position, const Keyframes<double>& speed, const Keyframes<double>& angle) :
+    VelocitySource<Scalar>(N, M, 0.0, 0.0),
+    width(std::min(std::max(width, 0), (int)N)),
+    height(std::min(std::max(height, 0), (int)M)),
+    position(position), speed(speed), angle(angle), time(0.0), rasterPosition(0, 0)
+{
+    rasterPosition = NearestCell(position.Evaluate(0.0));
+    this->u = std::make_shared<const SourceFootprint<Scalar>>(
+        RectVelocitySource<Scalar>::Rasterize(N, M, this->width, this->height, rasterPosition.x, rasterPosition.y,
+            Scalar(1)));
+    this->v = this->u;
+    Update();
+}
+
+template <typename Scalar>
+void AnimatedRectVelocitySource<Scalar>::Update()
+{
+    glm::ivec2 cell = NearestCell(position.Evaluate(time));
+    if (cell != rasterPosition) {
+        rasterPosition = cell;
+        this->u = std::make_shared<const SourceFootprint<Scalar>>(
+            RectVelocitySource<Scalar>::Rasterize(this->N, this->M, width, height, cell.x, cell.y, Scalar(1)));
+        this->v = this->u;
+    }
+
+    double a = angle.Evaluate(time);
+    this->strength = speed.Evaluate(time) * glm::dvec2(std::cos(a), std::sin(a));
+}
+
+template <typename Scalar>
+void AnimatedRectVelocitySource<Scalar>::Tick(double dt)
+{
+    time += dt;
+    Update();
+}
+
+template <typename Scalar>
+bool AnimatedRectVelocitySource<Scalar>::IsStatic() const
+{
+    return position.IsConstant() && speed.IsConstant() && angle.IsConstant();
+}
+
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> AnimatedRectVelocitySource<Scalar>::Clone() const
+{
+    return std::make_unique<AnimatedRectVelocitySource<Scalar>>(*this);
+}
+
+template class AnimatedCircularSource<float>;
+template class AnimatedCircularSource<double>;
+template class AnimatedRectVelocitySource<float>;
+template class AnimatedRectVelocitySource<double>;
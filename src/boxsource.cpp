@@ -0,0 +1,37 @@
+#include "boxsource.h"
+
+#include <algorithm>
+
+template <typename Scalar>
+BoxSource<Scalar>::BoxSource(unsigned int N, const glm::ivec3& corner, const glm::ivec3& size, double density,
+    const glm::dvec3& velocity) :
+    VolumeSource<Scalar>(N, density, velocity),
+    corner(glm::clamp(corner, glm::ivec3(1), glm::ivec3((int)N))), size(glm::max(size, glm::ivec3(0)))
+{
+    this->footprint = std::make_shared<const SourceFootprint<Scalar>>(Rasterize(N, corner, size, Scalar(1)));
+}
+
+template <typename Scalar>
+SourceFootprint<Scalar> BoxSource<Scalar>::Rasterize(unsigned int N, const glm::ivec3& corner,
+    const glm::ivec3& size, Scalar value)
+{
+    BrickLayout layout(N);
+    SourceFootprint<Scalar> footprint;
+    glm::ivec3 begin = glm::max(corner, glm::ivec3(1));
+    glm::ivec3 end = glm::min(corner + size, glm::ivec3((int)N + 1));
+    for (int k = begin.z; k < end.z; ++k) {
+        for (int j = begin.y; j < end.y; ++j) {
+            VolumeSource<Scalar>::AddRow(footprint, layout, begin.x, end.x, j, k, value);
+        }
+    }
+    return footprint;
+}
+
+template <typename Scalar>
+std::unique_ptr<VolumeSource<Scalar>> BoxSource<Scalar>::Clone() const
+{
+    return std::make_unique<BoxSource<Scalar>>(*this);
+}
+
+template class BoxSource<float>;
+template class BoxSource<double>;
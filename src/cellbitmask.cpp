@@ -0,0 +1,161 @@
+#include "cellbitmask.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+// The bits [lo, hi) of a word, 0 <= lo <= hi <= 64
+CellBitmask::Word SpanMask(int lo, int hi)
+{
+    CellBitmask::Word below = hi == CellBitmask::WORD_BITS ? ~CellBitmask::Word(0) : (CellBitmask::Word(1) << hi) - 1;
+    return below & (~CellBitmask::Word(0) << lo);
+}
+
+}
+
+CellBitmask::CellBitmask(unsigned int N, unsigned int M) :
+    N((int)N), M((int)M), wordsPerRow(((int)N + 2 + WORD_BITS - 1) / WORD_BITS),
+    words(size_t(wordsPerRow) * (M + 2), 0), setCount(0)
+{}
+
+bool CellBitmask::Set(int i, int j, bool value)
+{
+    return SetSpan(i, i + 1, j, value) != 0;
+}
+
+void CellBitmask::Clear()
+{
+    std::fill(words.begin(), words.end(), Word(0));
+    setCount = 0;
+}
+
+int CellBitmask::Count() const
+{
+    return setCount;
+}
+
+int CellBitmask::GetWordsPerRow() const
+{
+    return wordsPerRow;
+}
+
+const CellBitmask::Word* CellBitmask::GetRow(int j) const
+{
+    return &words[size_t(j) * wordsPerRow];
+}
+
+CellBitmask::Word CellBitmask::GetBits(int i, int j) const
+{
+    int word = i / WORD_BITS;
+    int shift = i % WORD_BITS;
+    if (word >= wordsPerRow) {
+        return 0;
+    }
+    const Word* row = GetRow(j);
+    Word bits = row[word] >> shift;
+    if (shift != 0 && word + 1 < wordsPerRow) {
+        bits |= row[word + 1] << (WORD_BITS - shift);
+    }
+    return bits;
+}
+
+bool CellBitmask::AllClear(int iBegin, int iEnd, int j) const
+{
+    const Word* row = GetRow(j);
+    for (int i = iBegin; i < iEnd; i = (i / WORD_BITS + 1) * WORD_BITS) {
+        int word = i / WORD_BITS;
+        Word mask = SpanMask(i % WORD_BITS, std::min(iEnd - word * WORD_BITS, WORD_BITS));
+        if ((row[word] & mask) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CellBitmask::AllSet(int iBegin, int iEnd, int j) const
+{
+    const Word* row = GetRow(j);
+    for (int i = iBegin; i < iEnd; i = (i / WORD_BITS + 1) * WORD_BITS) {
+        int word = i / WORD_BITS;
+        Word mask = SpanMask(i % WORD_BITS, std::min(iEnd - word * WORD_BITS, WORD_BITS));
+        if ((row[word] & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CellBitmask::FindNext(int i, int iEnd, int j, bool value) const
+{
+    const Word* row = GetRow(j);
+    while (i < iEnd) {
+        int word = i / WORD_BITS;
+        // Look for set bits; to find a clear bit, look at the complement
+        Word bits = (value ? row[word] : ~row[word]) & (~Word(0) << (i % WORD_BITS));
+        if (bits != 0) {
+            return std::min(word * WORD_BITS + std::countr_zero(bits), iEnd);
+        }
+        i = (word + 1) * WORD_BITS;
+    }
+    return iEnd;
+}
+
+int CellBitmask::SetSpan(int iBegin, int iEnd, int j, bool value)
+{
+    Word* row = &words[size_t(j) * wordsPerRow];
+    int changed = 0;
+    for (int i = iBegin; i < iEnd; i = (i / WORD_BITS + 1) * WORD_BITS) {
+        int word = i / WORD_BITS;
+        Word mask = SpanMask(i % WORD_BITS, std::min(iEnd - word * WORD_BITS, WORD_BITS));
+        changed += std::popcount(value ? mask & ~row[word] : mask & row[word]);
+        row[word] = value ? row[word] | mask : row[word] & ~mask;
+    }
+    setCount += value ? changed : -changed;
+    return changed;
+}
+
+int CellBitmask::SetRect(int x0, int y0, int x1, int y1, bool value)
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, N + 2);
+    y1 = std::min(y1, M + 2);
+    int changed = 0;
+    for (int j = y0; j < y1 && x0 < x1; j++) {
+        changed += SetSpan(x0, x1, j, value);
+    }
+    return changed;
+}
+
+int CellBitmask::SetCircle(double x, double y, double radius, bool value)
+{
+    int changed = 0;
+    int jBegin = std::max((int)std::ceil(y - radius), 0);
+    int jEnd = std::min((int)std::floor(y + radius), M + 1);
+    for (int j = jBegin; j <= jEnd; j++) {
+        int iBegin, iEnd;
+        GetCircleSpan(x, y, radius, j, iBegin, iEnd);
+        iBegin = std::max(iBegin, 0);
+        iEnd = std::min(iEnd, N + 2);
+        if (iBegin < iEnd) {
+            changed += SetSpan(iBegin, iEnd, j, value);
+        }
+    }
+    return changed;
+}
+
+void CellBitmask::GetCircleSpan(double x, double y, double radius, int j, int& iBegin, int& iEnd)
+{
+    double dy = j - y;
+    double halfWidthSquared = radius * radius - dy * dy;
+    if (halfWidthSquared <= 0) {
+        iBegin = iEnd = 0;
+        return;
+    }
+    // The cells with x - halfWidth < i < x + halfWidth
+    double halfWidth = std::sqrt(halfWidthSquared);
+    iBegin = (int)std::floor(x - halfWidth) + 1;
+    iEnd = (int)std::ceil(x + halfWidth);
+}
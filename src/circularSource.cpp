@@ -1,31 +1,48 @@
 #include "circularSource.h"
 
-CircularSource::CircularSource(unsigned int N, int x, int y, double radius, double amount):
-	DensitySource(N), circleCenter(x, y), radius(radius), amount(amount),
+template <typename Scalar>
+CircularSource<Scalar>::CircularSource(unsigned int N, unsigned int M, int x, int y, double radius, double amount):
+	DensitySource<Scalar>(N, M), circleCenter(x, y), radius(radius), amount(amount),
 	area(glm::pi<double>() * radius * radius)
 {	
+	// Cover every cell within the radius from the center with the same density. 
+	double densPerCell = amount / area; 
+	this->source = std::make_shared<const SourceFootprint<Scalar>>(Rasterize(N, M, x, y, radius, Scalar(densPerCell)));
+}
+
+template <typename Scalar>
+SourceFootprint<Scalar> CircularSource<Scalar>::Rasterize(unsigned int N, unsigned int M, int x, int y,
+	double radius, Scalar densPerCell)
+{
 	// Lamda function for checking if the cell is within the radius from the circle center 
 	auto InRadius = [&](int i, int j) {
-		int a = i - circleCenter.x; 
-		int b = j - circleCenter.y; 
+		int a = i - x; 
+		int b = j - y; 
 		int c = radius; 
 		return a * a + b * b < c * c; 
 	};
 
-	// Set the source matrix so that every density is added at every 
-	// cell within the radius from the center. 
-	double densPerCell = amount / area; 
-	for (int i = 0; i <= N; ++i) {
-		for (int j = 0; j <= N; ++j) {
-			if (InRadius(i, j)) {
-				source[IX(i, j)] = densPerCell; 
-			}
+	// The cells of a row inside the circle are consecutive, so each row is a single run. 
+	SourceFootprint<Scalar> footprint;
+	for (int j = 0; j <= (int)M; ++j) {
+		int i = 0;
+		while (i <= (int)N && !InRadius(i, j)) {
+			++i;
+		}
+		int iBegin = i;
+		while (i <= (int)N && InRadius(i, j)) {
+			++i;
 		}
+		footprint.AddRun(N, iBegin, i, j, densPerCell);
 	}
+	return footprint;
 }
 
-void CircularSource::Tick()
-{ 
-	// Nothing should happen here because the sourcde does not change over ticks 
-	return;
+template <typename Scalar>
+std::unique_ptr<DensitySource<Scalar>> CircularSource<Scalar>::Clone() const
+{
+	return std::make_unique<CircularSource<Scalar>>(*this);
 }
+
+template class CircularSource<float>;
+template class CircularSource<double>;
@@ -1,15 +1,39 @@
 #include "densitySource.h"
 
-DensitySource::DensitySource(unsigned int N) :
-    N(N), source((N + 2)* (N + 2), 0.0)
+template <typename Scalar>
+DensitySource<Scalar>::DensitySource(unsigned int N, unsigned int M) :
+    N(N), M(M), source(std::make_shared<const SourceFootprint<Scalar>>()), strength(1.0)
 {}
 
-void DensitySource::Tick()
+template <typename Scalar>
+std::unique_ptr<DensitySource<Scalar>> DensitySource<Scalar>::Clone() const
+{
+    return std::make_unique<DensitySource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+void DensitySource<Scalar>::Tick(double dt)
 {
     return; 
 }
 
-const std::vector<double>& DensitySource::GetSource() const
+template <typename Scalar>
+bool DensitySource<Scalar>::IsStatic() const
+{
+    return true;
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& DensitySource<Scalar>::GetSource() const
 {
-    return source;
+    return *source;
 }
+
+template <typename Scalar>
+double DensitySource<Scalar>::GetStrength() const
+{
+    return strength;
+}
+
+template class DensitySource<float>;
+template class DensitySource<double>;
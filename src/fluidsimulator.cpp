@@ -1,231 +1,778 @@
-#include <imgui.h>
-#include <glm/glm.hpp>
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include "fluidsimulator.h"
 #include "circularSource.h"
 #include "rectvelocitysource.h"
-#include "scenes/crosswindsscene.h"
-#include "scenes/whirlwindscene.h"
-#include "scenes/waterfountainscene.h"
+#include "scenes/scenecatalog.h"
 
-FluidSimulator::FluidSimulator(unsigned int N, GLuint densityTextureHandle, GLuint velocityTextureHandle, GLuint obstacleTextureHandle) :
-	N(N), diffusion(0.0001), viscosity(0), densityTextureHandle(densityTextureHandle), elemCount(N*N), densSources(),
-	velocityTextureHandle(velocityTextureHandle), scenes(), activeScene(nullptr), obstacleTextureHandle(obstacleTextureHandle),
-	obstColor(ImVec4(0, 0, 1, 0.5))
+template <typename Scalar>
+FluidSimulator<Scalar>::FluidSimulator(unsigned int N, unsigned int M) :
+	N(N), M(M > 0 ? M : N), diffusion(0.0001), viscosity(0), diffusionTolerance(1.0e-4), maxDiffusionIterations(20),
+	elemCount(GridSize(N, this->M)), obstacle(N, this->M), obstacleMask(N, this->M), sources(), staticSources(),
+	scenes(), activeScene(nullptr), lastTickTimings(), cflNumber(1.0), maxSubsteps(8), maxVelocity(0.0),
+	relaxationOrdering(RelaxationOrdering::RED_BLACK),
+	threadPool(std::make_unique<ThreadPool>()), kernels(&::GetStencilKernels<Scalar>()),
+	pressureSolverType(PressureSolverType::MULTIGRID), pressurePreconditioner(PreconditionerType::MIC0),
+	pressureTolerance(1.0e-4), maxPressureIterations(0), pressureSolver(), obstaclesChanged(false), lastPressureStats(),
+	domainBoundary(DomainBoundary::WALLS),
+	velocityLayout(VelocityLayout::COLLOCATED), spectralPressure(true), spectralSolver(), sparseTiles(false),
+	densityActivityThreshold(1.0e-5), velocityActivityThreshold(1.0e-3), tileActivity(N, this->M), sparsePressure(), sparseDivergence(),
+	approximateSparsePressure(false), tilePressureSolver(), wholeGridPasses(false)
 {
-	int gridSize = (N + 2) * (N + 2);
+	size_t gridSize = GridSize(N, this->M);
 	u.resize(gridSize);
 	v.resize(gridSize);
 	u_prev.resize(gridSize);
 	v_prev.resize(gridSize);
 	dens.resize(gridSize);
 	dens_prev.resize(gridSize);
-	obstacle.resize(gridSize);
 	obstacleColor.resize(gridSize);
+	obstaclePalette.push_back(glm::vec4(0));
 
-	for (int x = 1; x <= N; ++x) {
-		for (int y = 1; y <= N; ++y) {
-			if (x >= N - 20) {
-				//dens_prev[IX(x, y)] = 4;
-			}
-			else {
-				//dens_prev[IX(x, y)] = 1;
-
-			}
+	CreatePressureSolver();
+	InitializeScenes(); 
+}
 
-			//u[IX(x, y)] = 1;
-		}
-	}
+template <typename Scalar>
+unsigned int FluidSimulator<Scalar>::GetN() const
+{
+	return N;
+}
 
-	InitializeScenes(); 
+template <typename Scalar>
+unsigned int FluidSimulator<Scalar>::GetM() const
+{
+	return M;
 }
 
-const std::vector<double>& FluidSimulator::GetU() const
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator<Scalar>::GetU() const
 {
 	return u;
 }
 
-const std::vector<double>& FluidSimulator::GetV() const
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator<Scalar>::GetV() const
 {
 	return v;
 }
 
-const std::vector<double>& FluidSimulator::GetDens() const
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator<Scalar>::GetDens() const
 {
 	return dens;
 }
 
-void FluidSimulator::Tick()
+template <typename Scalar>
+bool FluidSimulator<Scalar>::IsObstacle(int x, int y) const
 {
-	if (densityTextureHandle > 10) return;
-	double dt = 0.016;// ImGui::GetIO().DeltaTime;
-	//todo: fix hardcoded window size
-	//dens_prev[IX(cursorX, cursorY)] = 4;
+	return obstacle.Get(x, y);
+}
 
-	VelStep(N, u, v, u_prev, v_prev, viscosity, dt);
-	DensStep(N, dens, dens_prev, u, v, diffusion, dt);
-	UpdateDensityTexture();
-	if (velocityTextureHandle <= 10) {
-		UpdateVelocityTexture();
+template <typename Scalar>
+const glm::vec4& FluidSimulator<Scalar>::GetObstacleColor(int x, int y) const
+{
+	return obstaclePalette[obstacleColor[IX(x, y)]];
+}
+
+template <typename Scalar>
+const std::vector<uint8_t>& FluidSimulator<Scalar>::GetObstacleColorIndices() const
+{
+	return obstacleColor;
+}
+
+template <typename Scalar>
+const std::vector<glm::vec4>& FluidSimulator<Scalar>::GetObstaclePalette() const
+{
+	return obstaclePalette;
+}
+
+template <typename Scalar>
+uint8_t FluidSimulator<Scalar>::GetPaletteIndex(const glm::vec4& color)
+{
+	if (color == glm::vec4(0)) {
+		return 0;
+	}
+	for (size_t index = 1; index < obstaclePalette.size(); ++index) {
+		if (obstaclePalette[index] == color) {
+			return (uint8_t)index;
+		}
+	}
+	if (obstaclePalette.size() <= UINT8_MAX) {
+		obstaclePalette.push_back(color);
+		return (uint8_t)(obstaclePalette.size() - 1);
 	}
-	if (obstacleTextureHandle <= 10) {
-		UpdateObstacleTexture();
+	// The palette is full, fall back to the nearest color already in it
+	size_t nearest = 1;
+	for (size_t index = 2; index < obstaclePalette.size(); ++index) {
+		glm::vec4 d = obstaclePalette[index] - color, dNearest = obstaclePalette[nearest] - color;
+		if (glm::dot(d, d) < glm::dot(dNearest, dNearest)) {
+			nearest = index;
+		}
 	}
+	return (uint8_t)nearest;
+}
 
-	HandleMouse();
+template <typename Scalar>
+const CellBitmask& FluidSimulator<Scalar>::GetObstacles() const
+{
+	return obstacle;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::Tick(double frameDt)
+{
+	using Clock = std::chrono::steady_clock;
 
-	for (int x = 1; x <= N; ++x) {
-		for (int y = 1; y <= N; y++) {
-			//dens[IX(x, y)] *= 0.99;
+	Clock::time_point start = Clock::now();
+	lastTickTimings = TickTimings();
+	if (obstaclesChanged) {
+		UpdateObstacles();
+	}
+	double elapsed = 0.0;
+	while (elapsed < frameDt) {
+		double remaining = frameDt - elapsed;
+		// Split what is left of the interval evenly rather than taking CFL-sized steps and a sliver at the end
+		int steps = 1;
+		if (cflNumber > 0 && lastTickTimings.substeps + 1 < maxSubsteps) {
+			double cells = remaining * N * maxVelocity;
+			steps = std::min((int)std::ceil(cells / cflNumber), maxSubsteps - lastTickTimings.substeps);
+			steps = std::max(steps, 1);
 		}
+		double dt = steps == 1 ? remaining : remaining / steps;
+		lastTickTimings.cfl = std::max(lastTickTimings.cfl, dt * N * maxVelocity);
+		Step(dt);
+		elapsed = steps == 1 ? frameDt : elapsed + dt;
+		lastTickTimings.substeps++;
 	}
+	lastTickTimings.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
 
-	double densSum = 0;
-	for (int i = 0; i < dens.size(); ++i) {
-		densSum += dens[i];
+template <typename Scalar>
+void FluidSimulator<Scalar>::Step(double dt)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point start = Clock::now();
+	sources.Tick(dt);
+	if (sparseTiles) {
+		ActivateTiles();
 	}
-	densSum += 1;
-	// std::cout << densSum << std::endl;
-	
+	VelStep(N, u, v, u_prev, v_prev, viscosity, dt);
+	maxVelocity = MeasureMaxVelocity();
+	Clock::time_point velDone = Clock::now();
+	DensStep(N, dens, dens_prev, u, v, diffusion, dt);
+	if (sparseTiles) {
+		RetireIdleTiles();
+	}
+	Clock::time_point densDone = Clock::now();
 
-	/*for (int i = 0; i <= N; ++i) {
-		AddDens(10, i, 100);
-	}*/
+	lastTickTimings.velStepMs += std::chrono::duration<double, std::milli>(velDone - start).count();
+	lastTickTimings.densStepMs += std::chrono::duration<double, std::milli>(densDone - velDone).count();
 }
 
-void FluidSimulator::HandleMouse() 
+template <typename Scalar>
+double FluidSimulator<Scalar>::MeasureMaxVelocity() const
 {
-	int cursorX = ImGui::GetMousePos().x / 1200 * N;
-	int cursorY = (1 - ImGui::GetMousePos().y / 1200) * N;
-	// NOTE: LeftCtrl + Mouse is for camera handling
-	// NOTE: LeftShift + Mouse is for adding obstacles
-	if (ImGui::IsMouseDragging(0) && !ImGui::IsKeyDown(ImGuiKey_LeftCtrl) && !ImGui::IsKeyDown(ImGuiKey_LeftShift)) {
-		ImVec2 dragVec = ImGui::GetMouseDragDelta(0);
-		// AddVel(cursorX, cursorY, dragVec.x, dragVec.y);
-		if (cursorX >= 0 && cursorX <= N && cursorY >= 0 && cursorY <= N && !obstacle[IX(cursorX, cursorY)]) {
-			AddDens(cursorX, cursorY, abs((dragVec.x + dragVec.y) * 100));
+	int minRowsPerChunk = std::max(1, 4096 / (int)N);
+	// Every row owns a slot for its maximum, as in LinearSolve
+	std::vector<double> rowMax(M + 2, 0.0);
+	threadPool->ParallelFor(1, M + 1, minRowsPerChunk, [&](int rowBegin, int rowEnd) {
+		for (int j = rowBegin; j < rowEnd; j++) {
+			Scalar largest = 0;
+			for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+				for (int i = run->begin; i < run->end; i++) {
+					largest = std::max(largest, std::max(std::abs(u[IX(i, j)]), std::abs(v[IX(i, j)])));
+				}
+			}
+			rowMax[j] = largest;
 		}
+	});
+	return *std::max_element(rowMax.begin(), rowMax.end());
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetCflLimit(double cflNumber, int maxSubsteps)
+{
+	this->cflNumber = cflNumber;
+	this->maxSubsteps = std::max(maxSubsteps, 1);
+}
+
+template <typename Scalar>
+double FluidSimulator<Scalar>::GetMaxVelocity() const
+{
+	return maxVelocity;
+}
+
+template <typename Scalar>
+const TickTimings& FluidSimulator<Scalar>::GetLastTickTimings() const
+{
+	return lastTickTimings;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetDiffusionTolerance(double relativeTolerance)
+{
+	diffusionTolerance = relativeTolerance;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetMaxDiffusionIterations(int iterations)
+{
+	maxDiffusionIterations = iterations;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetRelaxationOrdering(RelaxationOrdering ordering)
+{
+	relaxationOrdering = ordering;
+}
+
+template <typename Scalar>
+RelaxationOrdering FluidSimulator<Scalar>::GetRelaxationOrdering() const
+{
+	return relaxationOrdering;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetThreadCount(unsigned int threadCount)
+{
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+}
+
+template <typename Scalar>
+unsigned int FluidSimulator<Scalar>::GetThreadCount() const
+{
+	return threadPool->GetThreadCount();
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetPressureSolver(PressureSolverType type)
+{
+	if (type != pressureSolverType) {
+		pressureSolverType = type;
+		CreatePressureSolver();
 	}
-	if (ImGui::IsMouseDragging(1) && !ImGui::IsKeyDown(ImGuiKey_LeftCtrl) && !ImGui::IsKeyDown(ImGuiKey_LeftShift)) {
-		ImVec2 dragVec = ImGui::GetMouseDragDelta(1);
-		if (cursorX >= 0 && cursorX <= N && cursorY >= 0 && cursorY <= N) {
-			float dragStartX = cursorX - (dragVec.x / 1200 * N);
-			float dragStartY = cursorY - ((1 - dragVec.y) / 1200) * N;
-			AddVel(dragStartX, dragStartY, dragVec.x * 0.001, dragVec.y * -0.001);
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetPressurePreconditioner(PreconditionerType type)
+{
+	if (type != pressurePreconditioner) {
+		pressurePreconditioner = type;
+		if (pressureSolverType == PressureSolverType::CONJUGATE_GRADIENT) {
+			CreatePressureSolver();
 		}
 	}
-	// Add obstacles with left click and left shift
-	if (ImGui::IsKeyDown(ImGuiKey_LeftShift) && ImGui::IsMouseDown(0)) {
-		if (cursorX >= -1 && cursorX < N && cursorY >= 0 && cursorY <= N) {
-			glm::vec4 col(obstColor.x, obstColor.y, obstColor.z, obstColor.w);
-			ToggleObs(cursorX + 1, cursorY, true, col);			// this one offset makes it visually be more where the mouse is on my laptop
-			// also remove any density and velocity frozen by this obstacle
-			dens[IX(cursorX + 1, cursorY)] = 0;
-			u[IX(cursorX + 1, cursorY)] = 0;
-			v[IX(cursorX + 1, cursorY)] = 0;
-		}
+}
+
+template <typename Scalar>
+PreconditionerType FluidSimulator<Scalar>::GetPressurePreconditioner() const
+{
+	return pressurePreconditioner;
+}
+
+template <typename Scalar>
+PressureSolverType FluidSimulator<Scalar>::GetPressureSolver() const
+{
+	return pressureSolverType;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetSpectralPressure(bool enabled)
+{
+	spectralPressure = enabled;
+}
+
+template <typename Scalar>
+bool FluidSimulator<Scalar>::GetSpectralPressure() const
+{
+	return spectralPressure;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetDomainBoundary(DomainBoundary boundary)
+{
+	domainBoundary = boundary;
+}
+
+template <typename Scalar>
+DomainBoundary FluidSimulator<Scalar>::GetDomainBoundary() const
+{
+	return domainBoundary;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetVelocityLayout(VelocityLayout layout)
+{
+	if (layout == velocityLayout) {
+		return;
 	}
-	// Remove obstacles with right click and left shift
-	else if (ImGui::IsKeyDown(ImGuiKey_LeftShift) && ImGui::IsMouseDown(1)) {
-		if (cursorX >= -1 && cursorX < N && cursorY >= 0 && cursorY <= N) {
-			ToggleObs(cursorX + 1, cursorY, false, glm::vec4(0));
-		}
+	// The values of one layout mean nothing in the other
+	velocityLayout = layout;
+	Reset();
+}
+
+template <typename Scalar>
+VelocityLayout FluidSimulator<Scalar>::GetVelocityLayout() const
+{
+	return velocityLayout;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetSparseTiles(bool enabled)
+{
+	if (enabled == sparseTiles) {
+		return;
+	}
+	sparseTiles = enabled;
+	size_t gridSize = enabled ? GridSize(N, M) : 0;
+	sparsePressure.assign(gridSize, 0.0);
+	sparseDivergence.assign(gridSize, 0.0);
+	sparsePressure.shrink_to_fit();
+	sparseDivergence.shrink_to_fit();
+	CreateTilePressureSolver();
+	// Whatever the fields hold now is active until the first tick finds out otherwise
+	tileActivity.MarkAll();
+	tileActivity.Update(obstacleMask, domainBoundary == DomainBoundary::PERIODIC);
+}
+
+template <typename Scalar>
+bool FluidSimulator<Scalar>::GetSparseTiles() const
+{
+	return sparseTiles;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetApproximateSparsePressure(bool enabled)
+{
+	if (enabled == approximateSparsePressure) {
+		return;
+	}
+	approximateSparsePressure = enabled;
+	if (sparseTiles && enabled) {
+		// The approximate pressure needs the still air at rest
+		tileActivity.ClearInactiveTiles({ &u, &v });
+	}
+	CreateTilePressureSolver();
+}
+
+template <typename Scalar>
+bool FluidSimulator<Scalar>::GetApproximateSparsePressure() const
+{
+	return approximateSparsePressure;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::CreateTilePressureSolver()
+{
+	tilePressureSolver.reset();
+	if (!sparseTiles || !approximateSparsePressure) {
+		return;
+	}
+	tilePressureSolver = std::make_unique<TilePressureSolver<Scalar>>(N, M, pressureTolerance);
+	if (maxPressureIterations > 0) {
+		tilePressureSolver->SetMaxIterations(maxPressureIterations);
+	}
+	// The active cells are set by the next ActivateTiles(), before anything is solved
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetActivityThresholds(double density, double velocity)
+{
+	densityActivityThreshold = density;
+	velocityActivityThreshold = velocity;
+}
+
+template <typename Scalar>
+const TileActivity<Scalar>& FluidSimulator<Scalar>::GetTileActivity() const
+{
+	return tileActivity;
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetPressureTolerance(double relativeTolerance)
+{
+	pressureTolerance = relativeTolerance;
+	if (pressureSolver) {
+		pressureSolver->SetTolerance(relativeTolerance);
+	}
+	if (tilePressureSolver) {
+		tilePressureSolver->SetTolerance(relativeTolerance);
+	}
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetMaxPressureIterations(int iterations)
+{
+	maxPressureIterations = iterations;
+	if (tilePressureSolver) {
+		tilePressureSolver->SetMaxIterations(iterations > 0 ? iterations : TilePressureSolver<Scalar>::DEFAULT_MAX_ITERATIONS);
+	}
+	if (pressureSolver && iterations > 0) {
+		pressureSolver->SetMaxIterations(iterations);
+	}
+	else {
+		// A fresh solver starts from its own default cap
+		CreatePressureSolver();
 	}
 }
 
-GLuint FluidSimulator::GetDensityTextureHandle() const
+template <typename Scalar>
+const SolveStats& FluidSimulator<Scalar>::GetLastPressureStats() const
 {
-	return densityTextureHandle;
+	return lastPressureStats;
 }
 
-GLuint FluidSimulator::GetVelocityTextureHandle() const
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetMaxSimdLevel(SimdLevel maxLevel)
 {
-	return velocityTextureHandle;
+	kernels = &::GetStencilKernels<Scalar>(maxLevel);
 }
 
-GLuint FluidSimulator::GetObstacleTextureHandle() const
+template <typename Scalar>
+const StencilKernels<Scalar>& FluidSimulator<Scalar>::GetStencilKernels() const
 {
-	return obstacleTextureHandle;
+	return *kernels;
 }
 
-void FluidSimulator::AddSource(int N, std::vector<double>& x, const std::vector<double>& s, double dT)
+template <typename Scalar>
+void FluidSimulator<Scalar>::AddSource(int N, Field<Scalar>& x, const SourceFootprint<Scalar>& s, double dT)
 {
-	int cell, size = (N + 2) * (N + 2);
-	for (cell = 0; cell < size; cell++) x[cell] += dT * s[cell];
+	// Only the runs the source covers are touched
+	const Scalar* values = s.GetValues().data();
+	for (const typename SourceFootprint<Scalar>::Span& span : s.GetSpans()) {
+		kernels->addSource(&x[span.start], values + span.offset, span.length, Scalar(dT));
+	}
 }
 
-void FluidSimulator::ApplyDensitySources(double dT)
+template <typename Scalar>
+void FluidSimulator<Scalar>::ApplyDensitySources(double dT)
 {
-	for (const DensitySource& densSource : densSources) {
-		AddSource(N, dens, densSource.GetSource(), dT);
+	AddSource(N, dens, staticSources.GetDensity(), dT);
+	for (const std::unique_ptr<DensitySource<Scalar>>& densSource : sources.GetDensitySources()) {
+		if (densSource->IsStatic()) {
+			continue;
+		}
+		AddSource(N, dens, densSource->GetSource(), dT * densSource->GetStrength());
 	}
 }
 
-void FluidSimulator::ApplyVelocitySources(double dT)
+template <typename Scalar>
+void FluidSimulator<Scalar>::ApplyVelocitySources(double dT)
 {
-	for (const VelocitySource& velSource : velSources) {
-		AddSource(N, u, velSource.GetHorizontalVelocitySource(), dT);
-		AddSource(N, v, velSource.GetVerticalVelocitySource(), dT);
+	AddSource(N, u, staticSources.GetHorizontalVelocity(), dT);
+	AddSource(N, v, staticSources.GetVerticalVelocity(), dT);
+	for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : sources.GetVelocitySources()) {
+		if (velSource->IsStatic()) {
+			continue;
+		}
+		if (velSource->IsProcedural()) {
+			const ProceduralVelocitySource<Scalar>& procedural =
+				static_cast<const ProceduralVelocitySource<Scalar>&>(*velSource);
+			Scalar uScale = Scalar(dT * procedural.GetStrength().x);
+			Scalar vScale = Scalar(dT * procedural.GetStrength().y);
+			threadPool->ParallelFor(1, M + 1, std::max(1, 4096 / int(N)), [&](int rowBegin, int rowEnd) {
+				for (int j = rowBegin; j < rowEnd; j++) {
+					if (!sparseTiles || HoldsStillMotion()) {
+						procedural.AddVelocityRow(j, 1, N + 1, &u[IX(0, j)], &v[IX(0, j)], uScale, vScale);
+						continue;
+					}
+					// With the approximate sparse pressure only the active tiles move, the rest of the grid stays
+					// at zero
+					for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+						procedural.AddVelocityRow(j, run->begin, run->end, &u[IX(0, j)], &v[IX(0, j)], uScale, vScale);
+					}
+				}
+			});
+			continue;
+		}
+		AddSource(N, u, velSource->GetHorizontalVelocitySource(), dT * velSource->GetStrength().x);
+		AddSource(N, v, velSource->GetVerticalVelocitySource(), dT * velSource->GetStrength().y);
 	}
 }
 
-void FluidSimulator::AddDens(int x, int y, float amt) {
+template <typename Scalar>
+void FluidSimulator<Scalar>::AddDens(int x, int y, float amt) {
+	tileActivity.MarkCells(x, x + 1, y);
 	dens[IX(x, y)] += glm::clamp(amt + (float) dens[IX(x, y)], 0.f, 1.f);
 }
 
-void FluidSimulator::AddVel(int x, int y, float amtX, float amtY) {
+template <typename Scalar>
+void FluidSimulator<Scalar>::AddVel(int x, int y, float amtX, float amtY) {
+	tileActivity.MarkCells(x, x + 1, y);
 	u[IX(x, y)] += amtX;
 	v[IX(x, y)] += amtY;
 }
 
 
-void FluidSimulator::ToggleObs(int x, int y, bool isObs, glm::vec4 color) {
-	obstacle[IX(x, y)] = isObs;
-	obstacleColor[IX(x, y)] = color;
+template <typename Scalar>
+void FluidSimulator<Scalar>::ToggleObs(int x, int y, bool isObs, glm::vec4 color) {
+	if (obstacle.Set(x, y, isObs)) {
+		obstaclesChanged = true;
+	}
+	obstacleColor[IX(x, y)] = GetPaletteIndex(color);
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::PaintObstacleRect(int x0, int y0, int x1, int y1, bool isObs, glm::vec4 color) {
+	if (obstacle.SetRect(x0, y0, x1, y1, isObs) != 0) {
+		obstaclesChanged = true;
+	}
+	uint8_t colorIndex = isObs ? GetPaletteIndex(color) : 0;
+	x0 = std::max(x0, 0); x1 = std::min(x1, (int)N + 2);
+	for (int y = std::max(y0, 0); y < std::min(y1, (int)M + 2) && x0 < x1; ++y) {
+		std::fill(&obstacleColor[IX(x0, y)], &obstacleColor[IX(x1, y)], colorIndex);
+	}
 }
 
-void FluidSimulator::Diffuse(int N, BoundaryType b, std::vector<double>& x, const std::vector<double>& x0, double diff, double dt)
+template <typename Scalar>
+void FluidSimulator<Scalar>::PaintObstacleCircle(double x, double y, double radius, bool isObs, glm::vec4 color) {
+	if (obstacle.SetCircle(x, y, radius, isObs) != 0) {
+		obstaclesChanged = true;
+	}
+	uint8_t colorIndex = isObs ? GetPaletteIndex(color) : 0;
+	for (int j = std::max((int)std::ceil(y - radius), 0); j <= std::min((int)std::floor(y + radius), (int)M + 1); ++j) {
+		int iBegin, iEnd;
+		CellBitmask::GetCircleSpan(x, y, radius, j, iBegin, iEnd);
+		iBegin = std::max(iBegin, 0); iEnd = std::min(iEnd, (int)N + 2);
+		if (iBegin < iEnd) {
+			std::fill(&obstacleColor[IX(iBegin, j)], &obstacleColor[IX(iEnd, j)], colorIndex);
+		}
+	}
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::ClearCell(int x, int y) {
+	dens[IX(x, y)] = 0;
+	u[IX(x, y)] = 0;
+	v[IX(x, y)] = 0;
+}
+
+template <typename Scalar>
+int FluidSimulator<Scalar>::LinearSolve(int N, BoundaryType b, Field<Scalar>& x, const Field<Scalar>& x0, double a, double c,
+	int iterations, double tolerance)
 {
 	int i, j, k;
+	int m = (int)M;
+	// The sweeps stop once sqrt(sum of squared changes / (N M)) * c <= tolerance * RMS(x0)
+	double threshold = 0.0;
+	if (tolerance > 0) {
+		double rhsSumSquared = 0.0;
+		for (j = 1; j <= m; j++) {
+			for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+				for (i = run->begin; i < run->end; i++) {
+					rhsSumSquared += (double)x0[IX(i, j)] * x0[IX(i, j)];
+				}
+			}
+		}
+		threshold = tolerance * tolerance * rhsSumSquared / (c * c);
+	}
+	auto Converged = [&](double sumSquaredChange) {
+		return tolerance > 0 && sumSquaredChange <= threshold;
+	};
+
+	if (relaxationOrdering == RelaxationOrdering::LEXICOGRAPHIC) {
+		Scalar as = Scalar(a), cs = Scalar(c);
+		for (k = 0; k < iterations; k++) {
+			double sumSquaredChange = 0.0;
+			for (j = 1; j <= m; j++) {
+				for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+					for (i = run->begin; i < run->end; i++) {
+						Scalar relaxed = (x0[IX(i, j)] + as * (x[IX(i - 1, j)] + x[IX(i + 1, j)] +
+							x[IX(i, j - 1)] + x[IX(i, j + 1)])) / cs;
+						double change = relaxed - x[IX(i, j)];
+						sumSquaredChange += change * change;
+						x[IX(i, j)] = relaxed;
+					}
+				}
+			}
+			SetBoundaryConditions(N, b, x);
+			if (Converged(sumSquaredChange)) {
+				return k + 1;
+			}
+		}
+		return iterations;
+	}
+
+	// Red-black ordering: a cell only depends on neighbors of the other color, so every row of one color
+	// can be relaxed independently of the others and the rows are split across the thread pool.
+	// Rows are handed out in chunks of at least ~4096 cells so small grids are not dominated by dispatch overhead.
+	int minRowsPerChunk = std::max(1, 4096 / N);
+	Scalar as = Scalar(a);
+	Scalar invC = Scalar(1.0 / c);
+	// Every row owns a slot for its changes, so the sum does not depend on how the rows were split
+	std::vector<double> rowSumSquaredChange(M + 2);
+	for (k = 0; k < iterations; k++) {
+		std::fill(rowSumSquaredChange.begin(), rowSumSquaredChange.end(), 0.0);
+		for (int color = 0; color < 2; color++) {
+			threadPool->ParallelFor(1, M + 1, minRowsPerChunk, [&](int rowBegin, int rowEnd) {
+				for (int j = rowBegin; j < rowEnd; j++) {
+					// Each run of fluid cells is relaxed as a row of its own, starting at the cell before it.
+					// The first cell of the color being relaxed is the first one with i + j + color even.
+					for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+						int origin = IX(run->begin - 1, j);
+						int firstCell = 1 + ((run->begin + j + color) & 1);
+						rowSumSquaredChange[j] += kernels->relaxRowRedBlack(&x[origin], &x0[origin],
+							&x[origin - GridStride(N)], &x[origin + GridStride(N)], run->end - run->begin, firstCell, as,
+							invC);
+					}
+				}
+			});
+		}
+		SetBoundaryConditions(N, b, x);
+		double sumSquaredChange = 0.0;
+		for (double rowSum : rowSumSquaredChange) {
+			sumSquaredChange += rowSum;
+		}
+		if (Converged(sumSquaredChange)) {
+			return k + 1;
+		}
+	}
+	return iterations;
+}
+
+template <typename Scalar>
+double FluidSimulator<Scalar>::LinearSolveResidual(int N, const Field<Scalar>& x, const Field<Scalar>& x0, double a, double c) const
+{
+	int m = (int)M;
+	double sumSquared = 0.0;
+	for (int j = 1; j <= m; j++) {
+		for (int i = 1; i <= N; i++) {
+			double r = x0[IX(i, j)] + a * (x[IX(i - 1, j)] + x[IX(i + 1, j)] + x[IX(i, j - 1)] + x[IX(i, j + 1)]) - c * x[IX(i, j)];
+			sumSquared += r * r;
+		}
+	}
+	return std::sqrt(sumSquared / ((double)N * M));
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::Diffuse(int N, BoundaryType b, Field<Scalar>& x, const Field<Scalar>& x0, double diff, double dt)
+{
 	double a = dt * diff * N * N;
-	//todo: the 20 here is essentially our time step. It should be a function of grid meter size, not a constant.
-	for (k = 0; k < 20; k++) {
-		for (i = 1; i <= N; i++) {
-			for (j = 1; j <= N; j++) {
-				double initial = x[IX(i, j)];
-				double check = (x0[IX(i, j)] + a * (x[IX(i - 1, j)] + x[IX(i + 1, j)] +
-					x[IX(i, j - 1)] + x[IX(i, j + 1)])) / (1 + 4 * a);
-				x[IX(i, j)] = (x0[IX(i, j)] + a * (x[IX(i - 1, j)] + x[IX(i + 1, j)] +
-					x[IX(i, j - 1)] + x[IX(i, j + 1)])) / (1 + 4 * a);
+	if (a == 0) {
+		int m = (int)M;
+		// Without diffusion the system is x = x0
+		for (int j = 1; j <= m; j++) {
+			for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+				std::copy(&x0[IX(run->begin, j)], &x0[IX(run->end, j)], &x[IX(run->begin, j)]);
 			}
 		}
 		SetBoundaryConditions(N, b, x);
+		return;
 	}
+	// Weak diffusion converges in a sweep or two, so stop on the residual instead of always running the maximum
+	lastTickTimings.diffusionSweeps += LinearSolve(N, b, x, x0, a, 1 + 4 * a, maxDiffusionIterations,
+		diffusionTolerance);
+}
 
+template <typename Scalar>
+void FluidSimulator<Scalar>::Advect(int N, BoundaryType b, Field<Scalar>& d, const Field<Scalar>& d0, const Field<Scalar>& u, const Field<Scalar>& v, double dt)
+{
+	if (velocityLayout == VelocityLayout::STAGGERED) {
+		AdvectStaggered(N, b, d, d0, u, v, dt);
+		return;
+	}
+	AdvectFields(N, { { b, &d, &d0 } }, u, v, dt);
 }
 
-void FluidSimulator::Advect(int N, BoundaryType b, std::vector<double>& d, const std::vector<double>& d0, const std::vector<double>& u, const std::vector<double>& v, double dt)
+template <typename Scalar>
+void FluidSimulator<Scalar>::AdvectFields(int N, std::initializer_list<AdvectedField> fields, const Field<Scalar>& u,
+	const Field<Scalar>& v, double dt)
 {
-	int i, j, i0, j0, i1, j1;
+	int i, j, i0, j0;
 	double x, y, s0, t0, s1, t1, dt0;
+	int stride = GridStride(N);
 	dt0 = dt * N;
-	for (i = 1; i <= N; i++) {
-		for (j = 1; j <= N; j++) {
-			if (obstacle[IX(i, j)]) {
-				continue;
+	bool periodic = domainBoundary == DomainBoundary::PERIODIC;
+	int m = (int)M;
+	for (j = 1; j <= m; j++) {
+		// Only the fluid cells are moved, the solid ones get their wall values from SetBoundaryConditions
+		for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+			for (i = run->begin; i < run->end; i++) {
+				x = i - dt0 * u[IX(i, j)]; y = j - dt0 * v[IX(i, j)];
+				if (periodic) {
+					// Wrap into [0.5, N + 0.5) x [0.5, M + 0.5), the boundary cells hold the values from the opposite edge
+					x = 0.5 + std::fmod(x - 0.5, (double)N); if (x < 0.5) x += N;
+					y = 0.5 + std::fmod(y - 0.5, (double)M); if (y < 0.5) y += M;
+				}
+				if (x < 0.5) x = 0.5; if (x > N + 0.5) x = N + 0.5; i0 = (int)x;
+				if (y < 0.5) y = 0.5; if (y > M + 0.5) y = M + 0.5; j0 = (int)y;
+				s1 = x - i0; s0 = 1 - s1; t1 = y - j0; t0 = 1 - t1;
+				// The four cells around the departure point, shared by every field
+				int cell = IX(i, j);
+				int corner = IX(i0, j0);
+				for (const AdvectedField& field : fields) {
+					const Field<Scalar>& d0 = *field.d0;
+					(*field.d)[cell] = Scalar(s0 * (t0 * d0[corner] + t1 * d0[corner + stride]) +
+						s1 * (t0 * d0[corner + 1] + t1 * d0[corner + 1 + stride]));
+				}
+			}
+		}
+	}
+	for (const AdvectedField& field : fields) {
+		SetBoundaryConditions(N, field.b, *field.d);
+	}
+}
+
+template <typename Scalar>
+void FluidSimulator<Scalar>::AdvectStaggered(int N, BoundaryType b, Field<Scalar>& d, const Field<Scalar>& d0,
+	const Field<Scalar>& u, const Field<Scalar>& v, double dt)
+{
+	int stride = GridStride(N);
+	double dt0 = dt * N;
+	bool periodic = domainBoundary == DomainBoundary::PERIODIC;
+	// Position of the points of d within their cell, and the range their grid coordinates are clamped to: the
+	// components stop at the wall faces, the rest at the centers of the outer inner cells
+	double offsetX = b == BoundaryType::HORIZONTAL ? 0.5 : 0.0;
+	double offsetY = b == BoundaryType::VERTICAL ? 0.5 : 0.0;
+	double minX = b == BoundaryType::HORIZONTAL ? 0.0 : 0.5, maxX = b == BoundaryType::HORIZONTAL ? N : N + 0.5;
+	double minY = b == BoundaryType::VERTICAL ? 0.0 : 0.5, maxY = b == BoundaryType::VERTICAL ? M : M + 0.5;
+	int m = (int)M;
+	for (int j = 1; j <= m; j++) {
+		for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+			for (int i = run->begin; i < run->end; i++) {
+				int cell = IX(i, j);
+				// The velocity at the point, from the faces around it
+				double pointU, pointV;
+				switch (b) {
+				case BoundaryType::HORIZONTAL:
+					pointU = u[cell];
+					pointV = 0.25 * (v[cell] + v[cell + 1] + v[cell - stride] + v[cell + 1 - stride]);
+					break;
+				case BoundaryType::VERTICAL:
+					pointU = 0.25 * (u[cell] + u[cell - 1] + u[cell + stride] + u[cell - 1 + stride]);
+					pointV = v[cell];
+					break;
+				default:
+					pointU = 0.5 * (u[cell] + u[cell - 1]);
+					pointV = 0.5 * (v[cell] + v[cell - stride]);
+					break;
+				}
+				double x = i + offsetX - dt0 * pointU;
+				double y = j + offsetY - dt0 * pointV;
+				if (periodic) {
+					// Wrap into [0.5, N + 0.5) x [0.5, M + 0.5), the boundary cells hold the values from the opposite edge
+					x = 0.5 + std::fmod(x - 0.5, (double)N); if (x < 0.5) x += N;
+					y = 0.5 + std::fmod(y - 0.5, (double)M); if (y < 0.5) y += M;
+				}
+				// Grid coordinates of the departure point among the points of d
+				x = std::min(std::max(x - offsetX, minX), maxX);
+				y = std::min(std::max(y - offsetY, minY), maxY);
+				int i0 = (int)x, j0 = (int)y;
+				double s1 = x - i0, s0 = 1 - s1, t1 = y - j0, t0 = 1 - t1;
+				int corner = IX(i0, j0);
+				d[cell] = Scalar(s0 * (t0 * d0[corner] + t1 * d0[corner + stride]) +
+					s1 * (t0 * d0[corner + 1] + t1 * d0[corner + 1 + stride]));
 			}
-			x = i - dt0 * u[IX(i, j)]; y = j - dt0 * v[IX(i, j)];
-			if (x < 0.5) x = 0.5; if (x > N + 0.5) x = N + 0.5; i0 = (int)x; i1 = i0 + 1;
-			if (y < 0.5) y = 0.5; if (y > N + 0.5) y = N + 0.5; j0 = (int)y; j1 = j0 + 1;
-			s1 = x - i0; s0 = 1 - s1; t1 = y - j0; t0 = 1 - t1;
-			d[IX(i, j)] = s0 * (t0 * d0[IX(i0, j0)] + t1 * d0[IX(i0, j1)]) +
-				s1 * (t0 * d0[IX(i1, j0)] + t1 * d0[IX(i1, j1)]);
 		}
 	}
 	SetBoundaryConditions(N, b, d);
 }
 
-void FluidSimulator::DensStep(int N, std::vector<double>& x, std::vector<double>& x0, const std::vector<double>& u, const std::vector<double>& v, double diff, double dt)
+template <typename Scalar>
+void FluidSimulator<Scalar>::DensStep(int N, Field<Scalar>& x, Field<Scalar>& x0, const Field<Scalar>& u, const Field<Scalar>& v, double diff, double dt)
 {
 	// AddSource(N, x, x0, dt);
 	ApplyDensitySources(dt); 
@@ -235,7 +782,8 @@ void FluidSimulator::DensStep(int N, std::vector<double>& x, std::vector<double>
 	Advect(N, BoundaryType::NONE, x, x0, u, v, dt);
 }
 
-void FluidSimulator::VelStep(int N, std::vector<double>& u, std::vector<double>& v, std::vector<double>& u0, std::vector<double>& v0,
+template <typename Scalar>
+void FluidSimulator<Scalar>::VelStep(int N, Field<Scalar>& u, Field<Scalar>& v, Field<Scalar>& u0, Field<Scalar>& v0,
 	double visc, double dt) {
 	//AddSource(N, u, u0, dt); 
 	//AddSource(N, v, v0, dt);
@@ -246,161 +794,294 @@ void FluidSimulator::VelStep(int N, std::vector<double>& u, std::vector<double>&
 
 	SWAP(v0, v); 
 	Diffuse(N, BoundaryType::VERTICAL, v, v0, visc, dt);
+	if (HoldsStillMotion()) {
+		// The faint motion of the inactive tiles is only changed by the pressure and body forces
+		tileActivity.CopyInactiveTiles(u, u0);
+		tileActivity.CopyInactiveTiles(v, v0);
+	}
 
-	Project(N, u, v, u0, v0);
+	// With sparse tiles the pressure and divergence get buffers of their own, as the pressure solvers write outside
+	// the active tiles
+	Field<Scalar>& p = sparseTiles ? sparsePressure : u0;
+	Field<Scalar>& div = sparseTiles ? sparseDivergence : v0;
+	Project(N, u, v, p, div);
 	SWAP(u0, u); SWAP(v0, v);
-	Advect(N, BoundaryType::HORIZONTAL, u, u0, u0, v0, dt); 
-	Advect(N, BoundaryType::VERTICAL, v, v0, u0, v0, dt);
-	Project(N, u, v, u0, v0);
+	if (velocityLayout == VelocityLayout::STAGGERED) {
+		// The components live on different faces, so each has a backtrace of its own
+		AdvectStaggered(N, BoundaryType::HORIZONTAL, u, u0, u0, v0, dt);
+		AdvectStaggered(N, BoundaryType::VERTICAL, v, v0, u0, v0, dt);
+	}
+	else {
+		// Both components are moved along the same backtrace
+		AdvectFields(N, { { BoundaryType::HORIZONTAL, &u, &u0 }, { BoundaryType::VERTICAL, &v, &v0 } }, u0, v0, dt);
+	}
+	if (HoldsStillMotion()) {
+		tileActivity.CopyInactiveTiles(u, u0);
+		tileActivity.CopyInactiveTiles(v, v0);
+	}
+	Project(N, u, v, p, div);
 
 }
 
-void FluidSimulator::Project(int N, std::vector<double>& u, std::vector<double>& v, std::vector<double>& p, std::vector<double>& div) {
-	int i, j, k;
+template <typename Scalar>
+void FluidSimulator<Scalar>::Project(int N, Field<Scalar>& u, Field<Scalar>& v, Field<Scalar>& p, Field<Scalar>& div) {
 	double h;
 	h = 1.0 / N;
-	for (i = 1; i <= N; i++) {
-		for (j = 1; j <= N; j++) {
-			div[IX(i, j)] = -0.5 * h * (u[IX(i + 1, j)] - u[IX(i - 1, j)] +
-				v[IX(i, j + 1)] - v[IX(i, j - 1)]);
-			p[IX(i, j)] = 0;
+	int minRowsPerChunk = std::max(1, 4096 / N);
+	bool staggered = velocityLayout == VelocityLayout::STAGGERED;
+	bool periodic = domainBoundary == DomainBoundary::PERIODIC;
+	// With every tile active the solvers of the whole grid are as good, and the spectral one is faster
+	bool allTilesActive = tileActivity.GetActiveTileCount() == tileActivity.GetTileCount();
+	bool tilePressure = tilePressureSolver && !allTilesActive && (pressureSolver || spectralPressure);
+	// Otherwise the pressure couples every cell of the grid, and so does its gradient: the whole grid is visited,
+	// as without sparse tiles, and the inactive tiles take up their share of the motion
+	wholeGridPasses = HoldsStillMotion();
+	threadPool->ParallelFor(1, M + 1, minRowsPerChunk, [&](int rowBegin, int rowEnd) {
+		for (int j = rowBegin; j < rowEnd; j++) {
+			for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+				int origin = IX(run->begin - 1, j);
+				if (staggered) {
+					kernels->staggeredDivergenceRow(&div[origin], &p[origin], &u[origin], &v[origin - GridStride(N)],
+						&v[origin], run->end - run->begin, Scalar(-h));
+				}
+				else {
+					kernels->divergenceRow(&div[origin], &p[origin], &u[origin], &v[origin - GridStride(N)],
+						&v[origin + GridStride(N)], run->end - run->begin, Scalar(-0.5 * h));
+				}
+			}
 		}
-	}
+	});
 	SetBoundaryConditions(N, BoundaryType::NONE, div); SetBoundaryConditions(N, BoundaryType::NONE, p);
-	for (k = 0; k < 1; k++) {
-		for (i = 1; i <= N; i++) {
-			for (j = 1; j <= N; j++) {
-				p[IX(i, j)] = (div[IX(i, j)] + p[IX(i - 1, j)] + p[IX(i + 1, j)] +
-					p[IX(i, j - 1)] + p[IX(i, j + 1)]) / 4;
-			}
+	if (tilePressure) {
+		// Only the active tiles, which are closed to the still air around them
+		tilePressureSolver->Solve(*threadPool, p, div);
+		SetBoundaryConditions(N, BoundaryType::NONE, p);
+		lastPressureStats = tilePressureSolver->GetLastStats();
+	}
+	else if (spectralPressure && obstacle.Count() == 0) {
+		if (!spectralSolver || spectralSolver->IsPeriodic() != periodic) {
+			spectralSolver = std::make_unique<SpectralPoissonSolver<Scalar>>(N, M, periodic);
 		}
+		spectralSolver->Solve(*threadPool, p, div);
 		SetBoundaryConditions(N, BoundaryType::NONE, p);
+		lastPressureStats = spectralSolver->GetLastStats();
 	}
-	for (i = 1; i <= N; i++) {
-		for (j = 1; j <= N; j++) {
-			u[IX(i, j)] -= 0.5 * (p[IX(i + 1, j)] - p[IX(i - 1, j)]) / h;
-			v[IX(i, j)] -= 0.5 * (p[IX(i, j + 1)] - p[IX(i, j - 1)]) / h;
+	else if (pressureSolver && !periodic) {
+		pressureSolver->Solve(*threadPool, p, div);
+		SetBoundaryConditions(N, BoundaryType::NONE, p);
+		lastPressureStats = pressureSolver->GetLastStats();
+	}
+	else {
+		// The single sweep of Stam's solver, or relaxation to the pressure tolerance in a periodic domain with
+		// obstacles, which the iterative solvers do not model
+		int sweeps = 1;
+		double tolerance = 0.0;
+		if (pressureSolver) {
+			sweeps = maxPressureIterations > 0 ? maxPressureIterations : 200;
+			tolerance = pressureTolerance;
 		}
+		lastPressureStats = SolveStats();
+		lastPressureStats.iterations = LinearSolve(N, BoundaryType::NONE, p, div, 1, 4, sweeps, tolerance);
 	}
+	threadPool->ParallelFor(1, M + 1, minRowsPerChunk, [&](int rowBegin, int rowEnd) {
+		for (int j = rowBegin; j < rowEnd; j++) {
+			for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+				int origin = IX(run->begin - 1, j);
+				if (staggered) {
+					// Faces against a wall get a gradient too, and are cleared by SetBoundaryConditions
+					kernels->staggeredGradientRow(&u[origin], &v[origin], &p[origin], &p[origin + GridStride(N)],
+						run->end - run->begin, Scalar(1 / h));
+				}
+				else {
+					kernels->gradientRow(&u[origin], &v[origin], &p[origin], &p[origin - GridStride(N)],
+						&p[origin + GridStride(N)], run->end - run->begin, Scalar(0.5 / h));
+				}
+			}
+		}
+	});
 	SetBoundaryConditions(N, BoundaryType::HORIZONTAL, u); SetBoundaryConditions(N, BoundaryType::VERTICAL, v);
+	if (wholeGridPasses) {
+		// Activate the tiles of still air the gradient moved above the threshold, with their neighbors, for the
+		// passes that follow
+		wholeGridPasses = false;
+		Scalar threshold = Scalar(velocityActivityThreshold);
+		if (tileActivity.MarkHolding(*threadPool, { { &u, threshold }, { &v, threshold } })) {
+			tileActivity.Update(obstacleMask, periodic);
+		}
+	}
 }
 
-
-void FluidSimulator::SetBoundaryConditions(int N, BoundaryType b, std::vector<double>& x)
+template <typename Scalar>
+void FluidSimulator<Scalar>::CreatePressureSolver()
 {
-	//todo: add wrapping boundary type
-	int i;
-	for (i = 1; i <= N; i++) {
-		x[IX(0, i)] = b == BoundaryType::HORIZONTAL ? x[IX(1, i)] * -1 : x[IX(1, i)];
-		x[IX(N + 1, i)] = b == BoundaryType::HORIZONTAL ? x[IX(N, i)] * -1 : x[IX(N, i)];
-		x[IX(i, 0)] = b == BoundaryType::VERTICAL ? x[IX(i, 1)] * -1 : x[IX(i, 1)];
-		x[IX(i, N + 1)] = b == BoundaryType::VERTICAL ? x[IX(i, N)] * -1 : x[IX(i, N)];
+	switch (pressureSolverType) {
+	case PressureSolverType::GAUSS_SEIDEL:
+		pressureSolver.reset();
+		return;
+	case PressureSolverType::MULTIGRID:
+		pressureSolver = std::make_unique<MultigridSolver<Scalar>>(N, M);
+		break;
+	case PressureSolverType::CONJUGATE_GRADIENT:
+		pressureSolver = std::make_unique<ConjugateGradientSolver<Scalar>>(N, M, pressurePreconditioner);
+		break;
 	}
-	x[IX(0, 0)] = 0.5 * (x[IX(1, 0)] + x[IX(0, 1)]);
-	x[IX(0, N + 1)] = 0.5 * (x[IX(1, N + 1)] + x[IX(0, N)]);
-	x[IX(N + 1, 0)] = 0.5 * (x[IX(N, 0)] + x[IX(N + 1, 1)]);
-	x[IX(N + 1, N + 1)] = 0.5 * (x[IX(N, N + 1)] + x[IX(N + 1, N)]);
-}
-
-void FluidSimulator::UpdateDensityTexture() {
-	std::vector<float> gradient(N * N * 4); // RGBA as doubles
-
-	for(int y = 1; y <= N; ++y){
-		for (int x = 1; x <= N; ++x) {
-			double pixelDensity = dens[IX(x, y)] / 2.5;
-			int index = ((y-1) * N + (x-1)) * 4;
-			gradient[index] = pixelDensity;
-			gradient[index + 1] = pixelDensity;
-			gradient[index + 2] = pixelDensity;
-			gradient[index + 3] = 1;
-		}
+	pressureSolver->SetObstacles(obstacle);
+	pressureSolver->SetTolerance(pressureTolerance);
+	if (maxPressureIterations > 0) {
+		pressureSolver->SetMaxIterations(maxPressureIterations);
 	}
-
-	//todo:: send to gpu. better ways to do this
-	glBindTexture(GL_TEXTURE_2D, densityTextureHandle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, N, N, 0, GL_RGBA, GL_FLOAT, gradient.data());
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void FluidSimulator::InitializeScenes()
+template <typename Scalar>
+void FluidSimulator<Scalar>::UpdateObstacles()
 {
-	// Create two empty scenes and add them to the scene selector to test scene selection functionarlity
-	std::string emptySceneName1("Empty Scene");
-	scenes[emptySceneName1] = Scene(N, emptySceneName1);
-
-	std::string crosswindSceneName("Crosswind Scene");
-	scenes[crosswindSceneName] = CrosswindsScene(N, crosswindSceneName);
-
-	std::string whirlwindSceneName("Whirlwind Scene"); 
-	scenes[whirlwindSceneName] = WhirlwindScene(N, whirlwindSceneName);
-
-	std::string waterFountainScene("Water Fountain Scene");
-	scenes[waterFountainScene] = WaterFountainScene(N, waterFountainScene);
-}
-
-void FluidSimulator::SetDensityTextureHandle(GLuint handle) {
-	densityTextureHandle = handle;
+	obstacleMask.Build(obstacle);
+	// Whatever was inside a new obstacle is gone
+	for (Field<Scalar>* field : { &u, &v, &u_prev, &v_prev, &dens, &dens_prev }) {
+		obstacleMask.ClearSolidCells(*field);
+	}
+	if (pressureSolver) {
+		pressureSolver->SetObstacles(obstacle);
+	}
+	obstaclesChanged = false;
 }
 
-void FluidSimulator::UpdateVelocityTexture() {
-	std::vector<float> field(N * N * 4); // RGBA as doubles
-
-	for (int y = 1; y <= N; ++y) {
-		for (int x = 1; x <= N; ++x) {
-			glm::vec3 pixelVelocity = glm::vec3(u[IX(x, y)], v[IX(x, y)], 0);
-			int index = ((y - 1) * N + (x - 1)) * 4;
-			// mapping the vector vals [-1, 1] to [0, 1]
-			field[index] = (glm::normalize(pixelVelocity).x + 1.f) * 0.5;
-			field[index + 1] = (glm::normalize(pixelVelocity).y + 1.f) * 0.5;
-			field[index + 2] = (glm::normalize(pixelVelocity).z + 1.f) * 0.5;
-			// storing original length, dividing by 10 to ensure it is between 0 and 1, might need to change later
-			field[index + 3] = glm::length(pixelVelocity) / 10.f;
+template <typename Scalar>
+void FluidSimulator<Scalar>::ActivateTiles()
+{
+	tileActivity.MarkFootprint(staticSources.GetDensity());
+	tileActivity.MarkFootprint(staticSources.GetHorizontalVelocity());
+	tileActivity.MarkFootprint(staticSources.GetVerticalVelocity());
+	for (const std::unique_ptr<DensitySource<Scalar>>& densSource : sources.GetDensitySources()) {
+		if (!densSource->IsStatic()) {
+			tileActivity.MarkFootprint(densSource->GetSource());
 		}
 	}
-
-	//todo:: send to gpu. better ways to do this
-	glBindTexture(GL_TEXTURE_2D, velocityTextureHandle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, N, N, 0, GL_RGBA, GL_FLOAT, field.data());
-	glBindTexture(GL_TEXTURE_2D, 1);
+	for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : sources.GetVelocitySources()) {
+		if (velSource->IsStatic()) {
+			continue;
+		}
+		if (velSource->IsProcedural()) {
+			const ProceduralVelocitySource<Scalar>& procedural =
+				static_cast<const ProceduralVelocitySource<Scalar>&>(*velSource);
+			// A gradient is projected away wherever the fluid is still, so it only acts on the tiles already active
+			if (procedural.IsGradient(domainBoundary == DomainBoundary::PERIODIC)) {
+				continue;
+			}
+			int iBegin, iEnd, jBegin, jEnd;
+			if (procedural.GetBounds(iBegin, iEnd, jBegin, jEnd)) {
+				for (int j = jBegin; j < jEnd; j++) {
+					tileActivity.MarkCells(iBegin, iEnd, j);
+				}
+				continue;
+			}
+			// Anything else may add to any cell
+			tileActivity.MarkAll();
+			break;
+		}
+		tileActivity.MarkFootprint(velSource->GetHorizontalVelocitySource());
+		tileActivity.MarkFootprint(velSource->GetVerticalVelocitySource());
+	}
+	tileActivity.Update(obstacleMask, domainBoundary == DomainBoundary::PERIODIC);
+	if (tilePressureSolver && tileActivity.GetActiveTileCount() < tileActivity.GetTileCount()) {
+		tilePressureSolver->SetActiveCells(tileActivity, domainBoundary == DomainBoundary::PERIODIC);
+	}
 }
 
-void FluidSimulator::SetVelocityTextureHandle(GLuint handle) {
-	velocityTextureHandle = handle;
+template <typename Scalar>
+void FluidSimulator<Scalar>::RetireIdleTiles()
+{
+	Scalar velocityThreshold = Scalar(velocityActivityThreshold);
+	tileActivity.UpdateOccupancy(*threadPool, { { &dens, Scalar(densityActivityThreshold) },
+		{ &u, velocityThreshold }, { &v, velocityThreshold } });
+	if (!HoldsStillMotion()) {
+		tileActivity.ClearIdleTiles({ &u, &v, &u_prev, &v_prev, &dens, &dens_prev, &sparsePressure,
+			&sparseDivergence });
+		return;
+	}
+	// The faint motion stays where it is, and activates its tiles again once it grows above the threshold
+	tileActivity.MarkHolding(*threadPool, { { &u, velocityThreshold }, { &v, velocityThreshold } });
+	tileActivity.ClearIdleTiles({ &u_prev, &v_prev, &dens, &dens_prev, &sparsePressure, &sparseDivergence });
 }
 
-void FluidSimulator::UpdateObstacleTexture() {
-	std::vector<float> field(N * N * 4); // RGBA as doubles
-
-	for (int y = 1; y <= N; ++y) {
-		for (int x = 1; x <= N; ++x) {
-			int index = ((y - 1) * N + (x - 1)) * 4;
-			if (obstacle[IX(x, y)]) {
-				glm::vec4 col = obstacleColor[IX(x, y)];
-				field[index] = col.x;
-				field[index + 1] = col.y;
-				field[index + 2] = col.z;
-				field[index + 3] = col.w;
+template <typename Scalar>
+void FluidSimulator<Scalar>::SetBoundaryConditions(int N, BoundaryType b, Field<Scalar>& x)
+{
+	int i, j;
+	int m = (int)M;
+	bool staggered = velocityLayout == VelocityLayout::STAGGERED;
+	// The walls of the obstacles only read fluid cells, so they can go first
+	if (staggered) {
+		obstacleMask.ApplyFaceConditions(b, x);
+	}
+	else {
+		obstacleMask.ApplyWallConditions(b, x);
+	}
+	if (domainBoundary == DomainBoundary::PERIODIC) {
+		// In a staggered grid face 0 is face N and face N + 1 is face 1 as well, so the copies are the same
+		// Each boundary cell takes the value of the inner cell on the opposite edge; the rows go last so the corners
+		// pick up the wrapped columns
+		for (j = 1; j <= m; j++) {
+			x[IX(0, j)] = x[IX(N, j)];
+			x[IX(N + 1, j)] = x[IX(1, j)];
+		}
+		for (i = 0; i <= N + 1; i++) {
+			x[IX(i, 0)] = x[IX(i, M)];
+			x[IX(i, M + 1)] = x[IX(i, 1)];
+		}
+		return;
+	}
+	if (staggered && b != BoundaryType::NONE) {
+		// No flow through the wall faces. The faces beyond them mirror the inner ones, and the component is copied
+		// into the boundary cells along the walls it runs parallel to.
+		if (b == BoundaryType::HORIZONTAL) {
+			for (j = 1; j <= m; j++) {
+				x[IX(0, j)] = 0;
+				x[IX(N, j)] = 0;
+				x[IX(N + 1, j)] = -x[IX(N - 1, j)];
+			}
+			for (i = 0; i <= N + 1; i++) {
+				x[IX(i, 0)] = x[IX(i, 1)];
+				x[IX(i, M + 1)] = x[IX(i, M)];
+			}
+		}
+		else {
+			for (i = 1; i <= N; i++) {
+				x[IX(i, 0)] = 0;
+				x[IX(i, M)] = 0;
+				x[IX(i, M + 1)] = -x[IX(i, M - 1)];
+			}
+			for (j = 0; j <= m + 1; j++) {
+				x[IX(0, j)] = x[IX(1, j)];
+				x[IX(N + 1, j)] = x[IX(N, j)];
 			}
-			else {
-				field[index] = 0;
-				field[index + 1] = 0;
-				field[index + 2] = 0;
-				field[index + 3] = 0;
-			}	
 		}
+		return;
 	}
-
-	//todo:: send to gpu. better ways to do this
-	glBindTexture(GL_TEXTURE_2D, obstacleTextureHandle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, N, N, 0, GL_RGBA, GL_FLOAT, field.data());
-	glBindTexture(GL_TEXTURE_2D, 2);
+	// Left and right walls, one pair of cells per row
+	for (j = 1; j <= m; j++) {
+		x[IX(0, j)] = b == BoundaryType::HORIZONTAL ? x[IX(1, j)] * -1 : x[IX(1, j)];
+		x[IX(N + 1, j)] = b == BoundaryType::HORIZONTAL ? x[IX(N, j)] * -1 : x[IX(N, j)];
+	}
+	// Bottom and top walls, each a contiguous row
+	for (i = 1; i <= N; i++) {
+		x[IX(i, 0)] = b == BoundaryType::VERTICAL ? x[IX(i, 1)] * -1 : x[IX(i, 1)];
+		x[IX(i, M + 1)] = b == BoundaryType::VERTICAL ? x[IX(i, M)] * -1 : x[IX(i, M)];
+	}
+	x[IX(0, 0)] = Scalar(0.5) * (x[IX(1, 0)] + x[IX(0, 1)]);
+	x[IX(0, M + 1)] = Scalar(0.5) * (x[IX(1, M + 1)] + x[IX(0, M)]);
+	x[IX(N + 1, 0)] = Scalar(0.5) * (x[IX(N, 0)] + x[IX(N + 1, 1)]);
+	x[IX(N + 1, M + 1)] = Scalar(0.5) * (x[IX(N, M + 1)] + x[IX(N + 1, M)]);
 }
 
-void FluidSimulator::SetObstacleTextureHandle(GLuint handle) {
-	obstacleTextureHandle = handle;
+template <typename Scalar>
+void FluidSimulator<Scalar>::InitializeScenes()
+{
+	scenes = CreateScenes<Scalar>(N, M);
 }
 
-std::vector<std::string> FluidSimulator::GetSceneNames() const
+template <typename Scalar>
+std::vector<std::string> FluidSimulator<Scalar>::GetSceneNames() const
 {
 	// Create a vector and populate it with scene names by iterating through the map 
 	std::vector<std::string> sceneNames; 
@@ -410,7 +1091,8 @@ std::vector<std::string> FluidSimulator::GetSceneNames() const
 	return sceneNames; 
 }
 
-void FluidSimulator::ActivateSceneByName(const std::string& sceneName)
+template <typename Scalar>
+void FluidSimulator<Scalar>::ActivateSceneByName(const std::string& sceneName)
 {
 	// Do nothing if it is already active
 	if (activeScene != nullptr && activeScene->GetName() == sceneName) {
@@ -425,33 +1107,43 @@ void FluidSimulator::ActivateSceneByName(const std::string& sceneName)
 		// Activate the newly selected scene
 		activeScene = &(scenes[sceneName]); 
 
-		// Remove density sources from the previous scene
-		densSources.clear(); 
-		velSources.clear(); 
-
 		// Reset the density and the velocity of the current scene
 		Reset(); 
 
-		// Add the density and velocity sources from the new scene
-		for (const DensitySource& densSource : activeScene->GetDensSources()) {
-			densSources.push_back(densSource); 
-		}
-
-		for (const VelocitySource& velSource : activeScene->GetVelocitySources()) {
-			velSources.push_back(velSource); 
-		}
+		// Replace the sources of the previous scene with clones of the new scene's sources. The clones share the
+		// footprints of the scene, so this only copies a pointer and a little state per source.
+		sources = activeScene->GetSources(); 
+		staticSources = SourceBatch<Scalar>(N, M, sources);
 	}	
 }
 
-void FluidSimulator::Reset()
+template <typename Scalar>
+void FluidSimulator<Scalar>::Reset()
 {
-	int gridSize = (N + 2) * (N + 2);
+	size_t gridSize = GridSize(N, M);
 	u.assign(gridSize, 0.0);
 	v.assign(gridSize, 0.0);
 	u_prev.assign(gridSize, 0.0);
 	v_prev.assign(gridSize, 0.0);
 	dens.assign(gridSize, 0.0);
 	dens_prev.assign(gridSize, 0.0);
-	obstacle.assign(gridSize, false);
-	obstacleColor.assign(gridSize, glm::vec4(0));
-}
\ No newline at end of file
+	maxVelocity = 0.0;
+	obstacle.Clear();
+	obstacleColor.assign(gridSize, 0);
+	obstaclePalette.assign(1, glm::vec4(0));
+	obstaclesChanged = true;
+	if (sparseTiles) {
+		sparsePressure.assign(gridSize, 0.0);
+		sparseDivergence.assign(gridSize, 0.0);
+		tileActivity.Clear();
+	}
+	if (pressureSolver) {
+		pressureSolver->ResetInitialGuess();
+	}
+	if (tilePressureSolver) {
+		tilePressureSolver->ResetInitialGuess();
+	}
+}
+
+template class FluidSimulator<float>;
+template class FluidSimulator<double>;
@@ -0,0 +1,497 @@
+#include "fluidsimulator3d.h"
+#include "scenes/scenecatalog3d.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define FLUID_X86
+#endif
+
+namespace {
+
+/// <summary>
+/// Sets the flush-to-zero and denormals-are-zero modes of the calling thread while it exists, restoring the previous
+/// modes afterwards. Does nothing outside x86.
+/// </summary>
+class DenormalFlush {
+#ifdef FLUID_X86
+    unsigned int previous;
+
+public:
+    DenormalFlush() : previous(_mm_getcsr())
+    {
+        _mm_setcsr(previous | 0x8040);
+    }
+
+    ~DenormalFlush()
+    {
+        _mm_setcsr(previous);
+    }
+#endif
+};
+
+}
+
+template <typename Scalar>
+FluidSimulator3D<Scalar>::FluidSimulator3D(unsigned int N) :
+    N(N), layout(N), u(), u_prev(), v(), v_prev(), w(), w_prev(), dens(), dens_prev(),
+    scenes(CreateScenes3D<Scalar>(N)), activeSceneName(), sources(), viscosity(0), diffusion(0.0001),
+    solverIterations(20), lastTickTimings(), threadPool(std::make_unique<ThreadPool>())
+{
+    Reset();
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::Tick()
+{
+    using Clock = std::chrono::steady_clock;
+    double dt = 0.016;
+
+    Clock::time_point start = Clock::now();
+    sources.Tick(dt);
+    ApplySources(dt);
+    VelStep(dt);
+    Clock::time_point velDone = Clock::now();
+    DensStep(dt);
+    Clock::time_point densDone = Clock::now();
+
+    lastTickTimings.velStepMs = std::chrono::duration<double, std::milli>(velDone - start).count();
+    lastTickTimings.densStepMs = std::chrono::duration<double, std::milli>(densDone - velDone).count();
+    lastTickTimings.totalMs = std::chrono::duration<double, std::milli>(densDone - start).count();
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::Reset()
+{
+    for (Field<Scalar>* field : { &u, &u_prev, &v, &v_prev, &w, &w_prev, &dens, &dens_prev }) {
+        field->assign(layout.GetSize(), Scalar(0));
+    }
+}
+
+template <typename Scalar>
+typename FluidSimulator3D<Scalar>::BrickCells FluidSimulator3D<Scalar>::GetBrickCells(int brick) const
+{
+    BrickCells cells;
+    cells.origin = layout.BrickOrigin(brick, cells.first.x, cells.first.y, cells.first.z);
+    cells.begin = glm::max(glm::ivec3(1) - cells.first, glm::ivec3(0));
+    cells.end = glm::min(glm::ivec3((int)N + 1) - cells.first, glm::ivec3(BRICK_EDGE));
+    return cells;
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::ForEachBrick(const std::function<void(const BrickCells&)>& body) const
+{
+    threadPool->ParallelFor(0, layout.GetBrickCount(), 1, [&](int begin, int end) {
+        DenormalFlush flush;
+        for (int brick = begin; brick < end; brick++) {
+            BrickCells cells = GetBrickCells(brick);
+            if (cells.begin.x < cells.end.x && cells.begin.y < cells.end.y && cells.begin.z < cells.end.z) {
+                body(cells);
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+double FluidSimulator3D<Scalar>::SumBricks(const std::function<double(const BrickCells&)>& body) const
+{
+    std::vector<double> partialSums(layout.GetBrickCount(), 0.0);
+    ForEachBrick([&](const BrickCells& cells) {
+        partialSums[cells.origin / BRICK_CELLS] = body(cells);
+    });
+    double sum = 0.0;
+    for (double partialSum : partialSums) {
+        sum += partialSum;
+    }
+    return sum;
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::ApplySources(double dt)
+{
+    auto AddFootprint = [](Field<Scalar>& x, const SourceFootprint<Scalar>& footprint, double scale) {
+        if (scale == 0.0) {
+            return;
+        }
+        const std::vector<Scalar>& values = footprint.GetValues();
+        for (const typename SourceFootprint<Scalar>::Span& span : footprint.GetSpans()) {
+            for (int t = 0; t < span.length; t++) {
+                x[span.start + t] += Scalar(scale * values[span.offset + t]);
+            }
+        }
+    };
+    for (const std::unique_ptr<VolumeSource<Scalar>>& source : sources.GetSources()) {
+        const SourceFootprint<Scalar>& footprint = source->GetFootprint();
+        AddFootprint(dens, footprint, dt * source->GetDensity());
+        AddFootprint(u, footprint, dt * source->GetVelocity().x);
+        AddFootprint(v, footprint, dt * source->GetVelocity().y);
+        AddFootprint(w, footprint, dt * source->GetVelocity().z);
+    }
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::SetBoundaryConditions(VolumeBoundaryType b, Field<Scalar>& x)
+{
+    int n = (int)N;
+    auto I = [&](int i, int j, int k) { return layout.Index(i, j, k); };
+    Scalar signX = b == VolumeBoundaryType::X ? Scalar(-1) : Scalar(1);
+    Scalar signY = b == VolumeBoundaryType::Y ? Scalar(-1) : Scalar(1);
+    Scalar signZ = b == VolumeBoundaryType::Z ? Scalar(-1) : Scalar(1);
+
+    // The six faces. Slice t covers the x and y faces at k = t and the z faces at j = t, so no two slices write
+    // the same cell.
+    threadPool->ParallelFor(1, n + 1, std::max(1, 4096 / n), [&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            for (int s = 1; s <= n; s++) {
+                x[I(0, s, t)] = signX * x[I(1, s, t)];
+                x[I(n + 1, s, t)] = signX * x[I(n, s, t)];
+                x[I(s, 0, t)] = signY * x[I(s, 1, t)];
+                x[I(s, n + 1, t)] = signY * x[I(s, n, t)];
+                x[I(s, t, 0)] = signZ * x[I(s, t, 1)];
+                x[I(s, t, n + 1)] = signZ * x[I(s, t, n)];
+            }
+        }
+    });
+
+    // The twelve edges take the average of their two neighbors on the faces, and the eight corners that of their
+    // three neighbors on the edges
+    const int sides[2] = { 0, n + 1 };
+    for (int p : sides) {
+        int pInner = p == 0 ? 1 : n;
+        for (int q : sides) {
+            int qInner = q == 0 ? 1 : n;
+            for (int t = 1; t <= n; t++) {
+                x[I(t, p, q)] = Scalar(0.5) * (x[I(t, pInner, q)] + x[I(t, p, qInner)]);
+                x[I(p, t, q)] = Scalar(0.5) * (x[I(pInner, t, q)] + x[I(p, t, qInner)]);
+                x[I(p, q, t)] = Scalar(0.5) * (x[I(pInner, q, t)] + x[I(p, qInner, t)]);
+            }
+            for (int r : sides) {
+                int rInner = r == 0 ? 1 : n;
+                x[I(p, q, r)] = (x[I(pInner, q, r)] + x[I(p, qInner, r)] + x[I(p, q, rInner)]) / Scalar(3);
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::LinearSolve(VolumeBoundaryType b, Field<Scalar>& x, const Field<Scalar>& x0,
+    double a, double c)
+{
+    Scalar aScalar = Scalar(a);
+    Scalar invC = Scalar(1.0 / c);
+    for (int iteration = 0; iteration < solverIterations; iteration++) {
+        // Cells of one color only read cells of the other, so every brick of a color can be relaxed at once
+        for (int color = 0; color < 2; color++) {
+            ForEachBrick([&](const BrickCells& cells) {
+                for (int lk = cells.begin.z; lk < cells.end.z; lk++) {
+                    int up = layout.NextZ(lk);
+                    int down = layout.PrevZ(lk);
+                    for (int lj = cells.begin.y; lj < cells.end.y; lj++) {
+                        int north = layout.NextY(lj);
+                        int south = layout.PrevY(lj);
+                        int row = cells.origin + (lk * BRICK_EDGE + lj) * BRICK_EDGE;
+                        int parity = cells.first.x + cells.begin.x + cells.first.y + lj + cells.first.z + lk + color;
+                        for (int li = cells.begin.x + (parity & 1); li < cells.end.x; li += 2) {
+                            int cell = row + li;
+                            x[cell] = (x0[cell] + aScalar * (x[cell + layout.NextX(li)] + x[cell + layout.PrevX(li)] +
+                                x[cell + north] + x[cell + south] + x[cell + up] + x[cell + down])) * invC;
+                        }
+                    }
+                }
+            });
+        }
+        SetBoundaryConditions(b, x);
+    }
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::Diffuse(VolumeBoundaryType b, Field<Scalar>& x, Field<Scalar>& x0, double diff,
+    double dt)
+{
+    if (diff == 0) {
+        x.swap(x0);
+        return;
+    }
+    double a = dt * diff * N * N;
+    LinearSolve(b, x, x0, a, 1 + 6 * a);
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::Advect(std::initializer_list<AdvectedField> fields, const Field<Scalar>& u,
+    const Field<Scalar>& v, const Field<Scalar>& w, double dt)
+{
+    double dt0 = dt * N;
+    double maxCoordinate = N + 0.5;
+    ForEachBrick([&](const BrickCells& cells) {
+        for (int lk = cells.begin.z; lk < cells.end.z; lk++) {
+            for (int lj = cells.begin.y; lj < cells.end.y; lj++) {
+                int row = cells.origin + (lk * BRICK_EDGE + lj) * BRICK_EDGE;
+                for (int li = cells.begin.x; li < cells.end.x; li++) {
+                    int cell = row + li;
+                    double x = std::clamp(cells.first.x + li - dt0 * u[cell], 0.5, maxCoordinate);
+                    double y = std::clamp(cells.first.y + lj - dt0 * v[cell], 0.5, maxCoordinate);
+                    double z = std::clamp(cells.first.z + lk - dt0 * w[cell], 0.5, maxCoordinate);
+                    int i0 = (int)x;
+                    int j0 = (int)y;
+                    int k0 = (int)z;
+                    Scalar s1 = Scalar(x - i0), s0 = 1 - s1;
+                    Scalar t1 = Scalar(y - j0), t0 = 1 - t1;
+                    Scalar r1 = Scalar(z - k0), r0 = 1 - r1;
+                    // The eight cells around the departure point, shared by every field
+                    int c000 = layout.Index(i0, j0, k0);
+                    int c100 = layout.Index(i0 + 1, j0, k0);
+                    int c010 = layout.Index(i0, j0 + 1, k0);
+                    int c110 = layout.Index(i0 + 1, j0 + 1, k0);
+                    int c001 = layout.Index(i0, j0, k0 + 1);
+                    int c101 = layout.Index(i0 + 1, j0, k0 + 1);
+                    int c011 = layout.Index(i0, j0 + 1, k0 + 1);
+                    int c111 = layout.Index(i0 + 1, j0 + 1, k0 + 1);
+                    for (const AdvectedField& field : fields) {
+                        const Field<Scalar>& d0 = *field.d0;
+                        (*field.d)[cell] =
+                            r0 * (s0 * (t0 * d0[c000] + t1 * d0[c010]) + s1 * (t0 * d0[c100] + t1 * d0[c110])) +
+                            r1 * (s0 * (t0 * d0[c001] + t1 * d0[c011]) + s1 * (t0 * d0[c101] + t1 * d0[c111]));
+                    }
+                }
+            }
+        }
+    });
+    for (const AdvectedField& field : fields) {
+        SetBoundaryConditions(field.b, *field.d);
+    }
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::Project(Field<Scalar>& p, Field<Scalar>& div)
+{
+    Scalar halfH = Scalar(0.5 / N);
+    ForEachBrick([&](const BrickCells& cells) {
+        for (int lk = cells.begin.z; lk < cells.end.z; lk++) {
+            int up = layout.NextZ(lk);
+            int down = layout.PrevZ(lk);
+            for (int lj = cells.begin.y; lj < cells.end.y; lj++) {
+                int north = layout.NextY(lj);
+                int south = layout.PrevY(lj);
+                int row = cells.origin + (lk * BRICK_EDGE + lj) * BRICK_EDGE;
+                for (int li = cells.begin.x; li < cells.end.x; li++) {
+                    int cell = row + li;
+                    div[cell] = -halfH * (u[cell + layout.NextX(li)] - u[cell + layout.PrevX(li)] +
+                        v[cell + north] - v[cell + south] + w[cell + up] - w[cell + down]);
+                    p[cell] = 0;
+                }
+            }
+        }
+    });
+    SetBoundaryConditions(VolumeBoundaryType::NONE, div);
+    SetBoundaryConditions(VolumeBoundaryType::NONE, p);
+
+    LinearSolve(VolumeBoundaryType::NONE, p, div, 1, 6);
+
+    Scalar halfN = Scalar(0.5 * N);
+    ForEachBrick([&](const BrickCells& cells) {
+        for (int lk = cells.begin.z; lk < cells.end.z; lk++) {
+            int up = layout.NextZ(lk);
+            int down = layout.PrevZ(lk);
+            for (int lj = cells.begin.y; lj < cells.end.y; lj++) {
+                int north = layout.NextY(lj);
+                int south = layout.PrevY(lj);
+                int row = cells.origin + (lk * BRICK_EDGE + lj) * BRICK_EDGE;
+                for (int li = cells.begin.x; li < cells.end.x; li++) {
+                    int cell = row + li;
+                    u[cell] -= halfN * (p[cell + layout.NextX(li)] - p[cell + layout.PrevX(li)]);
+                    v[cell] -= halfN * (p[cell + north] - p[cell + south]);
+                    w[cell] -= halfN * (p[cell + up] - p[cell + down]);
+                }
+            }
+        }
+    });
+    SetBoundaryConditions(VolumeBoundaryType::X, u);
+    SetBoundaryConditions(VolumeBoundaryType::Y, v);
+    SetBoundaryConditions(VolumeBoundaryType::Z, w);
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::DensStep(double dt)
+{
+    dens.swap(dens_prev);
+    Diffuse(VolumeBoundaryType::NONE, dens, dens_prev, diffusion, dt);
+    dens.swap(dens_prev);
+    Advect({ { VolumeBoundaryType::NONE, &dens, &dens_prev } }, u, v, w, dt);
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::VelStep(double dt)
+{
+    u.swap(u_prev);
+    Diffuse(VolumeBoundaryType::X, u, u_prev, viscosity, dt);
+    v.swap(v_prev);
+    Diffuse(VolumeBoundaryType::Y, v, v_prev, viscosity, dt);
+    w.swap(w_prev);
+    Diffuse(VolumeBoundaryType::Z, w, w_prev, viscosity, dt);
+
+    Project(u_prev, v_prev);
+    u.swap(u_prev);
+    v.swap(v_prev);
+    w.swap(w_prev);
+    // The three components are moved along the same backtrace
+    Advect({ { VolumeBoundaryType::X, &u, &u_prev }, { VolumeBoundaryType::Y, &v, &v_prev },
+        { VolumeBoundaryType::Z, &w, &w_prev } }, u_prev, v_prev, w_prev, dt);
+    Project(u_prev, v_prev);
+}
+
+template <typename Scalar>
+std::vector<std::string> FluidSimulator3D<Scalar>::GetSceneNames() const
+{
+    std::vector<std::string> sceneNames;
+    for (const auto& scene : scenes) {
+        sceneNames.push_back(scene.first);
+    }
+    return sceneNames;
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::ActivateSceneByName(const std::string& sceneName)
+{
+    auto scene = scenes.find(sceneName);
+    if (scene == scenes.end()) {
+        return;
+    }
+    Reset();
+    sources = scene->second.GetSources();
+    activeSceneName = sceneName;
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::SetThreadCount(unsigned int threadCount)
+{
+    threadPool = std::make_unique<ThreadPool>(threadCount);
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::SetSolverIterations(int iterations)
+{
+    solverIterations = std::max(iterations, 1);
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::AddDens(int i, int j, int k, double amount)
+{
+    if (i < 1 || i > (int)N || j < 1 || j > (int)N || k < 1 || k > (int)N) {
+        return;
+    }
+    dens[layout.Index(i, j, k)] += Scalar(amount);
+}
+
+template <typename Scalar>
+void FluidSimulator3D<Scalar>::AddVel(int i, int j, int k, double uAmount, double vAmount, double wAmount)
+{
+    if (i < 1 || i > (int)N || j < 1 || j > (int)N || k < 1 || k > (int)N) {
+        return;
+    }
+    int cell = layout.Index(i, j, k);
+    u[cell] += Scalar(uAmount);
+    v[cell] += Scalar(vAmount);
+    w[cell] += Scalar(wAmount);
+}
+
+template <typename Scalar>
+const BrickLayout& FluidSimulator3D<Scalar>::GetLayout() const
+{
+    return layout;
+}
+
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator3D<Scalar>::GetU() const
+{
+    return u;
+}
+
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator3D<Scalar>::GetV() const
+{
+    return v;
+}
+
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator3D<Scalar>::GetW() const
+{
+    return w;
+}
+
+template <typename Scalar>
+const Field<Scalar>& FluidSimulator3D<Scalar>::GetDens() const
+{
+    return dens;
+}
+
+template <typename Scalar>
+double FluidSimulator3D<Scalar>::GetTotalDensity() const
+{
+    return SumBricks([&](const BrickCells& cells) {
+        double sum = 0.0;
+        for (int lk = cells.begin.z; lk < cells.end.z; lk++) {
+            for (int lj = cells.begin.y; lj < cells.end.y; lj++) {
+                int row = cells.origin + (lk * BRICK_EDGE + lj) * BRICK_EDGE;
+                for (int li = cells.begin.x; li < cells.end.x; li++) {
+                    sum += dens[row + li];
+                }
+            }
+        }
+        return sum;
+    });
+}
+
+template <typename Scalar>
+double FluidSimulator3D<Scalar>::GetRmsDivergence() const
+{
+    double sumSquared = SumBricks([&](const BrickCells& cells) {
+        double sum = 0.0;
+        for (int lk = cells.begin.z; lk < cells.end.z; lk++) {
+            int up = layout.NextZ(lk);
+            int down = layout.PrevZ(lk);
+            for (int lj = cells.begin.y; lj < cells.end.y; lj++) {
+                int north = layout.NextY(lj);
+                int south = layout.PrevY(lj);
+                int row = cells.origin + (lk * BRICK_EDGE + lj) * BRICK_EDGE;
+                for (int li = cells.begin.x; li < cells.end.x; li++) {
+                    int cell = row + li;
+                    double divergence = 0.5 * (double(u[cell + layout.NextX(li)]) - u[cell + layout.PrevX(li)] +
+                        v[cell + north] - v[cell + south] + w[cell + up] - w[cell + down]);
+                    sum += divergence * divergence;
+                }
+            }
+        }
+        return sum;
+    });
+    return std::sqrt(sumSquared / (double(N) * N * N));
+}
+
+template <typename Scalar>
+size_t FluidSimulator3D<Scalar>::GetFieldBytes() const
+{
+    return 8 * layout.GetSize() * sizeof(Scalar);
+}
+
+template <typename Scalar>
+const VolumeTickTimings& FluidSimulator3D<Scalar>::GetLastTickTimings() const
+{
+    return lastTickTimings;
+}
+
+template <typename Scalar>
+unsigned int FluidSimulator3D<Scalar>::GetN() const
+{
+    return N;
+}
+
+template <typename Scalar>
+unsigned int FluidSimulator3D<Scalar>::GetThreadCount() const
+{
+    return threadPool->GetThreadCount();
+}
+
+template class FluidSimulator3D<float>;
+template class FluidSimulator3D<double>;
@@ -0,0 +1,1158 @@
+#include "fluidsimulator.h"
+#include "fluidsimulator3d.h"
+#include "quadtreesimulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Command-line options accepted by the headless runner.
+/// </summary>
+struct RunnerOptions {
+    std::string sceneName;
+    unsigned int N = 100;
+    unsigned int M = 0;
+    unsigned int ticks = 100;
+    double frameDt = 0.016;
+    double cflNumber = 1.0;
+    int maxSubsteps = 8;
+    unsigned int threads = 0;
+    RelaxationOrdering ordering = RelaxationOrdering::RED_BLACK;
+    SimdLevel simdLevel = SimdLevel::AVX512;
+    PressureSolverType pressureSolver = PressureSolverType::MULTIGRID;
+    PreconditionerType preconditioner = PreconditionerType::MIC0;
+    double pressureTolerance = 1.0e-4;
+    double diffusionTolerance = 1.0e-4;
+    int pressureIterations = 0;
+    bool spectralPressure = true;
+    bool periodic = false;
+    bool staggered = false;
+    double obstacles = 0.0;
+    bool sparseTiles = false;
+    bool approximateSparsePressure = false;
+    double densityThreshold = 1.0e-5;
+    double velocityThreshold = 1.0e-3;
+    bool singlePrecision = false;
+    bool perTick = false;
+    bool largePressureGrids = false;
+    int minLevel = 5;
+    int remeshInterval = 4;
+    double vorticityThreshold = 0.02;
+    double densityRefineThreshold = 0.05;
+    int cellBudget = 1 << 18;
+};
+
+static void PrintUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --scene <name>   Name of the scene to step (default \"Water Fountain Scene\", or \"Smoke Column Scene\"\n"
+        << "                   with --3d)\n"
+        << "  --n <N>          Width of the inner grid (default 100)\n"
+        << "  --m <M>          Height of the inner grid (default N)\n"
+        << "  --ticks <K>      Number of ticks to run (default 100)\n"
+        << "  --frame-dt <s>   Simulated seconds per tick (default 0.016)\n"
+        << "  --cfl <c> <k>    Split a tick into at most k substeps so no velocity crosses more than c cells in one\n"
+        << "                   (default 1 8), 0 for a single step per tick\n"
+        << "  --threads <T>    Threads used by the red-black relaxation (default: one per core)\n"
+        << "  --ordering <o>   Gauss-Seidel ordering, \"lexicographic\" or \"red-black\" (default red-black)\n"
+        << "  --simd <level>   Widest kernels to use: scalar, sse2, avx2 or avx512 (default: widest supported)\n"
+        << "  --precision <p>  Scalar type of the fields, \"float\" or \"double\" (default double, float with --3d)\n"
+        << "  --pressure <s>   Pressure solver, \"gauss-seidel\" (one sweep), \"multigrid\" or \"conjugate-gradient\"\n"
+        << "                   (default multigrid)\n"
+        << "  --preconditioner <m>\n"
+        << "                   Preconditioner of conjugate-gradient, \"mic0\", \"incomplete-poisson\" or \"jacobi\"\n"
+        << "                   (default mic0)\n"
+        << "  --pressure-tolerance <t>\n"
+        << "                   Relative residual at which the pressure solver stops (default 1e-4)\n"
+        << "  --pressure-iterations <k>\n"
+        << "                   Maximum iterations of the pressure solver per projection\n"
+        << "                   (default 20 for multigrid, 200 for conjugate-gradient), or red-black sweeps of\n"
+        << "                   every linear solve with --3d (default 20)\n"
+        << "  --no-spectral    Use the selected pressure solver even when there are no obstacles\n"
+        << "  --periodic       Wrap the domain around instead of bounding it with solid walls\n"
+        << "  --staggered      Store the velocity on the cell faces (a MAC grid) instead of at the cell centers\n"
+        << "  --obstacles <f>  Fill the outer fraction f of the columns, half on either side, with obstacles (default 0)\n"
+        << "  --sparse         Only step the tiles holding smoke or motion, and the tiles around them\n"
+        << "  --approximate-sparse-pressure\n"
+        << "                   Solve the pressure over the active tiles alone with --sparse, closed to the still air\n"
+        << "                   around them; faster, but the velocity no longer matches the dense run\n"
+        << "  --activity-thresholds <d> <v>\n"
+        << "                   Density and velocity below which a tile counts as empty with --sparse\n"
+        << "                   (default 1e-5 1e-3)\n"
+        << "  --quadtree       Step the scene on an adaptive quadtree instead of the uniform grid; N must be a power of 2\n"
+        << "  --min-level <l>  Coarsest level of the quadtree, whose cells are N / 2^l wide (default 5)\n"
+        << "  --remesh-interval <m>\n"
+        << "                   Ticks between two adaptations of the quadtree (default 4)\n"
+        << "  --refine-thresholds <w> <d>\n"
+        << "                   Change of velocity (vorticity times width) and of density across a quadtree cell above\n"
+        << "                   which it is split (default 0.02 0.05)\n"
+        << "  --cell-budget <c>\n"
+        << "                   Number of quadtree cells beyond which only the cells furthest over the thresholds\n"
+        << "                   are split (default 262144)\n"
+        << "  --3d             Step a scene of an N x N x N volume instead of the grid\n"
+        << "  --diffusion-tolerance <t>\n"
+        << "                   Relative residual at which Diffuse stops relaxing, 0 for always 20 sweeps (default 1e-4)\n"
+        << "  --per-tick       Dump the timings of every tick as CSV\n"
+        << "  --check-relaxation\n"
+        << "                   Check that the red-black ordering converges like the lexicographic one\n"
+        << "  --check-pressure Check that the pressure solvers converge, multigrid in a number of cycles independent of N,\n"
+        << "                   on grids up to 256 wide\n"
+        << "  --check-pressure-large\n"
+        << "                   The same on grids up to 2048 wide, which takes minutes\n"
+        << "  --check-kernels  Check that every SIMD kernel table steps the scene like the scalar one, up to rounding\n"
+        << "  --check-sparse   Check that sparse tiles leave the still air of the Water Fountain Scene inactive at N = 256\n"
+        << "                   and match the dense run up to the motion below the activity threshold\n"
+        << "  --bench-layout   Measure the relaxation bandwidth of the field layouts and traversal orders for N = 512..4096\n"
+        << "  --list-scenes    Print the available scenes and exit\n"
+        << "  --help           Print this message and exit\n";
+}
+
+/// <summary>
+/// Relaxes x = (x0 + a * neighbors) / c from a zero initial guess with the given ordering,
+/// recording the residual after every sweep.
+/// </summary>
+template <typename Scalar>
+static std::vector<double> RelaxationHistory(FluidSimulator<Scalar>& fluidSimulator, RelaxationOrdering ordering,
+    BoundaryType b, const Field<Scalar>& x0, double a, double c, int sweeps)
+{
+    int N = fluidSimulator.GetN();
+    Field<Scalar> x(x0.size(), Scalar(0));
+    std::vector<double> history;
+    fluidSimulator.SetRelaxationOrdering(ordering);
+    for (int sweep = 0; sweep < sweeps; ++sweep) {
+        fluidSimulator.LinearSolve(N, b, x, x0, a, c, 1);
+        history.push_back(fluidSimulator.LinearSolveResidual(N, x, x0, a, c));
+    }
+    return history;
+}
+
+/// <summary>
+/// Estimates the asymptotic per-sweep residual reduction factor from the second half of a residual history,
+/// ignoring the sweeps after the residual first fell to the round-off level converged.
+/// </summary>
+static double ConvergenceFactor(const std::vector<double>& history, double converged)
+{
+    size_t length = 0;
+    while (length < history.size() && history[length] > converged) {
+        length++;
+    }
+    // A system that reaches round-off in one sweep still needs a second residual to give a rate at all
+    length = std::max<size_t>(length, 2);
+    size_t half = length / 2;
+    return std::pow(history[length - 1] / history[half - 1], 1.0 / double(length - half));
+}
+
+/// <summary>
+/// Relaxes the diffusion and pressure systems with the serial lexicographic Gauss-Seidel ordering and with the
+/// threaded red-black ordering, and checks that red-black reduces the residual at the same rate.
+/// </summary>
+/// <returns>The process exit code: 0 if red-black keeps up with the lexicographic ordering, 1 otherwise.</returns>
+template <typename Scalar>
+static int CheckRelaxation(const RunnerOptions& options)
+{
+    // Red-black may reduce the residual this much slower per sweep and still pass
+    const double tolerance = 0.01;
+    // Residuals below this are round-off and no longer say anything about the convergence rate
+    const double converged = 100 * std::numeric_limits<Scalar>::epsilon();
+    const int sweeps = 40;
+
+    FluidSimulator<Scalar> fluidSimulator(options.N);
+    fluidSimulator.SetThreadCount(options.threads);
+    fluidSimulator.SetMaxSimdLevel(options.simdLevel);
+    int N = options.N;
+
+    // A reproducible pseudo-random right hand side
+    Field<Scalar> x0(GridSize(N), Scalar(0));
+    unsigned int seed = 12345;
+    for (int j = 1; j <= N; ++j) {
+        for (int i = 1; i <= N; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            x0[IX(i, j)] = Scalar((seed >> 8) / double(1 << 24) - 0.5);
+        }
+    }
+
+    struct System { const char* name; double a; double c; };
+    double diffusionA = 0.016 * 0.0001 * N * N;
+    System systems[] = {
+        { "density diffusion", diffusionA, 1 + 4 * diffusionA },
+        { "stiff diffusion", 1.0e3 * diffusionA, 1 + 4.0e3 * diffusionA },
+        { "pressure", 1.0, 4.0 },
+    };
+
+    std::cout << "N: " << N << ", red-black threads: " << fluidSimulator.GetThreadCount()
+        << ", kernels: " << fluidSimulator.GetStencilKernels().name << "\n";
+    bool passed = true;
+    for (const System& system : systems) {
+        std::vector<double> lexicographic = RelaxationHistory(fluidSimulator, RelaxationOrdering::LEXICOGRAPHIC,
+            BoundaryType::NONE, x0, system.a, system.c, sweeps);
+        std::vector<double> redBlack = RelaxationHistory(fluidSimulator, RelaxationOrdering::RED_BLACK,
+            BoundaryType::NONE, x0, system.a, system.c, sweeps);
+
+        double lexicographicFactor = ConvergenceFactor(lexicographic, converged);
+        double redBlackFactor = ConvergenceFactor(redBlack, converged);
+        bool systemPassed = redBlackFactor <= lexicographicFactor + tolerance;
+        passed = passed && systemPassed;
+
+        std::cout << system.name << " (a = " << system.a << ")\n"
+            << "  sweep  lexicographic  red-black\n";
+        for (int sweep : { 0, 1, 4, 9, 19, sweeps - 1 }) {
+            std::cout << "  " << sweep + 1 << "  " << lexicographic[sweep] << "  " << redBlack[sweep] << "\n";
+        }
+        std::cout << "  residual reduction per sweep: lexicographic " << lexicographicFactor
+            << ", red-black " << redBlackFactor << "\n"
+            << "  " << (systemPassed ? "PASSED" : "FAILED") << "\n";
+    }
+    return passed ? 0 : 1;
+}
+
+/// <summary>
+/// Steps the selected scene with the kernels of one instruction set, on a fixed number of sweeps so every kernel
+/// table takes the same path, and returns the simulator.
+/// </summary>
+template <typename Scalar>
+static std::unique_ptr<FluidSimulator<Scalar>> StepWithKernels(const RunnerOptions& options, SimdLevel level,
+    VelocityLayout layout, int ticks)
+{
+    auto fluidSimulator = std::make_unique<FluidSimulator<Scalar>>(options.N, options.M);
+    fluidSimulator->SetThreadCount(options.threads);
+    fluidSimulator->SetMaxSimdLevel(level);
+    // The red-black sweeps of the single pressure sweep and the density diffusion run through relaxRowRedBlack,
+    // without a tolerance or substeps that rounding could turn into a different number of sweeps
+    fluidSimulator->SetRelaxationOrdering(RelaxationOrdering::RED_BLACK);
+    fluidSimulator->SetPressureSolver(PressureSolverType::GAUSS_SEIDEL);
+    fluidSimulator->SetSpectralPressure(false);
+    fluidSimulator->SetDiffusionTolerance(0);
+    fluidSimulator->SetCflLimit(0, 1);
+    fluidSimulator->SetVelocityLayout(layout);
+    fluidSimulator->ActivateSceneByName(options.sceneName);
+    for (int tick = 0; tick < ticks; ++tick) {
+        fluidSimulator->Tick();
+    }
+    return fluidSimulator;
+}
+
+/// <summary>
+/// Returns the largest difference between two fields relative to the largest magnitude in the first.
+/// </summary>
+template <typename Scalar>
+static double RelativeDifference(const Field<Scalar>& expected, const Field<Scalar>& actual)
+{
+    double largest = 0.0;
+    double difference = 0.0;
+    for (size_t cell = 0; cell < expected.size(); ++cell) {
+        largest = std::max(largest, std::abs((double)expected[cell]));
+        difference = std::max(difference, std::abs((double)expected[cell] - actual[cell]));
+    }
+    return largest > 0 ? difference / largest : difference;
+}
+
+/// <summary>
+/// Steps the selected scene with the kernels of every instruction set this CPU supports, with collocated and
+/// staggered velocities, and checks that the density and velocity match those of the scalar kernels up to rounding.
+/// </summary>
+/// <returns>The process exit code: 0 if every kernel table matches the scalar one, 1 otherwise.</returns>
+template <typename Scalar>
+static int CheckKernels(const RunnerOptions& options)
+{
+    // The kernels may round differently, e.g. by fusing a multiply and an add; the differences grow a little with
+    // every tick but stay far below anything a wrong stencil would give
+    const double tolerance = 1000 * std::numeric_limits<Scalar>::epsilon();
+    const int ticks = 50;
+
+    FluidSimulator<Scalar> probe(options.N, options.M);
+    std::vector<std::string> sceneNames = probe.GetSceneNames();
+    if (std::find(sceneNames.begin(), sceneNames.end(), options.sceneName) == sceneNames.end()) {
+        std::cerr << "No scene named \"" << options.sceneName << "\". Use --list-scenes to see the options.\n";
+        return 1;
+    }
+
+    std::cout << "scene: " << options.sceneName << ", N: " << options.N << ", ticks: " << ticks
+        << ", tolerance: " << tolerance << "\n"
+        << "kernels,layout,dens,u,v\n";
+    bool passed = true;
+    for (VelocityLayout layout : { VelocityLayout::COLLOCATED, VelocityLayout::STAGGERED }) {
+        const char* layoutName = layout == VelocityLayout::STAGGERED ? "staggered" : "collocated";
+        std::unique_ptr<FluidSimulator<Scalar>> reference =
+            StepWithKernels<Scalar>(options, SimdLevel::SCALAR, layout, ticks);
+        for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+            const StencilKernels<Scalar>& kernels = GetStencilKernels<Scalar>(level);
+            if (kernels.level != level) {
+                // Not supported by this CPU or build, the table of a narrower level would be checked twice
+                continue;
+            }
+            std::unique_ptr<FluidSimulator<Scalar>> simulator = StepWithKernels<Scalar>(options, level, layout, ticks);
+            double densDifference = RelativeDifference(reference->GetDens(), simulator->GetDens());
+            double uDifference = RelativeDifference(reference->GetU(), simulator->GetU());
+            double vDifference = RelativeDifference(reference->GetV(), simulator->GetV());
+            bool matched = densDifference <= tolerance && uDifference <= tolerance && vDifference <= tolerance;
+            passed = passed && matched;
+            std::cout << kernels.name << "," << layoutName << "," << densDifference << "," << uDifference << ","
+                << vDifference << (matched ? "" : ",FAILED") << "\n";
+        }
+    }
+    std::cout << (passed ? "PASSED" : "FAILED") << "\n";
+    return passed ? 0 : 1;
+}
+
+/// <summary>
+/// Solves the pressure equation for a pseudo-random divergence, with and without a few obstacles, on grids from
+/// N = 64 to 256 and on a wide channel with every iterative solver, up to N = 1024 and a 2048 x 256 channel with
+/// --check-pressure-large. Checks that each reaches the tolerance,
+/// multigrid within a fixed number of V-cycles whatever N, and conjugate gradient within a budget that grows with N.
+/// Then checks the spectral solver on empty boxes with walls and periodic edges, including sizes that are not powers
+/// of two and grids that are not square.
+/// </summary>
+/// <returns>The process exit code: 0 if every solve converged within its budget, 1 otherwise.</returns>
+template <typename Scalar>
+static int CheckPressure(const RunnerOptions& options)
+{
+    using Clock = std::chrono::steady_clock;
+    // Float round-off limits how far the residual can fall
+    const double tolerance = sizeof(Scalar) == sizeof(float) ? 1.0e-5 : 1.0e-8;
+
+    struct SolverCase {
+        const char* name;
+        PressureSolverType type;
+        PreconditionerType preconditioner;
+    };
+    const SolverCase solverCases[] = {
+        { "multigrid", PressureSolverType::MULTIGRID, PreconditionerType::MIC0 },
+        { "pcg-mic0", PressureSolverType::CONJUGATE_GRADIENT, PreconditionerType::MIC0 },
+        { "pcg-incomplete-poisson", PressureSolverType::CONJUGATE_GRADIENT, PreconditionerType::INCOMPLETE_POISSON },
+        { "pcg-jacobi", PressureSolverType::CONJUGATE_GRADIENT, PreconditionerType::JACOBI },
+    };
+
+    // The inner width and height of every grid solved
+    struct GridShape {
+        int N;
+        int M;
+    };
+    const GridShape solverGrids[] = { { 64, 64 }, { 128, 128 }, { 256, 256 }, { 512, 512 }, { 1024, 1024 },
+        { 256, 32 }, { 512, 64 }, { 2048, 256 } };
+    const GridShape spectralGrids[] = { { 64, 64 }, { 100, 100 }, { 128, 128 }, { 256, 256 }, { 300, 300 },
+        { 512, 512 }, { 1024, 1024 }, { 256, 64 }, { 300, 100 }, { 64, 200 } };
+    // Grids wider than this take minutes with the conjugate gradient solvers, and are only solved when asked for
+    const int maxExtent = options.largePressureGrids ? std::numeric_limits<int>::max() : 256;
+
+    ThreadPool threadPool(options.threads);
+    std::cout << "threads: " << threadPool.GetThreadCount() << ", tolerance: " << tolerance << "\n"
+        << "solver,N,M,obstacles,iterations,ms,initial_residual,final_residual,reduction_per_iteration\n";
+    bool passed = true;
+    for (const SolverCase& solverCase : solverCases) {
+        for (const GridShape& grid : solverGrids) {
+            int N = grid.N;
+            int M = grid.M;
+            if (std::max(N, M) > maxExtent) {
+                continue;
+            }
+            for (bool withObstacles : { false, true }) {
+                std::unique_ptr<PressureSolver<Scalar>> solver;
+                if (solverCase.type == PressureSolverType::MULTIGRID) {
+                    solver = std::make_unique<MultigridSolver<Scalar>>(N, M);
+                    solver->SetMaxIterations(30);
+                }
+                else {
+                    solver = std::make_unique<ConjugateGradientSolver<Scalar>>(N, M, solverCase.preconditioner);
+                    solver->SetMaxIterations(8 * std::max(N, M));
+                }
+                solver->SetTolerance(tolerance);
+
+                // A disc and a wall with a gap, scaled with the grid
+                CellBitmask obstacle(N, M);
+                if (withObstacles) {
+                    int wallBegin = 2 * N / 3;
+                    int wallEnd = wallBegin + N / 32 + 1;
+                    obstacle.SetCircle(N / 3, M / 2, std::min(N, M) / 8, true);
+                    obstacle.SetRect(wallBegin, 1, wallEnd, M / 3, true);
+                    obstacle.SetRect(wallBegin, M / 2 + 1, wallEnd, M + 1, true);
+                    solver->SetObstacles(obstacle);
+                }
+
+                Field<Scalar> rhs(GridSize(N, M), Scalar(0));
+                Field<Scalar> p(GridSize(N, M), Scalar(0));
+                unsigned int seed = 12345;
+                for (int j = 1; j <= M; ++j) {
+                    for (int i = 1; i <= N; ++i) {
+                        seed = seed * 1664525u + 1013904223u;
+                        rhs[IX(i, j)] = Scalar((seed >> 8) / double(1 << 24) - 0.5);
+                    }
+                }
+
+                Clock::time_point start = Clock::now();
+                int iterations = solver->Solve(threadPool, p, rhs);
+                double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+                const SolveStats& stats = solver->GetLastStats();
+                double reduction = iterations > 0 ?
+                    std::pow(stats.finalResidual / stats.initialResidual, 1.0 / iterations) : 0.0;
+                bool converged = stats.finalResidual <= tolerance * stats.rhsNorm;
+                passed = passed && converged;
+                std::cout << solverCase.name << "," << N << "," << M << "," << (withObstacles ? "yes" : "no") << ","
+                    << iterations << "," << ms << "," << stats.initialResidual / stats.rhsNorm << ","
+                    << stats.finalResidual / stats.rhsNorm << "," << reduction << (converged ? "" : ",FAILED") << "\n";
+            }
+        }
+    }
+
+    for (bool periodic : { false, true }) {
+        for (const GridShape& grid : spectralGrids) {
+            int N = grid.N;
+            int M = grid.M;
+            if (std::max(N, M) > maxExtent) {
+                continue;
+            }
+            SpectralPoissonSolver<Scalar> solver(N, M, periodic);
+            Field<Scalar> rhs(GridSize(N, M), Scalar(0));
+            Field<Scalar> p(GridSize(N, M), Scalar(0));
+            unsigned int seed = 12345;
+            for (int j = 1; j <= M; ++j) {
+                for (int i = 1; i <= N; ++i) {
+                    seed = seed * 1664525u + 1013904223u;
+                    rhs[IX(i, j)] = Scalar((seed >> 8) / double(1 << 24) - 0.5);
+                }
+            }
+
+            Clock::time_point start = Clock::now();
+            solver.Solve(threadPool, p, rhs);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            // The solve is exact up to rounding p to Scalar, which leaves a residual of up to 8 ulp of the largest
+            // pressure
+            double largestPressure = 0.0;
+            for (int j = 1; j <= M; ++j) {
+                for (int i = 1; i <= N; ++i) {
+                    largestPressure = std::max(largestPressure, std::abs((double)p[IX(i, j)]));
+                }
+            }
+            const SolveStats& stats = solver.GetLastStats();
+            bool converged = stats.finalResidual <= 8 * std::numeric_limits<Scalar>::epsilon() * largestPressure;
+            passed = passed && converged;
+            std::cout << (periodic ? "spectral-periodic" : "spectral-walls") << "," << N << "," << M << ",no,"
+                << stats.iterations << "," << ms << "," << stats.initialResidual / stats.rhsNorm << ","
+                << stats.finalResidual / stats.rhsNorm << "," << stats.finalResidual / stats.initialResidual
+                << (converged ? "" : ",FAILED") << "\n";
+        }
+    }
+    std::cout << (passed ? "PASSED" : "FAILED") << "\n";
+    return passed ? 0 : 1;
+}
+
+/// <summary>
+/// Returns the sum of a field over the inner cells of the grid.
+/// </summary>
+template <typename Scalar>
+static double InnerSum(const FluidSimulator<Scalar>& fluidSimulator, const Field<Scalar>& x)
+{
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    double sum = 0.0;
+    for (int j = 1; j <= M; ++j) {
+        for (int i = 1; i <= N; ++i) {
+            sum += x[IX(i, j)];
+        }
+    }
+    return sum;
+}
+
+/// <summary>
+/// Steps the Water Fountain Scene at N = 256 with and without sparse tiles and checks that the sparse run leaves
+/// part of the grid inactive after the first tick and matches the dense run in density, velocity and total density: only motion below the
+/// activity threshold may be lost, which a broken projection would exceed by orders of magnitude. Its gravity covers
+/// every cell, so this fails if uniform forces activate every tile. Also reports how far the approximate sparse
+/// pressure strays from the dense run, and the timings of all three, without checking them.
+/// </summary>
+/// <returns>The process exit code: 0 if every bound held, 1 otherwise.</returns>
+template <typename Scalar>
+static int CheckSparse(const RunnerOptions& options)
+{
+    const int N = 256;
+    // The motion below the activity threshold is lost, which matters less as the jet grows, so the bounds hold
+    // after as many ticks as this at the default thresholds
+    const unsigned int ticks = 100;
+    // Largest differences relative to the largest magnitude in the dense run
+    const double densTolerance = 1.0e-3;
+    const double velocityTolerance = 1.0e-2;
+    const double totalDensityTolerance = 1.0e-5;
+
+    struct SparseCase {
+        const char* name;
+        bool sparse;
+        bool approximate;
+    };
+    const SparseCase cases[] = { { "dense", false, false }, { "sparse", true, false }, { "approximate", true, true } };
+
+    std::cout << "N: " << N << ", ticks: " << ticks << ", tolerances: dens " << densTolerance
+        << ", velocity " << velocityTolerance << ", total density " << totalDensityTolerance << "\n"
+        << "run,active tiles (first tick then last),mean ms/tick,dens,u,v,total density\n";
+    std::unique_ptr<FluidSimulator<Scalar>> dense;
+    bool passed = true;
+    for (const SparseCase& sparseCase : cases) {
+        std::unique_ptr<FluidSimulator<Scalar>> simulator = std::make_unique<FluidSimulator<Scalar>>(N);
+        simulator->SetThreadCount(options.threads);
+        simulator->SetSparseTiles(sparseCase.sparse);
+        simulator->SetApproximateSparsePressure(sparseCase.approximate);
+        simulator->ActivateSceneByName("Water Fountain Scene");
+        // The jet sets more and more of the box in motion, so uniform forces show in the tiles of the first tick
+        simulator->Tick();
+        int firstTiles = simulator->GetTileActivity().GetActiveTileCount();
+        double meanMs = simulator->GetLastTickTimings().totalMs / ticks;
+        for (unsigned int tick = 1; tick < ticks; ++tick) {
+            simulator->Tick();
+            meanMs += simulator->GetLastTickTimings().totalMs / ticks;
+        }
+
+        int activeTiles = simulator->GetTileActivity().GetActiveTileCount();
+        int tileCount = simulator->GetTileActivity().GetTileCount();
+        double total = InnerSum(*simulator, simulator->GetDens());
+        std::cout << sparseCase.name << "," << firstTiles << " then " << activeTiles << " of " << tileCount << ","
+            << meanMs;
+        if (!dense) {
+            std::cout << ",,,," << total << "\n";
+            dense = std::move(simulator);
+            continue;
+        }
+        double densDifference = RelativeDifference(dense->GetDens(), simulator->GetDens());
+        double uDifference = RelativeDifference(dense->GetU(), simulator->GetU());
+        double vDifference = RelativeDifference(dense->GetV(), simulator->GetV());
+        double denseTotal = InnerSum(*dense, dense->GetDens());
+        double totalDifference = std::abs(total - denseTotal) / denseTotal;
+        std::cout << "," << densDifference << "," << uDifference << "," << vDifference << "," << total;
+        if (!sparseCase.approximate) {
+            bool matched = firstTiles < tileCount && densDifference <= densTolerance &&
+                uDifference <= velocityTolerance && vDifference <= velocityTolerance &&
+                totalDifference <= totalDensityTolerance;
+            passed = passed && matched;
+            std::cout << (matched ? "" : ",FAILED");
+        }
+        std::cout << "\n";
+    }
+    std::cout << (passed ? "PASSED" : "FAILED") << "\n";
+    return passed ? 0 : 1;
+}
+
+/// <summary>
+/// RMS of the divergence of (u, v) over the fluid cells of the inner grid, in grid units: central differences of
+/// the cell centers, or the differences across each cell of a staggered grid.
+/// </summary>
+template <typename Scalar>
+static double RmsDivergence(const FluidSimulator<Scalar>& fluidSimulator)
+{
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    const Field<Scalar>& u = fluidSimulator.GetU();
+    const Field<Scalar>& v = fluidSimulator.GetV();
+    bool staggered = fluidSimulator.GetVelocityLayout() == VelocityLayout::STAGGERED;
+    double sumSquared = 0.0;
+    int fluidCells = 0;
+    for (int j = 1; j <= M; ++j) {
+        for (int i = 1; i <= N; ++i) {
+            if (fluidSimulator.IsObstacle(i, j)) {
+                continue;
+            }
+            fluidCells++;
+            double divergence = staggered ? u[IX(i, j)] - u[IX(i - 1, j)] + v[IX(i, j)] - v[IX(i, j - 1)] :
+                0.5 * (u[IX(i + 1, j)] - u[IX(i - 1, j)] + v[IX(i, j + 1)] - v[IX(i, j - 1)]);
+            sumSquared += divergence * divergence;
+        }
+    }
+    return std::sqrt(sumSquared / std::max(fluidCells, 1));
+}
+
+/// <summary>
+/// One lexicographic Gauss-Seidel sweep x = (x0 + a * neighbors) * invC over a grid whose rows are stride elements
+/// apart, visiting the cells column by column (as the solver used to) or row by row (in memory order).
+/// </summary>
+template <typename Scalar>
+static void RelaxSweep(Scalar* x, const Scalar* x0, int N, int stride, bool rowMajor, Scalar a, Scalar invC)
+{
+    if (rowMajor) {
+        for (int j = 1; j <= N; j++) {
+            for (int i = 1; i <= N; i++) {
+                int cell = i + stride * j;
+                x[cell] = (x0[cell] + a * (x[cell - 1] + x[cell + 1] + x[cell - stride] + x[cell + stride])) * invC;
+            }
+        }
+    }
+    else {
+        for (int i = 1; i <= N; i++) {
+            for (int j = 1; j <= N; j++) {
+                int cell = i + stride * j;
+                x[cell] = (x0[cell] + a * (x[cell - 1] + x[cell + 1] + x[cell - stride] + x[cell + stride])) * invC;
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Times relaxation sweeps over large grids with the old layout (rows of N+2 cells, default alignment) and the
+/// padded, cache line aligned Field layout, in both traversal orders, and prints the effective bandwidth.
+/// </summary>
+template <typename Scalar>
+static int BenchmarkLayout()
+{
+    using Clock = std::chrono::steady_clock;
+    const Scalar a = 1;
+    const Scalar invC = Scalar(0.25);
+
+    std::cout << "N,layout,traversal,stride,sweeps,ms_per_sweep,gb_per_s\n";
+    for (int N : { 512, 1024, 2048, 4096 }) {
+        // Enough sweeps to touch ~64M cells per configuration
+        int sweeps = std::max(2, (1 << 26) / (N * N));
+
+        // x and x0 of the old layout share the same (unaligned) row length
+        std::vector<Scalar> packedX((size_t)(N + 2) * (N + 2), Scalar(0));
+        std::vector<Scalar> packedX0(packedX.size(), Scalar(0));
+        Field<Scalar> paddedX(GridSize(N), Scalar(0));
+        Field<Scalar> paddedX0(GridSize(N), Scalar(0));
+        for (int j = 1; j <= N; ++j) {
+            for (int i = 1; i <= N; ++i) {
+                Scalar value = Scalar(((i * 7 + j * 13) % 17) / 17.0);
+                packedX0[i + (N + 2) * j] = value;
+                paddedX0[IX(i, j)] = value;
+            }
+        }
+
+        struct Configuration { const char* layout; const char* traversal; Scalar* x; const Scalar* x0; int stride; bool rowMajor; };
+        Configuration configurations[] = {
+            { "packed", "column-major", packedX.data(), packedX0.data(), N + 2, false },
+            { "packed", "row-major", packedX.data(), packedX0.data(), N + 2, true },
+            { "padded", "column-major", paddedX.data(), paddedX0.data(), GridStride(N), false },
+            { "padded", "row-major", paddedX.data(), paddedX0.data(), GridStride(N), true },
+        };
+        for (const Configuration& configuration : configurations) {
+            // One untimed sweep to fault the pages in
+            RelaxSweep(configuration.x, configuration.x0, N, configuration.stride, configuration.rowMajor, a, invC);
+            Clock::time_point start = Clock::now();
+            for (int sweep = 0; sweep < sweeps; ++sweep) {
+                RelaxSweep(configuration.x, configuration.x0, N, configuration.stride, configuration.rowMajor, a, invC);
+            }
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / sweeps;
+            // Every sweep has to read x0 and read and write x at least once
+            double bytes = 3.0 * sizeof(Scalar) * N * N;
+            std::cout << N << "," << configuration.layout << "," << configuration.traversal << ","
+                << configuration.stride << "," << sweeps << "," << ms << "," << bytes / (ms * 1.0e6) << "\n";
+        }
+    }
+    return 0;
+}
+
+/// <summary>
+/// Steps the selected scene with fields of the given scalar type and prints the timings.
+/// </summary>
+template <typename Scalar>
+static int RunScene(const RunnerOptions& options, bool listScenes)
+{
+    FluidSimulator<Scalar> fluidSimulator(options.N, options.M);
+    std::vector<std::string> sceneNames = fluidSimulator.GetSceneNames();
+
+    if (listScenes) {
+        for (const std::string& sceneName : sceneNames) {
+            std::cout << sceneName << "\n";
+        }
+        return 0;
+    }
+
+    if (std::find(sceneNames.begin(), sceneNames.end(), options.sceneName) == sceneNames.end()) {
+        std::cerr << "No scene named \"" << options.sceneName << "\". Use --list-scenes to see the options.\n";
+        return 1;
+    }
+
+    fluidSimulator.SetRelaxationOrdering(options.ordering);
+    fluidSimulator.SetThreadCount(options.threads);
+    fluidSimulator.SetMaxSimdLevel(options.simdLevel);
+    fluidSimulator.SetPressureSolver(options.pressureSolver);
+    fluidSimulator.SetPressurePreconditioner(options.preconditioner);
+    fluidSimulator.SetPressureTolerance(options.pressureTolerance);
+    fluidSimulator.SetDiffusionTolerance(options.diffusionTolerance);
+    fluidSimulator.SetCflLimit(options.cflNumber, options.maxSubsteps);
+    fluidSimulator.SetMaxPressureIterations(options.pressureIterations);
+    fluidSimulator.SetSpectralPressure(options.spectralPressure);
+    fluidSimulator.SetDomainBoundary(options.periodic ? DomainBoundary::PERIODIC : DomainBoundary::WALLS);
+    fluidSimulator.SetVelocityLayout(options.staggered ? VelocityLayout::STAGGERED : VelocityLayout::COLLOCATED);
+    fluidSimulator.SetSparseTiles(options.sparseTiles);
+    fluidSimulator.SetApproximateSparsePressure(options.approximateSparsePressure);
+    fluidSimulator.SetActivityThresholds(options.densityThreshold, options.velocityThreshold);
+    fluidSimulator.ActivateSceneByName(options.sceneName);
+
+    // Solid columns along the left and right edges
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    int solidColumns = (int)(options.obstacles * N / 2);
+    fluidSimulator.PaintObstacleRect(1, 1, 1 + solidColumns, M + 1, true, glm::vec4(1));
+    fluidSimulator.PaintObstacleRect(N + 1 - solidColumns, 1, N + 1, M + 1, true, glm::vec4(1));
+
+    // Step the scene and record the timings of every tick
+    std::vector<TickTimings> timings;
+    timings.reserve(options.ticks);
+    double pressureIterations = 0.0;
+    for (unsigned int tick = 0; tick < options.ticks; ++tick) {
+        fluidSimulator.Tick(options.frameDt);
+        timings.push_back(fluidSimulator.GetLastTickTimings());
+        pressureIterations += fluidSimulator.GetLastPressureStats().iterations;
+    }
+
+    if (options.perTick) {
+        std::cout << "tick,vel_step_ms,dens_step_ms,total_ms,diffusion_sweeps,substeps,cfl\n";
+        for (size_t tick = 0; tick < timings.size(); ++tick) {
+            std::cout << tick << "," << timings[tick].velStepMs << "," << timings[tick].densStepMs << ","
+                << timings[tick].totalMs << "," << timings[tick].diffusionSweeps << "," << timings[tick].substeps
+                << "," << timings[tick].cfl << "\n";
+        }
+    }
+
+    // Summarize the run
+    TickTimings sum;
+    double minTotal = timings.empty() ? 0.0 : timings.front().totalMs;
+    double maxTotal = minTotal;
+    for (const TickTimings& timing : timings) {
+        sum.velStepMs += timing.velStepMs;
+        sum.densStepMs += timing.densStepMs;
+        sum.totalMs += timing.totalMs;
+        sum.diffusionSweeps += timing.diffusionSweeps;
+        sum.substeps += timing.substeps;
+        sum.cfl = std::max(sum.cfl, timing.cfl);
+        minTotal = std::min(minTotal, timing.totalMs);
+        maxTotal = std::max(maxTotal, timing.totalMs);
+    }
+    double count = std::max<size_t>(timings.size(), 1);
+
+    double densSum = 0.0;
+    for (double d : fluidSimulator.GetDens()) {
+        densSum += d;
+    }
+
+    std::cout << "scene: " << options.sceneName << "\n"
+        << "N: " << N << "\n"
+        << "M: " << M << "\n"
+        << "ticks: " << options.ticks << "\n"
+        << "precision: " << (sizeof(Scalar) == sizeof(float) ? "float" : "double") << "\n"
+        << "threads: " << fluidSimulator.GetThreadCount() << "\n"
+        << "kernels: " << fluidSimulator.GetStencilKernels().name << "\n"
+        << "domain: " << (options.periodic ? "periodic" : "walls") << "\n"
+        << "velocity layout: " << (options.staggered ? "staggered" : "collocated") << "\n"
+        << "obstacles: " << 2 * solidColumns << " of " << N << " columns\n"
+        << "active tiles: " << fluidSimulator.GetTileActivity().GetActiveTileCount() << " of "
+        << fluidSimulator.GetTileActivity().GetTileCount() << "\n"
+        << "total ms: " << sum.totalMs << "\n"
+        << "mean ms/tick: " << sum.totalMs / count << " (min " << minTotal << ", max " << maxTotal << ")\n"
+        << "mean vel step ms: " << sum.velStepMs / count << "\n"
+        << "mean dens step ms: " << sum.densStepMs / count << "\n"
+        << "mean diffusion sweeps: " << sum.diffusionSweeps / count << "\n"
+        << "mean substeps: " << sum.substeps / count << " (max cfl " << sum.cfl << ")\n"
+        << "mean pressure iterations: " << pressureIterations / count << "\n"
+        << "rms divergence: " << RmsDivergence(fluidSimulator) << "\n"
+        << "total density: " << densSum << "\n";
+
+    return 0;
+}
+
+/// <summary>
+/// Steps the selected scene on an adaptive quadtree and prints the timings and the number of cells.
+/// </summary>
+template <typename Scalar>
+static int RunQuadtree(const RunnerOptions& options)
+{
+    if (options.N & (options.N - 1)) {
+        std::cerr << "The quadtree needs N to be a power of 2\n";
+        return 1;
+    }
+    if (options.M != 0 && options.M != options.N) {
+        std::cerr << "The quadtree covers a square domain, --m must be left out or equal N\n";
+        return 1;
+    }
+    if (options.periodic) {
+        std::cerr << "The quadtree has solid walls, --periodic is not supported\n";
+        return 1;
+    }
+    if (options.obstacles > 0) {
+        std::cerr << "The quadtree has no obstacles, --obstacles is not supported\n";
+        return 1;
+    }
+    QuadtreeSimulator<Scalar> quadtreeSimulator(options.N, options.minLevel);
+    std::vector<std::string> sceneNames = quadtreeSimulator.GetSceneNames();
+    if (std::find(sceneNames.begin(), sceneNames.end(), options.sceneName) == sceneNames.end()) {
+        std::cerr << "No scene named \"" << options.sceneName << "\". Use --list-scenes to see the options.\n";
+        return 1;
+    }
+
+    quadtreeSimulator.SetThreadCount(options.threads);
+    quadtreeSimulator.SetPressureTolerance(options.pressureTolerance);
+    quadtreeSimulator.SetDiffusionTolerance(options.diffusionTolerance);
+    quadtreeSimulator.SetRemeshInterval(options.remeshInterval);
+    quadtreeSimulator.SetRefinementThresholds(options.vorticityThreshold, options.densityRefineThreshold);
+    quadtreeSimulator.SetCellBudget(options.cellBudget);
+    quadtreeSimulator.ActivateSceneByName(options.sceneName);
+
+    // Step the scene and record the timings and the size of the grid after every tick
+    std::vector<QuadtreeTickTimings> timings;
+    std::vector<int> cellCounts;
+    timings.reserve(options.ticks);
+    cellCounts.reserve(options.ticks);
+    double pressureIterations = 0.0;
+    for (unsigned int tick = 0; tick < options.ticks; ++tick) {
+        quadtreeSimulator.Tick(options.frameDt);
+        timings.push_back(quadtreeSimulator.GetLastTickTimings());
+        cellCounts.push_back(quadtreeSimulator.GetGrid().GetCellCount());
+        pressureIterations += quadtreeSimulator.GetLastPressureStats().iterations;
+    }
+
+    if (options.perTick) {
+        std::cout << "tick,remesh_ms,vel_step_ms,dens_step_ms,total_ms,cells\n";
+        for (size_t tick = 0; tick < timings.size(); ++tick) {
+            std::cout << tick << "," << timings[tick].remeshMs << "," << timings[tick].velStepMs << ","
+                << timings[tick].densStepMs << "," << timings[tick].totalMs << "," << cellCounts[tick] << "\n";
+        }
+    }
+
+    // Summarize the run
+    QuadtreeTickTimings sum;
+    double cellSum = 0.0;
+    int maxCells = 0;
+    for (size_t tick = 0; tick < timings.size(); ++tick) {
+        sum.remeshMs += timings[tick].remeshMs;
+        sum.velStepMs += timings[tick].velStepMs;
+        sum.densStepMs += timings[tick].densStepMs;
+        sum.totalMs += timings[tick].totalMs;
+        sum.diffusionSweeps += timings[tick].diffusionSweeps;
+        cellSum += cellCounts[tick];
+        maxCells = std::max(maxCells, cellCounts[tick]);
+    }
+    double count = std::max<size_t>(timings.size(), 1);
+
+    std::cout << "scene: " << options.sceneName << "\n"
+        << "N: " << options.N << " (quadtree, levels " << options.minLevel << " to "
+        << quadtreeSimulator.GetGrid().GetMaxLevel() << ")\n"
+        << "ticks: " << options.ticks << "\n"
+        << "precision: " << (sizeof(Scalar) == sizeof(float) ? "float" : "double") << "\n"
+        << "threads: " << quadtreeSimulator.GetThreadCount() << "\n"
+        << "cells: " << quadtreeSimulator.GetGrid().GetCellCount() << " (mean " << cellSum / count << ", max "
+        << maxCells << ") of " << (double)options.N * options.N << " finest\n"
+        << "total ms: " << sum.totalMs << "\n"
+        << "mean ms/tick: " << sum.totalMs / count << "\n"
+        << "mean remesh ms: " << sum.remeshMs / count << "\n"
+        << "mean vel step ms: " << sum.velStepMs / count << "\n"
+        << "mean dens step ms: " << sum.densStepMs / count << "\n"
+        << "mean diffusion sweeps: " << sum.diffusionSweeps / count << "\n"
+        << "mean pressure iterations: " << pressureIterations / count << "\n"
+        << "rms divergence: " << quadtreeSimulator.GetRmsDivergence() << "\n"
+        << "total density: " << quadtreeSimulator.GetTotalDensity() << "\n";
+
+    return 0;
+}
+
+/// <summary>
+/// Steps the selected scene in a volume and prints the timings and the memory held by the fields.
+/// </summary>
+template <typename Scalar>
+static int RunVolume(const RunnerOptions& options, bool listScenes)
+{
+    FluidSimulator3D<Scalar> volumeSimulator(options.N);
+    std::vector<std::string> sceneNames = volumeSimulator.GetSceneNames();
+
+    if (listScenes) {
+        for (const std::string& sceneName : sceneNames) {
+            std::cout << sceneName << "\n";
+        }
+        return 0;
+    }
+
+    if (std::find(sceneNames.begin(), sceneNames.end(), options.sceneName) == sceneNames.end()) {
+        std::cerr << "No scene named \"" << options.sceneName << "\". Use --3d --list-scenes to see the options.\n";
+        return 1;
+    }
+
+    volumeSimulator.SetThreadCount(options.threads);
+    if (options.pressureIterations > 0) {
+        volumeSimulator.SetSolverIterations(options.pressureIterations);
+    }
+    volumeSimulator.ActivateSceneByName(options.sceneName);
+
+    std::vector<VolumeTickTimings> timings;
+    timings.reserve(options.ticks);
+    for (unsigned int tick = 0; tick < options.ticks; ++tick) {
+        volumeSimulator.Tick();
+        timings.push_back(volumeSimulator.GetLastTickTimings());
+    }
+
+    if (options.perTick) {
+        std::cout << "tick,vel_step_ms,dens_step_ms,total_ms\n";
+        for (size_t tick = 0; tick < timings.size(); ++tick) {
+            std::cout << tick << "," << timings[tick].velStepMs << "," << timings[tick].densStepMs << ","
+                << timings[tick].totalMs << "\n";
+        }
+    }
+
+    VolumeTickTimings sum;
+    for (const VolumeTickTimings& timing : timings) {
+        sum.velStepMs += timing.velStepMs;
+        sum.densStepMs += timing.densStepMs;
+        sum.totalMs += timing.totalMs;
+    }
+    double count = std::max<size_t>(timings.size(), 1);
+
+    std::cout << "scene: " << options.sceneName << "\n"
+        << "N: " << options.N << " (3D, " << (double)options.N * options.N * options.N << " cells)\n"
+        << "ticks: " << options.ticks << "\n"
+        << "precision: " << (sizeof(Scalar) == sizeof(float) ? "float" : "double") << "\n"
+        << "threads: " << volumeSimulator.GetThreadCount() << "\n"
+        << "field memory MB: " << volumeSimulator.GetFieldBytes() / (1024.0 * 1024.0) << "\n"
+        << "total ms: " << sum.totalMs << "\n"
+        << "mean ms/tick: " << sum.totalMs / count << "\n"
+        << "mean vel step ms: " << sum.velStepMs / count << "\n"
+        << "mean dens step ms: " << sum.densStepMs / count << "\n"
+        << "rms divergence: " << volumeSimulator.GetRmsDivergence() << "\n"
+        << "total density: " << volumeSimulator.GetTotalDensity() << "\n";
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    RunnerOptions options;
+    bool listScenes = false;
+    bool checkRelaxation = false;
+    bool checkPressure = false;
+    bool checkKernels = false;
+    bool checkSparse = false;
+    bool benchmarkLayout = false;
+    bool quadtree = false;
+    bool volume = false;
+    bool precisionGiven = false;
+
+    for (int arg = 1; arg < argc; ++arg) {
+        bool hasValue = arg + 1 < argc;
+        if (!std::strcmp(argv[arg], "--scene") && hasValue) {
+            options.sceneName = argv[++arg];
+        }
+        else if (!std::strcmp(argv[arg], "--n") && hasValue) {
+            options.N = std::strtoul(argv[++arg], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[arg], "--m") && hasValue) {
+            options.M = std::strtoul(argv[++arg], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[arg], "--ticks") && hasValue) {
+            options.ticks = std::strtoul(argv[++arg], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[arg], "--threads") && hasValue) {
+            options.threads = std::strtoul(argv[++arg], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[arg], "--ordering") && hasValue) {
+            std::string ordering = argv[++arg];
+            if (ordering == "lexicographic") {
+                options.ordering = RelaxationOrdering::LEXICOGRAPHIC;
+            }
+            else if (ordering == "red-black") {
+                options.ordering = RelaxationOrdering::RED_BLACK;
+            }
+            else {
+                std::cerr << "Unknown ordering: " << ordering << "\n";
+                return 1;
+            }
+        }
+        else if (!std::strcmp(argv[arg], "--simd") && hasValue) {
+            std::string level = argv[++arg];
+            if (level == "scalar") {
+                options.simdLevel = SimdLevel::SCALAR;
+            }
+            else if (level == "sse2") {
+                options.simdLevel = SimdLevel::SSE2;
+            }
+            else if (level == "avx2") {
+                options.simdLevel = SimdLevel::AVX2;
+            }
+            else if (level == "avx512") {
+                options.simdLevel = SimdLevel::AVX512;
+            }
+            else {
+                std::cerr << "Unknown SIMD level: " << level << "\n";
+                return 1;
+            }
+        }
+        else if (!std::strcmp(argv[arg], "--precision") && hasValue) {
+            std::string precision = argv[++arg];
+            precisionGiven = true;
+            if (precision == "float") {
+                options.singlePrecision = true;
+            }
+            else if (precision == "double") {
+                options.singlePrecision = false;
+            }
+            else {
+                std::cerr << "Unknown precision: " << precision << "\n";
+                return 1;
+            }
+        }
+        else if (!std::strcmp(argv[arg], "--pressure") && hasValue) {
+            std::string solver = argv[++arg];
+            if (solver == "gauss-seidel") {
+                options.pressureSolver = PressureSolverType::GAUSS_SEIDEL;
+            }
+            else if (solver == "multigrid") {
+                options.pressureSolver = PressureSolverType::MULTIGRID;
+            }
+            else if (solver == "conjugate-gradient") {
+                options.pressureSolver = PressureSolverType::CONJUGATE_GRADIENT;
+            }
+            else {
+                std::cerr << "Unknown pressure solver: " << solver << "\n";
+                return 1;
+            }
+        }
+        else if (!std::strcmp(argv[arg], "--preconditioner") && hasValue) {
+            std::string preconditioner = argv[++arg];
+            if (preconditioner == "mic0") {
+                options.preconditioner = PreconditionerType::MIC0;
+            }
+            else if (preconditioner == "incomplete-poisson") {
+                options.preconditioner = PreconditionerType::INCOMPLETE_POISSON;
+            }
+            else if (preconditioner == "jacobi") {
+                options.preconditioner = PreconditionerType::JACOBI;
+            }
+            else {
+                std::cerr << "Unknown preconditioner: " << preconditioner << "\n";
+                return 1;
+            }
+        }
+        else if (!std::strcmp(argv[arg], "--pressure-tolerance") && hasValue) {
+            options.pressureTolerance = std::strtod(argv[++arg], nullptr);
+        }
+        else if (!std::strcmp(argv[arg], "--obstacles") && hasValue) {
+            options.obstacles = std::strtod(argv[++arg], nullptr);
+        }
+        else if (!std::strcmp(argv[arg], "--frame-dt") && hasValue) {
+            options.frameDt = std::strtod(argv[++arg], nullptr);
+        }
+        else if (!std::strcmp(argv[arg], "--cfl") && arg + 2 < argc) {
+            options.cflNumber = std::strtod(argv[++arg], nullptr);
+            options.maxSubsteps = std::atoi(argv[++arg]);
+        }
+        else if (!std::strcmp(argv[arg], "--diffusion-tolerance") && hasValue) {
+            options.diffusionTolerance = std::strtod(argv[++arg], nullptr);
+        }
+        else if (!std::strcmp(argv[arg], "--no-spectral")) {
+            options.spectralPressure = false;
+        }
+        else if (!std::strcmp(argv[arg], "--periodic")) {
+            options.periodic = true;
+        }
+        else if (!std::strcmp(argv[arg], "--staggered")) {
+            options.staggered = true;
+        }
+        else if (!std::strcmp(argv[arg], "--sparse")) {
+            options.sparseTiles = true;
+        }
+        else if (!std::strcmp(argv[arg], "--approximate-sparse-pressure")) {
+            options.approximateSparsePressure = true;
+        }
+        else if (!std::strcmp(argv[arg], "--activity-thresholds") && arg + 2 < argc) {
+            options.densityThreshold = std::strtod(argv[++arg], nullptr);
+            options.velocityThreshold = std::strtod(argv[++arg], nullptr);
+        }
+        else if (!std::strcmp(argv[arg], "--quadtree")) {
+            quadtree = true;
+        }
+        else if (!std::strcmp(argv[arg], "--3d")) {
+            volume = true;
+        }
+        else if (!std::strcmp(argv[arg], "--min-level") && hasValue) {
+            options.minLevel = std::atoi(argv[++arg]);
+        }
+        else if (!std::strcmp(argv[arg], "--remesh-interval") && hasValue) {
+            options.remeshInterval = std::atoi(argv[++arg]);
+        }
+        else if (!std::strcmp(argv[arg], "--refine-thresholds") && arg + 2 < argc) {
+            options.vorticityThreshold = std::strtod(argv[++arg], nullptr);
+            options.densityRefineThreshold = std::strtod(argv[++arg], nullptr);
+        }
+        else if (!std::strcmp(argv[arg], "--cell-budget") && hasValue) {
+            options.cellBudget = std::atoi(argv[++arg]);
+        }
+        else if (!std::strcmp(argv[arg], "--pressure-iterations") && hasValue) {
+            options.pressureIterations = std::atoi(argv[++arg]);
+        }
+        else if (!std::strcmp(argv[arg], "--check-relaxation")) {
+            checkRelaxation = true;
+        }
+        else if (!std::strcmp(argv[arg], "--check-pressure")) {
+            checkPressure = true;
+        }
+        else if (!std::strcmp(argv[arg], "--check-pressure-large")) {
+            checkPressure = true;
+            options.largePressureGrids = true;
+        }
+        else if (!std::strcmp(argv[arg], "--check-sparse")) {
+            checkSparse = true;
+        }
+        else if (!std::strcmp(argv[arg], "--check-kernels")) {
+            checkKernels = true;
+        }
+        else if (!std::strcmp(argv[arg], "--bench-layout")) {
+            benchmarkLayout = true;
+        }
+        else if (!std::strcmp(argv[arg], "--per-tick")) {
+            options.perTick = true;
+        }
+        else if (!std::strcmp(argv[arg], "--list-scenes")) {
+            listScenes = true;
+        }
+        else if (!std::strcmp(argv[arg], "--help")) {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else {
+            std::cerr << "Unknown or incomplete argument: " << argv[arg] << "\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.N == 0) {
+        std::cerr << "N must be positive\n";
+        return 1;
+    }
+
+    if (options.sceneName.empty()) {
+        options.sceneName = volume ? "Smoke Column Scene" : "Water Fountain Scene";
+    }
+
+    if (volume) {
+        // A volume is meant to be stepped in single precision, so only --precision double asks for doubles
+        bool singlePrecision = options.singlePrecision || !precisionGiven;
+        return singlePrecision ? RunVolume<float>(options, listScenes) : RunVolume<double>(options, listScenes);
+    }
+
+    if (checkRelaxation) {
+        return options.singlePrecision ? CheckRelaxation<float>(options) : CheckRelaxation<double>(options);
+    }
+
+    if (checkPressure) {
+        return options.singlePrecision ? CheckPressure<float>(options) : CheckPressure<double>(options);
+    }
+
+    if (checkSparse) {
+        return options.singlePrecision ? CheckSparse<float>(options) : CheckSparse<double>(options);
+    }
+
+    if (checkKernels) {
+        return options.singlePrecision ? CheckKernels<float>(options) : CheckKernels<double>(options);
+    }
+
+    if (benchmarkLayout) {
+        return options.singlePrecision ? BenchmarkLayout<float>() : BenchmarkLayout<double>();
+    }
+
+    if (quadtree && !listScenes) {
+        return options.singlePrecision ? RunQuadtree<float>(options) : RunQuadtree<double>(options);
+    }
+
+    return options.singlePrecision ? RunScene<float>(options, listScenes) : RunScene<double>(options, listScenes);
+}
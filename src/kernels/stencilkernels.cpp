@@ -0,0 +1,203 @@
+#include "kernels/stencilkernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FLUID_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+template <typename Scalar>
+void AddSourceScalar(Scalar* x, const Scalar* s, size_t count, Scalar dt)
+{
+    for (size_t cell = 0; cell < count; ++cell) {
+        x[cell] += dt * s[cell];
+    }
+}
+
+template <typename Scalar>
+double RelaxRowRedBlackScalar(Scalar* x, const Scalar* rhs, const Scalar* below, const Scalar* above, int n,
+    int firstCell, Scalar a, Scalar invC)
+{
+    Scalar sumSquaredChange = 0;
+    for (int i = firstCell; i <= n; i += 2) {
+        Scalar relaxed = (rhs[i] + a * (x[i - 1] + x[i + 1] + below[i] + above[i])) * invC;
+        Scalar change = relaxed - x[i];
+        sumSquaredChange += change * change;
+        x[i] = relaxed;
+    }
+    return sumSquaredChange;
+}
+
+template <typename Scalar>
+void DivergenceRowScalar(Scalar* div, Scalar* p, const Scalar* u, const Scalar* vBelow, const Scalar* vAbove,
+    int n, Scalar scale)
+{
+    for (int i = 1; i <= n; ++i) {
+        div[i] = scale * (u[i + 1] - u[i - 1] + vAbove[i] - vBelow[i]);
+        p[i] = 0;
+    }
+}
+
+template <typename Scalar>
+void GradientRowScalar(Scalar* u, Scalar* v, const Scalar* p, const Scalar* pBelow, const Scalar* pAbove,
+    int n, Scalar scale)
+{
+    for (int i = 1; i <= n; ++i) {
+        u[i] -= scale * (p[i + 1] - p[i - 1]);
+        v[i] -= scale * (pAbove[i] - pBelow[i]);
+    }
+}
+
+template <typename Scalar>
+void StaggeredDivergenceRowScalar(Scalar* div, Scalar* p, const Scalar* u, const Scalar* vBelow, const Scalar* v,
+    int n, Scalar scale)
+{
+    for (int i = 1; i <= n; ++i) {
+        div[i] = scale * (u[i] - u[i - 1] + v[i] - vBelow[i]);
+        p[i] = 0;
+    }
+}
+
+template <typename Scalar>
+void StaggeredGradientRowScalar(Scalar* u, Scalar* v, const Scalar* p, const Scalar* pAbove, int n, Scalar scale)
+{
+    for (int i = 1; i <= n; ++i) {
+        u[i] -= scale * (p[i + 1] - p[i]);
+        v[i] -= scale * (pAbove[i] - p[i]);
+    }
+}
+
+template <typename Scalar>
+constexpr StencilKernels<Scalar> scalarKernels{
+    SimdLevel::SCALAR,
+    "scalar",
+    &AddSourceScalar<Scalar>,
+    &RelaxRowRedBlackScalar<Scalar>,
+    &DivergenceRowScalar<Scalar>,
+    &GradientRowScalar<Scalar>,
+    &StaggeredDivergenceRowScalar<Scalar>,
+    &StaggeredGradientRowScalar<Scalar>,
+};
+
+#ifdef FLUID_X86
+/// <summary>
+/// Runs cpuid for the given leaf and subleaf. regs receives eax, ebx, ecx and edx.
+/// </summary>
+void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int out[4];
+    __cpuidex(out, (int)leaf, (int)subleaf);
+    for (int reg = 0; reg < 4; ++reg) {
+        regs[reg] = (unsigned int)out[reg];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/// <summary>
+/// Reads the XCR0 register, which says which register files the OS saves on context switches.
+/// Only call this when cpuid reports OSXSAVE.
+/// </summary>
+unsigned long long ReadXcr0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+SimdLevel QuerySimdLevel()
+{
+    unsigned int regs[4];
+    CpuId(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+
+    CpuId(1, 0, regs);
+    bool sse2 = regs[3] & (1u << 26);
+    bool osxsave = regs[2] & (1u << 27);
+    bool avx = regs[2] & (1u << 28);
+    if (!sse2) {
+        return SimdLevel::SCALAR;
+    }
+    if (!osxsave || !avx || maxLeaf < 7) {
+        return SimdLevel::SSE2;
+    }
+
+    // The OS must save the XMM and YMM registers (and the opmask and ZMM registers for AVX-512)
+    unsigned long long xcr0 = ReadXcr0();
+    bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+    bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    CpuId(7, 0, regs);
+    bool avx2 = regs[1] & (1u << 5);
+    bool avx512f = regs[1] & (1u << 16);
+
+    if (avx512f && zmmEnabled) {
+        return SimdLevel::AVX512;
+    }
+    if (avx2 && ymmEnabled) {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+}
+#endif
+
+}
+
+SimdLevel DetectSimdLevel()
+{
+#ifdef FLUID_X86
+    static const SimdLevel level = QuerySimdLevel();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+template <typename Scalar>
+const StencilKernels<Scalar>& GetStencilKernels(SimdLevel maxLevel)
+{
+    SimdLevel supported = DetectSimdLevel();
+    SimdLevel level = maxLevel < supported ? maxLevel : supported;
+
+    const StencilKernels<Scalar>* kernels = nullptr;
+    switch (level) {
+    case SimdLevel::AVX512:
+        kernels = GetAvx512StencilKernels<Scalar>();
+        break;
+    case SimdLevel::AVX2:
+        kernels = GetAvx2StencilKernels<Scalar>();
+        break;
+    case SimdLevel::SSE2:
+        kernels = GetSse2StencilKernels<Scalar>();
+        break;
+    default:
+        break;
+    }
+    return kernels ? *kernels : *GetScalarStencilKernels<Scalar>();
+}
+
+template const StencilKernels<float>& GetStencilKernels<float>(SimdLevel maxLevel);
+template const StencilKernels<double>& GetStencilKernels<double>(SimdLevel maxLevel);
+
+template <>
+const StencilKernels<float>* GetScalarStencilKernels<float>()
+{
+    return &scalarKernels<float>;
+}
+
+template <>
+const StencilKernels<double>* GetScalarStencilKernels<double>()
+{
+    return &scalarKernels<double>;
+}
@@ -0,0 +1,104 @@
+#include "kernels/stencilkernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+// MSVC accepts AVX2 intrinsics without /arch:AVX2, GCC and Clang need the target enabled for this unit only
+#if defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+#include <immintrin.h>
+#include "kernels/stencilkernelsimpl.h"
+
+namespace {
+
+struct Avx2Double {
+    using Scalar = double;
+    using Vec = __m256d;
+    static constexpr int width = 4;
+
+    static Vec Load(const double* p) { return _mm256_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec Set1(double d) { return _mm256_set1_pd(d); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+
+    static Vec LoadEven(const double* p)
+    {
+        // (p0, p4, p2, p6) reordered to (p0, p2, p4, p6)
+        return _mm256_permute4x64_pd(_mm256_unpacklo_pd(_mm256_loadu_pd(p), _mm256_loadu_pd(p + 4)), 0xD8);
+    }
+
+    static void StoreEven(double* p, Vec v)
+    {
+        // Spread (v0, v1, v2, v3) to (v0, _, v1, _) and (v2, _, v3, _) and store only the even lanes
+        __m256i evenLanes = _mm256_set_epi64x(0, -1, 0, -1);
+        _mm256_maskstore_pd(p, evenLanes, _mm256_permute4x64_pd(v, 0x50));
+        _mm256_maskstore_pd(p + 4, evenLanes, _mm256_permute4x64_pd(v, 0xFA));
+    }
+};
+
+struct Avx2Float {
+    using Scalar = float;
+    using Vec = __m256;
+    static constexpr int width = 8;
+
+    static Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec Set1(float f) { return _mm256_set1_ps(f); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+
+    static Vec LoadEven(const float* p)
+    {
+        // The shuffle works within 128-bit halves and gives (p0, p2, p8, p10, p4, p6, p12, p14),
+        // so swap the middle pairs back into order
+        __m256 evens = _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(2, 0, 2, 0));
+        return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(evens), 0xD8));
+    }
+
+    static void StoreEven(float* p, Vec v)
+    {
+        // Spread the lower and upper halves of v over the even lanes and store only those
+        __m256i evenLanes = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+        __m256i lowerHalf = _mm256_set_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+        __m256i upperHalf = _mm256_set_epi32(7, 7, 6, 6, 5, 5, 4, 4);
+        _mm256_maskstore_ps(p, evenLanes, _mm256_permutevar8x32_ps(v, lowerHalf));
+        _mm256_maskstore_ps(p + 8, evenLanes, _mm256_permutevar8x32_ps(v, upperHalf));
+    }
+};
+
+constexpr StencilKernels<double> avx2DoubleKernels = MakeStencilKernels<Avx2Double>(SimdLevel::AVX2, "AVX2");
+constexpr StencilKernels<float> avx2FloatKernels = MakeStencilKernels<Avx2Float>(SimdLevel::AVX2, "AVX2");
+
+}
+
+template <>
+const StencilKernels<double>* GetAvx2StencilKernels<double>()
+{
+    return &avx2DoubleKernels;
+}
+
+template <>
+const StencilKernels<float>* GetAvx2StencilKernels<float>()
+{
+    return &avx2FloatKernels;
+}
+
+#else
+
+template <>
+const StencilKernels<double>* GetAvx2StencilKernels<double>()
+{
+    return nullptr;
+}
+
+template <>
+const StencilKernels<float>* GetAvx2StencilKernels<float>()
+{
+    return nullptr;
+}
+
+#endif
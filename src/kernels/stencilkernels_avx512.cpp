@@ -0,0 +1,102 @@
+#include "kernels/stencilkernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+// MSVC accepts AVX-512 intrinsics without /arch:AVX512, GCC and Clang need the target enabled for this unit only
+#if defined(__GNUC__)
+#pragma GCC target("avx512f")
+#endif
+
+#include <immintrin.h>
+#include "kernels/stencilkernelsimpl.h"
+
+namespace {
+
+struct Avx512Double {
+    using Scalar = double;
+    using Vec = __m512d;
+    static constexpr int width = 8;
+
+    static Vec Load(const double* p) { return _mm512_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm512_storeu_pd(p, v); }
+    static Vec Set1(double d) { return _mm512_set1_pd(d); }
+    static Vec Add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+
+    static Vec LoadEven(const double* p)
+    {
+        __m512i evenIndices = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+        return _mm512_permutex2var_pd(_mm512_loadu_pd(p), evenIndices, _mm512_loadu_pd(p + 8));
+    }
+
+    static void StoreEven(double* p, Vec v)
+    {
+        // Spread the lower and upper halves of v over the even lanes and store only those
+        __m512i lowerHalf = _mm512_set_epi64(3, 3, 2, 2, 1, 1, 0, 0);
+        __m512i upperHalf = _mm512_set_epi64(7, 7, 6, 6, 5, 5, 4, 4);
+        _mm512_mask_storeu_pd(p, 0x55, _mm512_permutexvar_pd(lowerHalf, v));
+        _mm512_mask_storeu_pd(p + 8, 0x55, _mm512_permutexvar_pd(upperHalf, v));
+    }
+};
+
+struct Avx512Float {
+    using Scalar = float;
+    using Vec = __m512;
+    static constexpr int width = 16;
+
+    static Vec Load(const float* p) { return _mm512_loadu_ps(p); }
+    static void Store(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+    static Vec Set1(float f) { return _mm512_set1_ps(f); }
+    static Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+
+    static Vec LoadEven(const float* p)
+    {
+        __m512i evenIndices = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+        return _mm512_permutex2var_ps(_mm512_loadu_ps(p), evenIndices, _mm512_loadu_ps(p + 16));
+    }
+
+    static void StoreEven(float* p, Vec v)
+    {
+        // Spread the lower and upper halves of v over the even lanes and store only those
+        __m512i lowerHalf = _mm512_set_epi32(7, 7, 6, 6, 5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0, 0);
+        __m512i upperHalf = _mm512_set_epi32(15, 15, 14, 14, 13, 13, 12, 12, 11, 11, 10, 10, 9, 9, 8, 8);
+        _mm512_mask_storeu_ps(p, 0x5555, _mm512_permutexvar_ps(lowerHalf, v));
+        _mm512_mask_storeu_ps(p + 16, 0x5555, _mm512_permutexvar_ps(upperHalf, v));
+    }
+};
+
+constexpr StencilKernels<double> avx512DoubleKernels = MakeStencilKernels<Avx512Double>(SimdLevel::AVX512, "AVX-512");
+constexpr StencilKernels<float> avx512FloatKernels = MakeStencilKernels<Avx512Float>(SimdLevel::AVX512, "AVX-512");
+
+}
+
+template <>
+const StencilKernels<double>* GetAvx512StencilKernels<double>()
+{
+    return &avx512DoubleKernels;
+}
+
+template <>
+const StencilKernels<float>* GetAvx512StencilKernels<float>()
+{
+    return &avx512FloatKernels;
+}
+
+#else
+
+template <>
+const StencilKernels<double>* GetAvx512StencilKernels<double>()
+{
+    return nullptr;
+}
+
+template <>
+const StencilKernels<float>* GetAvx512StencilKernels<float>()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "kernels/stencilkernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+#if defined(__GNUC__)
+#pragma GCC target("sse2")
+#endif
+
+#include <emmintrin.h>
+#include "kernels/stencilkernelsimpl.h"
+
+namespace {
+
+struct Sse2Double {
+    using Scalar = double;
+    using Vec = __m128d;
+    static constexpr int width = 2;
+
+    static Vec Load(const double* p) { return _mm_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec Set1(double d) { return _mm_set1_pd(d); }
+    static Vec Add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Vec LoadEven(const double* p) { return _mm_loadh_pd(_mm_load_sd(p), p + 2); }
+    static void StoreEven(double* p, Vec v) { _mm_storel_pd(p, v); _mm_storeh_pd(p + 2, v); }
+};
+
+struct Sse2Float {
+    using Scalar = float;
+    using Vec = __m128;
+    static constexpr int width = 4;
+
+    static Vec Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec Set1(float f) { return _mm_set1_ps(f); }
+    static Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+
+    static Vec LoadEven(const float* p)
+    {
+        return _mm_shuffle_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _MM_SHUFFLE(2, 0, 2, 0));
+    }
+
+    static void StoreEven(float* p, Vec v)
+    {
+        // SSE2 has no masked store, so interleave v with the odd elements already in memory and write them back.
+        // The odd elements belong to the other color, which nobody writes while this color is relaxed.
+        __m128 low = _mm_loadu_ps(p);
+        __m128 high = _mm_loadu_ps(p + 4);
+        _mm_storeu_ps(p, _mm_unpacklo_ps(v, _mm_shuffle_ps(low, low, _MM_SHUFFLE(3, 1, 3, 1))));
+        _mm_storeu_ps(p + 4, _mm_unpackhi_ps(v, _mm_shuffle_ps(high, high, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+};
+
+constexpr StencilKernels<double> sse2DoubleKernels = MakeStencilKernels<Sse2Double>(SimdLevel::SSE2, "SSE2");
+constexpr StencilKernels<float> sse2FloatKernels = MakeStencilKernels<Sse2Float>(SimdLevel::SSE2, "SSE2");
+
+}
+
+template <>
+const StencilKernels<double>* GetSse2StencilKernels<double>()
+{
+    return &sse2DoubleKernels;
+}
+
+template <>
+const StencilKernels<float>* GetSse2StencilKernels<float>()
+{
+    return &sse2FloatKernels;
+}
+
+#else
+
+template <>
+const StencilKernels<double>* GetSse2StencilKernels<double>()
+{
+    return nullptr;
+}
+
+template <>
+const StencilKernels<float>* GetSse2StencilKernels<float>()
+{
+    return nullptr;
+}
+
+#endif
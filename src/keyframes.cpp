@@ -0,0 +1,71 @@
+#include "keyframes.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename T>
+Keyframes<T>::Keyframes(T value) :
+    keys{ { 0.0, value } }, loop(false)
+{}
+
+template <typename T>
+Keyframes<T>::Keyframes(std::initializer_list<std::pair<double, T>> keys, bool loop) :
+    keys(), loop(loop)
+{
+    for (const std::pair<double, T>& key : keys) {
+        AddKey(key.first, key.second);
+    }
+}
+
+template <typename T>
+void Keyframes<T>::AddKey(double time, T value)
+{
+    auto position = std::lower_bound(keys.begin(), keys.end(), time,
+        [](const std::pair<double, T>& key, double t) { return key.first < t; });
+    if (position != keys.end() && position->first == time) {
+        position->second = value;
+    }
+    else {
+        keys.insert(position, { time, value });
+    }
+}
+
+template <typename T>
+T Keyframes<T>::Evaluate(double time) const
+{
+    if (keys.empty()) {
+        return T(0);
+    }
+    double period = keys.back().first;
+    if (loop && period > 0) {
+        time = std::fmod(time, period);
+        if (time < 0) {
+            time += period;
+        }
+    }
+    if (time <= keys.front().first) {
+        return keys.front().second;
+    }
+    if (time >= keys.back().first) {
+        return keys.back().second;
+    }
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+        [](double t, const std::pair<double, T>& key) { return t < key.first; });
+    auto previous = next - 1;
+    double s = (time - previous->first) / (next->first - previous->first);
+    return previous->second + (next->second - previous->second) * s;
+}
+
+template <typename T>
+bool Keyframes<T>::IsConstant() const
+{
+    for (const std::pair<double, T>& key : keys) {
+        if (key.second != keys.front().second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template class Keyframes<double>;
+template class Keyframes<glm::dvec2>;
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include "mygl.h"
 #include "imgui.h"
@@ -8,9 +9,9 @@ MyGL::MyGL(unsigned int windowWidth, unsigned int windowHeight):
 	windowWidth(windowWidth), windowHeight(windowHeight), 
     window(nullptr), imguiContext(nullptr), vao(0), 
     overlayShader(), quad(), testTextureHandle(-1), velocityTextureHandle(-1), obstacleTextureHandle(-1),
-    fluidSimulator(100, testTextureHandle, velocityTextureHandle, obstacleTextureHandle),
-    camera(windowWidth, windowHeight), sceneSelector(),
-    velFieldShader(), arrow()
+    previousDensityTextureHandle(-1), previousVelocityTextureHandle(-1), fluidSimulator(100), obstColor(0, 0, 1, 0.5),
+    camera(windowWidth, windowHeight), sceneSelector(), lastFrameTime(-1.0), simulationAccumulator(0.0),
+    activeSceneName(), velFieldShader(), arrow()
 {
     sceneSelector.AddScenes(fluidSimulator.GetSceneNames()); 
 }
@@ -19,8 +20,10 @@ MyGL::MyGL(const MyGL& other):
 	windowWidth(other.windowWidth), windowHeight(other.windowHeight), 
     window(nullptr), imguiContext(nullptr), vao(0),
     overlayShader(), quad(), testTextureHandle(-1), velocityTextureHandle(-1), obstacleTextureHandle(-1),
-    camera(windowWidth, windowHeight), sceneSelector(),
-    velFieldShader(), arrow()
+    previousDensityTextureHandle(-1), previousVelocityTextureHandle(-1),
+    fluidSimulator(other.fluidSimulator.GetN(), other.fluidSimulator.GetM()), obstColor(other.obstColor),
+    camera(windowWidth, windowHeight), sceneSelector(), lastFrameTime(-1.0), simulationAccumulator(0.0),
+    activeSceneName(), velFieldShader(), arrow()
 {
     sceneSelector.AddScenes(other.fluidSimulator.GetSceneNames());
 }
@@ -112,8 +115,12 @@ bool MyGL::InitializeGL() {
 }
 
 void MyGL::PaintGL() {
-    // Update fluid sim
-    fluidSimulator.Tick();
+    // Update fluid sim and convert its fields into textures once they have been created
+    StepSimulation();
+    HandleMouse();
+    if (obstacleTextureHandle != -1) {
+        UpdateObstacleTexture();
+    }
 
     // Poll for and process events
     glfwPollEvents();
@@ -122,7 +129,11 @@ void MyGL::PaintGL() {
     ShowImGuiWindow();
 
     // Check which scene is selected by the user and set it as active scene in the fluid simulator
-    fluidSimulator.ActivateSceneByName(sceneSelector.GetSelectedSceneName()); 
+    if (sceneSelector.GetSelectedSceneName() != activeSceneName) {
+        activeSceneName = sceneSelector.GetSelectedSceneName();
+        fluidSimulator.ActivateSceneByName(activeSceneName);
+        RefreshFieldTextures();
+    }
 
     // Handle mouse events for camera functions
     // TODO: move this somewhere more appropriate, but we don't have a Tick() yet().
@@ -168,7 +179,20 @@ void MyGL::ShowImGuiWindow()
     sceneSelector.ShowUI();
     //ImGui::ShowDemoWindow();
     //ImVec4 color = ImVec4(114.0f / 255.0f, 144.0f / 255.0f, 154.0f / 255.0f, 200.0f / 255.0f);
-    ImGui::ColorEdit4("MyColor##2f", (float*)&fluidSimulator.obstColor, ImGuiColorEditFlags_Float);
+    ImGui::ColorEdit4("MyColor##2f", (float*)&obstColor, ImGuiColorEditFlags_Float);
+    bool sparseTiles = fluidSimulator.GetSparseTiles();
+    if (ImGui::Checkbox("Sparse tiles", &sparseTiles)) {
+        fluidSimulator.SetSparseTiles(sparseTiles);
+    }
+    bool staggered = fluidSimulator.GetVelocityLayout() == VelocityLayout::STAGGERED;
+    if (ImGui::Checkbox("Staggered velocity", &staggered)) {
+        fluidSimulator.SetVelocityLayout(staggered ? VelocityLayout::STAGGERED : VelocityLayout::COLLOCATED);
+        RefreshFieldTextures();
+    }
+    if (sparseTiles) {
+        const TileActivity<SimulationScalar>& tiles = fluidSimulator.GetTileActivity();
+        ImGui::Text("Active tiles: %d of %d", tiles.GetActiveTileCount(), tiles.GetTileCount());
+    }
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
         1000.0 / (double)(ImGui::GetIO().Framerate), (double)(ImGui::GetIO().Framerate));
     ImGui::End();
@@ -249,9 +273,6 @@ void MyGL::RenderTestImage()
 
         // Unbind the texture
         glBindTexture(GL_TEXTURE_2D, 0);
-
-        //Set fluid sim handle
-        fluidSimulator.SetDensityTextureHandle(testTextureHandle);
     }
 
     // Render the textured quad
@@ -261,6 +282,10 @@ void MyGL::RenderTestImage()
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, testTextureHandle);
     overlayShader.SetUnifInt("u_Texture", 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, previousDensityTextureHandle);
+    overlayShader.SetUnifInt("u_PreviousTexture", 3);
+    overlayShader.SetUnifFloat("u_Alpha", GetDisplayAlpha());
 
     // Temporarily disable depth testing to ensure the full-screen quad is rendered 
     // without being affected by depth buffer comparisons.
@@ -293,9 +318,6 @@ void MyGL::TestVelField() {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        //Set fluid sim handle
-        fluidSimulator.SetVelocityTextureHandle(velocityTextureHandle);
     }
 
     // render velocity field
@@ -305,6 +327,7 @@ void MyGL::TestVelField() {
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, velocityTextureHandle);
     overlayShader.SetUnifInt("u_Texture", 1);
+    overlayShader.SetUnifFloat("u_Alpha", 1.0f);
     glDisable(GL_DEPTH_TEST);
     // TODO: Set this 100 * 100 to a var that's connected to the fluidism
     overlayShader.Draw(quad);// , 100 * 100);
@@ -326,9 +349,6 @@ void MyGL::RenderVelocityField() {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        //Set fluid sim handle
-        fluidSimulator.SetVelocityTextureHandle(velocityTextureHandle);
     }
 
     // render velocity field
@@ -338,9 +358,15 @@ void MyGL::RenderVelocityField() {
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, velocityTextureHandle);
     velFieldShader.SetUnifInt("u_Texture", 1);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, previousVelocityTextureHandle);
+    velFieldShader.SetUnifInt("u_PreviousTexture", 4);
+    velFieldShader.SetUnifFloat("u_Alpha", GetDisplayAlpha());
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    velFieldShader.SetUnifVec2("u_GridSize", glm::vec2(N, M));
     glDisable(GL_DEPTH_TEST);
-    // TODO: Set this 100 * 100 to a var that's connected to the fluidism
-    velFieldShader.DrawInstanced(arrow, 100 * 100);
+    velFieldShader.DrawInstanced(arrow, N * M);
     glEnable(GL_DEPTH_TEST);
 }
 
@@ -359,9 +385,6 @@ void MyGL::RenderObstacleTexture() {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        //Set fluid sim handle
-        fluidSimulator.SetObstacleTextureHandle(obstacleTextureHandle);
     }
 
     // render obstacle texture
@@ -371,6 +394,7 @@ void MyGL::RenderObstacleTexture() {
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, obstacleTextureHandle);
     velFieldShader.SetUnifInt("u_Texture", 2);
+    overlayShader.SetUnifFloat("u_Alpha", 1.0f);
     glDisable(GL_DEPTH_TEST);
     // TODO: Set this 100 * 100 to a var that's connected to the fluidism
     overlayShader.Draw(quad);
@@ -396,4 +420,203 @@ void MyGL::updateCamera() {
             camera.Zoom(io.MouseWheel * 0.2f);
         }                 
     }
-}
\ No newline at end of file
+}
+
+void MyGL::HandleMouse()
+{
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    int cursorX = ImGui::GetMousePos().x / windowWidth * N;
+    int cursorY = (1 - ImGui::GetMousePos().y / windowHeight) * M;
+    // NOTE: LeftCtrl + Mouse is for camera handling
+    // NOTE: LeftShift + Mouse is for adding obstacles
+    if (ImGui::IsMouseDragging(0) && !ImGui::IsKeyDown(ImGuiKey_LeftCtrl) && !ImGui::IsKeyDown(ImGuiKey_LeftShift)) {
+        ImVec2 dragVec = ImGui::GetMouseDragDelta(0);
+        if (cursorX >= 0 && cursorX <= N && cursorY >= 0 && cursorY <= M && !fluidSimulator.IsObstacle(cursorX, cursorY)) {
+            fluidSimulator.AddDens(cursorX, cursorY, abs((dragVec.x + dragVec.y) * 100));
+        }
+    }
+    if (ImGui::IsMouseDragging(1) && !ImGui::IsKeyDown(ImGuiKey_LeftCtrl) && !ImGui::IsKeyDown(ImGuiKey_LeftShift)) {
+        ImVec2 dragVec = ImGui::GetMouseDragDelta(1);
+        if (cursorX >= 0 && cursorX <= N && cursorY >= 0 && cursorY <= M) {
+            float dragStartX = cursorX - (dragVec.x / windowWidth * N);
+            float dragStartY = cursorY - ((1 - dragVec.y) / windowHeight) * M;
+            fluidSimulator.AddVel(dragStartX, dragStartY, dragVec.x * 0.001, dragVec.y * -0.001);
+        }
+    }
+    // Add obstacles with left click and left shift
+    if (ImGui::IsKeyDown(ImGuiKey_LeftShift) && ImGui::IsMouseDown(0)) {
+        if (cursorX >= -1 && cursorX < N && cursorY >= 0 && cursorY <= M) {
+            glm::vec4 col(obstColor.x, obstColor.y, obstColor.z, obstColor.w);
+            fluidSimulator.ToggleObs(cursorX + 1, cursorY, true, col);     // this one offset makes it visually be more where the mouse is on my laptop
+            // also remove any density and velocity frozen by this obstacle
+            fluidSimulator.ClearCell(cursorX + 1, cursorY);
+        }
+    }
+    // Remove obstacles with right click and left shift
+    else if (ImGui::IsKeyDown(ImGuiKey_LeftShift) && ImGui::IsMouseDown(1)) {
+        if (cursorX >= -1 && cursorX < N && cursorY >= 0 && cursorY <= M) {
+            fluidSimulator.ToggleObs(cursorX + 1, cursorY, false, glm::vec4(0));
+        }
+    }
+}
+
+void MyGL::StepSimulation() {
+    double now = glfwGetTime();
+    if (lastFrameTime >= 0) {
+        simulationAccumulator += now - lastFrameTime;
+    }
+    lastFrameTime = now;
+
+    int steps = (int)(simulationAccumulator / simulationStep);
+    if (steps > maxStepsPerFrame) {
+        // Falling behind: the simulation slows down instead of taking ever more steps per frame
+        simulationAccumulator -= (steps - maxStepsPerFrame) * simulationStep;
+        steps = maxStepsPerFrame;
+    }
+    if (previousDensityTextureHandle == -1) {
+        RefreshFieldTextures();
+    }
+    for (int step = 0; step < steps; ++step) {
+        // Only the state before the last step is blended with. After a single step the current textures already hold
+        // it and just trade places with the previous ones, otherwise the state is uploaded into the previous ones.
+        if (step == steps - 1) {
+            if (steps == 1) {
+                std::swap(previousDensityTextureHandle, testTextureHandle);
+                std::swap(previousVelocityTextureHandle, velocityTextureHandle);
+            }
+            else {
+                UpdateDensityTexture(previousDensityTextureHandle);
+                UpdateVelocityTexture(previousVelocityTextureHandle);
+            }
+        }
+        fluidSimulator.Tick(simulationStep);
+        simulationAccumulator -= simulationStep;
+    }
+    if (steps > 0) {
+        UpdateDensityTexture(testTextureHandle);
+        UpdateVelocityTexture(velocityTextureHandle);
+    }
+}
+
+void MyGL::RefreshFieldTextures() {
+    if (testTextureHandle == -1) {
+        testTextureHandle = CreateFieldTexture();
+    }
+    if (velocityTextureHandle == -1) {
+        velocityTextureHandle = CreateFieldTexture();
+    }
+    if (previousDensityTextureHandle == -1) {
+        previousDensityTextureHandle = CreateFieldTexture();
+        previousVelocityTextureHandle = CreateFieldTexture();
+    }
+    UpdateDensityTexture(testTextureHandle);
+    UpdateVelocityTexture(velocityTextureHandle);
+    UpdateDensityTexture(previousDensityTextureHandle);
+    UpdateVelocityTexture(previousVelocityTextureHandle);
+}
+
+float MyGL::GetDisplayAlpha() const {
+    return (float)std::clamp(simulationAccumulator / simulationStep, 0.0, 1.0);
+}
+
+GLuint MyGL::CreateFieldTexture() {
+    GLuint textureHandle;
+    glGenTextures(1, &textureHandle);
+    glBindTexture(GL_TEXTURE_2D, textureHandle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return textureHandle;
+}
+
+void MyGL::UpdateDensityTexture(GLuint textureHandle) {
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    const Field<SimulationScalar>& dens = fluidSimulator.GetDens();
+    const TileActivity<SimulationScalar>& tiles = fluidSimulator.GetTileActivity();
+    std::vector<float> gradient(N * M * 4); // RGBA as doubles
+    for (int index = 3; index < N * M * 4; index += 4) {
+        gradient[index] = 1;
+    }
+
+    // Only the active tiles hold any density, the rest stays black
+    for (int y = 1; y <= M; ++y) {
+        for (const auto* span = tiles.ColumnsBegin(y); span != tiles.ColumnsEnd(y); ++span) {
+            for (int x = span->begin; x < span->end; ++x) {
+                double pixelDensity = dens[IX(x, y)] / 2.5;
+                int index = ((y - 1) * N + (x - 1)) * 4;
+                gradient[index] = pixelDensity;
+                gradient[index + 1] = pixelDensity;
+                gradient[index + 2] = pixelDensity;
+            }
+        }
+    }
+
+    //todo:: send to gpu. better ways to do this
+    glBindTexture(GL_TEXTURE_2D, textureHandle);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, N, M, 0, GL_RGBA, GL_FLOAT, gradient.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void MyGL::UpdateVelocityTexture(GLuint textureHandle) {
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    const Field<SimulationScalar>& u = fluidSimulator.GetU();
+    const Field<SimulationScalar>& v = fluidSimulator.GetV();
+    const TileActivity<SimulationScalar>& tiles = fluidSimulator.GetTileActivity();
+    std::vector<float> field(N * M * 4, 0.5f); // RGBA as doubles
+    for (int index = 3; index < N * M * 4; index += 4) {
+        field[index] = 0;
+    }
+
+    // Outside the active tiles the fluid is at rest: no direction and a length of 0
+    for (int y = 1; y <= M; ++y) {
+        for (const auto* span = tiles.ColumnsBegin(y); span != tiles.ColumnsEnd(y); ++span) {
+            for (int x = span->begin; x < span->end; ++x) {
+                glm::vec3 pixelVelocity = glm::vec3(u[IX(x, y)], v[IX(x, y)], 0);
+                int index = ((y - 1) * N + (x - 1)) * 4;
+                // mapping the vector vals [-1, 1] to [0, 1]
+                field[index] = (glm::normalize(pixelVelocity).x + 1.f) * 0.5;
+                field[index + 1] = (glm::normalize(pixelVelocity).y + 1.f) * 0.5;
+                field[index + 2] = (glm::normalize(pixelVelocity).z + 1.f) * 0.5;
+                // storing original length, dividing by 10 to ensure it is between 0 and 1, might need to change later
+                field[index + 3] = glm::length(pixelVelocity) / 10.f;
+            }
+        }
+    }
+
+    //todo:: send to gpu. better ways to do this
+    glBindTexture(GL_TEXTURE_2D, textureHandle);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, N, M, 0, GL_RGBA, GL_FLOAT, field.data());
+    glBindTexture(GL_TEXTURE_2D, 1);
+}
+
+void MyGL::UpdateObstacleTexture() {
+    int N = fluidSimulator.GetN();
+    int M = fluidSimulator.GetM();
+    std::vector<float> field(N * M * 4, 0.0f); // RGBA as floats, transparent where there is no obstacle
+
+    // Jump from one obstacle to the next a word of the mask at a time, skipping the open fluid, and expand the
+    // palette index of each to its color
+    const CellBitmask& obstacles = fluidSimulator.GetObstacles();
+    const std::vector<uint8_t>& colorIndices = fluidSimulator.GetObstacleColorIndices();
+    const std::vector<glm::vec4>& palette = fluidSimulator.GetObstaclePalette();
+    for (int y = 1; y <= M; ++y) {
+        for (int x = obstacles.FindNext(1, N + 1, y, true); x <= N; x = obstacles.FindNext(x + 1, N + 1, y, true)) {
+            int index = ((y - 1) * N + (x - 1)) * 4;
+            const glm::vec4& col = palette[colorIndices[IX(x, y)]];
+            field[index] = col.x;
+            field[index + 1] = col.y;
+            field[index + 2] = col.z;
+            field[index + 3] = col.w;
+        }
+    }
+
+    //todo:: send to gpu. better ways to do this
+    glBindTexture(GL_TEXTURE_2D, obstacleTextureHandle);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, N, M, 0, GL_RGBA, GL_FLOAT, field.data());
+    glBindTexture(GL_TEXTURE_2D, 2);
+}
@@ -0,0 +1,141 @@
+#include "obstaclemask.h"
+
+#include <algorithm>
+#include <bit>
+
+template <typename Scalar>
+ObstacleMask<Scalar>::ObstacleMask(unsigned int N, unsigned int M) :
+    N((int)N), M((int)M), runs(), rowRuns(), wallCells(), solidCells(0)
+{
+    Build(CellBitmask(N, M));
+}
+
+template <typename Scalar>
+void ObstacleMask<Scalar>::Build(const CellBitmask& obstacle)
+{
+    auto IsFluid = [&](int i, int j) {
+        return i >= 1 && i <= N && j >= 1 && j <= M && !obstacle.Get(i, j);
+    };
+
+    runs.clear();
+    rowRuns.assign(M + 3, 0);
+    solidCells = N * M;
+    for (int j = 1; j <= M; j++) {
+        rowRuns[j] = (int)runs.size();
+        int i = obstacle.FindNext(1, N + 1, j, false);
+        while (i <= N) {
+            int end = obstacle.FindNext(i, N + 1, j, true);
+            runs.push_back({ i, end });
+            solidCells -= end - i;
+            i = obstacle.FindNext(end, N + 1, j, false);
+        }
+    }
+    rowRuns[M + 1] = (int)runs.size();
+    rowRuns[M + 2] = (int)runs.size();
+
+    // Bit k of FluidBits(i, j) tells whether cell (i + k, j) is an inner fluid cell, for i >= -1
+    using Word = CellBitmask::Word;
+    auto FluidBits = [&](int i, int j) -> Word {
+        if (j < 1 || j > M) {
+            return 0;
+        }
+        // Column -1 lies outside the grid, start at column 0 and shift it in as solid
+        int shift = i < 0 ? 1 : 0;
+        i += shift;
+        int lo = std::max(1 - i, 0);
+        int hi = std::min(N + 1 - i, CellBitmask::WORD_BITS);
+        if (hi <= lo) {
+            return 0;
+        }
+        Word inner = (hi == CellBitmask::WORD_BITS ? ~Word(0) : (Word(1) << hi) - 1) & (~Word(0) << lo);
+        return (~obstacle.GetBits(i, j) & inner) << shift;
+    };
+
+    // The wall cells are the solid inner cells with a fluid neighbor, found 64 at a time
+    const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    wallCells.clear();
+    for (int j = 1; j <= M; j++) {
+        for (int c = 0; c <= N; c += CellBitmask::WORD_BITS) {
+            Word walls = obstacle.GetBits(c, j) &
+                (FluidBits(c - 1, j) | FluidBits(c + 1, j) | FluidBits(c, j - 1) | FluidBits(c, j + 1));
+            for (; walls != 0; walls &= walls - 1) {
+                int i = c + std::countr_zero(walls);
+                if (i < 1 || i > N) {
+                    continue;
+                }
+                WallCell wallCell = {};
+                wallCell.cell = IX(i, j);
+                int fluidNeighbors = 0;
+                for (int k = 0; k < 4; k++) {
+                    int ni = i + offsets[k][0];
+                    int nj = j + offsets[k][1];
+                    bool fluid = IsFluid(ni, nj);
+                    wallCell.neighbors[k] = fluid ? IX(ni, nj) : wallCell.cell;
+                    fluidNeighbors += fluid;
+                }
+                // The component of the velocity normal to a face flips sign across it, so no flow passes through
+                // the wall
+                Scalar weight = Scalar(1) / fluidNeighbors;
+                for (int k = 0; k < 4; k++) {
+                    bool fluid = wallCell.neighbors[k] != wallCell.cell;
+                    bool horizontalFace = k < 2;
+                    Scalar normal = fluid ? -weight : Scalar(0);
+                    Scalar tangential = fluid ? weight : Scalar(0);
+                    wallCell.weights[int(BoundaryType::NONE)][k] = tangential;
+                    wallCell.weights[int(BoundaryType::HORIZONTAL)][k] = horizontalFace ? normal : tangential;
+                    wallCell.weights[int(BoundaryType::VERTICAL)][k] = horizontalFace ? tangential : normal;
+                }
+                wallCells.push_back(wallCell);
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+void ObstacleMask<Scalar>::ApplyWallConditions(BoundaryType b, Field<Scalar>& x) const
+{
+    int type = int(b);
+    for (const WallCell& wallCell : wallCells) {
+        const Scalar* weights = wallCell.weights[type];
+        x[wallCell.cell] = weights[0] * x[wallCell.neighbors[0]] + weights[1] * x[wallCell.neighbors[1]] +
+            weights[2] * x[wallCell.neighbors[2]] + weights[3] * x[wallCell.neighbors[3]];
+    }
+}
+
+template <typename Scalar>
+void ObstacleMask<Scalar>::ApplyFaceConditions(BoundaryType b, Field<Scalar>& x) const
+{
+    if (b == BoundaryType::NONE) {
+        ApplyWallConditions(b, x);
+        return;
+    }
+    // The faces before and after the wall cell along the component
+    int offset = b == BoundaryType::HORIZONTAL ? 1 : GridStride(N);
+    for (const WallCell& wallCell : wallCells) {
+        x[wallCell.cell - offset] = 0;
+        x[wallCell.cell] = 0;
+    }
+}
+
+template <typename Scalar>
+void ObstacleMask<Scalar>::ClearSolidCells(Field<Scalar>& x) const
+{
+    // The solid cells of a row are the gaps between its runs
+    for (int j = 1; j <= M; j++) {
+        int i = 1;
+        for (const Run* run = RunsBegin(j); run != RunsEnd(j); ++run) {
+            std::fill(&x[IX(i, j)], &x[IX(run->begin, j)], Scalar(0));
+            i = run->end;
+        }
+        std::fill(&x[IX(i, j)], &x[IX(N + 1, j)], Scalar(0));
+    }
+}
+
+template <typename Scalar>
+int ObstacleMask<Scalar>::GetSolidCellCount() const
+{
+    return solidCells;
+}
+
+template class ObstacleMask<float>;
+template class ObstacleMask<double>;
@@ -0,0 +1,242 @@
+#include "proceduralvelocitysource.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename Scalar>
+ProceduralVelocitySource<Scalar>::ProceduralVelocitySource(unsigned int N, unsigned int M) :
+    VelocitySource<Scalar>(N, M, 0.0, 0.0)
+{}
+
+template <typename Scalar>
+bool ProceduralVelocitySource<Scalar>::IsStatic() const
+{
+    return false;
+}
+
+template <typename Scalar>
+bool ProceduralVelocitySource<Scalar>::IsProcedural() const
+{
+    return true;
+}
+
+template <typename Scalar>
+bool ProceduralVelocitySource<Scalar>::IsGradient(bool periodic) const
+{
+    return false;
+}
+
+template <typename Scalar>
+bool ProceduralVelocitySource<Scalar>::GetBounds(int& iBegin, int& iEnd, int& jBegin, int& jEnd) const
+{
+    return false;
+}
+
+template <typename Scalar>
+BodyForceSource<Scalar>::BodyForceSource(unsigned int N, unsigned int M, double forceX, double forceY) :
+    ProceduralVelocitySource<Scalar>(N, M), forceX(forceX), forceY(forceY)
+{}
+
+template <typename Scalar>
+void BodyForceSource<Scalar>::SetForce(double forceX, double forceY)
+{
+    this->forceX = forceX;
+    this->forceY = forceY;
+}
+
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> BodyForceSource<Scalar>::Clone() const
+{
+    return std::make_unique<BodyForceSource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+bool BodyForceSource<Scalar>::IsGradient(bool periodic) const
+{
+    // A uniform force is the gradient of a linear potential, which does not wrap around a periodic domain: there
+    // nothing holds the fluid back, and the force accelerates it everywhere
+    return !periodic;
+}
+
+template <typename Scalar>
+void BodyForceSource<Scalar>::AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow,
+    Scalar uScale, Scalar vScale) const
+{
+    Scalar du = Scalar(forceX) * uScale;
+    Scalar dv = Scalar(forceY) * vScale;
+    // A zero component leaves its field untouched
+    if (du != 0) {
+        for (int i = iBegin; i < iEnd; i++) {
+            uRow[i] += du;
+        }
+    }
+    if (dv != 0) {
+        for (int i = iBegin; i < iEnd; i++) {
+            vRow[i] += dv;
+        }
+    }
+}
+
+template <typename Scalar>
+glm::dvec2 BodyForceSource<Scalar>::GetVelocity(double x, double y) const
+{
+    return glm::dvec2(forceX, forceY);
+}
+
+template <typename Scalar>
+VortexSource<Scalar>::VortexSource(unsigned int N, unsigned int M, double x, double y, double angularSpeed,
+    double angle) :
+    ProceduralVelocitySource<Scalar>(N, M), center(x, y), angularSpeed(angularSpeed), angle(angle)
+{}
+
+template <typename Scalar>
+void VortexSource<Scalar>::SetAngularSpeed(double angularSpeed)
+{
+    this->angularSpeed = angularSpeed;
+}
+
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> VortexSource<Scalar>::Clone() const
+{
+    return std::make_unique<VortexSource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+void VortexSource<Scalar>::AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow,
+    Scalar uScale, Scalar vScale) const
+{
+    // The tangent (-dy, dx) turned by angle is linear in i along the row: u = uStart + uStep * i, likewise v
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    double dy = j - center.y;
+    double uFactor = angularSpeed * uScale;
+    double vFactor = angularSpeed * vScale;
+    Scalar uStep = Scalar(-uFactor * s);
+    Scalar vStep = Scalar(vFactor * c);
+    Scalar uStart = Scalar(uFactor * (-dy * c + center.x * s));
+    Scalar vStart = Scalar(vFactor * (-dy * s - center.x * c));
+    for (int i = iBegin; i < iEnd; i++) {
+        uRow[i] += uStart + uStep * Scalar(i);
+        vRow[i] += vStart + vStep * Scalar(i);
+    }
+}
+
+template <typename Scalar>
+glm::dvec2 VortexSource<Scalar>::GetVelocity(double x, double y) const
+{
+    // The tangent (-dy, dx) turned by angle
+    double dx = x - center.x;
+    double dy = y - center.y;
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    return angularSpeed * glm::dvec2(-dy * c - dx * s, dx * c - dy * s);
+}
+
+template <typename Scalar>
+RadialJetSource<Scalar>::RadialJetSource(unsigned int N, unsigned int M, double x, double y, double radius,
+    double speed) :
+    ProceduralVelocitySource<Scalar>(N, M), center(x, y), radius(radius), speed(speed)
+{}
+
+template <typename Scalar>
+void RadialJetSource<Scalar>::SetSpeed(double speed)
+{
+    this->speed = speed;
+}
+
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> RadialJetSource<Scalar>::Clone() const
+{
+    return std::make_unique<RadialJetSource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+bool RadialJetSource<Scalar>::GetBounds(int& iBegin, int& iEnd, int& jBegin, int& jEnd) const
+{
+    iBegin = std::max(1, (int)std::ceil(center.x - radius));
+    iEnd = std::min((int)this->N, (int)std::floor(center.x + radius)) + 1;
+    jBegin = std::max(1, (int)std::ceil(center.y - radius));
+    jEnd = std::min((int)this->M, (int)std::floor(center.y + radius)) + 1;
+    return true;
+}
+
+template <typename Scalar>
+void RadialJetSource<Scalar>::AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow,
+    Scalar uScale, Scalar vScale) const
+{
+    double dy = j - center.y;
+    if (std::abs(dy) >= radius) {
+        return;
+    }
+    // Only the cells of the row inside the radius are visited
+    double halfWidth = std::sqrt(radius * radius - dy * dy);
+    int iFirst = std::max(iBegin, (int)std::ceil(center.x - halfWidth));
+    int iLast = std::min(iEnd - 1, (int)std::floor(center.x + halfWidth));
+    Scalar rowDy = Scalar(dy);
+    Scalar centerX = Scalar(center.x);
+    Scalar inverseRadius = Scalar(1.0 / radius);
+    Scalar uSpeed = Scalar(speed) * uScale;
+    Scalar vSpeed = Scalar(speed) * vScale;
+    for (int i = iFirst; i <= iLast; i++) {
+        Scalar dx = Scalar(i) - centerX;
+        Scalar distance = std::sqrt(dx * dx + rowDy * rowDy);
+        // speed * (1 - distance / radius) along the unit offset; the center itself gets no direction
+        Scalar factor = distance > 0 ? std::max(Scalar(1) / distance - inverseRadius, Scalar(0)) : Scalar(0);
+        uRow[i] += uSpeed * factor * dx;
+        vRow[i] += vSpeed * factor * rowDy;
+    }
+}
+
+template <typename Scalar>
+glm::dvec2 RadialJetSource<Scalar>::GetVelocity(double x, double y) const
+{
+    glm::dvec2 offset(x - center.x, y - center.y);
+    double distance = glm::length(offset);
+    if (distance >= radius || distance <= 0.0) {
+        return glm::dvec2(0.0);
+    }
+    return speed * (1.0 / distance - 1.0 / radius) * offset;
+}
+
+template <typename Scalar>
+FunctionVelocitySource<Scalar>::FunctionVelocitySource(unsigned int N, unsigned int M, VelocityFunction velocity) :
+    ProceduralVelocitySource<Scalar>(N, M), velocity(std::move(velocity))
+{}
+
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> FunctionVelocitySource<Scalar>::Clone() const
+{
+    return std::make_unique<FunctionVelocitySource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+void FunctionVelocitySource<Scalar>::AddVelocityRow(int j, int iBegin, int iEnd, Scalar* uRow, Scalar* vRow,
+    Scalar uScale, Scalar vScale) const
+{
+    for (int i = iBegin; i < iEnd; i++) {
+        glm::dvec2 cellVelocity = velocity(i, j);
+        uRow[i] += Scalar(cellVelocity.x * uScale);
+        vRow[i] += Scalar(cellVelocity.y * vScale);
+    }
+}
+
+template <typename Scalar>
+glm::dvec2 FunctionVelocitySource<Scalar>::GetVelocity(double x, double y) const
+{
+    int N = this->N;
+    int M = this->M;
+    int i = std::clamp((int)std::lround(x), 1, N);
+    int j = std::clamp((int)std::lround(y), 1, M);
+    return velocity(i, j);
+}
+
+template class ProceduralVelocitySource<float>;
+template class ProceduralVelocitySource<double>;
+template class BodyForceSource<float>;
+template class BodyForceSource<double>;
+template class VortexSource<float>;
+template class VortexSource<double>;
+template class RadialJetSource<float>;
+template class RadialJetSource<double>;
+template class FunctionVelocitySource<float>;
+template class FunctionVelocitySource<double>;
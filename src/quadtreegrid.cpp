@@ -0,0 +1,307 @@
+#include "quadtreegrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+namespace {
+
+/// <summary>
+/// The state of one QuadtreeGrid::Restructure() pass: the tree being read and the one being built from it.
+/// </summary>
+struct Restructuring {
+    const std::vector<QuadtreeGrid::Node>& oldNodes;
+    const std::vector<uint8_t>& split;
+    const std::vector<uint8_t>& merge;
+    std::vector<QuadtreeGrid::Node> nodes;
+    std::vector<QuadtreeGrid::Cell> cells;
+    std::vector<int>& sources;
+    std::vector<int>& sourceBegin;
+
+    // Turns the new node into a leaf made of the given old cells
+    void AddLeaf(int node, int x, int y, int size, int level, std::initializer_list<int> oldCells)
+    {
+        nodes[node].firstChild = -1;
+        nodes[node].cell = (int)cells.size();
+        cells.push_back({ x, y, size, level, node });
+        sources.insert(sources.end(), oldCells);
+        sourceBegin.push_back((int)sources.size());
+    }
+
+    // Splits the new node, returning its first child
+    int AddChildren(int node)
+    {
+        int firstChild = (int)nodes.size();
+        nodes[node].firstChild = firstChild;
+        nodes[node].cell = -1;
+        nodes.resize(nodes.size() + 4, { -1, -1, node });
+        return firstChild;
+    }
+
+    // Builds the new node covering the same square as the old one
+    void Build(int oldNode, int node, int x, int y, int size, int level)
+    {
+        const QuadtreeGrid::Node old = oldNodes[oldNode];
+        int half = size / 2;
+        if (old.firstChild < 0) {
+            if (!split[old.cell]) {
+                AddLeaf(node, x, y, size, level, { old.cell });
+                return;
+            }
+            int firstChild = AddChildren(node);
+            for (int k = 0; k < 4; k++) {
+                AddLeaf(firstChild + k, x + (k & 1) * half, y + (k >> 1) * half, half, level + 1, { old.cell });
+            }
+            return;
+        }
+        if (merge[oldNode]) {
+            int first = old.firstChild;
+            AddLeaf(node, x, y, size, level, { oldNodes[first].cell, oldNodes[first + 1].cell,
+                oldNodes[first + 2].cell, oldNodes[first + 3].cell });
+            return;
+        }
+        int firstChild = AddChildren(node);
+        for (int k = 0; k < 4; k++) {
+            Build(old.firstChild + k, firstChild + k, x + (k & 1) * half, y + (k >> 1) * half, half, level + 1);
+        }
+    }
+};
+
+}
+
+QuadtreeGrid::QuadtreeGrid(unsigned int N, int level) :
+    N((int)N), maxLevel(0), nodes(), cells(), faces(), cellFaces(), cellFaceBegin(), transferSources(),
+    transferBegin()
+{
+    while ((1 << maxLevel) < this->N) {
+        maxLevel++;
+    }
+    nodes.push_back({ -1, 0, -1 });
+    cells.push_back({ 0, 0, this->N, 0, 0 });
+    transferSources.assign(1, 0);
+    transferBegin.assign({ 0, 1 });
+    level = std::min(level, maxLevel);
+    for (int l = 0; l < level; l++) {
+        Adapt(std::vector<int8_t>(cells.size(), 1), 0, level);
+    }
+    BuildFaces();
+}
+
+int QuadtreeGrid::FindNode(int x, int y, int level) const
+{
+    int node = 0;
+    for (int l = 0; l < level && nodes[node].firstChild >= 0; l++) {
+        int shift = maxLevel - l - 1;
+        node = nodes[node].firstChild + ((x >> shift) & 1) + 2 * ((y >> shift) & 1);
+    }
+    return node;
+}
+
+int QuadtreeGrid::FindNeighbor(const Cell& cell, int side, int level) const
+{
+    int x = cell.x;
+    int y = cell.y;
+    switch (side) {
+    case 0: x += cell.size; break;
+    case 1: x -= 1; break;
+    case 2: y += cell.size; break;
+    default: y -= 1; break;
+    }
+    if (x < 0 || x >= N || y < 0 || y >= N) {
+        return -1;
+    }
+    return FindNode(x, y, level);
+}
+
+void QuadtreeGrid::Restructure(const std::vector<uint8_t>& split, const std::vector<uint8_t>& merge,
+    std::vector<int>& sources, std::vector<int>& sourceBegin)
+{
+    sources.clear();
+    sourceBegin.assign(1, 0);
+    Restructuring restructuring{ nodes, split, merge, {}, {}, sources, sourceBegin };
+    restructuring.nodes.push_back({ -1, -1, -1 });
+    restructuring.Build(0, 0, 0, 0, N, 0);
+    nodes.swap(restructuring.nodes);
+    cells.swap(restructuring.cells);
+}
+
+bool QuadtreeGrid::CanMerge(int node) const
+{
+    // Each child borders the outside of its parent on two sides, where it must not meet cells finer than itself
+    int firstChild = nodes[node].firstChild;
+    for (int k = 0; k < 4; k++) {
+        const Cell& child = cells[nodes[firstChild + k].cell];
+        int sides[2] = { (k & 1) ? 0 : 1, (k >> 1) ? 2 : 3 };
+        for (int side : sides) {
+            int neighbor = FindNeighbor(child, side, child.level);
+            if (neighbor >= 0 && nodes[neighbor].firstChild >= 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool QuadtreeGrid::FindUnbalanced(std::vector<uint8_t>& split) const
+{
+    bool found = false;
+    split.assign(cells.size(), 0);
+    for (const Cell& cell : cells) {
+        for (int side = 0; side < 4; side++) {
+            int neighbor = FindNeighbor(cell, side, cell.level);
+            if (neighbor < 0 || nodes[neighbor].firstChild >= 0) {
+                continue;
+            }
+            int neighborCell = nodes[neighbor].cell;
+            if (cells[neighborCell].level < cell.level - 1) {
+                split[neighborCell] = 1;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+bool QuadtreeGrid::Adapt(const std::vector<int8_t>& change, int minLevel, int maxLevel)
+{
+    maxLevel = std::min(maxLevel, this->maxLevel);
+    bool changed = false;
+    std::vector<uint8_t> split(cells.size(), 0);
+    for (size_t c = 0; c < cells.size(); c++) {
+        if (change[c] > 0 && cells[c].level < maxLevel) {
+            split[c] = 1;
+            changed = true;
+        }
+    }
+    std::vector<uint8_t> merge(nodes.size(), 0);
+    for (size_t n = 0; n < nodes.size(); n++) {
+        int firstChild = nodes[n].firstChild;
+        if (firstChild < 0) {
+            continue;
+        }
+        bool allCoarsen = true;
+        for (int k = 0; k < 4 && allCoarsen; k++) {
+            int cell = nodes[firstChild + k].cell;
+            allCoarsen = cell >= 0 && change[cell] < 0 && cells[cell].level > minLevel;
+        }
+        if (allCoarsen && CanMerge((int)n)) {
+            merge[n] = 1;
+            changed = true;
+        }
+    }
+    if (!changed) {
+        transferSources.resize(cells.size());
+        transferBegin.resize(cells.size() + 1);
+        for (size_t c = 0; c < cells.size(); c++) {
+            transferSources[c] = (int)c;
+            transferBegin[c] = (int)c;
+        }
+        transferBegin[cells.size()] = (int)cells.size();
+        return false;
+    }
+    Restructure(split, merge, transferSources, transferBegin);
+
+    // Splitting cells next to coarse ones can leave them two levels apart; each pass fixes one level of that
+    std::vector<uint8_t> balance;
+    std::vector<uint8_t> none;
+    std::vector<int> sources;
+    std::vector<int> sourceBegin;
+    while (FindUnbalanced(balance)) {
+        none.assign(nodes.size(), 0);
+        Restructure(balance, none, sources, sourceBegin);
+        // Balancing only splits, so every new cell comes from one cell of the previous pass
+        std::vector<int> composedSources;
+        std::vector<int> composedBegin(1, 0);
+        for (size_t c = 0; c < cells.size(); c++) {
+            int previous = sources[sourceBegin[c]];
+            composedSources.insert(composedSources.end(), transferSources.begin() + transferBegin[previous],
+                transferSources.begin() + transferBegin[previous + 1]);
+            composedBegin.push_back((int)composedSources.size());
+        }
+        transferSources.swap(composedSources);
+        transferBegin.swap(composedBegin);
+    }
+    BuildFaces();
+    return true;
+}
+
+void QuadtreeGrid::BuildFaces()
+{
+    faces.clear();
+    for (int c = 0; c < (int)cells.size(); c++) {
+        const Cell& cell = cells[c];
+        for (int side = 0; side < 4; side++) {
+            // Finer neighbors add the faces they share with this cell, and of two cells of the same level the one
+            // to the left or below does
+            int neighbor = FindNeighbor(cell, side, cell.level);
+            if (neighbor < 0 || nodes[neighbor].firstChild >= 0) {
+                continue;
+            }
+            int neighborCell = nodes[neighbor].cell;
+            const Cell& other = cells[neighborCell];
+            bool upperSide = side == 0 || side == 2;
+            if (other.level == cell.level && !upperSide) {
+                continue;
+            }
+            Face face;
+            face.lower = upperSide ? c : neighborCell;
+            face.upper = upperSide ? neighborCell : c;
+            face.axis = side < 2 ? 0 : 1;
+            face.length = cell.size;
+            face.weight = cell.size / (0.5 * (cell.size + other.size));
+            faces.push_back(face);
+        }
+    }
+
+    cellFaceBegin.assign(cells.size() + 1, 0);
+    for (const Face& face : faces) {
+        cellFaceBegin[face.lower + 1]++;
+        cellFaceBegin[face.upper + 1]++;
+    }
+    for (size_t c = 0; c < cells.size(); c++) {
+        cellFaceBegin[c + 1] += cellFaceBegin[c];
+    }
+    cellFaces.resize(cellFaceBegin[cells.size()]);
+    std::vector<int> next(cellFaceBegin.begin(), cellFaceBegin.end() - 1);
+    for (int f = 0; f < (int)faces.size(); f++) {
+        cellFaces[next[faces[f].lower]++] = f;
+        cellFaces[next[faces[f].upper]++] = f;
+    }
+}
+
+int QuadtreeGrid::Locate(double x, double y) const
+{
+    int i = std::clamp((int)std::floor(x), 0, N - 1);
+    int j = std::clamp((int)std::floor(y), 0, N - 1);
+    return Locate(i, j);
+}
+
+int QuadtreeGrid::GetN() const
+{
+    return N;
+}
+
+int QuadtreeGrid::GetMaxLevel() const
+{
+    return maxLevel;
+}
+
+int QuadtreeGrid::GetCellCount() const
+{
+    return (int)cells.size();
+}
+
+const std::vector<QuadtreeGrid::Cell>& QuadtreeGrid::GetCells() const
+{
+    return cells;
+}
+
+const std::vector<QuadtreeGrid::Node>& QuadtreeGrid::GetNodes() const
+{
+    return nodes;
+}
+
+const std::vector<QuadtreeGrid::Face>& QuadtreeGrid::GetFaces() const
+{
+    return faces;
+}
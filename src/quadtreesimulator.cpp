@@ -0,0 +1,651 @@
+#include "quadtreesimulator.h"
+#include "proceduralvelocitysource.h"
+#include "scenes/scenecatalog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+template <typename Scalar>
+QuadtreeSimulator<Scalar>::QuadtreeSimulator(unsigned int N, int minLevel) :
+    N(N), grid(N, minLevel), u(), u_prev(), v(), v_prev(), dens(), dens_prev(), pressure(), divergence(),
+    pressureSolver(), scenes(CreateScenes<Scalar>(N, N)), activeSceneName(), sources(), viscosity(0),
+    diffusion(0.0001), diffusionTolerance(1.0e-4), maxDiffusionIterations(20), coloredCells(), colorStarts(),
+    minLevel(minLevel), maxLevel(grid.GetMaxLevel()), remeshInterval(4),
+    vorticityThreshold(0.02), densityThreshold(0.05), cellBudget(1 << 18),
+    tickCount(0), lastTickTimings(), lastPressureStats(),
+    threadPool(std::make_unique<ThreadPool>())
+{
+    this->minLevel = std::clamp(minLevel, 0, maxLevel);
+    Reset();
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::Tick(double dt)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start = Clock::now();
+    lastTickTimings.diffusionSweeps = 0;
+    if (tickCount % remeshInterval == 0) {
+        Remesh();
+    }
+    Clock::time_point remeshDone = Clock::now();
+    sources.Tick(dt);
+    VelStep(dt);
+    Clock::time_point velDone = Clock::now();
+    DensStep(dt);
+    Clock::time_point densDone = Clock::now();
+    tickCount++;
+
+    lastTickTimings.remeshMs = std::chrono::duration<double, std::milli>(remeshDone - start).count();
+    lastTickTimings.velStepMs = std::chrono::duration<double, std::milli>(velDone - remeshDone).count();
+    lastTickTimings.densStepMs = std::chrono::duration<double, std::milli>(densDone - velDone).count();
+    lastTickTimings.totalMs = std::chrono::duration<double, std::milli>(densDone - start).count();
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::Reset()
+{
+    grid = QuadtreeGrid(N, minLevel);
+    size_t cellCount = grid.GetCellCount();
+    for (Field<Scalar>* field : { &u, &u_prev, &v, &v_prev, &dens, &dens_prev, &pressure, &divergence }) {
+        field->assign(cellCount, Scalar(0));
+    }
+    pressureSolver.SetGrid(grid);
+    ColorCells();
+    tickCount = 0;
+}
+
+template <typename Scalar>
+typename QuadtreeSimulator<Scalar>::Stencil QuadtreeSimulator<Scalar>::GetStencil(double x, double y) const
+{
+    const QuadtreeGrid::Cell& cell = grid.GetCells()[grid.Locate(x, y)];
+    double size = cell.size;
+    double centerX = cell.x + 0.5 * size;
+    double centerY = cell.y + 0.5 * size;
+
+    // The cell of the point and the cells one width away towards it, as if they were all of its size
+    int stepX = x >= centerX ? 1 : -1;
+    int stepY = y >= centerY ? 1 : -1;
+    double s1 = std::abs(x - centerX) / size;
+    double t1 = std::abs(y - centerY) / size;
+    double s0 = 1 - s1;
+    double t0 = 1 - t1;
+    const int offsets[4][2] = { { 0, 0 }, { stepX, 0 }, { 0, stepY }, { stepX, stepY } };
+    const double weights[4] = { s0 * t0, s1 * t0, s0 * t1, s1 * t1 };
+
+    Stencil stencil;
+    for (int k = 0; k < 4; k++) {
+        double sampleX = centerX + offsets[k][0] * size;
+        double sampleY = centerY + offsets[k][1] * size;
+        stencil.wallX[k] = sampleX < 0 || sampleX >= N;
+        stencil.wallY[k] = sampleY < 0 || sampleY >= N;
+        // Beyond a wall the cell at the wall stands in, as the boundary cells of FluidSimulator do
+        stencil.cell[k] = grid.Locate(sampleX, sampleY);
+        stencil.weight[k] = Scalar(weights[k]);
+    }
+    return stencil;
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::AddSource(Field<Scalar>& x, const SourceFootprint<Scalar>& s, double dT)
+{
+    int stride = GridStride(N);
+    int width = N;
+    const std::vector<Scalar>& values = s.GetValues();
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    for (const typename SourceFootprint<Scalar>::Span& span : s.GetSpans()) {
+        // Footprints are laid out on the grid of FluidSimulator, whose inner cell (i, j) is finest cell (i - 1, j - 1)
+        int finestY = span.start / stride - 1;
+        int firstX = span.start % stride - 1;
+        if (finestY < 0 || finestY >= width) {
+            continue;
+        }
+        // The run is added a cell at a time: every finest cell up to the right edge of a cell lands in it
+        int k = std::max(0, -firstX);
+        int end = std::min(span.length, width - firstX);
+        while (k < end) {
+            int c = grid.Locate(firstX + k, finestY);
+            const QuadtreeGrid::Cell& cell = cells[c];
+            int cellEnd = std::min(end, cell.x + cell.size - firstX);
+            double sum = 0.0;
+            for (; k < cellEnd; k++) {
+                sum += values[span.offset + k];
+            }
+            x[c] += Scalar(dT * sum / (double(cell.size) * cell.size));
+        }
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::ApplyDensitySources(double dT)
+{
+    for (const std::unique_ptr<DensitySource<Scalar>>& densSource : sources.GetDensitySources()) {
+        AddSource(dens, densSource->GetSource(), dT * densSource->GetStrength());
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::ApplyVelocitySources(double dT)
+{
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : sources.GetVelocitySources()) {
+        if (velSource->IsProcedural()) {
+            const ProceduralVelocitySource<Scalar>& procedural =
+                static_cast<const ProceduralVelocitySource<Scalar>&>(*velSource);
+            ForEachCell([&](int c) {
+                // The center of the cell in the coordinates of FluidSimulator, where inner cell i is centered on i
+                const QuadtreeGrid::Cell& cell = cells[c];
+                glm::dvec2 velocity = procedural.GetVelocity(cell.x + 0.5 * cell.size + 0.5,
+                    cell.y + 0.5 * cell.size + 0.5);
+                u[c] += Scalar(velocity.x * dT * procedural.GetStrength().x);
+                v[c] += Scalar(velocity.y * dT * procedural.GetStrength().y);
+            });
+            continue;
+        }
+        AddSource(u, velSource->GetHorizontalVelocitySource(), dT * velSource->GetStrength().x);
+        AddSource(v, velSource->GetVerticalVelocitySource(), dT * velSource->GetStrength().y);
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::ColorCells()
+{
+    const std::vector<QuadtreeGrid::Face>& faces = grid.GetFaces();
+    int cellCount = grid.GetCellCount();
+    std::vector<int> color(cellCount, -1);
+    std::vector<char> taken;
+    int colorCount = 0;
+    for (int c = 0; c < cellCount; c++) {
+        // The lowest color none of the neighbors colored so far has
+        taken.assign(colorCount + 1, 0);
+        for (const int* f = grid.CellFacesBegin(c); f != grid.CellFacesEnd(c); ++f) {
+            const QuadtreeGrid::Face& face = faces[*f];
+            int neighbor = face.lower == c ? face.upper : face.lower;
+            if (color[neighbor] >= 0) {
+                taken[color[neighbor]] = 1;
+            }
+        }
+        int k = 0;
+        while (taken[k]) {
+            k++;
+        }
+        color[c] = k;
+        colorCount = std::max(colorCount, k + 1);
+    }
+
+    // Group the cells by color, keeping the Z-order within each
+    colorStarts.assign(colorCount + 1, 0);
+    for (int c = 0; c < cellCount; c++) {
+        colorStarts[color[c] + 1]++;
+    }
+    for (int k = 0; k < colorCount; k++) {
+        colorStarts[k + 1] += colorStarts[k];
+    }
+    std::vector<int> next(colorStarts.begin(), colorStarts.end() - 1);
+    coloredCells.resize(cellCount);
+    for (int c = 0; c < cellCount; c++) {
+        coloredCells[next[color[c]]++] = c;
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::Diffuse(Field<Scalar>& x, const Field<Scalar>& x0, double diff, double dt)
+{
+    std::copy(x0.begin(), x0.end(), x.begin());
+    if (diff == 0) {
+        return;
+    }
+    // The flux diff * weight * (x(neighbor) - x(c)) through each face, spread over the area of the cell
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    const std::vector<QuadtreeGrid::Face>& faces = grid.GetFaces();
+    double coefficient = dt * diff * N * N;
+    int cellCount = grid.GetCellCount();
+
+    // The sweeps stop once the RMS residual is at most diffusionTolerance * RMS(x0), as in FluidSimulator
+    double threshold = 0.0;
+    if (diffusionTolerance > 0) {
+        double rhsSumSquared = 0.0;
+        for (int c = 0; c < cellCount; c++) {
+            rhsSumSquared += (double)x0[c] * x0[c];
+        }
+        threshold = diffusionTolerance * diffusionTolerance * rhsSumSquared;
+    }
+
+    // Every chunk of cells owns a slot for its squared residuals, so the sum does not depend on the thread count
+    const int chunkSize = 1024;
+    std::vector<double> chunkSums;
+    for (int sweep = 0; sweep < maxDiffusionIterations; sweep++) {
+        double sumSquaredResidual = 0.0;
+        for (size_t k = 0; k + 1 < colorStarts.size(); k++) {
+            int colorBegin = colorStarts[k];
+            int colorEnd = colorStarts[k + 1];
+            int chunks = (colorEnd - colorBegin + chunkSize - 1) / chunkSize;
+            chunkSums.assign(chunks, 0.0);
+            threadPool->ParallelFor(0, chunks, 1, [&](int chunkBegin, int chunkEnd) {
+                for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+                    double chunkSum = 0.0;
+                    int end = std::min(colorEnd, colorBegin + (chunk + 1) * chunkSize);
+                    for (int index = colorBegin + chunk * chunkSize; index < end; index++) {
+                        int c = coloredCells[index];
+                        double a = coefficient / (double(cells[c].size) * cells[c].size);
+                        double sum = x0[c];
+                        double diagonal = 1.0;
+                        for (const int* f = grid.CellFacesBegin(c); f != grid.CellFacesEnd(c); ++f) {
+                            const QuadtreeGrid::Face& face = faces[*f];
+                            int neighbor = face.lower == c ? face.upper : face.lower;
+                            sum += a * face.weight * x[neighbor];
+                            diagonal += a * face.weight;
+                        }
+                        double residual = sum - diagonal * x[c];
+                        chunkSum += residual * residual;
+                        x[c] = Scalar(sum / diagonal);
+                    }
+                    chunkSums[chunk] = chunkSum;
+                }
+            });
+            for (double chunkSum : chunkSums) {
+                sumSquaredResidual += chunkSum;
+            }
+        }
+        lastTickTimings.diffusionSweeps++;
+        if (diffusionTolerance > 0 && sumSquaredResidual <= threshold) {
+            break;
+        }
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::Advect(std::initializer_list<AdvectedField> fields, const Field<Scalar>& u,
+    const Field<Scalar>& v, double dt)
+{
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    double dt0 = dt * N;
+    ForEachCell([&](int c) {
+        const QuadtreeGrid::Cell& cell = cells[c];
+        double x = cell.x + 0.5 * cell.size - dt0 * u[c];
+        double y = cell.y + 0.5 * cell.size - dt0 * v[c];
+        x = std::clamp(x, 0.0, (double)N);
+        y = std::clamp(y, 0.0, (double)N);
+        // The stencil of the departure point, shared by every field
+        Stencil stencil = GetStencil(x, y);
+        for (const AdvectedField& field : fields) {
+            const Field<Scalar>& d0 = *field.d0;
+            Scalar value = 0;
+            for (int k = 0; k < 4; k++) {
+                bool mirrored = (field.b == BoundaryType::HORIZONTAL && stencil.wallX[k]) ||
+                    (field.b == BoundaryType::VERTICAL && stencil.wallY[k]);
+                Scalar sample = d0[stencil.cell[k]];
+                value += stencil.weight[k] * (mirrored ? -sample : sample);
+            }
+            (*field.d)[c] = value;
+        }
+    });
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::Project(Field<Scalar>& u, Field<Scalar>& v)
+{
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    const std::vector<QuadtreeGrid::Face>& faces = grid.GetFaces();
+
+    // Sums length * (value at the face - value of c) * outward normal over the faces of c, the value at a face
+    // interpolated between the two centers. At the walls the face value is that of c, so they add nothing.
+    auto FaceSums = [&](int c, const Field<Scalar>& x, const Field<Scalar>& y, double& sumX, double& sumY) {
+        sumX = 0.0;
+        sumY = 0.0;
+        for (const int* f = grid.CellFacesBegin(c); f != grid.CellFacesEnd(c); ++f) {
+            const QuadtreeGrid::Face& face = faces[*f];
+            bool lower = face.lower == c;
+            int neighbor = lower ? face.upper : face.lower;
+            double toFace = double(cells[c].size) / (cells[c].size + cells[neighbor].size);
+            double scale = (lower ? face.length : -face.length) * toFace;
+            if (face.axis == 0) {
+                sumX += scale * (x[neighbor] - x[c]);
+            }
+            else {
+                sumY += scale * (y[neighbor] - y[c]);
+            }
+        }
+    };
+
+    // The net outflow of every cell, in the scaling of FluidSimulator's -0.5 h (u(i + 1) - u(i - 1) + ...). No
+    // velocity crosses the walls, so only the faces between cells carry flux.
+    ForEachCell([&](int c) {
+        double outflow = 0.0;
+        for (const int* f = grid.CellFacesBegin(c); f != grid.CellFacesEnd(c); ++f) {
+            const QuadtreeGrid::Face& face = faces[*f];
+            bool lower = face.lower == c;
+            int neighbor = lower ? face.upper : face.lower;
+            double toFace = double(cells[c].size) / (cells[c].size + cells[neighbor].size);
+            const Field<Scalar>& x = face.axis == 0 ? u : v;
+            double faceValue = x[c] + toFace * (x[neighbor] - x[c]);
+            outflow += (lower ? face.length : -face.length) * faceValue;
+        }
+        divergence[c] = Scalar(-outflow / N);
+    });
+    pressureSolver.Solve(*threadPool, pressure, divergence);
+    lastPressureStats = pressureSolver.GetLastStats();
+
+    // Subtract the Green-Gauss gradient of the pressure, 0.5 N (p(i + 1) - p(i - 1)) on a uniform grid
+    ForEachCell([&](int c) {
+        double gradientX, gradientY;
+        FaceSums(c, pressure, pressure, gradientX, gradientY);
+        double scale = double(N) / (double(cells[c].size) * cells[c].size);
+        u[c] -= Scalar(scale * gradientX);
+        v[c] -= Scalar(scale * gradientY);
+    });
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::DensStep(double dt)
+{
+    ApplyDensitySources(dt);
+    dens.swap(dens_prev);
+    Diffuse(dens, dens_prev, diffusion, dt);
+    dens.swap(dens_prev);
+    Advect({ { BoundaryType::NONE, &dens, &dens_prev } }, u, v, dt);
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::VelStep(double dt)
+{
+    ApplyVelocitySources(dt);
+
+    u.swap(u_prev);
+    Diffuse(u, u_prev, viscosity, dt);
+    v.swap(v_prev);
+    Diffuse(v, v_prev, viscosity, dt);
+
+    Project(u, v);
+    u.swap(u_prev);
+    v.swap(v_prev);
+    // Both components are moved along the same backtrace
+    Advect({ { BoundaryType::HORIZONTAL, &u, &u_prev }, { BoundaryType::VERTICAL, &v, &v_prev } }, u_prev, v_prev,
+        dt);
+    Project(u, v);
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::MarkRow(int y, int xBegin, int xEnd, std::vector<int8_t>& atSource) const
+{
+    int width = N;
+    if (y < 0 || y >= width) {
+        return;
+    }
+    // One lookup per cell the row crosses, not per finest cell
+    int x = std::max(xBegin, 0);
+    xEnd = std::min(xEnd, width);
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    while (x < xEnd) {
+        int c = grid.Locate(x, y);
+        atSource[c] = 1;
+        x = cells[c].x + cells[c].size;
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::MarkSources(std::vector<int8_t>& atSource) const
+{
+    // Footprints are laid out on the grid of FluidSimulator, whose inner cell (i, j) is finest cell (i - 1, j - 1)
+    int stride = GridStride(N);
+    auto markFootprint = [&](const SourceFootprint<Scalar>& s) {
+        for (const typename SourceFootprint<Scalar>::Span& span : s.GetSpans()) {
+            int firstX = span.start % stride - 1;
+            MarkRow(span.start / stride - 1, firstX, firstX + span.length, atSource);
+        }
+    };
+
+    for (const std::unique_ptr<DensitySource<Scalar>>& densSource : sources.GetDensitySources()) {
+        if (densSource->GetStrength() != 0.0) {
+            markFootprint(densSource->GetSource());
+        }
+    }
+    for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : sources.GetVelocitySources()) {
+        if (velSource->GetStrength() == glm::dvec2(0.0)) {
+            continue;
+        }
+        if (velSource->IsProcedural()) {
+            // Sources without bounds, such as gravity, act everywhere alike and add no detail of their own
+            const ProceduralVelocitySource<Scalar>& procedural =
+                static_cast<const ProceduralVelocitySource<Scalar>&>(*velSource);
+            int iBegin, iEnd, jBegin, jEnd;
+            if (procedural.GetBounds(iBegin, iEnd, jBegin, jEnd)) {
+                for (int j = jBegin; j < jEnd; j++) {
+                    MarkRow(j - 1, iBegin - 1, iEnd - 1, atSource);
+                }
+            }
+            continue;
+        }
+        markFootprint(velSource->GetHorizontalVelocitySource());
+        markFootprint(velSource->GetVerticalVelocitySource());
+    }
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::Remesh()
+{
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    const std::vector<QuadtreeGrid::Face>& faces = grid.GetFaces();
+    std::vector<int8_t> change(cells.size(), 0);
+    std::vector<double> excess(cells.size(), 0.0);
+    std::vector<int8_t> atSource(cells.size(), 0);
+    MarkSources(atSource);
+    ForEachCell([&](int c) {
+        // The cells a source adds to are refined down to maxLevel, past the budget if need be
+        if (atSource[c]) {
+            change[c] = 1;
+            excess[c] = std::numeric_limits<double>::infinity();
+            return;
+        }
+        // Green-Gauss differences over the faces, as in Project: the change of the density and the vorticity times
+        // the width of the cell are what the cell fails to resolve
+        double densityX = 0.0, densityY = 0.0, curl = 0.0;
+        for (const int* f = grid.CellFacesBegin(c); f != grid.CellFacesEnd(c); ++f) {
+            const QuadtreeGrid::Face& face = faces[*f];
+            bool lower = face.lower == c;
+            int neighbor = lower ? face.upper : face.lower;
+            double toFace = double(cells[c].size) / (cells[c].size + cells[neighbor].size);
+            double scale = (lower ? face.length : -face.length) * toFace;
+            if (face.axis == 0) {
+                densityX += scale * (dens[neighbor] - dens[c]);
+                curl += scale * (v[neighbor] - v[c]);
+            }
+            else {
+                densityY += scale * (dens[neighbor] - dens[c]);
+                curl -= scale * (u[neighbor] - u[c]);
+            }
+        }
+        double size = cells[c].size;
+        double densityChange = std::sqrt(densityX * densityX + densityY * densityY) / size;
+        double velocityChange = std::abs(curl) / size;
+        excess[c] = std::max(densityChange / densityThreshold, velocityChange / vorticityThreshold);
+        if (excess[c] > 1.0) {
+            change[c] = 1;
+        }
+        else if (excess[c] < 0.25) {
+            change[c] = -1;
+        }
+    });
+
+    // Each split adds three cells. Past the budget only the cells exceeding their thresholds the most are split,
+    // leaving the balancing splits out of the count.
+    std::vector<double> splitExcess;
+    for (size_t c = 0; c < cells.size(); c++) {
+        if (change[c] > 0 && cells[c].level < maxLevel) {
+            splitExcess.push_back(excess[c]);
+        }
+    }
+    size_t allowed = (size_t)std::max(cellBudget - (int)cells.size(), 0) / 3;
+    if (splitExcess.size() > allowed) {
+        double cutoff = std::numeric_limits<double>::infinity();
+        if (allowed > 0) {
+            std::nth_element(splitExcess.begin(), splitExcess.begin() + (allowed - 1), splitExcess.end(),
+                std::greater<double>());
+            cutoff = splitExcess[allowed - 1];
+        }
+        for (size_t c = 0; c < cells.size(); c++) {
+            if (change[c] > 0 && excess[c] < cutoff) {
+                change[c] = 0;
+            }
+        }
+    }
+
+    if (!grid.Adapt(change, minLevel, maxLevel)) {
+        return;
+    }
+    for (Field<Scalar>* field : { &u, &u_prev, &v, &v_prev, &dens, &dens_prev, &pressure, &divergence }) {
+        grid.Transfer(*field);
+    }
+    pressureSolver.SetGrid(grid);
+    ColorCells();
+}
+
+template <typename Scalar>
+std::vector<std::string> QuadtreeSimulator<Scalar>::GetSceneNames() const
+{
+    std::vector<std::string> sceneNames;
+    for (const auto& scene : scenes) {
+        sceneNames.push_back(scene.first);
+    }
+    return sceneNames;
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::ActivateSceneByName(const std::string& sceneName)
+{
+    auto scene = scenes.find(sceneName);
+    if (scene == scenes.end()) {
+        return;
+    }
+    Reset();
+    sources = scene->second.GetSources();
+    activeSceneName = sceneName;
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetRemeshInterval(int ticks)
+{
+    remeshInterval = std::max(ticks, 1);
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetRefinementThresholds(double vorticity, double density)
+{
+    vorticityThreshold = vorticity;
+    densityThreshold = density;
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetCellBudget(int cells)
+{
+    cellBudget = std::max(cells, 1);
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetThreadCount(unsigned int threadCount)
+{
+    threadPool = std::make_unique<ThreadPool>(threadCount);
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetPressureTolerance(double relativeTolerance)
+{
+    pressureSolver.SetTolerance(relativeTolerance);
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetDiffusionTolerance(double relativeTolerance)
+{
+    diffusionTolerance = relativeTolerance;
+}
+
+template <typename Scalar>
+void QuadtreeSimulator<Scalar>::SetMaxDiffusionIterations(int iterations)
+{
+    maxDiffusionIterations = iterations;
+}
+
+template <typename Scalar>
+const QuadtreeGrid& QuadtreeSimulator<Scalar>::GetGrid() const
+{
+    return grid;
+}
+
+template <typename Scalar>
+const Field<Scalar>& QuadtreeSimulator<Scalar>::GetU() const
+{
+    return u;
+}
+
+template <typename Scalar>
+const Field<Scalar>& QuadtreeSimulator<Scalar>::GetV() const
+{
+    return v;
+}
+
+template <typename Scalar>
+const Field<Scalar>& QuadtreeSimulator<Scalar>::GetDens() const
+{
+    return dens;
+}
+
+template <typename Scalar>
+double QuadtreeSimulator<Scalar>::GetTotalDensity() const
+{
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    double sum = 0.0;
+    for (size_t c = 0; c < cells.size(); c++) {
+        sum += dens[c] * (double(cells[c].size) * cells[c].size);
+    }
+    return sum;
+}
+
+template <typename Scalar>
+double QuadtreeSimulator<Scalar>::GetRmsDivergence() const
+{
+    // The mean divergence of every cell in grid units, 0.5 (u(i + 1) - u(i - 1) + ...) on a uniform grid, weighted
+    // by the finest cells it covers
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    const std::vector<QuadtreeGrid::Face>& faces = grid.GetFaces();
+    std::vector<double> outflow(cells.size(), 0.0);
+    for (const QuadtreeGrid::Face& face : faces) {
+        const Field<Scalar>& x = face.axis == 0 ? u : v;
+        double sizeLower = cells[face.lower].size;
+        double sizeUpper = cells[face.upper].size;
+        double faceValue = (x[face.lower] * sizeUpper + x[face.upper] * sizeLower) / (sizeLower + sizeUpper);
+        outflow[face.lower] += face.length * faceValue;
+        outflow[face.upper] -= face.length * faceValue;
+    }
+    double sumSquared = 0.0;
+    for (size_t c = 0; c < cells.size(); c++) {
+        double area = double(cells[c].size) * cells[c].size;
+        double divergence = outflow[c] / area;
+        sumSquared += area * divergence * divergence;
+    }
+    return std::sqrt(sumSquared / (double(N) * N));
+}
+
+template <typename Scalar>
+const QuadtreeTickTimings& QuadtreeSimulator<Scalar>::GetLastTickTimings() const
+{
+    return lastTickTimings;
+}
+
+template <typename Scalar>
+const SolveStats& QuadtreeSimulator<Scalar>::GetLastPressureStats() const
+{
+    return lastPressureStats;
+}
+
+template <typename Scalar>
+unsigned int QuadtreeSimulator<Scalar>::GetThreadCount() const
+{
+    return threadPool->GetThreadCount();
+}
+
+template class QuadtreeSimulator<float>;
+template class QuadtreeSimulator<double>;
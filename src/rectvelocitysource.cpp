@@ -1,21 +1,42 @@
 #include "rectvelocitysource.h"
 
-RectVelocitySource::RectVelocitySource(unsigned int N, int width, int height, int x, int y, double uVel, double vVel)
+template <typename Scalar>
+RectVelocitySource<Scalar>::RectVelocitySource(unsigned int N, unsigned int M, int width, int height, int x, int y,
+    double uVel, double vVel)
     :
-    VelocitySource(N, uVel, vVel),
+    VelocitySource<Scalar>(N, M, uVel, vVel),
     width(std::min(std::max(width, 0), (int)N)),
-    height(std::min(std::max(height, 0), (int)N)),
+    height(std::min(std::max(height, 0), (int)M)),
     position(
         glm::ivec2(
             std::min(std::max(x, 0), (int)N),
-            std::min(std::max(y, 0), (int)N)
+            std::min(std::max(y, 0), (int)M)
         )
     )
 {
-    for (int i = position.x; i < N && i < position.x + width; ++i) {
-        for (int j = position.y; j < N && j < position.y + height; ++j) {
-            u[IX(i, j)] = uVel; 
-            v[IX(i, j)] = vVel; 
-        }
+    this->u = std::make_shared<const SourceFootprint<Scalar>>(Rasterize(N, M, width, height, x, y, Scalar(uVel)));
+    this->v = std::make_shared<const SourceFootprint<Scalar>>(Rasterize(N, M, width, height, x, y, Scalar(vVel)));
+}
+
+template <typename Scalar>
+SourceFootprint<Scalar> RectVelocitySource<Scalar>::Rasterize(unsigned int N, unsigned int M, int width, int height,
+    int x, int y, Scalar value)
+{
+    int iBegin = std::min(std::max(x, 0), (int)N);
+    int jBegin = std::min(std::max(y, 0), (int)M);
+    int iEnd = std::min((int)N, iBegin + width);
+    SourceFootprint<Scalar> footprint;
+    for (int j = jBegin; j < (int)M && j < jBegin + height; ++j) {
+        footprint.AddRun(N, iBegin, iEnd, j, value);
     }
+    return footprint;
 }
+
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> RectVelocitySource<Scalar>::Clone() const
+{
+    return std::make_unique<RectVelocitySource<Scalar>>(*this);
+}
+
+template class RectVelocitySource<float>;
+template class RectVelocitySource<double>;
@@ -0,0 +1,20 @@
+#include "scenes/collidingjetsscene.h"
+#include "spheresource.h"
+
+template <typename Scalar>
+CollidingJetsScene<Scalar>::CollidingJetsScene(unsigned int N, const std::string& name) :
+	Scene3D<Scalar>(N, name)
+{
+	double radius = N / 20.0;
+
+	// Jet 1: near the left face, blowing towards the right
+	this->sources.AddSource(std::make_unique<SphereSource<Scalar>>(N, glm::ivec3(N / 5, N / 2, N / 2), radius, 2.5,
+		glm::dvec3(0.3, 0.0, 0.0)));
+
+	// Jet 2: near the right face, slightly offset along z so the sheet where they meet turns, blowing to the left
+	this->sources.AddSource(std::make_unique<SphereSource<Scalar>>(N, glm::ivec3(4 * N / 5, N / 2, N / 2 + N / 20),
+		radius, 2.5, glm::dvec3(-0.3, 0.0, 0.0)));
+}
+
+template class CollidingJetsScene<float>;
+template class CollidingJetsScene<double>;
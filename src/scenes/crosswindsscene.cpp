@@ -2,20 +2,24 @@
 #include "circularsource.h"
 #include "rectvelocitysource.h"
 
-CrosswindsScene::CrosswindsScene(unsigned int N, const std::string& name):
-	Scene(N, name)
+template <typename Scalar>
+CrosswindsScene<Scalar>::CrosswindsScene(unsigned int N, unsigned int M, const std::string& name):
+	Scene<Scalar>(N, M, name)
 {
 	// Add two circular density sources at opposite sides of the grid
 	// Source 1: Positioned near the left edge
-	densSources.push_back(CircularSource(N, N / 4, N / 2, 5, 100));
+	this->sources.AddDensitySource(std::make_unique<CircularSource<Scalar>>(N, M, N / 4, M / 2, 5, 100));
 
 	// Source 2: Positioned near the right edge
-	densSources.push_back(CircularSource(N, 3 * N / 4, N / 2, 5, 100));
+	this->sources.AddDensitySource(std::make_unique<CircularSource<Scalar>>(N, M, 3 * N / 4, M / 2, 5, 100));
 
 	// Add two rectangular velocity sources to direct the smoke
 	// Velocity Source 1: Pushes smoke from the left source to the right
-	velSources.push_back(RectVelocitySource(N, 20, 20, N / 4 - 10, N / 2 - 10, 0.1, 0));
+	this->sources.AddVelocitySource(std::make_unique<RectVelocitySource<Scalar>>(N, M, 20, 20, N / 4 - 10, M / 2 - 10, 0.1, 0));
 
 	// Velocity Source 2: Pushes smoke from the right source to the left
-	velSources.push_back(RectVelocitySource(N, 20, 20, 3 * N / 4 - 10, N / 2 - 10, -0.1, 0));
+	this->sources.AddVelocitySource(std::make_unique<RectVelocitySource<Scalar>>(N, M, 20, 20, 3 * N / 4 - 10, M / 2 - 10, -0.1, 0));
 }
+
+template class CrosswindsScene<float>;
+template class CrosswindsScene<double>;
@@ -0,0 +1,37 @@
+#include "scenes/lighthousescene.h"
+#include "animatedsource.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename Scalar>
+LighthouseScene<Scalar>::LighthouseScene(unsigned int N, unsigned int M, const std::string& name) :
+	Scene<Scalar>(N, M, name)
+{
+	// Sizes follow the shorter side, so the orbit stays inside a rectangular grid
+	unsigned int side = std::min(N, M);
+	glm::dvec2 center((N + 2) * 0.5, (M + 2) * 0.5);
+	double orbit = side * 0.25;
+	double period = 8.0;
+
+	// A density source circling the center once per period, pulsing twice per lap
+	Keyframes<glm::dvec2> path({}, true);
+	for (int k = 0; k <= 16; ++k) {
+		double t = period * k / 16;
+		double a = 2.0 * glm::pi<double>() * k / 16;
+		path.AddKey(t, center + orbit * glm::dvec2(std::cos(a), std::sin(a)));
+	}
+	Keyframes<double> amount({ { 0.0, 20.0 }, { period * 0.25, 80.0 }, { period * 0.5, 20.0 } }, true);
+	this->sources.AddDensitySource(std::make_unique<AnimatedCircularSource<Scalar>>(N, M, path,
+		Keyframes<double>(side / 40.0), amount));
+
+	// A beam from the center of the grid sweeping around in the opposite direction
+	int size = std::max(1, (int)side / 20);
+	Keyframes<glm::dvec2> position(center - size * 0.5);
+	Keyframes<double> angle({ { 0.0, 0.0 }, { period, -2.0 * glm::pi<double>() } }, true);
+	this->sources.AddVelocitySource(std::make_unique<AnimatedRectVelocitySource<Scalar>>(N, M, size, size, position,
+		Keyframes<double>(0.25), angle));
+}
+
+template class LighthouseScene<float>;
+template class LighthouseScene<double>;
@@ -1,20 +1,21 @@
 #include "scenes/scene.h"
 
-Scene::Scene(unsigned int N, const std::string& name):
-	N(N), name(name)
+template <typename Scalar>
+Scene<Scalar>::Scene(unsigned int N, unsigned int M, const std::string& name):
+	N(N), M(M), name(name)
 {}
 
-const std::string& Scene::GetName() const
+template <typename Scalar>
+const std::string& Scene<Scalar>::GetName() const
 {
 	return name;
 }
 
-const std::vector<DensitySource>& Scene::GetDensSources() const
+template <typename Scalar>
+const SourceRegistry<Scalar>& Scene<Scalar>::GetSources() const
 {
-	return densSources; 
+	return sources; 
 }
 
-const std::vector<VelocitySource>& Scene::GetVelocitySources() const
-{
-	return velSources; 
-}
+template class Scene<float>;
+template class Scene<double>;
@@ -0,0 +1,21 @@
+#include "scenes/scene3d.h"
+
+template <typename Scalar>
+Scene3D<Scalar>::Scene3D(unsigned int N, const std::string& name):
+	N(N), name(name)
+{}
+
+template <typename Scalar>
+const std::string& Scene3D<Scalar>::GetName() const
+{
+	return name;
+}
+
+template <typename Scalar>
+const VolumeSourceRegistry<Scalar>& Scene3D<Scalar>::GetSources() const
+{
+	return sources;
+}
+
+template class Scene3D<float>;
+template class Scene3D<double>;
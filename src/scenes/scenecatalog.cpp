@@ -0,0 +1,32 @@
+#include "scenes/scenecatalog.h"
+#include "scenes/crosswindsscene.h"
+#include "scenes/lighthousescene.h"
+#include "scenes/whirlwindscene.h"
+#include "scenes/waterfountainscene.h"
+
+template <typename Scalar>
+std::map<std::string, Scene<Scalar>> CreateScenes(unsigned int N, unsigned int M)
+{
+	std::map<std::string, Scene<Scalar>> scenes;
+
+	// Create two empty scenes and add them to the scene selector to test scene selection functionarlity
+	std::string emptySceneName1("Empty Scene");
+	scenes[emptySceneName1] = Scene<Scalar>(N, M, emptySceneName1);
+
+	std::string crosswindSceneName("Crosswind Scene");
+	scenes[crosswindSceneName] = CrosswindsScene<Scalar>(N, M, crosswindSceneName);
+
+	std::string whirlwindSceneName("Whirlwind Scene"); 
+	scenes[whirlwindSceneName] = WhirlwindScene<Scalar>(N, M, whirlwindSceneName);
+
+	std::string waterFountainScene("Water Fountain Scene");
+	scenes[waterFountainScene] = WaterFountainScene<Scalar>(N, M, waterFountainScene);
+
+	std::string lighthouseSceneName("Lighthouse Scene");
+	scenes[lighthouseSceneName] = LighthouseScene<Scalar>(N, M, lighthouseSceneName);
+
+	return scenes;
+}
+
+template std::map<std::string, Scene<float>> CreateScenes<float>(unsigned int N, unsigned int M);
+template std::map<std::string, Scene<double>> CreateScenes<double>(unsigned int N, unsigned int M);
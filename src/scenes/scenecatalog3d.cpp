@@ -0,0 +1,23 @@
+#include "scenes/scenecatalog3d.h"
+#include "scenes/collidingjetsscene.h"
+#include "scenes/smokecolumnscene.h"
+
+template <typename Scalar>
+std::map<std::string, Scene3D<Scalar>> CreateScenes3D(unsigned int N)
+{
+	std::map<std::string, Scene3D<Scalar>> scenes;
+
+	std::string emptySceneName("Empty Scene");
+	scenes[emptySceneName] = Scene3D<Scalar>(N, emptySceneName);
+
+	std::string smokeColumnSceneName("Smoke Column Scene");
+	scenes[smokeColumnSceneName] = SmokeColumnScene<Scalar>(N, smokeColumnSceneName);
+
+	std::string collidingJetsSceneName("Colliding Jets Scene");
+	scenes[collidingJetsSceneName] = CollidingJetsScene<Scalar>(N, collidingJetsSceneName);
+
+	return scenes;
+}
+
+template std::map<std::string, Scene3D<float>> CreateScenes3D<float>(unsigned int N);
+template std::map<std::string, Scene3D<double>> CreateScenes3D<double>(unsigned int N);
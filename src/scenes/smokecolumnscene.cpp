@@ -0,0 +1,27 @@
+#include "scenes/smokecolumnscene.h"
+#include "boxsource.h"
+#include "spheresource.h"
+
+#include <algorithm>
+
+template <typename Scalar>
+SmokeColumnScene<Scalar>::SmokeColumnScene(unsigned int N, const std::string& name) :
+	Scene3D<Scalar>(N, name)
+{
+	// A ball of smoke centered above the floor, with a radius proportional to N
+	glm::ivec3 center(N / 2, N / 6, N / 2);
+	double radius = N / 16.0;
+	this->sources.AddSource(std::make_unique<SphereSource<Scalar>>(N, center, radius, 2.5));
+
+	// A box just above the ball that pushes the smoke upward
+	int width = std::max(1, (int)N / 8);
+	this->sources.AddSource(std::make_unique<BoxSource<Scalar>>(N, center - glm::ivec3(width / 2, 0, width / 2),
+		glm::ivec3(width, width, width), 0.0, glm::dvec3(0.0, 0.25, 0.0)));
+
+	// A slab of wind across the upper half of the volume that bends the column along x
+	this->sources.AddSource(std::make_unique<BoxSource<Scalar>>(N, glm::ivec3(1, N / 2, 1),
+		glm::ivec3(N / 8, N / 4, N), 0.0, glm::dvec3(0.05, 0.0, 0.0)));
+}
+
+template class SmokeColumnScene<float>;
+template class SmokeColumnScene<double>;
@@ -1,19 +1,30 @@
 #include "scenes/waterfountainscene.h"
 #include "circularsource.h"
 #include "rectvelocitysource.h"
+#include "proceduralvelocitysource.h"
 
-WaterFountainScene::WaterFountainScene(unsigned int N, const std::string& name) :
-    Scene(N, name)
+#include <algorithm>
+
+template <typename Scalar>
+WaterFountainScene<Scalar>::WaterFountainScene(unsigned int N, unsigned int M, const std::string& name) :
+    Scene<Scalar>(N, M, name)
 {
+    // Sizes follow the shorter side of the grid
+    unsigned int side = std::min(N, M);
+
     // Add a single density source to simulate the water particles
     // Positioned at the center of the bottom of the grid, with radius and intensity proportional to N
-    densSources.push_back(CircularSource(N, N * 0.5, N * 0.7, N / 40.0, 50));
+    this->sources.AddDensitySource(std::make_unique<CircularSource<Scalar>>(N, M, N * 0.5, M * 0.7, side / 40.0, 50));
 
     // Add a velocity source that pushes particles upward, simulating the fountain effect
     // Positioned just above the density source, with a strong upward velocity proportional to N
-    velSources.push_back(RectVelocitySource(N, N / 10, N / 10, N * 0.5 - N / 20, N * 0.7 - N / 20, 0.0, 0.25));
+    this->sources.AddVelocitySource(std::make_unique<RectVelocitySource<Scalar>>(N, M, side / 10, side / 10,
+        N * 0.5 - side / 20, M * 0.7 - side / 20, 0.0, 0.25));
 
     // Add gravity to pull particles downward
     // Gravity source: A constant downward force on the particles, with a magnitude relative to N
-    velSources.push_back(RectVelocitySource(N, N, N, 0, 0, 0.0, -0.05));
+    this->sources.AddVelocitySource(std::make_unique<BodyForceSource<Scalar>>(N, M, 0.0, -0.05));
 }
+
+template class WaterFountainScene<float>;
+template class WaterFountainScene<double>;
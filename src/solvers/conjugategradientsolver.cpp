@@ -0,0 +1,197 @@
+#include "solvers/conjugategradientsolver.h"
+
+#include <cmath>
+
+namespace {
+
+// MIC(0) parameters from Bridson's "Fluid Simulation for Computer Graphics": blend 97% of the dropped fill-in back
+// into the diagonal, and fall back to the plain diagonal when a pivot gets too small
+constexpr double MIC_TUNING = 0.97;
+constexpr double MIC_SAFETY = 0.25;
+
+}
+
+template <typename Scalar>
+ConjugateGradientSolver<Scalar>::ConjugateGradientSolver(unsigned int N, unsigned int M,
+    PreconditionerType preconditioner) :
+    PressureSolver<Scalar>(N, M, 1.0e-4, 200), preconditionerType(preconditioner),
+    residual(GridSize(N, M), Scalar(0)), z(GridSize(N, M), Scalar(0)), direction(GridSize(N, M), Scalar(0)),
+    product(GridSize(N, M), Scalar(0)), inversePivot()
+{
+    CouplingsChanged();
+}
+
+template <typename Scalar>
+void ConjugateGradientSolver<Scalar>::CouplingsChanged()
+{
+    if (preconditionerType == PreconditionerType::MIC0) {
+        BuildPreconditioner();
+    }
+}
+
+template <typename Scalar>
+void ConjugateGradientSolver<Scalar>::BuildPreconditioner()
+{
+    int N = this->N;
+    int M = this->M;
+    const Field<Scalar>& east = this->eastWeight;
+    const Field<Scalar>& north = this->northWeight;
+    inversePivot.assign(GridSize(N, M), Scalar(0));
+    for (int j = 1; j <= M; j++) {
+        for (int i = 1; i <= N; i++) {
+            if (this->inverseDiagonal[IX(i, j)] == 0) {
+                continue;
+            }
+            // The off-diagonal entries of A are -weight, the pivots of the west and south neighbors are already known
+            double diagonal = 1.0 / this->inverseDiagonal[IX(i, j)];
+            double west = east[IX(i - 1, j)] * inversePivot[IX(i - 1, j)];
+            double south = north[IX(i, j - 1)] * inversePivot[IX(i, j - 1)];
+            double pivot = diagonal - west * west - south * south - MIC_TUNING * (
+                east[IX(i - 1, j)] * north[IX(i - 1, j)] * inversePivot[IX(i - 1, j)] * inversePivot[IX(i - 1, j)] +
+                north[IX(i, j - 1)] * east[IX(i, j - 1)] * inversePivot[IX(i, j - 1)] * inversePivot[IX(i, j - 1)]);
+            if (pivot < MIC_SAFETY * diagonal) {
+                pivot = diagonal;
+            }
+            inversePivot[IX(i, j)] = Scalar(1.0 / std::sqrt(pivot));
+        }
+    }
+}
+
+template <typename Scalar>
+void ConjugateGradientSolver<Scalar>::Precondition(ThreadPool& threadPool)
+{
+    int N = this->N;
+    int M = this->M;
+    int stride = GridStride(N);
+    const Field<Scalar>& eastWeight = this->eastWeight;
+    const Field<Scalar>& northWeight = this->northWeight;
+    const Field<Scalar>& inverseDiagonal = this->inverseDiagonal;
+
+    switch (preconditionerType) {
+    case PreconditionerType::JACOBI:
+        this->ForEachRow(threadPool, N, M, [&](int j) {
+            const Scalar* r = &residual[stride * j];
+            const Scalar* inverseDiagonalRow = &inverseDiagonal[stride * j];
+            Scalar* zRow = &z[stride * j];
+            for (int i = 1; i <= N; i++) {
+                zRow[i] = r[i] * inverseDiagonalRow[i];
+            }
+        });
+        break;
+
+    case PreconditionerType::INCOMPLETE_POISSON:
+        // z = K K^T r with K = I - L D^-1, L the strict lower triangle of A. Both products are plain stencils, so
+        // every row is independent.
+        this->ForEachRow(threadPool, N, M, [&](int j) {
+            const Scalar* r = &residual[stride * j];
+            const Scalar* east = &eastWeight[stride * j];
+            const Scalar* north = &northWeight[stride * j];
+            const Scalar* inverseDiagonalRow = &inverseDiagonal[stride * j];
+            Scalar* t = &product[stride * j];
+            for (int i = 1; i <= N; i++) {
+                t[i] = r[i] + (east[i] * r[i + 1] + north[i] * r[i + stride]) * inverseDiagonalRow[i];
+            }
+        });
+        this->ForEachRow(threadPool, N, M, [&](int j) {
+            const Scalar* t = &product[stride * j];
+            const Scalar* east = &eastWeight[stride * j];
+            const Scalar* north = &northWeight[stride * j];
+            const Scalar* inverseDiagonalRow = &inverseDiagonal[stride * j];
+            Scalar* zRow = &z[stride * j];
+            for (int i = 1; i <= N; i++) {
+                zRow[i] = inverseDiagonalRow[i] != 0 ? t[i] + east[i - 1] * t[i - 1] * inverseDiagonalRow[i - 1] +
+                    north[i - stride] * t[i - stride] * inverseDiagonalRow[i - stride] : Scalar(0);
+            }
+        });
+        break;
+
+    case PreconditionerType::MIC0:
+        // Forward substitution with (F + E) E^-1, then backward substitution with its transpose. Each cell depends on
+        // the one just before it, so these run serially.
+        for (int j = 1; j <= M; j++) {
+            for (int i = 1; i <= N; i++) {
+                int cell = IX(i, j);
+                Scalar t = residual[cell] + eastWeight[cell - 1] * inversePivot[cell - 1] * product[cell - 1] +
+                    northWeight[cell - stride] * inversePivot[cell - stride] * product[cell - stride];
+                product[cell] = t * inversePivot[cell];
+            }
+        }
+        for (int j = M; j >= 1; j--) {
+            for (int i = N; i >= 1; i--) {
+                int cell = IX(i, j);
+                Scalar t = product[cell] + (eastWeight[cell] * z[cell + 1] +
+                    northWeight[cell] * z[cell + stride]) * inversePivot[cell];
+                z[cell] = t * inversePivot[cell];
+            }
+        }
+        break;
+    }
+}
+
+template <typename Scalar>
+int ConjugateGradientSolver<Scalar>::Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    int N = this->N;
+    int M = this->M;
+    int stride = GridStride(N);
+    double cells = (double)N * M;
+
+    double residualNorm = this->InitializeResidual(threadPool, rhs, residual);
+    double threshold = this->tolerance * this->lastStats.rhsNorm;
+    int iterations = 0;
+    if (residualNorm > threshold && this->maxIterations > 0) {
+        Precondition(threadPool);
+        std::copy(z.begin(), z.end(), direction.begin());
+        double residualDotZ = this->Dot(threadPool, residual, z);
+        while (iterations < this->maxIterations) {
+            this->ApplyOperator(threadPool, direction, product);
+            double curvature = this->Dot(threadPool, direction, product);
+            if (!(curvature > 0.0)) {
+                break;
+            }
+            Scalar alpha = Scalar(residualDotZ / curvature);
+            this->ForEachRow(threadPool, N, M, [&](int j) {
+                const Scalar* d = &direction[stride * j];
+                const Scalar* Ad = &product[stride * j];
+                Scalar* x = &this->solution[stride * j];
+                Scalar* r = &residual[stride * j];
+                for (int i = 1; i <= N; i++) {
+                    x[i] += alpha * d[i];
+                    r[i] -= alpha * Ad[i];
+                }
+            });
+            iterations++;
+
+            residualNorm = std::sqrt(this->Dot(threadPool, residual, residual) / cells);
+            if (residualNorm <= threshold || iterations == this->maxIterations) {
+                break;
+            }
+
+            Precondition(threadPool);
+            double nextResidualDotZ = this->Dot(threadPool, residual, z);
+            Scalar beta = Scalar(nextResidualDotZ / residualDotZ);
+            residualDotZ = nextResidualDotZ;
+            this->ForEachRow(threadPool, N, M, [&](int j) {
+                const Scalar* zRow = &z[stride * j];
+                Scalar* d = &direction[stride * j];
+                for (int i = 1; i <= N; i++) {
+                    d[i] = zRow[i] + beta * d[i];
+                }
+            });
+        }
+    }
+    this->lastStats.iterations = iterations;
+    this->lastStats.finalResidual = residualNorm;
+
+    this->StorePressure(p);
+    return iterations;
+}
+
+template <typename Scalar>
+PreconditionerType ConjugateGradientSolver<Scalar>::GetPreconditioner() const
+{
+    return preconditionerType;
+}
+
+template class ConjugateGradientSolver<float>;
+template class ConjugateGradientSolver<double>;
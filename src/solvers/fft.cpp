@@ -0,0 +1,174 @@
+#include "solvers/fft.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+bool IsPowerOfTwo(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+}
+
+Fft::Fft(int n) :
+    n(n), radix2Size(n), bitReversed(), twiddles(), chirp(), chirpSpectrum()
+{
+    if (!IsPowerOfTwo(n)) {
+        // Bluestein: X[k] = chirp[k] * sum of (x[j] chirp[j]) conj(chirp[k - j]), a convolution long enough not to
+        // wrap around, padded to a power of two
+        radix2Size = 1;
+        while (radix2Size < 2 * n - 1) {
+            radix2Size *= 2;
+        }
+    }
+
+    int bits = 0;
+    while ((1 << bits) < radix2Size) {
+        bits++;
+    }
+    bitReversed.resize(radix2Size);
+    for (int index = 0; index < radix2Size; index++) {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            reversed |= ((index >> bit) & 1) << (bits - 1 - bit);
+        }
+        bitReversed[index] = reversed;
+    }
+    twiddles.resize(radix2Size / 2);
+    for (int k = 0; k < radix2Size / 2; k++) {
+        twiddles[k] = std::polar(1.0, -2.0 * PI * k / radix2Size);
+    }
+
+    if (radix2Size != n) {
+        chirp.resize(n);
+        for (int k = 0; k < n; k++) {
+            // k^2 mod 2n keeps the angle small, so large k do not lose precision
+            long long square = (long long)k * k % (2LL * n);
+            chirp[k] = std::polar(1.0, -PI * square / n);
+        }
+        chirpSpectrum.assign(radix2Size, Complex(0.0));
+        chirpSpectrum[0] = std::conj(chirp[0]);
+        for (int k = 1; k < n; k++) {
+            chirpSpectrum[k] = std::conj(chirp[k]);
+            chirpSpectrum[radix2Size - k] = std::conj(chirp[k]);
+        }
+        Radix2(chirpSpectrum.data());
+    }
+}
+
+int Fft::Size() const
+{
+    return n;
+}
+
+size_t Fft::ScratchSize() const
+{
+    return radix2Size == n ? 0 : radix2Size;
+}
+
+void Fft::Radix2(Complex* data) const
+{
+    for (int index = 0; index < radix2Size; index++) {
+        if (index < bitReversed[index]) {
+            std::swap(data[index], data[bitReversed[index]]);
+        }
+    }
+    for (int half = 1; half < radix2Size; half *= 2) {
+        int twiddleStep = radix2Size / (2 * half);
+        for (int block = 0; block < radix2Size; block += 2 * half) {
+            for (int k = 0; k < half; k++) {
+                Complex odd = data[block + half + k] * twiddles[k * twiddleStep];
+                data[block + half + k] = data[block + k] - odd;
+                data[block + k] += odd;
+            }
+        }
+    }
+}
+
+void Fft::Forward(std::complex<double>* data, std::complex<double>* scratch) const
+{
+    if (radix2Size == n) {
+        Radix2(data);
+        return;
+    }
+
+    std::fill(scratch, scratch + radix2Size, Complex(0.0));
+    for (int k = 0; k < n; k++) {
+        scratch[k] = data[k] * chirp[k];
+    }
+    Radix2(scratch);
+    for (int k = 0; k < radix2Size; k++) {
+        // Inverse transform by conjugation: ifft(a) = conj(fft(conj(a))) / size
+        scratch[k] = std::conj(scratch[k] * chirpSpectrum[k]);
+    }
+    Radix2(scratch);
+    double scale = 1.0 / radix2Size;
+    for (int k = 0; k < n; k++) {
+        data[k] = std::conj(scratch[k]) * scale * chirp[k];
+    }
+}
+
+void Fft::Inverse(std::complex<double>* data, std::complex<double>* scratch) const
+{
+    for (int k = 0; k < n; k++) {
+        data[k] = std::conj(data[k]);
+    }
+    Forward(data, scratch);
+    double scale = 1.0 / n;
+    for (int k = 0; k < n; k++) {
+        data[k] = std::conj(data[k]) * scale;
+    }
+}
+
+Dct::Dct(int n) :
+    fft(n), shift(n)
+{
+    for (int k = 0; k < n; k++) {
+        shift[k] = std::polar(1.0, -PI * k / (2.0 * n));
+    }
+}
+
+size_t Dct::ScratchSize() const
+{
+    return fft.Size() + fft.ScratchSize();
+}
+
+void Dct::Forward(const double* in, double* out, std::complex<double>* scratch) const
+{
+    int n = fft.Size();
+    Complex* v = scratch;
+    // Even samples in order followed by the odd samples reversed; the DCT-II is then the real part of the shifted
+    // transform of this sequence
+    for (int j = 0; 2 * j < n; j++) {
+        v[j] = in[2 * j];
+    }
+    for (int j = 0; 2 * j + 1 < n; j++) {
+        v[n - 1 - j] = in[2 * j + 1];
+    }
+    fft.Forward(v, scratch + n);
+    for (int k = 0; k < n; k++) {
+        out[k] = (shift[k] * v[k]).real();
+    }
+}
+
+void Dct::Inverse(const double* in, double* out, std::complex<double>* scratch) const
+{
+    int n = fft.Size();
+    Complex* v = scratch;
+    // shift[k] * V[k] = C[k] - i C[n - k] (with C[n] = 0) recovers the full transform of the reordered sequence
+    for (int k = 0; k < n; k++) {
+        Complex shifted(in[k], k == 0 ? 0.0 : -in[n - k]);
+        v[k] = std::conj(shift[k]) * shifted;
+    }
+    fft.Inverse(v, scratch + n);
+    for (int j = 0; 2 * j < n; j++) {
+        out[2 * j] = v[j].real();
+    }
+    for (int j = 0; 2 * j + 1 < n; j++) {
+        out[2 * j + 1] = v[n - 1 - j].real();
+    }
+}
@@ -0,0 +1,291 @@
+#include "solvers/multigridsolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename Scalar>
+MultigridSolver<Scalar>::MultigridSolver(unsigned int N, unsigned int M) :
+    PressureSolver<Scalar>(N, M, 1.0e-4, 20), levels(), residual(GridSize(N, M), Scalar(0)),
+    previousResidual(GridSize(N, M), Scalar(0)), direction(GridSize(N, M), Scalar(0)),
+    product(GridSize(N, M), Scalar(0)), preSmoothingSweeps(2), postSmoothingSweeps(2), coarsestSweeps(50)
+{
+    // Halve the grid until it is only a few cells wide and high; the coarsest level is cheap enough to relax to
+    // convergence
+    int levelN = (int)N;
+    int levelM = (int)M;
+    while (true) {
+        Level level;
+        level.N = levelN;
+        level.M = levelM;
+        size_t size = GridSize(levelN, levelM);
+        level.x.assign(size, Scalar(0));
+        level.b.assign(size, Scalar(0));
+        level.r.assign(size, Scalar(0));
+        level.eastWeight.assign(size, Scalar(0));
+        level.northWeight.assign(size, Scalar(0));
+        level.inverseDiagonal.assign(size, Scalar(0));
+        levels.push_back(std::move(level));
+        if (levelN <= 4 && levelM <= 4) {
+            break;
+        }
+        levelN = (levelN + 1) / 2;
+        levelM = (levelM + 1) / 2;
+    }
+
+    CouplingsChanged();
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::CouplingsChanged()
+{
+    levels[0].eastWeight = this->eastWeight;
+    levels[0].northWeight = this->northWeight;
+    levels[0].inverseDiagonal = this->inverseDiagonal;
+    for (size_t level = 1; level < levels.size(); level++) {
+        BuildCoarseLevel(levels[level - 1], levels[level]);
+    }
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::BuildCoarseLevel(const Level& fine, Level& coarse)
+{
+    int fineStride = GridStride(fine.N);
+    int coarseStride = GridStride(coarse.N);
+    // Coarse cell (I, J) covers the fine cells (2I - 1, 2J - 1) to (2I, 2J). With an odd fine width or height the
+    // last coarse column or row also covers the fine boundary, whose faces are all closed.
+    for (int J = 1; J <= coarse.M; J++) {
+        for (int I = 1; I <= coarse.N; I++) {
+            int fineCell = 2 * I + fineStride * (2 * J);
+            int coarseCell = I + coarseStride * J;
+            // Average of the two fine faces between this coarse cell and its east (north) neighbor
+            coarse.eastWeight[coarseCell] = Scalar(0.5) *
+                (fine.eastWeight[fineCell - fineStride] + fine.eastWeight[fineCell]);
+            coarse.northWeight[coarseCell] = Scalar(0.5) *
+                (fine.northWeight[fineCell - 1] + fine.northWeight[fineCell]);
+        }
+    }
+    for (int J = 1; J <= coarse.M; J++) {
+        for (int I = 1; I <= coarse.N; I++) {
+            int coarseCell = I + coarseStride * J;
+            Scalar diagonal = coarse.eastWeight[coarseCell] + coarse.eastWeight[coarseCell - 1] +
+                coarse.northWeight[coarseCell] + coarse.northWeight[coarseCell - coarseStride];
+            coarse.inverseDiagonal[coarseCell] = diagonal > 0 ? Scalar(1) / diagonal : Scalar(0);
+        }
+    }
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::Smooth(ThreadPool& threadPool, Level& level, int sweeps)
+{
+    int N = level.N;
+    int M = level.M;
+    int stride = GridStride(N);
+    for (int sweep = 0; sweep < sweeps; sweep++) {
+        for (int color = 0; color < 2; color++) {
+            threadPool.ParallelFor(1, M + 1, this->MinRowsPerChunk(N), [&](int rowBegin, int rowEnd) {
+                for (int j = rowBegin; j < rowEnd; j++) {
+                    Scalar* x = &level.x[stride * j];
+                    const Scalar* b = &level.b[stride * j];
+                    const Scalar* east = &level.eastWeight[stride * j];
+                    const Scalar* north = &level.northWeight[stride * j];
+                    const Scalar* inverseDiagonal = &level.inverseDiagonal[stride * j];
+                    // Cells without an equation have an inverse diagonal (and couplings) of 0 and stay at 0
+                    for (int i = 2 - ((j + color) & 1); i <= N; i += 2) {
+                        x[i] = (b[i] + east[i] * x[i + 1] + east[i - 1] * x[i - 1] +
+                            north[i] * x[i + stride] + north[i - stride] * x[i - stride]) * inverseDiagonal[i];
+                    }
+                }
+            });
+        }
+    }
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::ComputeResidual(ThreadPool& threadPool, Level& level)
+{
+    int N = level.N;
+    int M = level.M;
+    int stride = GridStride(N);
+    this->ForEachRow(threadPool, N, M, [&](int j) {
+        const Scalar* x = &level.x[stride * j];
+        const Scalar* b = &level.b[stride * j];
+        const Scalar* east = &level.eastWeight[stride * j];
+        const Scalar* north = &level.northWeight[stride * j];
+        Scalar* r = &level.r[stride * j];
+        for (int i = 1; i <= N; i++) {
+            Scalar diagonal = east[i] + east[i - 1] + north[i] + north[i - stride];
+            Scalar neighbors = east[i] * x[i + 1] + east[i - 1] * x[i - 1] +
+                north[i] * x[i + stride] + north[i - stride] * x[i - stride];
+            r[i] = b[i] - (diagonal * x[i] - neighbors);
+        }
+    });
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::Restrict(ThreadPool& threadPool, const Level& fine, Level& coarse)
+{
+    int fineStride = GridStride(fine.N);
+    int coarseStride = GridStride(coarse.N);
+    int coarseN = coarse.N;
+    std::fill(coarse.x.begin(), coarse.x.end(), Scalar(0));
+    threadPool.ParallelFor(1, coarse.M + 1, this->MinRowsPerChunk(coarseN), [&](int rowBegin, int rowEnd) {
+        for (int J = rowBegin; J < rowEnd; J++) {
+            const Scalar* upperRow = &fine.r[fineStride * (2 * J)];
+            const Scalar* lowerRow = upperRow - fineStride;
+            Scalar* b = &coarse.b[coarseStride * J];
+            for (int I = 1; I <= coarseN; I++) {
+                // The equations are scaled by h^2, so summing (not averaging) the children matches the coarse h
+                b[I] = lowerRow[2 * I - 1] + lowerRow[2 * I] + upperRow[2 * I - 1] + upperRow[2 * I];
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::ProlongAndCorrect(ThreadPool& threadPool, const Level& coarse, Level& fine)
+{
+    int fineN = fine.N;
+    int fineStride = GridStride(fine.N);
+    int coarseStride = GridStride(coarse.N);
+    threadPool.ParallelFor(1, fine.M + 1, this->MinRowsPerChunk(fineN), [&](int rowBegin, int rowEnd) {
+        for (int j = rowBegin; j < rowEnd; j++) {
+            // The parent row, and the coarse row on the same side of the parent center as this fine row
+            int J = (j + 1) / 2;
+            int nearRow = (j & 1) ? -coarseStride : coarseStride;
+            const Scalar* fineInverseDiagonal = &fine.inverseDiagonal[fineStride * j];
+            Scalar* x = &fine.x[fineStride * j];
+            for (int i = 1; i <= fineN; i++) {
+                if (fineInverseDiagonal[i] == 0) {
+                    continue;
+                }
+                int parentCell = (i + 1) / 2 + coarseStride * J;
+                int nearColumn = (i & 1) ? -1 : 1;
+                Scalar parent = coarse.x[parentCell];
+                // Bilinear interpolation between the four nearest coarse centers. Coarse cells outside the fluid
+                // hold no correction, so the parent's value stands in for them.
+                auto Near = [&](int cell) {
+                    return coarse.inverseDiagonal[cell] != 0 ? coarse.x[cell] : parent;
+                };
+                x[i] += Scalar(0.5625) * parent +
+                    Scalar(0.1875) * (Near(parentCell + nearColumn) + Near(parentCell + nearRow)) +
+                    Scalar(0.0625) * Near(parentCell + nearColumn + nearRow);
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+void MultigridSolver<Scalar>::VCycle(ThreadPool& threadPool, size_t levelIndex)
+{
+    Level& level = levels[levelIndex];
+    if (levelIndex + 1 == levels.size()) {
+        Smooth(threadPool, level, coarsestSweeps);
+        return;
+    }
+
+    Level& coarse = levels[levelIndex + 1];
+    Smooth(threadPool, level, preSmoothingSweeps);
+    ComputeResidual(threadPool, level);
+    Restrict(threadPool, level, coarse);
+    VCycle(threadPool, levelIndex + 1);
+    ProlongAndCorrect(threadPool, coarse, level);
+    Smooth(threadPool, level, postSmoothingSweeps);
+}
+
+template <typename Scalar>
+const Field<Scalar>& MultigridSolver<Scalar>::Precondition(ThreadPool& threadPool, const Field<Scalar>& r)
+{
+    Level& finest = levels[0];
+    int N = finest.N;
+    int M = finest.M;
+    int stride = GridStride(N);
+    std::copy(r.begin(), r.end(), finest.b.begin());
+    std::fill(finest.x.begin(), finest.x.end(), Scalar(0));
+    VCycle(threadPool, 0);
+
+    // The V-cycle leaves an arbitrary constant in z, which A cannot see. Remove it so the iterate does not drift.
+    double sum = this->SumRows(threadPool, N, M, [&](int j) {
+        const Scalar* z = &finest.x[stride * j];
+        double rowSum = 0.0;
+        for (int i = 1; i <= N; i++) {
+            rowSum += z[i];
+        }
+        return rowSum;
+    });
+    Scalar mean = Scalar(this->fluidCells > 0 ? sum / this->fluidCells : 0.0);
+    this->ForEachRow(threadPool, N, M, [&](int j) {
+        Scalar* z = &finest.x[stride * j];
+        const Scalar* inverseDiagonal = &finest.inverseDiagonal[stride * j];
+        for (int i = 1; i <= N; i++) {
+            z[i] = inverseDiagonal[i] != 0 ? z[i] - mean : Scalar(0);
+        }
+    });
+    return finest.x;
+}
+
+template <typename Scalar>
+int MultigridSolver<Scalar>::Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    int N = this->N;
+    int M = this->M;
+    int stride = GridStride(N);
+    double cells = (double)N * M;
+
+    double residualNorm = this->InitializeResidual(threadPool, rhs, residual);
+    double threshold = this->tolerance * this->lastStats.rhsNorm;
+    int iterations = 0;
+    if (residualNorm > threshold && this->maxIterations > 0) {
+        const Field<Scalar>& z = Precondition(threadPool, residual);
+        std::copy(z.begin(), z.end(), direction.begin());
+        double residualDotZ = this->Dot(threadPool, residual, z);
+        while (iterations < this->maxIterations) {
+            this->ApplyOperator(threadPool, direction, product);
+            double curvature = this->Dot(threadPool, direction, product);
+            if (!(curvature > 0.0)) {
+                break;
+            }
+            Scalar alpha = Scalar(residualDotZ / curvature);
+            this->ForEachRow(threadPool, N, M, [&](int j) {
+                const Scalar* d = &direction[stride * j];
+                const Scalar* Ad = &product[stride * j];
+                Scalar* x = &this->solution[stride * j];
+                Scalar* r = &residual[stride * j];
+                Scalar* rPrevious = &previousResidual[stride * j];
+                for (int i = 1; i <= N; i++) {
+                    x[i] += alpha * d[i];
+                    rPrevious[i] = r[i];
+                    r[i] -= alpha * Ad[i];
+                }
+            });
+            iterations++;
+
+            residualNorm = std::sqrt(this->Dot(threadPool, residual, residual) / cells);
+            if (residualNorm <= threshold || iterations == this->maxIterations) {
+                break;
+            }
+
+            // Polak-Ribiere form of beta, which stays stable although the V-cycle is not an exactly symmetric
+            // preconditioner
+            const Field<Scalar>& zNext = Precondition(threadPool, residual);
+            double nextResidualDotZ = this->Dot(threadPool, residual, zNext);
+            double beta = (nextResidualDotZ - this->Dot(threadPool, previousResidual, zNext)) / residualDotZ;
+            residualDotZ = nextResidualDotZ;
+            Scalar scalarBeta = Scalar(std::max(beta, 0.0));
+            this->ForEachRow(threadPool, N, M, [&](int j) {
+                const Scalar* zRow = &zNext[stride * j];
+                Scalar* d = &direction[stride * j];
+                for (int i = 1; i <= N; i++) {
+                    d[i] = zRow[i] + scalarBeta * d[i];
+                }
+            });
+        }
+    }
+    this->lastStats.iterations = iterations;
+    this->lastStats.finalResidual = residualNorm;
+
+    this->StorePressure(p);
+    return iterations;
+}
+
+template class MultigridSolver<float>;
+template class MultigridSolver<double>;
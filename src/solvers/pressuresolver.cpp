@@ -0,0 +1,190 @@
+#include "solvers/pressuresolver.h"
+
+#include <cmath>
+
+template <typename Scalar>
+PressureSolver<Scalar>::PressureSolver(unsigned int N, unsigned int M, double tolerance, int maxIterations) :
+    N((int)N), M((int)M), eastWeight(GridSize(N, M), Scalar(0)), northWeight(GridSize(N, M), Scalar(0)),
+    inverseDiagonal(GridSize(N, M), Scalar(0)), fluidCells(0), solution(GridSize(N, M), Scalar(0)),
+    tolerance(tolerance), maxIterations(maxIterations), lastStats()
+{
+    // Derived solvers set up what they derive from the couplings in their own constructors
+    BuildCouplings(CellBitmask(N, M));
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::BuildCouplings(const CellBitmask& obstacle)
+{
+    auto IsFluid = [&](int i, int j) {
+        return i >= 1 && i <= N && j >= 1 && j <= M && !obstacle.Get(i, j);
+    };
+
+    // Two fluid cells are coupled with weight 1, any face touching a solid cell is closed
+    for (int j = 0; j <= M + 1; j++) {
+        for (int i = 0; i <= N + 1; i++) {
+            bool fluid = IsFluid(i, j);
+            eastWeight[IX(i, j)] = Scalar(fluid && IsFluid(i + 1, j));
+            northWeight[IX(i, j)] = Scalar(fluid && IsFluid(i, j + 1));
+        }
+    }
+    fluidCells = 0;
+    for (int j = 1; j <= M; j++) {
+        for (int i = 1; i <= N; i++) {
+            Scalar diagonal = eastWeight[IX(i, j)] + eastWeight[IX(i - 1, j)] +
+                northWeight[IX(i, j)] + northWeight[IX(i, j - 1)];
+            // Cells inside obstacles, and fluid cells walled in on all sides, have no equation
+            inverseDiagonal[IX(i, j)] = diagonal > 0 ? Scalar(1) / diagonal : Scalar(0);
+            if (diagonal == 0) {
+                solution[IX(i, j)] = 0;
+            }
+            else {
+                fluidCells++;
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::SetObstacles(const CellBitmask& obstacle)
+{
+    BuildCouplings(obstacle);
+    CouplingsChanged();
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::ApplyOperator(ThreadPool& threadPool, const Field<Scalar>& in, Field<Scalar>& out) const
+{
+    int stride = GridStride(N);
+    ForEachRow(threadPool, N, M, [&](int j) {
+        const Scalar* x = &in[stride * j];
+        const Scalar* east = &eastWeight[stride * j];
+        const Scalar* north = &northWeight[stride * j];
+        Scalar* y = &out[stride * j];
+        for (int i = 1; i <= N; i++) {
+            Scalar diagonal = east[i] + east[i - 1] + north[i] + north[i - stride];
+            y[i] = diagonal * x[i] - (east[i] * x[i + 1] + east[i - 1] * x[i - 1] +
+                north[i] * x[i + stride] + north[i - stride] * x[i - stride]);
+        }
+    });
+}
+
+template <typename Scalar>
+double PressureSolver<Scalar>::Dot(ThreadPool& threadPool, const Field<Scalar>& a, const Field<Scalar>& b) const
+{
+    int stride = GridStride(N);
+    return SumRows(threadPool, N, M, [&](int j) {
+        const Scalar* aRow = &a[stride * j];
+        const Scalar* bRow = &b[stride * j];
+        double rowSum = 0.0;
+        for (int i = 1; i <= N; i++) {
+            rowSum += (double)aRow[i] * bRow[i];
+        }
+        return rowSum;
+    });
+}
+
+template <typename Scalar>
+double PressureSolver<Scalar>::InitializeResidual(ThreadPool& threadPool, const Field<Scalar>& rhs,
+    Field<Scalar>& residual)
+{
+    int stride = GridStride(N);
+    double cells = (double)N * M;
+
+    double rhsSum = SumRows(threadPool, N, M, [&](int j) {
+        const Scalar* b = &rhs[stride * j];
+        const Scalar* inverseDiagonalRow = &inverseDiagonal[stride * j];
+        double rowSum = 0.0;
+        for (int i = 1; i <= N; i++) {
+            if (inverseDiagonalRow[i] != 0) {
+                rowSum += b[i];
+            }
+        }
+        return rowSum;
+    });
+    Scalar rhsMean = Scalar(fluidCells > 0 ? rhsSum / fluidCells : 0.0);
+
+    // residual = (rhs - mean) - A solution, starting from the previous solution
+    ApplyOperator(threadPool, solution, residual);
+    double rhsSumSquared = SumRows(threadPool, N, M, [&](int j) {
+        const Scalar* b = &rhs[stride * j];
+        const Scalar* inverseDiagonalRow = &inverseDiagonal[stride * j];
+        Scalar* r = &residual[stride * j];
+        double rowSum = 0.0;
+        for (int i = 1; i <= N; i++) {
+            Scalar balanced = inverseDiagonalRow[i] != 0 ? b[i] - rhsMean : Scalar(0);
+            r[i] = balanced - r[i];
+            rowSum += (double)balanced * balanced;
+        }
+        return rowSum;
+    });
+
+    lastStats.rhsNorm = std::sqrt(rhsSumSquared / cells);
+    lastStats.initialResidual = std::sqrt(Dot(threadPool, residual, residual) / cells);
+    return lastStats.initialResidual;
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::StorePressure(Field<Scalar>& p)
+{
+    // The pressure is only defined up to a constant. Pin its mean to zero so the warm start does not drift.
+    double solutionSum = 0.0;
+    for (int j = 1; j <= M; j++) {
+        for (int i = 1; i <= N; i++) {
+            solutionSum += solution[IX(i, j)];
+        }
+    }
+    Scalar solutionMean = Scalar(fluidCells > 0 ? solutionSum / fluidCells : 0.0);
+
+    for (int j = 1; j <= M; j++) {
+        for (int i = 1; i <= N; i++) {
+            if (inverseDiagonal[IX(i, j)] != 0) {
+                solution[IX(i, j)] -= solutionMean;
+                p[IX(i, j)] = solution[IX(i, j)];
+            }
+        }
+    }
+    // Solid cells take the average of their fluid neighbors
+    for (int j = 1; j <= M; j++) {
+        for (int i = 1; i <= N; i++) {
+            if (inverseDiagonal[IX(i, j)] != 0) {
+                continue;
+            }
+            Scalar sum = 0;
+            int count = 0;
+            for (int neighbor : { IX(i - 1, j), IX(i + 1, j), IX(i, j - 1), IX(i, j + 1) }) {
+                if (inverseDiagonal[neighbor] != 0) {
+                    sum += solution[neighbor];
+                    count++;
+                }
+            }
+            p[IX(i, j)] = count > 0 ? sum / count : Scalar(0);
+        }
+    }
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::SetTolerance(double relativeTolerance)
+{
+    tolerance = relativeTolerance;
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::SetMaxIterations(int iterations)
+{
+    maxIterations = iterations;
+}
+
+template <typename Scalar>
+void PressureSolver<Scalar>::ResetInitialGuess()
+{
+    std::fill(solution.begin(), solution.end(), Scalar(0));
+}
+
+template <typename Scalar>
+const SolveStats& PressureSolver<Scalar>::GetLastStats() const
+{
+    return lastStats;
+}
+
+template class PressureSolver<float>;
+template class PressureSolver<double>;
@@ -0,0 +1,357 @@
+#include "solvers/quadtreepressuresolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace {
+
+// Unknowns are handed out in chunks of at least this many, so small levels run on the calling thread
+constexpr int MIN_CHUNK = 4096;
+
+// Runs body(k) for k in [0, count) across the pool
+template <typename Body>
+void ForEachUnknown(ThreadPool& threadPool, int count, Body body)
+{
+    threadPool.ParallelFor(0, count, MIN_CHUNK, [&](int begin, int end) {
+        for (int k = begin; k < end; k++) {
+            body(k);
+        }
+    });
+}
+
+// Sums body(k) over [0, count). Every chunk of MIN_CHUNK unknowns gets its own slot so the total does not depend on
+// the thread count.
+template <typename Body>
+double SumUnknowns(ThreadPool& threadPool, int count, Body body)
+{
+    int chunks = (count + MIN_CHUNK - 1) / MIN_CHUNK;
+    std::vector<double> chunkSums(chunks, 0.0);
+    threadPool.ParallelFor(0, chunks, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+            double sum = 0.0;
+            for (int k = chunk * MIN_CHUNK; k < std::min(count, (chunk + 1) * MIN_CHUNK); k++) {
+                sum += body(k);
+            }
+            chunkSums[chunk] = sum;
+        }
+    });
+    double sum = 0.0;
+    for (double chunkSum : chunkSums) {
+        sum += chunkSum;
+    }
+    return sum;
+}
+
+}
+
+template <typename Scalar>
+QuadtreePressureSolver<Scalar>::QuadtreePressureSolver(double tolerance, int maxIterations) :
+    levels(), residual(), previousResidual(), direction(), product(), tolerance(tolerance),
+    maxIterations(maxIterations), preSmoothingSweeps(2), postSmoothingSweeps(2), coarsestSweeps(50), lastStats()
+{}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::SetGrid(const QuadtreeGrid& grid)
+{
+    levels.clear();
+
+    // The cells of the grid, coupled through their faces
+    Level finest;
+    const std::vector<QuadtreeGrid::Cell>& cells = grid.GetCells();
+    const std::vector<QuadtreeGrid::Face>& faces = grid.GetFaces();
+    finest.count = grid.GetCellCount();
+    finest.rowBegin.assign(1, 0);
+    for (int c = 0; c < finest.count; c++) {
+        Scalar diagonal = 0;
+        for (const int* f = grid.CellFacesBegin(c); f != grid.CellFacesEnd(c); ++f) {
+            const QuadtreeGrid::Face& face = faces[*f];
+            finest.column.push_back(face.lower == c ? face.upper : face.lower);
+            finest.weight.push_back(Scalar(face.weight));
+            finest.length.push_back(face.length);
+            diagonal += Scalar(face.weight);
+        }
+        finest.rowBegin.push_back((int)finest.column.size());
+        finest.inverseDiagonal.push_back(diagonal > 0 ? Scalar(1) / diagonal : Scalar(0));
+        finest.size.push_back(cells[c].size);
+        finest.node.push_back(cells[c].node);
+    }
+    levels.push_back(std::move(finest));
+
+    // Merge siblings until a handful of unknowns is left, which the coarsest level relaxes to convergence
+    while (levels.back().count > 16) {
+        Level coarse;
+        if (!BuildCoarseLevel(grid, levels.back(), coarse)) {
+            break;
+        }
+        levels.push_back(std::move(coarse));
+    }
+
+    for (Level& level : levels) {
+        level.x.assign(level.count, Scalar(0));
+        level.b.assign(level.count, Scalar(0));
+        level.r.assign(level.count, Scalar(0));
+    }
+    int count = levels[0].count;
+    residual.assign(count, Scalar(0));
+    previousResidual.assign(count, Scalar(0));
+    direction.assign(count, Scalar(0));
+    product.assign(count, Scalar(0));
+}
+
+template <typename Scalar>
+bool QuadtreePressureSolver<Scalar>::BuildCoarseLevel(const QuadtreeGrid& grid, Level& fine, Level& coarse)
+{
+    const std::vector<QuadtreeGrid::Node>& nodes = grid.GetNodes();
+    std::vector<int> nodeUnknown(nodes.size(), -1);
+    for (int k = 0; k < fine.count; k++) {
+        nodeUnknown[fine.node[k]] = k;
+    }
+
+    // An unknown moves up to its parent when its three siblings are unknowns of this level too
+    std::vector<int> nodeCoarse(nodes.size(), -1);
+    bool merged = false;
+    coarse.count = 0;
+    fine.coarse.assign(fine.count, -1);
+    for (int k = 0; k < fine.count; k++) {
+        int node = fine.node[k];
+        int parent = nodes[node].parent;
+        bool complete = parent >= 0;
+        for (int child = 0; child < 4 && complete; child++) {
+            complete = nodeUnknown[nodes[parent].firstChild + child] >= 0;
+        }
+        int target = complete ? parent : node;
+        if (nodeCoarse[target] < 0) {
+            nodeCoarse[target] = coarse.count++;
+            coarse.node.push_back(target);
+            coarse.size.push_back(complete ? 2 * fine.size[k] : fine.size[k]);
+        }
+        fine.coarse[k] = nodeCoarse[target];
+        merged = merged || complete;
+    }
+    if (!merged) {
+        return false;
+    }
+
+    // The faces between two coarse unknowns add up to the length of their contact
+    std::vector<std::tuple<int, int, double>> contacts;
+    for (int k = 0; k < fine.count; k++) {
+        for (int e = fine.rowBegin[k]; e < fine.rowBegin[k + 1]; e++) {
+            int row = fine.coarse[k];
+            int column = fine.coarse[fine.column[e]];
+            if (row != column) {
+                contacts.emplace_back(row, column, fine.length[e]);
+            }
+        }
+    }
+    std::sort(contacts.begin(), contacts.end());
+    coarse.rowBegin.assign(coarse.count + 1, 0);
+    for (size_t e = 0; e < contacts.size(); e++) {
+        int row = std::get<0>(contacts[e]);
+        int column = std::get<1>(contacts[e]);
+        if (e > 0 && std::get<0>(contacts[e - 1]) == row && std::get<1>(contacts[e - 1]) == column) {
+            coarse.length.back() += std::get<2>(contacts[e]);
+            continue;
+        }
+        coarse.column.push_back(column);
+        coarse.length.push_back(std::get<2>(contacts[e]));
+        coarse.rowBegin[row + 1]++;
+    }
+    for (int k = 0; k < coarse.count; k++) {
+        coarse.rowBegin[k + 1] += coarse.rowBegin[k];
+    }
+
+    coarse.inverseDiagonal.assign(coarse.count, Scalar(0));
+    for (int k = 0; k < coarse.count; k++) {
+        Scalar diagonal = 0;
+        for (int e = coarse.rowBegin[k]; e < coarse.rowBegin[k + 1]; e++) {
+            double distance = 0.5 * (coarse.size[k] + coarse.size[coarse.column[e]]);
+            coarse.weight.push_back(Scalar(coarse.length[e] / distance));
+            diagonal += coarse.weight.back();
+        }
+        coarse.inverseDiagonal[k] = diagonal > 0 ? Scalar(1) / diagonal : Scalar(0);
+    }
+    return true;
+}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::Smooth(Level& level, int sweeps, bool backward)
+{
+    // Gauss-Seidel in Z-order, or its reverse, so a forward pre-smoothing and a backward post-smoothing keep the
+    // V-cycle symmetric
+    for (int sweep = 0; sweep < sweeps; sweep++) {
+        for (int step = 0; step < level.count; step++) {
+            int k = backward ? level.count - 1 - step : step;
+            Scalar sum = level.b[k];
+            for (int e = level.rowBegin[k]; e < level.rowBegin[k + 1]; e++) {
+                sum += level.weight[e] * level.x[level.column[e]];
+            }
+            level.x[k] = sum * level.inverseDiagonal[k];
+        }
+    }
+}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::ApplyOperator(ThreadPool& threadPool, const Level& level,
+    const Field<Scalar>& in, Field<Scalar>& out) const
+{
+    ForEachUnknown(threadPool, level.count, [&](int k) {
+        Scalar sum = 0;
+        Scalar diagonal = 0;
+        for (int e = level.rowBegin[k]; e < level.rowBegin[k + 1]; e++) {
+            sum += level.weight[e] * in[level.column[e]];
+            diagonal += level.weight[e];
+        }
+        out[k] = diagonal * in[k] - sum;
+    });
+}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::ComputeResidual(ThreadPool& threadPool, Level& level)
+{
+    ApplyOperator(threadPool, level, level.x, level.r);
+    ForEachUnknown(threadPool, level.count, [&](int k) {
+        level.r[k] = level.b[k] - level.r[k];
+    });
+}
+
+template <typename Scalar>
+double QuadtreePressureSolver<Scalar>::Dot(ThreadPool& threadPool, const Field<Scalar>& a,
+    const Field<Scalar>& b) const
+{
+    return SumUnknowns(threadPool, levels[0].count, [&](int k) {
+        return (double)a[k] * b[k];
+    });
+}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::VCycle(ThreadPool& threadPool, size_t levelIndex)
+{
+    Level& level = levels[levelIndex];
+    std::fill(level.x.begin(), level.x.end(), Scalar(0));
+    if (levelIndex + 1 == levels.size()) {
+        Smooth(level, coarsestSweeps, false);
+        return;
+    }
+
+    Smooth(level, preSmoothingSweeps, false);
+    ComputeResidual(threadPool, level);
+    Level& coarse = levels[levelIndex + 1];
+    std::fill(coarse.b.begin(), coarse.b.end(), Scalar(0));
+    for (int k = 0; k < level.count; k++) {
+        coarse.b[level.coarse[k]] += level.r[k];
+    }
+    VCycle(threadPool, levelIndex + 1);
+    ForEachUnknown(threadPool, level.count, [&](int k) {
+        level.x[k] += coarse.x[level.coarse[k]];
+    });
+    Smooth(level, postSmoothingSweeps, true);
+}
+
+template <typename Scalar>
+const Field<Scalar>& QuadtreePressureSolver<Scalar>::Precondition(ThreadPool& threadPool, const Field<Scalar>& r)
+{
+    Level& finest = levels[0];
+    std::copy(r.begin(), r.end(), finest.b.begin());
+    VCycle(threadPool, 0);
+
+    // The V-cycle leaves an arbitrary constant in z, which A cannot see. Remove it so the iterate does not drift.
+    Scalar mean = Scalar(SumUnknowns(threadPool, finest.count, [&](int k) {
+        return (double)finest.x[k];
+    }) / finest.count);
+    ForEachUnknown(threadPool, finest.count, [&](int k) {
+        finest.x[k] -= mean;
+    });
+    return finest.x;
+}
+
+template <typename Scalar>
+int QuadtreePressureSolver<Scalar>::Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    int count = levels[0].count;
+    double cells = (double)count;
+    p.resize(count, Scalar(0));
+
+    // residual = (rhs - mean) - A p, starting from the previous pressure
+    Scalar rhsMean = Scalar(SumUnknowns(threadPool, count, [&](int k) {
+        return (double)rhs[k];
+    }) / cells);
+    ApplyOperator(threadPool, levels[0], p, residual);
+    double rhsSumSquared = SumUnknowns(threadPool, count, [&](int k) {
+        Scalar balanced = rhs[k] - rhsMean;
+        residual[k] = balanced - residual[k];
+        return (double)balanced * balanced;
+    });
+    lastStats.rhsNorm = std::sqrt(rhsSumSquared / cells);
+    double residualNorm = std::sqrt(Dot(threadPool, residual, residual) / cells);
+    lastStats.initialResidual = residualNorm;
+
+    double threshold = tolerance * lastStats.rhsNorm;
+    int iterations = 0;
+    if (residualNorm > threshold && maxIterations > 0) {
+        const Field<Scalar>& z = Precondition(threadPool, residual);
+        std::copy(z.begin(), z.end(), direction.begin());
+        double residualDotZ = Dot(threadPool, residual, z);
+        while (iterations < maxIterations) {
+            ApplyOperator(threadPool, levels[0], direction, product);
+            double curvature = Dot(threadPool, direction, product);
+            if (!(curvature > 0.0)) {
+                break;
+            }
+            Scalar alpha = Scalar(residualDotZ / curvature);
+            ForEachUnknown(threadPool, count, [&](int k) {
+                p[k] += alpha * direction[k];
+                previousResidual[k] = residual[k];
+                residual[k] -= alpha * product[k];
+            });
+            iterations++;
+
+            residualNorm = std::sqrt(Dot(threadPool, residual, residual) / cells);
+            if (residualNorm <= threshold || iterations == maxIterations) {
+                break;
+            }
+
+            // Polak-Ribiere form of beta, as in MultigridSolver
+            const Field<Scalar>& zNext = Precondition(threadPool, residual);
+            double nextResidualDotZ = Dot(threadPool, residual, zNext);
+            double beta = (nextResidualDotZ - Dot(threadPool, previousResidual, zNext)) / residualDotZ;
+            residualDotZ = nextResidualDotZ;
+            Scalar scalarBeta = Scalar(std::max(beta, 0.0));
+            ForEachUnknown(threadPool, count, [&](int k) {
+                direction[k] = zNext[k] + scalarBeta * direction[k];
+            });
+        }
+    }
+    lastStats.iterations = iterations;
+    lastStats.finalResidual = residualNorm;
+
+    // The pressure is only defined up to a constant. Pin its mean to zero so the warm start does not drift.
+    Scalar solutionMean = Scalar(SumUnknowns(threadPool, count, [&](int k) {
+        return (double)p[k];
+    }) / cells);
+    ForEachUnknown(threadPool, count, [&](int k) {
+        p[k] -= solutionMean;
+    });
+    return iterations;
+}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::SetTolerance(double relativeTolerance)
+{
+    tolerance = relativeTolerance;
+}
+
+template <typename Scalar>
+void QuadtreePressureSolver<Scalar>::SetMaxIterations(int iterations)
+{
+    maxIterations = iterations;
+}
+
+template <typename Scalar>
+const SolveStats& QuadtreePressureSolver<Scalar>::GetLastStats() const
+{
+    return lastStats;
+}
+
+template class QuadtreePressureSolver<float>;
+template class QuadtreePressureSolver<double>;
@@ -0,0 +1,240 @@
+#include "solvers/spectralpoissonsolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// Rows (or columns) are handed out in chunks of at least ~4096 cells, like the relaxation
+int MinLinesPerChunk(int N)
+{
+    return std::max(1, 4096 / N);
+}
+
+// Columns are gathered this many at a time, so every row of the spectrum is read a cache line at a time
+constexpr int COLUMN_BLOCK = 8;
+
+// Calls transform(column, k, scratch) on a copy of every column k of the M x N row-major array data and stores the
+// result back
+template <typename T, typename Transform>
+void ForEachColumn(ThreadPool& threadPool, std::vector<T>& data, int N, int M, size_t scratchSize,
+    const Transform& transform)
+{
+    int blocks = (N + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+    int minBlocks = std::max(1, MinLinesPerChunk(M) / COLUMN_BLOCK);
+    threadPool.ParallelFor(0, blocks, minBlocks, [&](int blockBegin, int blockEnd) {
+        std::vector<std::complex<double>> scratch(scratchSize);
+        std::vector<T> columns(size_t(COLUMN_BLOCK) * M);
+        for (int block = blockBegin; block < blockEnd; block++) {
+            int first = block * COLUMN_BLOCK;
+            int width = std::min(COLUMN_BLOCK, N - first);
+            for (int l = 0; l < M; l++) {
+                for (int c = 0; c < width; c++) {
+                    columns[size_t(c) * M + l] = data[size_t(l) * N + first + c];
+                }
+            }
+            for (int c = 0; c < width; c++) {
+                transform(&columns[size_t(c) * M], first + c, scratch.data());
+            }
+            for (int l = 0; l < M; l++) {
+                for (int c = 0; c < width; c++) {
+                    data[size_t(l) * N + first + c] = columns[size_t(c) * M + l];
+                }
+            }
+        }
+    });
+}
+
+}
+
+template <typename Scalar>
+SpectralPoissonSolver<Scalar>::SpectralPoissonSolver(unsigned int N, unsigned int M, bool periodic) :
+    N((int)N), M((int)M), periodic(periodic), fft((int)N), columnFft((int)M), dct((int)N), columnDct((int)M),
+    eigenvalues(N), columnEigenvalues(M), spectrum(), complexSpectrum(), lastStats()
+{
+    // Mode k of the cosine transform is cos(pi k (i + 1/2) / N), of the Fourier transform exp(2 pi i k j / N)
+    double angle = periodic ? 2.0 * PI / N : PI / N;
+    for (int k = 0; k < (int)N; k++) {
+        eigenvalues[k] = 2.0 - 2.0 * std::cos(angle * k);
+    }
+    double columnAngle = periodic ? 2.0 * PI / M : PI / M;
+    for (int l = 0; l < (int)M; l++) {
+        columnEigenvalues[l] = 2.0 - 2.0 * std::cos(columnAngle * l);
+    }
+    if (periodic) {
+        complexSpectrum.resize(size_t(N) * M);
+    }
+    else {
+        spectrum.resize(size_t(N) * M);
+    }
+}
+
+template <typename Scalar>
+bool SpectralPoissonSolver<Scalar>::IsPeriodic() const
+{
+    return periodic;
+}
+
+template <typename Scalar>
+void SpectralPoissonSolver<Scalar>::Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    if (periodic) {
+        SolvePeriodic(threadPool, p, rhs);
+    }
+    else {
+        SolveWalls(threadPool, p, rhs);
+    }
+    MeasureResidual(threadPool, p, rhs);
+}
+
+template <typename Scalar>
+void SpectralPoissonSolver<Scalar>::SolveWalls(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    int N = this->N;
+    int M = this->M;
+    int minLines = MinLinesPerChunk(N);
+
+    // Transform the rows
+    threadPool.ParallelFor(1, M + 1, minLines, [&](int rowBegin, int rowEnd) {
+        std::vector<std::complex<double>> scratch(dct.ScratchSize());
+        for (int j = rowBegin; j < rowEnd; j++) {
+            double* row = &spectrum[size_t(j - 1) * N];
+            for (int i = 1; i <= N; i++) {
+                row[i - 1] = rhs[IX(i, j)];
+            }
+            dct.Forward(row, row, scratch.data());
+        }
+    });
+
+    // Transform each column, divide by the eigenvalues and transform it back
+    ForEachColumn(threadPool, spectrum, N, M, columnDct.ScratchSize(), [&](double* column, int k,
+        std::complex<double>* scratch) {
+        columnDct.Forward(column, column, scratch);
+        for (int l = 0; l < M; l++) {
+            double eigenvalue = eigenvalues[k] + columnEigenvalues[l];
+            // The constant mode has no solution: drop the mean of rhs and pin the mean of p to zero
+            column[l] = eigenvalue > 0 ? column[l] / eigenvalue : 0.0;
+        }
+        columnDct.Inverse(column, column, scratch);
+    });
+
+    // Transform the rows back into the pressure
+    threadPool.ParallelFor(1, M + 1, minLines, [&](int rowBegin, int rowEnd) {
+        std::vector<std::complex<double>> scratch(dct.ScratchSize());
+        for (int j = rowBegin; j < rowEnd; j++) {
+            double* row = &spectrum[size_t(j - 1) * N];
+            dct.Inverse(row, row, scratch.data());
+            for (int i = 1; i <= N; i++) {
+                p[IX(i, j)] = Scalar(row[i - 1]);
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+void SpectralPoissonSolver<Scalar>::SolvePeriodic(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    int N = this->N;
+    int M = this->M;
+    int minLines = MinLinesPerChunk(N);
+
+    threadPool.ParallelFor(1, M + 1, minLines, [&](int rowBegin, int rowEnd) {
+        std::vector<std::complex<double>> scratch(fft.ScratchSize());
+        for (int j = rowBegin; j < rowEnd; j++) {
+            std::complex<double>* row = &complexSpectrum[size_t(j - 1) * N];
+            for (int i = 1; i <= N; i++) {
+                row[i - 1] = rhs[IX(i, j)];
+            }
+            fft.Forward(row, scratch.data());
+        }
+    });
+
+    ForEachColumn(threadPool, complexSpectrum, N, M, columnFft.ScratchSize(), [&](std::complex<double>* column, int k,
+        std::complex<double>* scratch) {
+        columnFft.Forward(column, scratch);
+        for (int l = 0; l < M; l++) {
+            double eigenvalue = eigenvalues[k] + columnEigenvalues[l];
+            column[l] = eigenvalue > 0 ? column[l] / eigenvalue : 0.0;
+        }
+        columnFft.Inverse(column, scratch);
+    });
+
+    threadPool.ParallelFor(1, M + 1, minLines, [&](int rowBegin, int rowEnd) {
+        std::vector<std::complex<double>> scratch(fft.ScratchSize());
+        for (int j = rowBegin; j < rowEnd; j++) {
+            std::complex<double>* row = &complexSpectrum[size_t(j - 1) * N];
+            fft.Inverse(row, scratch.data());
+            // The imaginary parts are round-off, the right hand side is real
+            for (int i = 1; i <= N; i++) {
+                p[IX(i, j)] = Scalar(row[i - 1].real());
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+void SpectralPoissonSolver<Scalar>::MeasureResidual(ThreadPool& threadPool, const Field<Scalar>& p,
+    const Field<Scalar>& rhs)
+{
+    int N = this->N;
+    int M = this->M;
+    double cells = (double)N * M;
+    double rhsSum = 0.0;
+    for (int j = 1; j <= M; j++) {
+        for (int i = 1; i <= N; i++) {
+            rhsSum += rhs[IX(i, j)];
+        }
+    }
+    double rhsMean = rhsSum / cells;
+
+    // Neighbors across a wall mirror the cell itself, across a periodic edge they wrap around
+    auto Neighbor = [&](int index, int n) {
+        if (index < 1) {
+            return periodic ? n : 1;
+        }
+        if (index > n) {
+            return periodic ? 1 : n;
+        }
+        return index;
+    };
+    std::vector<double> rowResidual(M + 2, 0.0);
+    std::vector<double> rowRhs(M + 2, 0.0);
+    threadPool.ParallelFor(1, M + 1, MinLinesPerChunk(N), [&](int rowBegin, int rowEnd) {
+        for (int j = rowBegin; j < rowEnd; j++) {
+            double residualSum = 0.0;
+            double rhsSumSquared = 0.0;
+            for (int i = 1; i <= N; i++) {
+                double b = rhs[IX(i, j)] - rhsMean;
+                double neighbors = (double)p[IX(Neighbor(i - 1, N), j)] + p[IX(Neighbor(i + 1, N), j)] +
+                    p[IX(i, Neighbor(j - 1, M))] + p[IX(i, Neighbor(j + 1, M))];
+                double r = b - (4.0 * p[IX(i, j)] - neighbors);
+                residualSum += r * r;
+                rhsSumSquared += b * b;
+            }
+            rowResidual[j] = residualSum;
+            rowRhs[j] = rhsSumSquared;
+        }
+    });
+    double residualSum = 0.0;
+    double rhsSumSquared = 0.0;
+    for (int j = 1; j <= M; j++) {
+        residualSum += rowResidual[j];
+        rhsSumSquared += rowRhs[j];
+    }
+
+    lastStats.iterations = 1;
+    lastStats.rhsNorm = std::sqrt(rhsSumSquared / cells);
+    lastStats.initialResidual = lastStats.rhsNorm;
+    lastStats.finalResidual = std::sqrt(residualSum / cells);
+}
+
+template <typename Scalar>
+const SolveStats& SpectralPoissonSolver<Scalar>::GetLastStats() const
+{
+    return lastStats;
+}
+
+template class SpectralPoissonSolver<float>;
+template class SpectralPoissonSolver<double>;
@@ -0,0 +1,517 @@
+#include "solvers/tilepressuresolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Unknowns are handed out in chunks of at least this many, so small levels run on the calling thread
+constexpr int MIN_CHUNK = 4096;
+
+// Levels of at most this many unknowns are relaxed to convergence instead of coarsened further
+constexpr int COARSEST_UNKNOWNS = 64;
+
+// Runs body(k) for k in [begin, end) across the pool
+template <typename Body>
+void ForEachUnknown(ThreadPool& threadPool, int begin, int end, Body body)
+{
+    threadPool.ParallelFor(begin, end, MIN_CHUNK, [&](int chunkBegin, int chunkEnd) {
+        for (int k = chunkBegin; k < chunkEnd; k++) {
+            body(k);
+        }
+    });
+}
+
+// Sums body(k) over [0, count). Every chunk of MIN_CHUNK unknowns gets its own slot so the total does not depend on
+// the thread count.
+template <typename Body>
+double SumUnknowns(ThreadPool& threadPool, int count, Body body)
+{
+    int chunks = (count + MIN_CHUNK - 1) / MIN_CHUNK;
+    std::vector<double> chunkSums(chunks, 0.0);
+    threadPool.ParallelFor(0, chunks, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+            double sum = 0.0;
+            for (int k = chunk * MIN_CHUNK; k < std::min(count, (chunk + 1) * MIN_CHUNK); k++) {
+                sum += body(k);
+            }
+            chunkSums[chunk] = sum;
+        }
+    });
+    double sum = 0.0;
+    for (double chunkSum : chunkSums) {
+        sum += chunkSum;
+    }
+    return sum;
+}
+
+}
+
+template <typename Scalar>
+TilePressureSolver<Scalar>::TilePressureSolver(unsigned int N, unsigned int M, double tolerance, int maxIterations) :
+    N((int)N), M((int)M), levels(), levelCount(0), cells(), region(), regionSize(), edgeCells(), edgeBegin(1, 0),
+    edgeNeighbors(), values(1, Scalar(0)), residual(1, Scalar(0)), previousResidual(1, Scalar(0)),
+    direction(1, Scalar(0)), product(1, Scalar(0)), solution(GridSize(N, M), Scalar(0)), tolerance(tolerance),
+    maxIterations(maxIterations), preSmoothingSweeps(2), postSmoothingSweeps(2), coarsestSweeps(50), lastStats()
+{
+    // Every level is half as wide and high as the one before, down to a single unknown
+    int width = (int)N;
+    int height = (int)M;
+    while (true) {
+        Level level;
+        level.count = 0;
+        level.redCount = 0;
+        level.colored = true;
+        level.width = width;
+        level.height = height;
+        level.index.assign(size_t(width) * height, -1);
+        levels.push_back(std::move(level));
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::FinishLevel(Level& level)
+{
+    int count = level.count;
+    level.inverseDiagonal.assign(count, Scalar(0));
+    level.colored = true;
+    for (int k = 0; k < count; k++) {
+        Scalar diagonal = 0;
+        for (int d = 0; d < 4; d++) {
+            int n = level.neighbor[4 * k + d];
+            if (n == count) {
+                continue;
+            }
+            diagonal += level.weight[4 * k + d];
+            if ((k < level.redCount) == (n < level.redCount)) {
+                level.colored = false;
+            }
+        }
+        level.inverseDiagonal[k] = diagonal > 0 ? Scalar(1) / diagonal : Scalar(0);
+    }
+    level.x.assign(count + 1, Scalar(0));
+    level.b.assign(count + 1, Scalar(0));
+    level.r.assign(count + 1, Scalar(0));
+}
+
+template <typename Scalar>
+bool TilePressureSolver<Scalar>::BuildCoarseLevel(Level& fine, Level& coarse)
+{
+    // The positions of the merged unknowns, in the order they are first met, then split by color. The index map is
+    // set to -2 for positions already met.
+    std::vector<int> positions;
+    for (int k = 0; k < fine.count; k++) {
+        int position = (fine.y0[k] >> 1) * coarse.width + (fine.x0[k] >> 1);
+        if (coarse.index[position] == -1) {
+            coarse.index[position] = -2;
+            positions.push_back(position);
+        }
+    }
+    // Coarsening has to shrink the level by a good fraction to pay for its smoothing sweeps
+    if (4 * positions.size() > 3 * size_t(fine.count)) {
+        for (int position : positions) {
+            coarse.index[position] = -1;
+        }
+        return false;
+    }
+
+    coarse.count = (int)positions.size();
+    coarse.x0.clear();
+    coarse.y0.clear();
+    for (int color = 0; color < 2; color++) {
+        if (color == 1) {
+            coarse.redCount = (int)coarse.x0.size();
+        }
+        for (int position : positions) {
+            int x = position % coarse.width;
+            int y = position / coarse.width;
+            if (((x + y) & 1) == color) {
+                coarse.index[position] = (int)coarse.x0.size();
+                coarse.x0.push_back(x);
+                coarse.y0.push_back(y);
+            }
+        }
+    }
+
+    // Two merged unknowns are coupled through the fine faces between them, at half the weight: the faces are as long
+    // and the centers twice as far apart
+    fine.coarse.resize(fine.count);
+    coarse.children.assign(4 * size_t(coarse.count), fine.count);
+    coarse.neighbor.assign(4 * size_t(coarse.count), coarse.count);
+    coarse.weight.assign(4 * size_t(coarse.count), Scalar(0));
+    for (int k = 0; k < fine.count; k++) {
+        int c = coarse.index[(fine.y0[k] >> 1) * coarse.width + (fine.x0[k] >> 1)];
+        fine.coarse[k] = c;
+        coarse.children[4 * c + (fine.x0[k] & 1) + 2 * (fine.y0[k] & 1)] = k;
+    }
+    for (int k = 0; k < fine.count; k++) {
+        int c = fine.coarse[k];
+        for (int d = 0; d < 4; d++) {
+            int n = fine.neighbor[4 * k + d];
+            if (n == fine.count || fine.coarse[n] == c) {
+                continue;
+            }
+            coarse.neighbor[4 * c + d] = fine.coarse[n];
+            coarse.weight[4 * c + d] += Scalar(0.5) * fine.weight[4 * k + d];
+        }
+    }
+    FinishLevel(coarse);
+    return true;
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::FindRegions()
+{
+    const Level& finest = levels[0];
+    region.assign(finest.count, -1);
+    regionSize.clear();
+    std::vector<int> stack;
+    for (int seed = 0; seed < finest.count; seed++) {
+        if (region[seed] >= 0) {
+            continue;
+        }
+        int label = (int)regionSize.size();
+        int size = 0;
+        region[seed] = label;
+        stack.push_back(seed);
+        while (!stack.empty()) {
+            int k = stack.back();
+            stack.pop_back();
+            size++;
+            for (int d = 0; d < 4; d++) {
+                int n = finest.neighbor[4 * k + d];
+                if (n != finest.count && region[n] < 0) {
+                    region[n] = label;
+                    stack.push_back(n);
+                }
+            }
+        }
+        regionSize.push_back(size);
+    }
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::RemoveRegionMeans(Field<Scalar>& x) const
+{
+    const Level& finest = levels[0];
+    std::vector<double> sums(regionSize.size(), 0.0);
+    for (int k = 0; k < finest.count; k++) {
+        sums[region[k]] += x[k];
+    }
+    for (size_t r = 0; r < sums.size(); r++) {
+        sums[r] /= regionSize[r];
+    }
+    for (int k = 0; k < finest.count; k++) {
+        x[k] = finest.inverseDiagonal[k] != 0 ? x[k] - Scalar(sums[region[k]]) : Scalar(0);
+    }
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::SetActiveCells(const TileActivity<Scalar>& tiles, bool periodic)
+{
+    // Clear the index maps of the previous unknowns, which is all that was ever set in them
+    for (int l = 0; l < levelCount; l++) {
+        Level& level = levels[l];
+        for (int k = 0; k < level.count; k++) {
+            level.index[level.y0[k] * level.width + level.x0[k]] = -1;
+        }
+        level.count = 0;
+    }
+
+    // The active fluid cells, red ((i + j) even) first, each color row by row
+    Level& finest = levels[0];
+    finest.x0.clear();
+    finest.y0.clear();
+    cells.clear();
+    for (int color = 0; color < 2; color++) {
+        if (color == 1) {
+            finest.redCount = (int)cells.size();
+        }
+        for (int j = 1; j <= M; j++) {
+            for (const typename TileActivity<Scalar>::Run* run = tiles.RunsBegin(j); run != tiles.RunsEnd(j); ++run) {
+                for (int i = run->begin + ((run->begin + j + color) & 1); i < run->end; i += 2) {
+                    finest.index[(j - 1) * N + i - 1] = (int)cells.size();
+                    finest.x0.push_back(i - 1);
+                    finest.y0.push_back(j - 1);
+                    cells.push_back(IX(i, j));
+                }
+            }
+        }
+    }
+    finest.count = (int)cells.size();
+
+    // Neighboring active cells are coupled with weight 1. The other neighbors are inactive cells, obstacles or the
+    // walls of the domain, which no flux crosses; the inner ones among them are the edge cells.
+    int count = finest.count;
+    finest.neighbor.assign(4 * size_t(count), count);
+    finest.weight.assign(4 * size_t(count), Scalar(0));
+    std::vector<std::pair<int, int>> edgePairs;
+    const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (int k = 0; k < count; k++) {
+        for (int d = 0; d < 4; d++) {
+            int x = finest.x0[k] + offsets[d][0];
+            int y = finest.y0[k] + offsets[d][1];
+            if (periodic) {
+                x = (x + N) % N;
+                y = (y + M) % M;
+            }
+            else if (x < 0 || x >= N || y < 0 || y >= M) {
+                continue;
+            }
+            int n = finest.index[y * N + x];
+            if (n >= 0) {
+                if (n != k) {
+                    finest.neighbor[4 * k + d] = n;
+                    finest.weight[4 * k + d] = Scalar(1);
+                }
+                continue;
+            }
+            edgePairs.push_back({ y * N + x, k });
+        }
+    }
+    FinishLevel(finest);
+
+    // Group the neighbors of every edge cell
+    edgeCells.clear();
+    edgeBegin.assign(1, 0);
+    edgeNeighbors.clear();
+    std::sort(edgePairs.begin(), edgePairs.end());
+    for (size_t pair = 0; pair < edgePairs.size(); pair++) {
+        int position = edgePairs[pair].first;
+        if (pair == 0 || position != edgePairs[pair - 1].first) {
+            if (pair > 0) {
+                edgeBegin.push_back((int)edgeNeighbors.size());
+            }
+            edgeCells.push_back(IX(position % N + 1, position / N + 1));
+        }
+        edgeNeighbors.push_back(edgePairs[pair].second);
+    }
+    if (!edgePairs.empty()) {
+        edgeBegin.push_back((int)edgeNeighbors.size());
+    }
+
+    FindRegions();
+
+    levelCount = 1;
+    while (levels[levelCount - 1].count > COARSEST_UNKNOWNS && levelCount < (int)levels.size() &&
+        BuildCoarseLevel(levels[levelCount - 1], levels[levelCount])) {
+        levelCount++;
+    }
+
+    for (Field<Scalar>* field : { &values, &residual, &previousResidual, &direction, &product }) {
+        field->assign(count + 1, Scalar(0));
+    }
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::Smooth(ThreadPool& threadPool, Level& level, int sweeps)
+{
+    auto Relax = [&](int k) {
+        const int* n = &level.neighbor[4 * k];
+        const Scalar* w = &level.weight[4 * k];
+        level.x[k] = (level.b[k] + w[0] * level.x[n[0]] + w[1] * level.x[n[1]] + w[2] * level.x[n[2]] +
+            w[3] * level.x[n[3]]) * level.inverseDiagonal[k];
+    };
+    for (int sweep = 0; sweep < sweeps; sweep++) {
+        if (!level.colored) {
+            // Two unknowns of a color are coupled, so the colors cannot be relaxed in parallel
+            for (int k = 0; k < level.count; k++) {
+                Relax(k);
+            }
+            continue;
+        }
+        ForEachUnknown(threadPool, 0, level.redCount, Relax);
+        ForEachUnknown(threadPool, level.redCount, level.count, Relax);
+    }
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::ApplyOperator(ThreadPool& threadPool, const Level& level, const Field<Scalar>& in,
+    Field<Scalar>& out) const
+{
+    ForEachUnknown(threadPool, 0, level.count, [&](int k) {
+        const int* n = &level.neighbor[4 * k];
+        const Scalar* w = &level.weight[4 * k];
+        out[k] = (w[0] + w[1] + w[2] + w[3]) * in[k] -
+            (w[0] * in[n[0]] + w[1] * in[n[1]] + w[2] * in[n[2]] + w[3] * in[n[3]]);
+    });
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::ComputeResidual(ThreadPool& threadPool, Level& level)
+{
+    ApplyOperator(threadPool, level, level.x, level.r);
+    ForEachUnknown(threadPool, 0, level.count, [&](int k) {
+        level.r[k] = level.b[k] - level.r[k];
+    });
+}
+
+template <typename Scalar>
+double TilePressureSolver<Scalar>::Dot(ThreadPool& threadPool, const Field<Scalar>& a, const Field<Scalar>& b) const
+{
+    return SumUnknowns(threadPool, levels[0].count, [&](int k) {
+        return (double)a[k] * b[k];
+    });
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::VCycle(ThreadPool& threadPool, size_t levelIndex)
+{
+    Level& level = levels[levelIndex];
+    if (levelIndex + 1 == (size_t)levelCount) {
+        Smooth(threadPool, level, coarsestSweeps);
+        return;
+    }
+
+    Level& coarse = levels[levelIndex + 1];
+    Smooth(threadPool, level, preSmoothingSweeps);
+    ComputeResidual(threadPool, level);
+    // The equations are scaled by h^2, so summing (not averaging) the merged residuals matches the coarse h
+    ForEachUnknown(threadPool, 0, coarse.count, [&](int c) {
+        const int* child = &coarse.children[4 * c];
+        coarse.b[c] = level.r[child[0]] + level.r[child[1]] + level.r[child[2]] + level.r[child[3]];
+        coarse.x[c] = 0;
+    });
+    VCycle(threadPool, levelIndex + 1);
+    ForEachUnknown(threadPool, 0, level.count, [&](int k) {
+        if (level.inverseDiagonal[k] != 0) {
+            level.x[k] += coarse.x[level.coarse[k]];
+        }
+    });
+    Smooth(threadPool, level, postSmoothingSweeps);
+}
+
+template <typename Scalar>
+const Field<Scalar>& TilePressureSolver<Scalar>::Precondition(ThreadPool& threadPool, const Field<Scalar>& r)
+{
+    Level& finest = levels[0];
+    std::copy(r.begin(), r.begin() + finest.count, finest.b.begin());
+    std::fill(finest.x.begin(), finest.x.end(), Scalar(0));
+    VCycle(threadPool, 0);
+
+    // The V-cycle leaves an arbitrary constant in every region, which A cannot see. Remove them so the iterate does
+    // not drift.
+    RemoveRegionMeans(finest.x);
+    return finest.x;
+}
+
+template <typename Scalar>
+int TilePressureSolver<Scalar>::Solve(ThreadPool& threadPool, Field<Scalar>& p, const Field<Scalar>& rhs)
+{
+    const Level& finest = levels[0];
+    int count = finest.count;
+    lastStats = SolveStats();
+    if (count == 0) {
+        return 0;
+    }
+
+    // Every region is closed, so its equations only have a solution if its divergence sums to zero
+    ForEachUnknown(threadPool, 0, count, [&](int k) {
+        residual[k] = rhs[cells[k]];
+        values[k] = solution[cells[k]];
+    });
+    RemoveRegionMeans(residual);
+    double rhsSumSquared = Dot(threadPool, residual, residual);
+
+    // residual = rhs - A values, starting from the previous solution
+    ApplyOperator(threadPool, finest, values, product);
+    ForEachUnknown(threadPool, 0, count, [&](int k) {
+        residual[k] -= product[k];
+    });
+    lastStats.rhsNorm = std::sqrt(rhsSumSquared / count);
+    double residualNorm = std::sqrt(Dot(threadPool, residual, residual) / count);
+    lastStats.initialResidual = residualNorm;
+
+    double threshold = tolerance * lastStats.rhsNorm;
+    int iterations = 0;
+    if (residualNorm > threshold && maxIterations > 0) {
+        const Field<Scalar>& z = Precondition(threadPool, residual);
+        std::copy(z.begin(), z.end(), direction.begin());
+        double residualDotZ = Dot(threadPool, residual, z);
+        while (iterations < maxIterations) {
+            ApplyOperator(threadPool, finest, direction, product);
+            double curvature = Dot(threadPool, direction, product);
+            if (!(curvature > 0.0)) {
+                break;
+            }
+            Scalar alpha = Scalar(residualDotZ / curvature);
+            ForEachUnknown(threadPool, 0, count, [&](int k) {
+                values[k] += alpha * direction[k];
+                previousResidual[k] = residual[k];
+                residual[k] -= alpha * product[k];
+            });
+            iterations++;
+
+            residualNorm = std::sqrt(Dot(threadPool, residual, residual) / count);
+            if (residualNorm <= threshold || iterations == maxIterations) {
+                break;
+            }
+
+            // Polak-Ribiere form of beta, as in MultigridSolver
+            const Field<Scalar>& zNext = Precondition(threadPool, residual);
+            double nextResidualDotZ = Dot(threadPool, residual, zNext);
+            double beta = (nextResidualDotZ - Dot(threadPool, previousResidual, zNext)) / residualDotZ;
+            residualDotZ = nextResidualDotZ;
+            Scalar scalarBeta = Scalar(std::max(beta, 0.0));
+            ForEachUnknown(threadPool, 0, count, [&](int k) {
+                direction[k] = zNext[k] + scalarBeta * direction[k];
+            });
+        }
+    }
+    lastStats.iterations = iterations;
+    lastStats.finalResidual = residualNorm;
+
+    // The pressure of every region is only defined up to a constant. Pin their means to zero so the warm start does
+    // not drift.
+    RemoveRegionMeans(values);
+    ForEachUnknown(threadPool, 0, count, [&](int k) {
+        solution[cells[k]] = values[k];
+        p[cells[k]] = values[k];
+    });
+    for (size_t e = 0; e < edgeCells.size(); e++) {
+        Scalar sum = 0;
+        for (int n = edgeBegin[e]; n < edgeBegin[e + 1]; n++) {
+            sum += values[edgeNeighbors[n]];
+        }
+        p[edgeCells[e]] = sum / Scalar(edgeBegin[e + 1] - edgeBegin[e]);
+    }
+    return iterations;
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::SetTolerance(double relativeTolerance)
+{
+    tolerance = relativeTolerance;
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::SetMaxIterations(int iterations)
+{
+    maxIterations = iterations;
+}
+
+template <typename Scalar>
+void TilePressureSolver<Scalar>::ResetInitialGuess()
+{
+    std::fill(solution.begin(), solution.end(), Scalar(0));
+}
+
+template <typename Scalar>
+int TilePressureSolver<Scalar>::GetUnknownCount() const
+{
+    return levels[0].count;
+}
+
+template <typename Scalar>
+const SolveStats& TilePressureSolver<Scalar>::GetLastStats() const
+{
+    return lastStats;
+}
+
+template class TilePressureSolver<float>;
+template class TilePressureSolver<double>;
@@ -0,0 +1,80 @@
+#include "sourcebatch.h"
+
+namespace {
+
+// Adds the values of a footprint, times strength, to a dense grid
+template <typename Scalar>
+void Accumulate(std::vector<Scalar>& grid, const SourceFootprint<Scalar>& footprint, double strength)
+{
+    if (strength == 0) {
+        return;
+    }
+    const Scalar* values = footprint.GetValues().data();
+    for (const typename SourceFootprint<Scalar>::Span& span : footprint.GetSpans()) {
+        for (int k = 0; k < span.length; ++k) {
+            grid[span.start + k] += Scalar(strength * values[span.offset + k]);
+        }
+    }
+}
+
+}
+
+template <typename Scalar>
+SourceBatch<Scalar>::SourceBatch() :
+    density(), horizontalVelocity(), verticalVelocity(), sourceCount(0)
+{}
+
+template <typename Scalar>
+SourceBatch<Scalar>::SourceBatch(unsigned int N, unsigned int M, const SourceRegistry<Scalar>& sources) :
+    density(), horizontalVelocity(), verticalVelocity(), sourceCount(0)
+{
+    // Overlapping sources are summed on a dense grid, which is then compressed back into runs. This runs once per
+    // scene activation, which already clears grids of the same size.
+    std::vector<Scalar> grid(GridSize(N, M), Scalar(0));
+    for (const std::unique_ptr<DensitySource<Scalar>>& densSource : sources.GetDensitySources()) {
+        if (densSource->IsStatic()) {
+            Accumulate(grid, densSource->GetSource(), densSource->GetStrength());
+            sourceCount++;
+        }
+    }
+    density = SourceFootprint<Scalar>(N, M, grid);
+
+    std::vector<Scalar> vGrid(GridSize(N, M), Scalar(0));
+    grid.assign(GridSize(N, M), Scalar(0));
+    for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : sources.GetVelocitySources()) {
+        if (velSource->IsStatic()) {
+            Accumulate(grid, velSource->GetHorizontalVelocitySource(), velSource->GetStrength().x);
+            Accumulate(vGrid, velSource->GetVerticalVelocitySource(), velSource->GetStrength().y);
+            sourceCount++;
+        }
+    }
+    horizontalVelocity = SourceFootprint<Scalar>(N, M, grid);
+    verticalVelocity = SourceFootprint<Scalar>(N, M, vGrid);
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& SourceBatch<Scalar>::GetDensity() const
+{
+    return density;
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& SourceBatch<Scalar>::GetHorizontalVelocity() const
+{
+    return horizontalVelocity;
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& SourceBatch<Scalar>::GetVerticalVelocity() const
+{
+    return verticalVelocity;
+}
+
+template <typename Scalar>
+size_t SourceBatch<Scalar>::GetSourceCount() const
+{
+    return sourceCount;
+}
+
+template class SourceBatch<float>;
+template class SourceBatch<double>;
@@ -0,0 +1,64 @@
+#include "sourcefootprint.h"
+
+template <typename Scalar>
+SourceFootprint<Scalar>::SourceFootprint() :
+    spans(), values()
+{}
+
+template <typename Scalar>
+SourceFootprint<Scalar>::SourceFootprint(unsigned int N, unsigned int M, const std::vector<Scalar>& grid) :
+    spans(), values()
+{
+    for (int j = 0; j <= (int)M + 1; ++j) {
+        int i = 0;
+        while (i <= (int)N + 1) {
+            if (grid[IX(i, j)] == Scalar(0)) {
+                ++i;
+                continue;
+            }
+            Span span = { IX(i, j), 0, (int)values.size() };
+            for (; i <= (int)N + 1 && grid[IX(i, j)] != Scalar(0); ++i) {
+                values.push_back(grid[IX(i, j)]);
+                span.length++;
+            }
+            spans.push_back(span);
+        }
+    }
+}
+
+template <typename Scalar>
+void SourceFootprint<Scalar>::AddRun(unsigned int N, int iBegin, int iEnd, int j, Scalar value)
+{
+    AddSpan(IX(iBegin, j), iEnd - iBegin, value);
+}
+
+template <typename Scalar>
+void SourceFootprint<Scalar>::AddSpan(int start, int length, Scalar value)
+{
+    if (length <= 0 || value == Scalar(0)) {
+        return;
+    }
+    spans.push_back({ start, length, (int)values.size() });
+    values.insert(values.end(), size_t(length), value);
+}
+
+template <typename Scalar>
+const std::vector<typename SourceFootprint<Scalar>::Span>& SourceFootprint<Scalar>::GetSpans() const
+{
+    return spans;
+}
+
+template <typename Scalar>
+const std::vector<Scalar>& SourceFootprint<Scalar>::GetValues() const
+{
+    return values;
+}
+
+template <typename Scalar>
+size_t SourceFootprint<Scalar>::GetCellCount() const
+{
+    return values.size();
+}
+
+template class SourceFootprint<float>;
+template class SourceFootprint<double>;
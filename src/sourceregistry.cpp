@@ -0,0 +1,76 @@
+#include "sourceregistry.h"
+
+template <typename Scalar>
+SourceRegistry<Scalar>::SourceRegistry() :
+    densSources(), velSources()
+{}
+
+template <typename Scalar>
+SourceRegistry<Scalar>::SourceRegistry(const SourceRegistry& other) :
+    densSources(), velSources()
+{
+    *this = other;
+}
+
+template <typename Scalar>
+SourceRegistry<Scalar>& SourceRegistry<Scalar>::operator=(const SourceRegistry& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    Clear();
+    densSources.reserve(other.densSources.size());
+    for (const std::unique_ptr<DensitySource<Scalar>>& densSource : other.densSources) {
+        densSources.push_back(densSource->Clone());
+    }
+    velSources.reserve(other.velSources.size());
+    for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : other.velSources) {
+        velSources.push_back(velSource->Clone());
+    }
+    return *this;
+}
+
+template <typename Scalar>
+void SourceRegistry<Scalar>::AddDensitySource(std::unique_ptr<DensitySource<Scalar>> source)
+{
+    densSources.push_back(std::move(source));
+}
+
+template <typename Scalar>
+void SourceRegistry<Scalar>::AddVelocitySource(std::unique_ptr<VelocitySource<Scalar>> source)
+{
+    velSources.push_back(std::move(source));
+}
+
+template <typename Scalar>
+void SourceRegistry<Scalar>::Clear()
+{
+    densSources.clear();
+    velSources.clear();
+}
+
+template <typename Scalar>
+void SourceRegistry<Scalar>::Tick(double dt)
+{
+    for (const std::unique_ptr<DensitySource<Scalar>>& densSource : densSources) {
+        densSource->Tick(dt);
+    }
+    for (const std::unique_ptr<VelocitySource<Scalar>>& velSource : velSources) {
+        velSource->Tick(dt);
+    }
+}
+
+template <typename Scalar>
+const std::vector<std::unique_ptr<DensitySource<Scalar>>>& SourceRegistry<Scalar>::GetDensitySources() const
+{
+    return densSources;
+}
+
+template <typename Scalar>
+const std::vector<std::unique_ptr<VelocitySource<Scalar>>>& SourceRegistry<Scalar>::GetVelocitySources() const
+{
+    return velSources;
+}
+
+template class SourceRegistry<float>;
+template class SourceRegistry<double>;
@@ -0,0 +1,48 @@
+#include "spheresource.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename Scalar>
+SphereSource<Scalar>::SphereSource(unsigned int N, const glm::ivec3& center, double radius, double density,
+    const glm::dvec3& velocity) :
+    VolumeSource<Scalar>(N, density, velocity),
+    center(center), radius(radius)
+{
+    this->footprint = std::make_shared<const SourceFootprint<Scalar>>(Rasterize(N, center, radius, Scalar(1)));
+}
+
+template <typename Scalar>
+SourceFootprint<Scalar> SphereSource<Scalar>::Rasterize(unsigned int N, const glm::ivec3& center, double radius,
+    Scalar value)
+{
+    BrickLayout layout(N);
+    SourceFootprint<Scalar> footprint;
+    int n = (int)N;
+    int reach = (int)std::ceil(radius);
+    // Every row of the ball is a single run, whose half width follows from the distance of the row to the center
+    for (int k = std::max(1, center.z - reach); k <= std::min(n, center.z + reach); ++k) {
+        for (int j = std::max(1, center.y - reach); j <= std::min(n, center.y + reach); ++j) {
+            double dy = j - center.y;
+            double dz = k - center.z;
+            double remaining = radius * radius - dy * dy - dz * dz;
+            if (remaining <= 0.0) {
+                continue;
+            }
+            int halfWidth = (int)std::ceil(std::sqrt(remaining)) - 1;
+            int iBegin = std::max(1, center.x - halfWidth);
+            int iEnd = std::min(n + 1, center.x + halfWidth + 1);
+            VolumeSource<Scalar>::AddRow(footprint, layout, iBegin, iEnd, j, k, value);
+        }
+    }
+    return footprint;
+}
+
+template <typename Scalar>
+std::unique_ptr<VolumeSource<Scalar>> SphereSource<Scalar>::Clone() const
+{
+    return std::make_unique<SphereSource<Scalar>>(*this);
+}
+
+template class SphereSource<float>;
+template class SphereSource<double>;
@@ -0,0 +1,100 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+    workers(), mutex(), wakeCondition(), doneCondition(), job(nullptr), chunks(),
+    generation(0), pendingWorkers(0), stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    chunks.resize(threadCount);
+    for (unsigned int workerIndex = 1; workerIndex < threadCount; ++workerIndex) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, workerIndex);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+    return (unsigned int)workers.size() + 1;
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int minChunkSize, const std::function<void(int, int)>& body)
+{
+    int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+
+    // Only wake as many threads as there are chunks worth splitting off
+    int chunkCount = std::min<int>(GetThreadCount(), std::max(1, count / std::max(1, minChunkSize)));
+    if (chunkCount == 1) {
+        body(begin, end);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int chunk = 0; chunk < (int)chunks.size(); ++chunk) {
+            // Workers past chunkCount receive an empty range and return immediately
+            int chunkBegin = begin + (int)((long long)count * std::min(chunk, chunkCount) / chunkCount);
+            int chunkEnd = begin + (int)((long long)count * std::min(chunk + 1, chunkCount) / chunkCount);
+            chunks[chunk] = { chunkBegin, chunkEnd };
+        }
+        job = &body;
+        pendingWorkers = (unsigned int)workers.size();
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    // The calling thread takes the first chunk instead of idling
+    body(chunks[0].first, chunks[0].second);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return pendingWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::WorkerLoop(unsigned int workerIndex)
+{
+    unsigned long long seenGeneration = 0;
+    while (true) {
+        const std::function<void(int, int)>* currentJob;
+        std::pair<int, int> chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            currentJob = job;
+            chunk = chunks[workerIndex];
+        }
+
+        if (chunk.first < chunk.second) {
+            (*currentJob)(chunk.first, chunk.second);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pendingWorkers == 0) {
+                doneCondition.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,290 @@
+#include "tileactivity.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename Scalar>
+TileActivity<Scalar>::TileActivity(unsigned int N, unsigned int M) :
+    N((int)N), M((int)M), tilesX(((int)N + TILE_SIZE - 1) / TILE_SIZE), tilesY(((int)M + TILE_SIZE - 1) / TILE_SIZE),
+    occupied(), active(), activeTiles(0), columns(), tileRowColumns(), runs(), rowRuns(M + 2, 0)
+{
+    MarkAll();
+    active = occupied;
+    activeTiles = GetTileCount();
+    for (int ty = 0; ty < tilesY; ty++) {
+        tileRowColumns.push_back((int)columns.size());
+        columns.push_back({ 1, this->N + 1 });
+    }
+    tileRowColumns.push_back((int)columns.size());
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::GetTileCells(int t, int n, bool withBoundary, int& begin, int& end) const
+{
+    begin = withBoundary && t == 0 ? 0 : 1 + t * TILE_SIZE;
+    end = withBoundary && (t + 1) * TILE_SIZE >= n ? n + 2 : std::min(n, (t + 1) * TILE_SIZE) + 1;
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::MarkCells(int iBegin, int iEnd, int j)
+{
+    // Sources may reach into the boundary, which belongs to the tiles along the edge
+    iBegin = std::max(iBegin, 1);
+    iEnd = std::min(iEnd, N + 1);
+    j = std::clamp(j, 1, M);
+    if (iBegin >= iEnd) {
+        return;
+    }
+    int ty = (j - 1) / TILE_SIZE;
+    for (int tx = (iBegin - 1) / TILE_SIZE; tx <= (iEnd - 2) / TILE_SIZE; tx++) {
+        occupied[ty * tilesX + tx] = 1;
+    }
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::MarkFootprint(const SourceFootprint<Scalar>& footprint)
+{
+    int stride = GridStride(N);
+    for (const typename SourceFootprint<Scalar>::Span& span : footprint.GetSpans()) {
+        int i = span.start % stride;
+        MarkCells(i, i + span.length, span.start / stride);
+    }
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::MarkAll()
+{
+    occupied.assign(size_t(tilesX) * tilesY, 1);
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::Clear()
+{
+    occupied.assign(size_t(tilesX) * tilesY, 0);
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::Update(const ObstacleMask<Scalar>& obstacleMask, bool periodic)
+{
+    // Grow every occupied tile by its eight neighbors
+    active.assign(occupied.size(), 0);
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (!occupied[ty * tilesX + tx]) {
+                continue;
+            }
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = tx + dx;
+                    int ny = ty + dy;
+                    if (periodic) {
+                        nx = (nx + tilesX) % tilesX;
+                        ny = (ny + tilesY) % tilesY;
+                    }
+                    else if (nx < 0 || nx >= tilesX || ny < 0 || ny >= tilesY) {
+                        continue;
+                    }
+                    active[ny * tilesX + nx] = 1;
+                }
+            }
+        }
+    }
+    activeTiles = (int)std::count(active.begin(), active.end(), uint8_t(1));
+
+    // Neighboring active tiles of a row of tiles form one span of columns
+    columns.clear();
+    tileRowColumns.assign(tilesY + 1, 0);
+    for (int ty = 0; ty < tilesY; ty++) {
+        tileRowColumns[ty] = (int)columns.size();
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (!active[ty * tilesX + tx]) {
+                continue;
+            }
+            int begin, end, unused;
+            GetTileCells(tx, N, false, begin, unused);
+            while (tx + 1 < tilesX && active[ty * tilesX + tx + 1]) {
+                tx++;
+            }
+            GetTileCells(tx, N, false, unused, end);
+            columns.push_back({ begin, end });
+        }
+    }
+    tileRowColumns[tilesY] = (int)columns.size();
+
+    // The fluid cells of the active tiles are where the fluid runs and the spans of active columns overlap
+    runs.clear();
+    rowRuns.assign(M + 2, 0);
+    for (int j = 1; j <= M; j++) {
+        rowRuns[j] = (int)runs.size();
+        const Run* fluid = obstacleMask.RunsBegin(j);
+        const Run* span = ColumnsBegin(j);
+        while (fluid != obstacleMask.RunsEnd(j) && span != ColumnsEnd(j)) {
+            int begin = std::max(fluid->begin, span->begin);
+            int end = std::min(fluid->end, span->end);
+            if (begin < end) {
+                runs.push_back({ begin, end });
+            }
+            if (fluid->end < span->end) {
+                ++fluid;
+            }
+            else {
+                ++span;
+            }
+        }
+    }
+    rowRuns[M + 1] = (int)runs.size();
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::UpdateOccupancy(ThreadPool& threadPool, std::initializer_list<WatchedField> fields)
+{
+    threadPool.ParallelFor(0, tilesY, 1, [&](int tyBegin, int tyEnd) {
+        for (int ty = tyBegin; ty < tyEnd; ty++) {
+            int jBegin, jEnd;
+            GetTileCells(ty, M, false, jBegin, jEnd);
+            for (int tx = 0; tx < tilesX; tx++) {
+                int tile = ty * tilesX + tx;
+                // Tiles outside the active ones are zero
+                if (!active[tile]) {
+                    occupied[tile] = 0;
+                    continue;
+                }
+                int iBegin, iEnd;
+                GetTileCells(tx, N, false, iBegin, iEnd);
+                auto Holds = [&](const Field<Scalar>& x, Scalar threshold) {
+                    for (int j = jBegin; j < jEnd; j++) {
+                        for (int i = iBegin; i < iEnd; i++) {
+                            if (std::abs(x[IX(i, j)]) > threshold) {
+                                return true;
+                            }
+                        }
+                    }
+                    return false;
+                };
+                occupied[tile] = 0;
+                for (const WatchedField& watched : fields) {
+                    if (Holds(*watched.field, watched.threshold)) {
+                        occupied[tile] = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::ClearIdleTiles(std::initializer_list<Field<Scalar>*> fields) const
+{
+    for (int ty = 0; ty < tilesY; ty++) {
+        int jBegin, jEnd;
+        GetTileCells(ty, M, true, jBegin, jEnd);
+        for (int tx = 0; tx < tilesX; tx++) {
+            int tile = ty * tilesX + tx;
+            if (!active[tile] || occupied[tile]) {
+                continue;
+            }
+            int iBegin, iEnd;
+            GetTileCells(tx, N, true, iBegin, iEnd);
+            for (Field<Scalar>* field : fields) {
+                for (int j = jBegin; j < jEnd; j++) {
+                    std::fill(field->data() + IX(iBegin, j), field->data() + IX(iEnd, j), Scalar(0));
+                }
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+bool TileActivity<Scalar>::MarkHolding(ThreadPool& threadPool, std::initializer_list<WatchedField> fields)
+{
+    // Every row of tiles owns a slot, so the rows can be scanned in parallel
+    std::vector<uint8_t> rowMarked(tilesY, 0);
+    threadPool.ParallelFor(0, tilesY, 1, [&](int tyBegin, int tyEnd) {
+        for (int ty = tyBegin; ty < tyEnd; ty++) {
+            int jBegin, jEnd;
+            GetTileCells(ty, M, false, jBegin, jEnd);
+            for (int tx = 0; tx < tilesX; tx++) {
+                int tile = ty * tilesX + tx;
+                if (active[tile]) {
+                    continue;
+                }
+                int iBegin, iEnd;
+                GetTileCells(tx, N, false, iBegin, iEnd);
+                auto Holds = [&](const Field<Scalar>& x, Scalar threshold) {
+                    for (int j = jBegin; j < jEnd; j++) {
+                        for (int i = iBegin; i < iEnd; i++) {
+                            if (std::abs(x[IX(i, j)]) > threshold) {
+                                return true;
+                            }
+                        }
+                    }
+                    return false;
+                };
+                for (const WatchedField& watched : fields) {
+                    if (Holds(*watched.field, watched.threshold)) {
+                        occupied[tile] = 1;
+                        rowMarked[ty] = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+    return std::find(rowMarked.begin(), rowMarked.end(), uint8_t(1)) != rowMarked.end();
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::ClearInactiveTiles(std::initializer_list<Field<Scalar>*> fields) const
+{
+    for (int ty = 0; ty < tilesY; ty++) {
+        int jBegin, jEnd;
+        GetTileCells(ty, M, true, jBegin, jEnd);
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (active[ty * tilesX + tx]) {
+                continue;
+            }
+            int iBegin, iEnd;
+            GetTileCells(tx, N, true, iBegin, iEnd);
+            for (Field<Scalar>* field : fields) {
+                for (int j = jBegin; j < jEnd; j++) {
+                    std::fill(field->data() + IX(iBegin, j), field->data() + IX(iEnd, j), Scalar(0));
+                }
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+void TileActivity<Scalar>::CopyInactiveTiles(Field<Scalar>& target, const Field<Scalar>& source) const
+{
+    for (int ty = 0; ty < tilesY; ty++) {
+        int jBegin, jEnd;
+        GetTileCells(ty, M, true, jBegin, jEnd);
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (active[ty * tilesX + tx]) {
+                continue;
+            }
+            int iBegin, iEnd;
+            GetTileCells(tx, N, true, iBegin, iEnd);
+            for (int j = jBegin; j < jEnd; j++) {
+                std::copy(source.data() + IX(iBegin, j), source.data() + IX(iEnd, j), target.data() + IX(iBegin, j));
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+int TileActivity<Scalar>::GetActiveTileCount() const
+{
+    return activeTiles;
+}
+
+template <typename Scalar>
+int TileActivity<Scalar>::GetTileCount() const
+{
+    return tilesX * tilesY;
+}
+
+template class TileActivity<float>;
+template class TileActivity<double>;
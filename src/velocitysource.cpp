@@ -1,26 +1,60 @@
 #include "velocitySource.h"
 
-VelocitySource::VelocitySource(unsigned int N, double uVel, double vVel):
-    N(N), u((N + 2)* (N + 2), 0.0), v((N + 2)* (N + 2), 0.0), 
-    uVel(uVel), vVel(vVel)
+template <typename Scalar>
+VelocitySource<Scalar>::VelocitySource(unsigned int N, unsigned int M, double uVel, double vVel):
+    N(N), M(M), u(std::make_shared<const SourceFootprint<Scalar>>()), v(std::make_shared<const SourceFootprint<Scalar>>()),
+    uVel(uVel), vVel(vVel), strength(1.0)
 {}
 
-VelocitySource::VelocitySource(unsigned int N, std::vector<double> uVec, std::vector<double> vVec):
-    N(N), u(uVec), v(vVec), uVel(0), vVel(0)
+template <typename Scalar>
+VelocitySource<Scalar>::VelocitySource(unsigned int N, unsigned int M, std::vector<Scalar> uVec,
+    std::vector<Scalar> vVec):
+    N(N), M(M), u(std::make_shared<const SourceFootprint<Scalar>>(N, M, uVec)),
+    v(std::make_shared<const SourceFootprint<Scalar>>(N, M, vVec)), uVel(0), vVel(0),
+    strength(1.0)
 {}
 
+template <typename Scalar>
+std::unique_ptr<VelocitySource<Scalar>> VelocitySource<Scalar>::Clone() const
+{
+    return std::make_unique<VelocitySource<Scalar>>(*this);
+}
 
-void VelocitySource::Tick()
+template <typename Scalar>
+void VelocitySource<Scalar>::Tick(double dt)
 {
     return;
 }
 
-const std::vector<double>& VelocitySource::GetHorizontalVelocitySource() const
+template <typename Scalar>
+bool VelocitySource<Scalar>::IsStatic() const
+{
+    return true;
+}
+
+template <typename Scalar>
+bool VelocitySource<Scalar>::IsProcedural() const
+{
+    return false;
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& VelocitySource<Scalar>::GetHorizontalVelocitySource() const
+{
+    return *u; 
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& VelocitySource<Scalar>::GetVerticalVelocitySource() const
 {
-    return u; 
+    return *v; 
 }
 
-const std::vector<double>& VelocitySource::GetVerticalVelocitySource() const
+template <typename Scalar>
+const glm::dvec2& VelocitySource<Scalar>::GetStrength() const
 {
-    return v; 
+    return strength;
 }
+
+template class VelocitySource<float>;
+template class VelocitySource<double>;
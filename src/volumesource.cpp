@@ -0,0 +1,52 @@
+#include "volumesource.h"
+
+#include <algorithm>
+
+template <typename Scalar>
+VolumeSource<Scalar>::VolumeSource(unsigned int N, double density, const glm::dvec3& velocity) :
+    N(N), footprint(std::make_shared<const SourceFootprint<Scalar>>()), density(density), velocity(velocity)
+{}
+
+template <typename Scalar>
+void VolumeSource<Scalar>::AddRow(SourceFootprint<Scalar>& footprint, const BrickLayout& layout, int iBegin,
+    int iEnd, int j, int k, Scalar value)
+{
+    // The cells of a row are only consecutive in memory up to the face of their brick
+    while (iBegin < iEnd) {
+        int brickEnd = std::min(iEnd, (iBegin / BRICK_EDGE + 1) * BRICK_EDGE);
+        footprint.AddSpan(layout.Index(iBegin, j, k), brickEnd - iBegin, value);
+        iBegin = brickEnd;
+    }
+}
+
+template <typename Scalar>
+std::unique_ptr<VolumeSource<Scalar>> VolumeSource<Scalar>::Clone() const
+{
+    return std::make_unique<VolumeSource<Scalar>>(*this);
+}
+
+template <typename Scalar>
+void VolumeSource<Scalar>::Tick(double dt)
+{
+}
+
+template <typename Scalar>
+const SourceFootprint<Scalar>& VolumeSource<Scalar>::GetFootprint() const
+{
+    return *footprint;
+}
+
+template <typename Scalar>
+double VolumeSource<Scalar>::GetDensity() const
+{
+    return density;
+}
+
+template <typename Scalar>
+const glm::dvec3& VolumeSource<Scalar>::GetVelocity() const
+{
+    return velocity;
+}
+
+template class VolumeSource<float>;
+template class VolumeSource<double>;
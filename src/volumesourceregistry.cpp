@@ -0,0 +1,56 @@
+#include "volumesourceregistry.h"
+
+template <typename Scalar>
+VolumeSourceRegistry<Scalar>::VolumeSourceRegistry() :
+    volumeSources()
+{}
+
+template <typename Scalar>
+VolumeSourceRegistry<Scalar>::VolumeSourceRegistry(const VolumeSourceRegistry& other) :
+    volumeSources()
+{
+    *this = other;
+}
+
+template <typename Scalar>
+VolumeSourceRegistry<Scalar>& VolumeSourceRegistry<Scalar>::operator=(const VolumeSourceRegistry& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    Clear();
+    volumeSources.reserve(other.volumeSources.size());
+    for (const std::unique_ptr<VolumeSource<Scalar>>& source : other.volumeSources) {
+        volumeSources.push_back(source->Clone());
+    }
+    return *this;
+}
+
+template <typename Scalar>
+void VolumeSourceRegistry<Scalar>::AddSource(std::unique_ptr<VolumeSource<Scalar>> source)
+{
+    volumeSources.push_back(std::move(source));
+}
+
+template <typename Scalar>
+void VolumeSourceRegistry<Scalar>::Clear()
+{
+    volumeSources.clear();
+}
+
+template <typename Scalar>
+void VolumeSourceRegistry<Scalar>::Tick(double dt)
+{
+    for (const std::unique_ptr<VolumeSource<Scalar>>& source : volumeSources) {
+        source->Tick(dt);
+    }
+}
+
+template <typename Scalar>
+const std::vector<std::unique_ptr<VolumeSource<Scalar>>>& VolumeSourceRegistry<Scalar>::GetSources() const
+{
+    return volumeSources;
+}
+
+template class VolumeSourceRegistry<float>;
+template class VolumeSourceRegistry<double>;